@@ -11,17 +11,167 @@
 
 using namespace polymer;
 
+//////////////////////////////
+//   Splat Instance Sorter  //
+//////////////////////////////
+
+enum class splat_sort_mode : int { gpu = 0, cpu = 1 };
+
+// Sorts the (tile << 32 | depth) instance keys written by preprocess_sort together with their gaussian
+// index payloads. Keys go into unsorted_keys()/unsorted_payloads(); after sort() the result is in
+// sorted_keys()/sorted_payloads(). Both modes ping-pong between two key/payload buffer pairs, so
+// nothing is copied back and nothing is allocated once the capacity has been reached.
+//  - gpu: LSD radix sort in compute, 8-bit digits, three dispatches per digit (radix_hist, radix_scan,
+//    radix_sort). Only the digits the keys can use are sorted and the data never leaves the device.
+//  - cpu: the buffers are persistently mapped and the parallel radix_sort runs directly on them
+//    after a fence, instead of reading back into vectors and uploading the result again. The keys
+//    are this frame's, so the CPU waits for the GPU every frame; it is a reference for the gpu mode.
+class splat_instance_sorter
+{
+    static constexpr uint32_t kWorkgroupSize = 256;
+    static constexpr uint32_t kRadixSize = 256;
+    static constexpr uint32_t kMaxGroups = 1024; // radix_scan.comp scans up to 4 entries per thread
+
+    std::unique_ptr<gl_shader_compute> hist_shader;
+    std::unique_ptr<gl_shader_compute> scan_shader;
+    std::unique_ptr<gl_shader_compute> scatter_shader;
+
+    gl_buffer keys[2];
+    gl_buffer payloads[2];
+    gl_buffer counts;
+    gl_buffer digit_totals;
+
+    uint64_t * mapped_keys[2] = { nullptr, nullptr };
+    uint32_t * mapped_payloads[2] = { nullptr, nullptr };
+
+    uint32_t capacity = 0;
+    uint32_t result = 0;
+    splat_sort_mode mode = splat_sort_mode::gpu;
+    radix_sort cpu_sorter;
+
+    static void set_uint(const gl_shader_compute & shader, const char * name, const uint32_t value)
+    {
+        glProgramUniform1ui(shader.handle(), shader.get_uniform_location(name), value);
+    }
+
+    void allocate()
+    {
+        const GLbitfield flags = (mode == splat_sort_mode::cpu) ? (GL_MAP_READ_BIT | GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT) : 0;
+        for (int i = 0; i < 2; ++i)
+        {
+            // Storage is immutable, so a new size or mode needs new buffer objects
+            keys[i] = gl_buffer();
+            payloads[i] = gl_buffer();
+            keys[i].set_buffer_storage(capacity * sizeof(uint64_t), nullptr, flags);
+            payloads[i].set_buffer_storage(capacity * sizeof(uint32_t), nullptr, flags);
+            mapped_keys[i] = flags ? static_cast<uint64_t *>(glMapNamedBufferRange(keys[i], 0, keys[i].size, flags)) : nullptr;
+            mapped_payloads[i] = flags ? static_cast<uint32_t *>(glMapNamedBufferRange(payloads[i], 0, payloads[i].size, flags)) : nullptr;
+        }
+    }
+
+public:
+
+    void load_shaders()
+    {
+        hist_shader = std::make_unique<gl_shader_compute>(read_file_text("../assets/shaders/3dgs/radix_hist.comp"));
+        scan_shader = std::make_unique<gl_shader_compute>(read_file_text("../assets/shaders/3dgs/radix_scan.comp"));
+        scatter_shader = std::make_unique<gl_shader_compute>(read_file_text("../assets/shaders/3dgs/radix_sort.comp"));
+        counts.set_buffer_data(kMaxGroups * kRadixSize * sizeof(uint32_t), nullptr, GL_DYNAMIC_COPY);
+        digit_totals.set_buffer_data(kRadixSize * sizeof(uint32_t), nullptr, GL_DYNAMIC_COPY);
+    }
+
+    void reserve(const uint32_t count, const splat_sort_mode new_mode)
+    {
+        if (count <= capacity && new_mode == mode) return;
+        capacity = std::max(count, capacity);
+        mode = new_mode;
+        allocate();
+    }
+
+    splat_sort_mode get_mode() const { return mode; }
+
+    GLuint unsorted_keys() const { return keys[0]; }
+    GLuint unsorted_payloads() const { return payloads[0]; }
+    GLuint sorted_keys() const { return keys[result]; }
+    GLuint sorted_payloads() const { return payloads[result]; }
+
+    // key_bits: how many low bits of the keys can be non-zero. first_bit: bits below it are already in
+    // order within equal higher bits, so the GPU path starts there (the CPU path sorts every byte in use).
+    void sort(const uint32_t count, const uint32_t key_bits, const uint32_t first_bit = 0)
+    {
+        result = 0;
+        if (count < 2) return;
+
+        if (mode == splat_sort_mode::cpu)
+        {
+            glMemoryBarrier(GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
+            GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {}
+            glDeleteSync(fence);
+
+            // Coherent mapping: the sorted data is visible to the following dispatches without a flush
+            result = cpu_sorter.sort_pairs(mapped_keys[0], mapped_payloads[0], mapped_keys[1], mapped_payloads[1], count) ? 1 : 0;
+            return;
+        }
+
+        // Each workgroup owns a contiguous range, a multiple of the workgroup size long
+        uint32_t groups = std::min(kMaxGroups, (count + kWorkgroupSize - 1) / kWorkgroupSize);
+        const uint32_t elements_per_group = ((count + groups - 1) / groups + kWorkgroupSize - 1) / kWorkgroupSize * kWorkgroupSize;
+        groups = (count + elements_per_group - 1) / elements_per_group;
+
+        for (const gl_shader_compute * shader : { hist_shader.get(), scatter_shader.get() })
+        {
+            set_uint(*shader, "num_elements", count);
+            set_uint(*shader, "num_groups", groups);
+            set_uint(*shader, "elements_per_group", elements_per_group);
+        }
+        set_uint(*scan_shader, "num_groups", groups);
+
+        uint32_t src = 0;
+        for (uint32_t shift = first_bit; shift < key_bits; shift += 8, src ^= 1)
+        {
+            set_uint(*hist_shader, "shift", shift);
+            set_uint(*scatter_shader, "shift", shift);
+
+            hist_shader->bind_ssbo(0, keys[src]);
+            hist_shader->bind_ssbo(1, counts);
+            hist_shader->dispatch_and_barrier(groups, 1, 1, GL_SHADER_STORAGE_BARRIER_BIT);
+
+            scan_shader->bind_ssbo(1, counts);
+            scan_shader->bind_ssbo(2, digit_totals);
+            scan_shader->dispatch_and_barrier(kRadixSize, 1, 1, GL_SHADER_STORAGE_BARRIER_BIT);
+
+            scatter_shader->bind_ssbo(0, keys[src]);
+            scatter_shader->bind_ssbo(1, counts);
+            scatter_shader->bind_ssbo(2, digit_totals);
+            scatter_shader->bind_ssbo(3, payloads[src]);
+            scatter_shader->bind_ssbo(4, keys[src ^ 1]);
+            scatter_shader->bind_ssbo(5, payloads[src ^ 1]);
+            scatter_shader->dispatch_and_barrier(groups, 1, 1, GL_SHADER_STORAGE_BARRIER_BIT);
+        }
+        result = src;
+    }
+};
+
 /////////////////////////////////
 //   Gaussian Splat Renderer   //
 /////////////////////////////////
 
 class gaussian_splat_renderer
 {
+    // Persistently mapped copy of the depths, fenced once preprocess has written them
+    struct depth_readback
+    {
+        gl_buffer buffer;
+        const float * depths = nullptr;
+        GLsync fence = nullptr;
+    };
+    static constexpr uint32_t kDepthReadbacks = 3;
 
 public:
 
     gaussian_splat_renderer() = default;
-    ~gaussian_splat_renderer() = default;
+    ~gaussian_splat_renderer() { release_depth_readbacks(); }
 
     void initialize(uint32_t width, uint32_t height)
     {
@@ -43,19 +193,43 @@ public:
         }
     }
 
-    void set_scene(const gaussian_splat_scene & scene)
+    // Accepts gaussian_splat_scene or compressed_gaussian_splats; splats are expanded to the shader
+    // layout directly in the mapped vertex buffer, so no CPU copy of the vertices is kept
+    template <typename splats_t>
+    void set_scene(const splats_t & splats)
     {
-        scene_ = scene;
-        num_gaussians_ = static_cast<uint32_t>(scene_.vertices.size());
+        num_gaussians_ = static_cast<uint32_t>(splats.size());
+        sh_degree_ = splats.sh_degree;
         if (num_gaussians_ == 0) return;
 
         const size_t vertex_size = sizeof(gaussian_vertex);
         const size_t attr_size= 64;
-        vertex_buffer_.set_buffer_data(num_gaussians_ * vertex_size, scene_.vertices.data(), GL_STATIC_DRAW);
+        vertex_buffer_.set_buffer_data(num_gaussians_ * vertex_size, nullptr, GL_STATIC_DRAW);
+        void * mapped = glMapNamedBufferRange(vertex_buffer_, 0, vertex_buffer_.size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        pack_gaussian_vertices(splats, static_cast<gaussian_vertex *>(mapped));
+        glUnmapNamedBuffer(vertex_buffer_);
+
         cov3d_buffer_.set_buffer_data(num_gaussians_ * 6 * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
         vertex_attr_buffer_.set_buffer_data(num_gaussians_ * attr_size, nullptr, GL_DYNAMIC_DRAW);
         tile_overlap_buffer_.set_buffer_data(num_gaussians_ * sizeof(uint32_t), nullptr, GL_DYNAMIC_DRAW);
         prefix_sum_buffer_.set_buffer_data(num_gaussians_ * sizeof(uint32_t), nullptr, GL_DYNAMIC_DRAW);
+        prefix_block_sums_buffer_.set_buffer_data(prefix_sum_blocks() * sizeof(uint32_t), nullptr, GL_DYNAMIC_DRAW);
+
+        // Depths written by preprocess go to the oldest readback of the ring when it is free, and to the
+        // device-only depth buffer otherwise. The order is uploaded like any other buffer update, so
+        // the driver keeps it from changing under frames still in flight.
+        release_depth_readbacks();
+        const GLbitfield readback_flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        for (depth_readback & r : depth_readbacks_)
+        {
+            r.buffer = gl_buffer();
+            r.buffer.set_buffer_storage(num_gaussians_ * sizeof(float), nullptr, readback_flags);
+            r.depths = static_cast<const float *>(glMapNamedBufferRange(r.buffer, 0, r.buffer.size, readback_flags));
+        }
+        depth_buffer_.set_buffer_data(num_gaussians_ * sizeof(float), nullptr, GL_DYNAMIC_COPY);
+        order_buffer_.set_buffer_data(num_gaussians_ * sizeof(uint32_t), nullptr, GL_DYNAMIC_DRAW);
+        depth_order_.reset();
+        has_depth_order_ = false;
 
         recreate_tile_buffers();
         recreate_sort_buffers();
@@ -68,7 +242,13 @@ public:
         auto start_time = std::chrono::high_resolution_clock::now();
 
         precompute_cov3d(scale_modifier);
-        preprocess(cam, sh_degree); // project, cull, compute 2D cov, SH
+        if (temporal_coherence_) update_depth_order();
+
+        depth_readback * readback = temporal_coherence_ ? free_depth_readback() : nullptr;
+        preprocess(cam, sh_degree, readback ? readback->buffer : depth_buffer_); // project, cull, compute 2D cov, SH
+        if (readback) queue_depth_readback(*readback);
+
+        use_depth_order_ = temporal_coherence_ && has_depth_order_;
         compute_prefix_sum();
 
         uint32_t total_instances = 0;
@@ -98,7 +278,7 @@ public:
         }
 
         generate_sort_keys(total_instances);
-        sort_instances_cpu(total_instances); // workaround until gpu radix support is implemented
+        sort_instances(total_instances);
         compute_tile_boundaries(total_instances);
         render_tiles();
 
@@ -106,6 +286,22 @@ public:
         last_frame_time_ms_ = std::chrono::duration<float, std::milli>(end_time - start_time).count();
     }
 
+    void set_sort_mode(const splat_sort_mode mode)
+    {
+        sort_mode_ = mode;
+        if (max_sort_instances_ > 0) sorter_.reserve(max_sort_instances_, sort_mode_);
+    }
+
+    // Emit instances in a per-gaussian depth order that is kept across frames and repaired incrementally,
+    // so the instance sort only has to order tiles. Depths are read back through a ring of fenced buffers
+    // that is polled without waiting, so the order trails the view by the frames the GPU is behind (at
+    // most kDepthReadbacks), and the first frames after a new scene fully sort the instances.
+    void set_temporal_coherence(const bool enabled) { temporal_coherence_ = enabled; }
+
+    // Disorder of last frame's depth order when it was reused, and whether it had to be sorted from scratch
+    float get_depth_order_disorder() const { return depth_order_.disorder(); }
+    bool get_depth_order_full_sort() const { return depth_order_.full_sort(); }
+
     GLuint get_output_texture() const { return output_texture_; }
     uint32_t get_visible_count() const { return visible_gaussians_; }
     float get_frame_time_ms() const { return last_frame_time_ms_; }
@@ -120,6 +316,7 @@ private:
         preprocess_sort_shader_ = std::make_unique<gl_shader_compute>(read_file_text("../assets/shaders/3dgs/preprocess_sort.comp"));
         tile_boundary_shader_ = std::make_unique<gl_shader_compute>(read_file_text("../assets/shaders/3dgs/tile_boundary.comp"));
         render_shader_ = std::make_unique<gl_shader_compute>(read_file_text("../assets/shaders/3dgs/render.comp"));
+        sorter_.load_shaders();
     }
 
     void create_output_texture()
@@ -141,10 +338,7 @@ private:
     void recreate_sort_buffers()
     {
         if (max_sort_instances_ == 0) max_sort_instances_ = 1024 * 1024;
-        sort_keys_.resize(max_sort_instances_);
-        sort_payloads_.resize(max_sort_instances_);
-        sort_keys_buffer_.set_buffer_data(max_sort_instances_ * sizeof(uint64_t), nullptr, GL_DYNAMIC_DRAW);
-        sort_payloads_buffer_.set_buffer_data(max_sort_instances_ * sizeof(uint32_t), nullptr, GL_DYNAMIC_DRAW);
+        sorter_.reserve(max_sort_instances_, sort_mode_);
     }
 
     void precompute_cov3d(float scale_modifier)
@@ -169,12 +363,13 @@ private:
         glDeleteBuffers(1, &ubo);
     }
 
-    void preprocess(const perspective_camera & cam, uint32_t sh_degree)
+    void preprocess(const perspective_camera & cam, uint32_t sh_degree, GLuint depths)
     {
         preprocess_shader_->bind_ssbo(0, vertex_buffer_);
         preprocess_shader_->bind_ssbo(1, cov3d_buffer_);
         preprocess_shader_->bind_ssbo(3, vertex_attr_buffer_);
         preprocess_shader_->bind_ssbo(4, tile_overlap_buffer_);
+        preprocess_shader_->bind_ssbo(5, depths);
 
         float4x4 view_mat = cam.get_view_matrix();
         float4x4 proj_mat = cam.get_projection_matrix(static_cast<float>(width_) / height_);
@@ -202,7 +397,7 @@ private:
         params.height = height_;
         params.tan_fovx = tan_fovx;
         params.tan_fovy = tan_fovy;
-        params.sh_degree = std::min(sh_degree, scene_.sh_degree);
+        params.sh_degree = std::min(sh_degree, sh_degree_);
         params.num_gaussians = num_gaussians_;
 
         GLuint ubo;
@@ -216,38 +411,98 @@ private:
         glDeleteBuffers(1, &ubo);
     }
 
-    void compute_prefix_sum()
+    // The oldest readback of the ring, if the CPU is done with it
+    depth_readback * free_depth_readback()
     {
-        // CPU-based prefix sum for correctness (GPU version has race conditions)
-        std::vector<uint32_t> tile_overlaps(num_gaussians_);
-        glGetNamedBufferSubData(tile_overlap_buffer_, 0, num_gaussians_ * sizeof(uint32_t), tile_overlaps.data());
+        depth_readback & r = depth_readbacks_[next_readback_];
+        return r.fence ? nullptr : &r;
+    }
+
+    void queue_depth_readback(depth_readback & r)
+    {
+        glMemoryBarrier(GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
+        r.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        next_readback_ = (next_readback_ + 1) % kDepthReadbacks;
+    }
 
-        // Inclusive prefix sum
-        uint32_t running_sum = 0;
-        for (uint32_t i = 0; i < num_gaussians_; i++)
+    void release_depth_readbacks()
+    {
+        for (depth_readback & r : depth_readbacks_)
         {
-            running_sum += tile_overlaps[i];
-            tile_overlaps[i] = running_sum;
+            if (r.fence) glDeleteSync(r.fence);
+            r.fence = nullptr;
         }
+        next_readback_ = 0;
+    }
 
-        // Upload result
-        glNamedBufferSubData(prefix_sum_buffer_, 0, num_gaussians_ * sizeof(uint32_t), tile_overlaps.data());
+    // Sorts the newest readback that has landed, skipping older ones. Fences are polled with a zero
+    // timeout, so a frame never waits on the GPU; without a new readback the previous order is kept.
+    void update_depth_order()
+    {
+        const float * depths = nullptr;
+        for (uint32_t k = 0; k < kDepthReadbacks; ++k)
+        {
+            // Oldest first: fences signal in submission order, so the first pending one ends the search
+            depth_readback & r = depth_readbacks_[(next_readback_ + k) % kDepthReadbacks];
+            if (!r.fence) continue;
+            const GLenum status = glClientWaitSync(r.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) break;
+            glDeleteSync(r.fence);
+            r.fence = nullptr;
+            depths = r.depths;
+        }
+        if (!depths) return;
+
+        const std::vector<uint32_t> & order = depth_order_.sort(depths, num_gaussians_);
+
+        // An unchanged order is already in the buffer from a previous frame
+        if (!has_depth_order_ || depth_order_.full_sort() || depth_order_.disorder() > 0.f)
+        {
+            order_buffer_.set_buffer_sub_data(order.size() * sizeof(uint32_t), 0, order.data());
+        }
+        has_depth_order_ = true;
+    }
+
+    uint32_t prefix_sum_blocks() const { return (num_gaussians_ + 1023) / 1024; } // prefix_sum.comp BLOCK_SIZE
+
+    // Inclusive scan of the tile overlap counts: per-block scans, a scan of the block totals, then a fixup
+    void compute_prefix_sum()
+    {
+        const GLuint program = prefix_sum_shader_->handle();
+        glProgramUniform1ui(program, prefix_sum_shader_->get_uniform_location("num_elements"), num_gaussians_);
+        glProgramUniform1ui(program, prefix_sum_shader_->get_uniform_location("num_blocks"), prefix_sum_blocks());
+        glProgramUniform1ui(program, prefix_sum_shader_->get_uniform_location("use_order"), use_depth_order_ ? 1 : 0);
+
+        prefix_sum_shader_->bind_ssbo(0, tile_overlap_buffer_);
+        prefix_sum_shader_->bind_ssbo(1, prefix_sum_buffer_);
+        prefix_sum_shader_->bind_ssbo(2, prefix_block_sums_buffer_);
+        prefix_sum_shader_->bind_ssbo(3, order_buffer_);
+
+        const GLint stage = prefix_sum_shader_->get_uniform_location("stage");
+        glProgramUniform1ui(program, stage, 0);
+        prefix_sum_shader_->dispatch_and_barrier(prefix_sum_blocks(), 1, 1, GL_SHADER_STORAGE_BARRIER_BIT);
+        glProgramUniform1ui(program, stage, 1);
+        prefix_sum_shader_->dispatch_and_barrier(1, 1, 1, GL_SHADER_STORAGE_BARRIER_BIT);
+        glProgramUniform1ui(program, stage, 2);
+        prefix_sum_shader_->dispatch_and_barrier(prefix_sum_blocks(), 1, 1, GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
     }
 
     void generate_sort_keys(uint32_t total_instances)
     {
         preprocess_sort_shader_->bind_ssbo(0, vertex_attr_buffer_);
         preprocess_sort_shader_->bind_ssbo(1, prefix_sum_buffer_);
-        preprocess_sort_shader_->bind_ssbo(2, sort_keys_buffer_);
-        preprocess_sort_shader_->bind_ssbo(3, sort_payloads_buffer_);
+        preprocess_sort_shader_->bind_ssbo(2, sorter_.unsorted_keys());
+        preprocess_sort_shader_->bind_ssbo(3, sorter_.unsorted_payloads());
+        preprocess_sort_shader_->bind_ssbo(5, order_buffer_);
 
         uint32_t tiles_x = (width_ + 15) / 16;
 
         struct {
             uint32_t tiles_x;
             uint32_t num_gaussians;
-            float pad[2];
-        } params = { tiles_x, num_gaussians_, {0, 0} };
+            uint32_t use_order;
+            float pad;
+        } params = { tiles_x, num_gaussians_, use_depth_order_ ? 1u : 0u, 0 };
 
         GLuint ubo;
         glCreateBuffers(1, &ubo);
@@ -260,41 +515,20 @@ private:
         glDeleteBuffers(1, &ubo);
     }
 
-    void sort_instances_cpu(uint32_t total_instances)
+    void sort_instances(uint32_t total_instances)
     {
-        // CPU sorting fallback (GPU radix sort is complex to implement correctly)
-        glGetNamedBufferSubData(sort_keys_buffer_, 0, total_instances * sizeof(uint64_t), sort_keys_.data());
-        glGetNamedBufferSubData(sort_payloads_buffer_, 0, total_instances * sizeof(uint32_t), sort_payloads_.data());
-
-        // Create index array for sorting
-        std::vector<uint32_t> indices(total_instances);
-        for (uint32_t i = 0; i < total_instances; i++) indices[i] = i;
-
-        // Sort by key
-        std::sort(indices.begin(), indices.end(), [this](uint32_t a, uint32_t b) {
-            return sort_keys_[a] < sort_keys_[b];
-        });
-
-        // Reorder
-        std::vector<uint64_t> sorted_keys(total_instances);
-        std::vector<uint32_t> sorted_payloads(total_instances);
-        for (uint32_t i = 0; i < total_instances; i++)
-        {
-            sorted_keys[i] = sort_keys_[indices[i]];
-            sorted_payloads[i] = sort_payloads_[indices[i]];
-        }
-
-        // Upload sorted data
-        glNamedBufferSubData(sort_keys_buffer_, 0, total_instances * sizeof(uint64_t), sorted_keys.data());
-        glNamedBufferSubData(sort_payloads_buffer_, 0, total_instances * sizeof(uint32_t), sorted_payloads.data());
+        // Keys are (tile << 32 | depth): 32 depth bits plus however many bits the tile count needs.
+        // Instances emitted in depth order only need the stable tile passes.
+        uint32_t tile_bits = 0;
+        while ((1u << tile_bits) < num_tiles_) ++tile_bits;
+        sorter_.sort(total_instances, 32 + tile_bits, use_depth_order_ ? 32 : 0);
     }
 
     void compute_tile_boundaries(uint32_t total_instances)
     {
-        std::vector<uint32_t> zeros(num_tiles_ * 2, 0);
-        glNamedBufferSubData(tile_boundary_buffer_, 0, zeros.size() * sizeof(uint32_t), zeros.data());
+        glClearNamedBufferData(tile_boundary_buffer_, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
 
-        tile_boundary_shader_->bind_ssbo(0, sort_keys_buffer_);
+        tile_boundary_shader_->bind_ssbo(0, sorter_.sorted_keys());
         tile_boundary_shader_->bind_ssbo(1, tile_boundary_buffer_);
 
         struct {
@@ -318,7 +552,7 @@ private:
     {
         render_shader_->bind_ssbo(0, vertex_attr_buffer_);
         render_shader_->bind_ssbo(1, tile_boundary_buffer_);
-        render_shader_->bind_ssbo(2, sort_payloads_buffer_);
+        render_shader_->bind_ssbo(2, sorter_.sorted_payloads());
         render_shader_->bind_image(3, output_texture_, GL_WRITE_ONLY, GL_RGBA8);
 
         struct {
@@ -347,8 +581,7 @@ private:
     uint32_t max_sort_instances_ = 0;
     uint32_t visible_gaussians_ = 0;
     float last_frame_time_ms_ = 0.0f;
-
-    gaussian_splat_scene scene_;
+    uint32_t sh_degree_ = 0;
 
     // Buffers
     gl_buffer vertex_buffer_;
@@ -356,13 +589,20 @@ private:
     gl_buffer vertex_attr_buffer_;
     gl_buffer tile_overlap_buffer_;
     gl_buffer prefix_sum_buffer_;
+    gl_buffer prefix_block_sums_buffer_;
     gl_buffer tile_boundary_buffer_;
-    gl_buffer sort_keys_buffer_;
-    gl_buffer sort_payloads_buffer_;
+    gl_buffer depth_buffer_;
+    gl_buffer order_buffer_;
 
-    // CPU sorting buffers
-    std::vector<uint64_t> sort_keys_;
-    std::vector<uint32_t> sort_payloads_;
+    depth_readback depth_readbacks_[kDepthReadbacks];
+    uint32_t next_readback_ = 0;
+    bool has_depth_order_ = false;
+    bool use_depth_order_ = false; // this frame emits instances in order_buffer_ order
+
+    splat_instance_sorter sorter_;
+    splat_sort_mode sort_mode_ = splat_sort_mode::gpu;
+    incremental_sort<float> depth_order_;
+    bool temporal_coherence_ = true;
 
     // Shaders
     std::unique_ptr<gl_shader_compute> precomp_cov3d_shader_;
@@ -389,10 +629,16 @@ struct gs_viewer_app final : public polymer_app
     std::unique_ptr<simple_texture_view> fullscreen_surface;
     std::unique_ptr<gaussian_splat_renderer> renderer;
 
-    gaussian_splat_scene scene; // fixme since this copies the gsplat
+    // Only one of these holds the loaded splats, depending on load_compressed
+    gaussian_splat_scene scene;
+    compressed_gaussian_splats compressed_scene;
+    std::string scene_path;
     std::string scene_filename;
+    bool load_compressed = false;
 
     int sh_degree_override = 3;
+    int sort_mode = static_cast<int>(splat_sort_mode::gpu);
+    bool temporal_coherence = true;
     float scale_modifier = 1.0f;
     bool show_imgui = true;
 
@@ -439,35 +685,45 @@ struct gs_viewer_app final : public polymer_app
             return;
         }
 
-        scene = import_gaussian_splat_ply(path);
+        scene = {};
+        compressed_scene = {};
+        if (load_compressed) compressed_scene = import_gaussian_splat_ply_compressed(path);
+        else scene = import_gaussian_splat_ply(path);
+
+        scene_path = path;
         scene_filename = get_filename_with_extension(path);
 
-        if (scene.vertices.size() > 0)
+        if (splat_count() > 0)
         {
-            renderer->set_scene(scene);
-            sh_degree_override = scene.sh_degree;
+            if (load_compressed) renderer->set_scene(compressed_scene);
+            else renderer->set_scene(scene);
+            sh_degree_override = load_compressed ? compressed_scene.sh_degree : scene.sh_degree;
             reset_camera();
         }
     }
 
+    size_t splat_count() const { return load_compressed ? compressed_scene.size() : scene.size(); }
+    size_t splat_memory_bytes() const { return load_compressed ? compressed_scene.memory_bytes() : scene.memory_bytes(); }
+    float3 splat_position(const size_t i) const { return load_compressed ? compressed_scene.position(i) : scene.positions[i]; }
+
     void reset_camera()
     {
-        if (scene.vertices.empty()) return;
+        const size_t count = splat_count();
+        if (count == 0) return;
 
         // Compute center of mass
         float3 center_of_mass(0.0f);
-        for (const auto & v : scene.vertices)
+        for (size_t i = 0; i < count; ++i)
         {
-            center_of_mass += float3(v.position.x, v.position.y, v.position.z);
+            center_of_mass += splat_position(i);
         }
-        center_of_mass /= static_cast<float>(scene.vertices.size());
+        center_of_mass /= static_cast<float>(count);
 
         // Compute radius from center of mass
         float max_dist_sq = 0.0f;
-        for (const auto & v : scene.vertices)
+        for (size_t i = 0; i < count; ++i)
         {
-            float3 pos(v.position.x, v.position.y, v.position.z);
-            float dist_sq = length2(pos - center_of_mass);
+            float dist_sq = length2(splat_position(i) - center_of_mass);
             max_dist_sq = std::max(max_dist_sq, dist_sq);
         }
         float radius = std::sqrt(max_dist_sq);
@@ -564,20 +820,40 @@ struct gs_viewer_app final : public polymer_app
         ImGui::Begin("Polymer 3DGS Viewer");
 
         ImGui::Text("Scene/PLY: %s", scene_filename.empty() ? "None" : scene_filename.c_str());
-        ImGui::Text("Gaussians: %zu", scene.vertices.size());
-        ImGui::Text("SH Degree: %u", scene.sh_degree);
+        ImGui::Text("Gaussians: %zu", splat_count());
+        ImGui::Text("SH Degree: %u", load_compressed ? compressed_scene.sh_degree : scene.sh_degree);
+        ImGui::Text("CPU Memory: %.1f MB", splat_memory_bytes() / (1024.0 * 1024.0));
 
         ImGui::Separator();
 
-        ImGui::Text("Visible: %u (%.1f%%)", renderer->get_visible_count(), scene.vertices.size() > 0 ? 100.0f * renderer->get_visible_count() / scene.vertices.size() : 0.0f);
+        ImGui::Text("Visible: %u (%.1f%%)", renderer->get_visible_count(), splat_count() > 0 ? 100.0f * renderer->get_visible_count() / splat_count() : 0.0f);
         ImGui::Text("Frame Time: %.2f ms", renderer->get_frame_time_ms());
         ImGui::Text("FPS: %.1f", 1000.0f / std::max(renderer->get_frame_time_ms(), 0.001f));
+        if (temporal_coherence)
+        {
+            ImGui::Text("Depth Order Disorder: %.3f%% (%s)", 100.0f * renderer->get_depth_order_disorder(), renderer->get_depth_order_full_sort() ? "full sort" : "repaired");
+        }
 
         ImGui::Separator();
 
         ImGui::SliderInt("SH Degree", &sh_degree_override, 0, 3);
         ImGui::SliderFloat("Scale", &scale_modifier, 0.1f, 3.0f);
 
+        if (ImGui::Combo("Sort", &sort_mode, "GPU radix\0CPU radix (mapped)\0"))
+        {
+            renderer->set_sort_mode(static_cast<splat_sort_mode>(sort_mode));
+        }
+
+        if (ImGui::Checkbox("Temporal Coherence", &temporal_coherence))
+        {
+            renderer->set_temporal_coherence(temporal_coherence);
+        }
+
+        if (ImGui::Checkbox("Compressed", &load_compressed) && !scene_path.empty())
+        {
+            load_scene(scene_path);
+        }
+
         if (ImGui::Button("Reset Camera (R)"))
         {
             reset_camera();
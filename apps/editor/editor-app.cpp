@@ -236,11 +236,6 @@ void scene_editor_app::on_input(const app_input_event & event)
                     gizmo->clear();
                 }
             }
-
-            if (gizmo->moved())
-            {
-                the_scene.get_collision_system()->queue_acceleration_rebuild();
-            }
         }
     }
 }
@@ -268,7 +263,8 @@ void scene_editor_app::import_scene(const std::string & path)
         log::get()->engine_log->info("resolving local `{}` directory.", parent_dir);
         the_scene.resolver->add_search_path(parent_dir);
 
-        the_scene.resolver->resolve();
+        // Assets stream in over the following frames, see on_update
+        the_scene.resolver->resolve_async();
 
         glfwSetWindowTitle(window, path.c_str());
     }
@@ -302,6 +298,7 @@ void scene_editor_app::on_update(const app_update_event & e)
     editorProfiler.begin("on_update");
     flycam.update(e.timestep_ms);
     shaderMonitor.handle_recompile();
+    the_scene.resolver->update();
     gizmo->on_update(cam, float2(static_cast<float>(width), static_cast<float>(height)));
     editorProfiler.end("on_update");
 }
@@ -393,55 +390,50 @@ void scene_editor_app::on_draw()
             r.mesh = obj.get_component<mesh_component>();
             if (auto * xform = obj.get_component<transform_component>())
             {
-                r.world_matrix = xform->get_world_transform().matrix() * make_scaling_matrix(xform->local_scale);
+                r.world_matrix = xform->get_world_matrix();
             }
             r.render_sort_order = 0;
             return r;
         };
 
-        // Iterate all objects in the scene graph
-        for (auto & [e, obj] : the_scene.get_graph().graph_objects)
-        {
-            // Does the entity have a material? If so, we can render it.
-            if (auto * mat_c = obj.get_component<material_component>())
-            {
-                auto * mesh_c = obj.get_component<mesh_component>();
-                if (!mesh_c) continue; // for the case that we just created a material component and haven't set a mesh yet
+        scene_graph & graph = the_scene.get_graph();
 
-                render_component r = assemble_render_component(obj);
-                renderer_payload.render_components.push_back(r);
-            }
+        // Stream through the component pools rather than walking every object. Entities that have a
+        // material but no mesh yet (e.g. a material component that was just created) are skipped.
+        graph.view<material_component, mesh_component, transform_component>([&](const entity & e, material_component & mat_c, mesh_component & mesh_c, transform_component & xform)
+        {
+            render_component r;
+            r.material = &mat_c;
+            r.mesh = &mesh_c;
+            r.world_matrix = xform.get_world_matrix();
+            r.render_sort_order = 0;
+            renderer_payload.render_components.push_back(r);
+        });
 
-            // IBL cubemap
-            if (auto * cubemap = obj.get_component<ibl_component>())
-            {
-                renderer_payload.ibl_cubemap = cubemap;
-            }
+        // IBL cubemap
+        graph.view<ibl_component>([&](const entity & e, ibl_component & cubemap)
+        {
+            renderer_payload.ibl_cubemap = &cubemap;
+        });
 
-            // Procedural skybox
-            if (auto * proc_skybox = obj.get_component<procedural_skybox_component>())
+        // Procedural skybox
+        graph.view<procedural_skybox_component>([&](const entity & e, procedural_skybox_component & proc_skybox)
+        {
+            renderer_payload.procedural_skybox = &proc_skybox;
+            if (proc_skybox.sun_directional_light != kInvalidEntity)
             {
-                renderer_payload.procedural_skybox = proc_skybox;
-                if (proc_skybox->sun_directional_light != kInvalidEntity)
+                if (auto * sunlight = graph.get_components().get<directional_light_component>(proc_skybox.sun_directional_light))
                 {
-                    // Use scene::get_object which returns nullptr for invalid entities,
-                    // not scene_graph::get_object which creates empty entries via operator[]
-                    if (base_object * sun_obj = the_scene.get_object(proc_skybox->sun_directional_light))
-                    {
-                        if (auto * sunlight = sun_obj->get_component<directional_light_component>())
-                        {
-                            renderer_payload.sunlight = sunlight;
-                        }
-                    }
+                    renderer_payload.sunlight = sunlight;
                 }
             }
+        });
 
-            // Point lights
-            if (auto * pt_light_c = obj.get_component<point_light_component>())
-            {
-                renderer_payload.point_lights.push_back(pt_light_c);
-            }
-        }
+        // Point lights
+        graph.view<point_light_component>([&](const entity & e, point_light_component & pt_light_c)
+        {
+            renderer_payload.point_lights.push_back(&pt_light_c);
+        });
 
         // Add debug renderer entity
         entity debug_ent = polymer::global_debug_mesh_manager::get()->get_entity();
@@ -490,9 +482,7 @@ void scene_editor_app::on_draw()
         {
             base_object & obj = the_scene.get_graph().get_object(e);
             auto * xform = obj.get_component<transform_component>();
-            const transform p = xform->get_world_transform();
-            const float3 scale = xform->local_scale;
-            const float4x4 modelMatrix = (p.matrix() * make_scaling_matrix(scale));
+            const float4x4 modelMatrix = xform->get_world_matrix();
             program.uniform("u_modelMatrix", modelMatrix);
             if (auto * mesh = obj.get_component<mesh_component>())
             {
@@ -801,6 +791,7 @@ void scene_editor_app::on_draw()
             {
                 for (auto & t : the_scene.get_renderer()->gpuProfiler.get_data()) ImGui::Text("[Renderer GPU] %s %f ms", t.first.c_str(), t.second);
                 for (auto & t : the_scene.get_renderer()->cpuProfiler.get_data()) ImGui::Text("[Renderer CPU] %s %f ms", t.first.c_str(), t.second);
+                for (auto & t : the_scene.get_renderer()->cpuProfiler.get_counters()) ImGui::Text("[Renderer] %s %f", t.first.c_str(), t.second);
             }
 
             ImGui::Dummy({ 0, 10 });
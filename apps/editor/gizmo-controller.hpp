@@ -62,13 +62,8 @@ class gizmo_controller
     // Helper to set local transform
     void set_local_transform(entity e, const transform & pose, const float3 & scale)
     {
-        base_object & obj = the_scene->get_graph().get_object(e);
-        if (auto * xform = obj.get_component<transform_component>())
-        {
-            xform->local_pose = pose;
-            xform->local_scale = scale;
-        }
-        the_scene->get_graph().refresh();
+        the_scene->get_graph().set_local_transform(e, pose, scale);
+        the_scene->get_graph().update_world_transforms();
     }
 
     void compute_entity_transform()
@@ -203,8 +198,9 @@ public:
                     const entity parent_entity = get_parent(e);
                     base_object & parent_obj = the_scene->get_graph().get_object(parent_entity);
                     transform_component * parent_xform = parent_obj.get_component<transform_component>();
-                    const transform parent_pose = parent_xform ? parent_xform->local_pose : transform();
-                    const transform child_local_pose = parent_pose.inverse() * updated_pose;
+                    const transform parent_pose = parent_xform ? parent_xform->get_world_transform() : transform();
+                    const float3 parent_scale = parent_xform ? parent_xform->get_world_scale() : float3(1.f);
+                    const transform child_local_pose = make_local_transform(parent_pose, parent_scale, updated_pose);
 
                     set_local_transform(e, child_local_pose, local_scale);
                 }
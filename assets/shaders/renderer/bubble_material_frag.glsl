@@ -340,17 +340,20 @@ void main()
     }
 
     // Point lights
-    for (int i = 0; i < u_activePointLights; ++i)
+    uvec2 lightCluster = get_light_cluster(gl_FragCoord.xy, v_world_position);
+    for (uint i = 0u; i < lightCluster.y; ++i)
     {
-        vec3 L = normalize(u_pointLights[i].position - v_world_position);
+        PointLight light = u_pointLights[u_lightIndices[lightCluster.x + i]];
+
+        vec3 L = normalize(light.position - v_world_position);
         vec3 H = normalize(L + V);
 
         float NdotL = max(dot(N, L), 0.0);
         float NdotH = max(dot(N, H), 0.0);
         float VdotH = max(dot(V, H), 0.0);
 
-        float dist = length(u_pointLights[i].position - v_world_position);
-        float attenuation = point_light_attenuation(u_pointLights[i].radius, 2.0, 0.1, dist);
+        float dist = length(light.position - v_world_position);
+        float attenuation = point_light_attenuation(light.radius, 2.0, 0.1, dist);
 
         float D = D_GGX(NdotH, alpha);
         float Vis = V_SmithGGXCorrelated(NdotV, NdotL, alpha);
@@ -358,7 +361,7 @@ void main()
         // Use vectorized Fresnel with thin-film F0 for colored specular
         vec3 F = fresnel_schlick_vec(VdotH, effective_F0);
 
-        vec3 spec = (D * Vis) * F * u_pointLights[i].color * attenuation * NdotL;
+        vec3 spec = (D * Vis) * F * light.color * attenuation * NdotL;
 
         direct_specular += spec;
     }
@@ -63,6 +63,7 @@ in vec3 v_normal;               // Interpolated vertex normal (may not be normal
 in vec2 v_texcoord;             // Texture coordinates for material maps
 in vec3 v_tangent;              // Tangent vector for normal mapping (TBN matrix)
 in vec3 v_bitangent;            // Bitangent vector for normal mapping (TBN matrix)
+flat in float v_receiveShadow;  // Per-object flag, from the object's instance data
 
 ////////////////////////////////////////////////////////////////////////////////
 // MATERIAL UNIFORMS
@@ -1052,8 +1053,8 @@ void main()
             // Calculate shadow factor from CSM (0 = in shadow, 1 = lit)
             shadowTerm = calculate_csm_coefficient(s_csmArray, biased_pos, v_view_space_position, u_cascadesMatrix, u_cascadesPlane, debugShadowColor);
             // Combine shadow with NdotL to fade shadows at light terminator
-            // u_shadowOpacity controls shadow darkness, u_receiveShadow is per-object flag
-            shadowVisibility = 1.0 - ((shadowTerm * NdotL) * u_shadowOpacity * u_receiveShadow);
+            // u_shadowOpacity controls shadow darkness, v_receiveShadow is per-object flag
+            shadowVisibility = 1.0 - ((shadowTerm * NdotL) * u_shadowOpacity * v_receiveShadow);
         #endif
 
         // ---------------------------------------------------------------------
@@ -1092,12 +1093,21 @@ void main()
     //   - Minimum distance clamp (treats light as small sphere)
     //   - Smooth falloff to zero at influence radius
     //
+    // CLUSTERED LIGHTING:
+    // The view frustum is divided into froxels (screen tiles × depth slices),
+    // and each frame the renderer bins every light into the froxels its radius
+    // reaches. A fragment only visits the lights of its own froxel, so a scene
+    // can hold hundreds of lights while each pixel pays for the few nearby.
+    //
     // Reference: Karis, "Real Shading in Unreal Engine 4" [1]
     // -------------------------------------------------------------------------
-    for (int i = 0; i < u_activePointLights; ++i)
+    uvec2 lightCluster = get_light_cluster(gl_FragCoord.xy, v_world_position);
+    for (uint i = 0u; i < lightCluster.y; ++i)
     {
+        PointLight light = u_pointLights[u_lightIndices[lightCluster.x + i]];
+
         // Light direction: from surface to light position (world space)
-        vec3 L = normalize(u_pointLights[i].position - v_world_position);
+        vec3 L = normalize(light.position - v_world_position);
 
         // Half-vector for this light-view configuration
         vec3 H = normalize(L + V);
@@ -1121,7 +1131,7 @@ void main()
         // DISTANCE ATTENUATION
         // ---------------------------------------------------------------------
         // Calculate distance from surface to light
-        float dist = length(u_pointLights[i].position - v_world_position);
+        float dist = length(light.position - v_world_position);
 
         // point_light_attenuation parameters:
         //   - radius: Light's influence radius (falloff reaches zero here)
@@ -1130,7 +1140,7 @@ void main()
         //   - dist: Actual distance to light
         //
         // Returns smoothly attenuated factor [0, 1]
-        float attenuation = point_light_attenuation(u_pointLights[i].radius, 2.0, 0.1, dist);
+        float attenuation = point_light_attenuation(light.radius, 2.0, 0.1, dist);
 
         // ---------------------------------------------------------------------
         // BRDF EVALUATION
@@ -1141,7 +1151,7 @@ void main()
         // Final contribution: BRDF × Light_color × NdotL
         // Note: attenuation is already applied inside compute_cook_torrance
         // Accumulate diffuse and specular separately for clear coat attenuation
-        vec3 lightContrib = NdotL * u_pointLights[i].color;
+        vec3 lightContrib = NdotL * light.color;
         Lo_direct_diffuse += lightContrib * diffuseContrib;
         Lo_direct_specular += lightContrib * specContrib;
     }
@@ -1447,24 +1457,26 @@ void main()
         // =====================================================================
         // POINT LIGHT CLEAR COAT EVALUATION
         // =====================================================================
-        for (int i = 0; i < u_activePointLights; ++i)
+        for (uint i = 0u; i < lightCluster.y; ++i)
         {
-            vec3 L = normalize(u_pointLights[i].position - v_world_position);
+            PointLight light = u_pointLights[u_lightIndices[lightCluster.x + i]];
+
+            vec3 L = normalize(light.position - v_world_position);
             vec3 H = normalize(L + V);
             float NdotL = clamp(dot(N, L), 0.001, 1.0);
             float NdotH = clamp(dot(N, H), 0.0, 1.0);
             float LdotH = clamp(dot(L, H), 0.0, 1.0);
             float VdotH = clamp(dot(V, H), 0.0, 1.0);
 
-            float dist = length(u_pointLights[i].position - v_world_position);
-            float attenuation = point_light_attenuation(u_pointLights[i].radius, 2.0, 0.1, dist);
+            float dist = length(light.position - v_world_position);
+            float attenuation = point_light_attenuation(light.radius, 2.0, 0.1, dist);
 
             // Clear coat BRDF terms (use half-precision safe version)
             float ccD = D_GGX(NdotH, ccAlpha, N, H);
             float ccV = visibility_kelemen(LdotH);
             float ccF = ccF0 + (1.0 - ccF0) * pow(1.0 - VdotH, 5.0);
 
-            Lo_clearCoat_direct += u_pointLights[i].color * attenuation * NdotL * ccD * ccV * ccF * u_clearCoat;
+            Lo_clearCoat_direct += light.color * attenuation * NdotL * ccD * ccV * ccF * u_clearCoat;
         }
 
         // =====================================================================
@@ -8,6 +8,7 @@ in vec3 v_normal;
 in vec2 v_texcoord;
 in vec3 v_tangent;
 in vec3 v_bitangent;
+flat in float v_receiveShadow;
 
 // Material Uniforms
 uniform vec3 u_diffuseColor;
@@ -88,26 +89,29 @@ void main()
             const float normal_bias = 0.01;
             vec3 biased_pos = get_biased_position(v_world_position, slope_bias, normal_bias, v_normal, L);
             shadowTerm = calculate_csm_coefficient(s_csmArray, biased_pos, v_view_space_position, u_cascadesMatrix, u_cascadesPlane, debugShadowColor);
-            shadowVisibility = 1.0 - ((shadowTerm  * NdotL) * u_receiveShadow);
+            shadowVisibility = 1.0 - ((shadowTerm  * NdotL) * v_receiveShadow);
         #endif
 
         Lo += diffuseContrib + specContrib;
     }
     
     // Compute point lights
-    for (int i = 0; i < u_activePointLights; ++i)
+    uvec2 lightCluster = get_light_cluster(gl_FragCoord.xy, v_world_position);
+    for (uint i = 0u; i < lightCluster.y; ++i)
     {
-        vec3 L = normalize(u_pointLights[i].position - v_world_position); 
+        PointLight light = u_pointLights[u_lightIndices[lightCluster.x + i]];
+
+        vec3 L = normalize(light.position - v_world_position); 
         vec3 H = normalize(L + V);  
 
         float NdotL = clamp(dot(N, L), 0.001, 1.0);
         float NdotH = clamp(dot(N, H), 0.0, 1.0);
         float LdotH = clamp(dot(L, H), 0.0, 1.0);
 
-        float dist = length(u_pointLights[i].position - v_world_position);
-        float attenuation = point_light_attenuation(u_pointLights[i].radius, 2.0, 0.1, dist); // reasonable intensity is 0.01 to 8
+        float dist = length(light.position - v_world_position);
+        float attenuation = point_light_attenuation(light.radius, 2.0, 0.1, dist); // reasonable intensity is 0.01 to 8
 
-        const vec3 irradiance = NdotL * u_pointLights[i].color;
+        const vec3 irradiance = NdotL * light.color;
 
         vec3 diffuseContrib, specContrib;
         diffuseContrib += irradiance * lambert_diffuse(diffuseColor);
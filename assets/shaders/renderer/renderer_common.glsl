@@ -6,8 +6,6 @@
 #define RCP_4PI 1.0 / (4 * PI)
 #define DEFAULT_GAMMA 2.2
 
-const int MAX_POINT_LIGHTS = 4;
-
 const int NUM_CASCADES = 2;
 #define TWO_CASCADES // fixme
 
@@ -28,7 +26,6 @@ struct PointLight
 layout(binding = 0, std140) uniform PerScene
 {
     DirectionalLight u_directionalLight;
-    PointLight u_pointLights[MAX_POINT_LIGHTS];
     float u_time;
     int u_activePointLights;
     int sunlightActive;
@@ -45,14 +42,51 @@ layout(binding = 1, std140) uniform PerView
     mat4 u_viewMatrix;
     mat4 u_viewProjMatrix;
     vec4 u_eyePos;
+    vec4 u_zBufferParams;
+    vec4 u_projectionParams;
+    uvec4 u_clusterDims;
+    vec4 u_clusterParams;
+};
+
+// Clustered lighting. Every point light of the frame, then for each froxel of the view the offset and count
+// of its run in the light index list.
+layout(binding = 3, std430) readonly buffer PointLights
+{
+    PointLight u_pointLights[];
+};
+
+layout(binding = 4, std430) readonly buffer LightClusters
+{
+    uvec2 u_lightClusters[];
+};
+
+layout(binding = 5, std430) readonly buffer LightIndices
+{
+    uint u_lightIndices[];
+};
+
+// The offset and count of the point lights of the froxel holding a fragment, from its window position and
+// world position. Loop over them as u_pointLights[u_lightIndices[cluster.x + i]] for i < cluster.y.
+uvec2 get_light_cluster(vec2 fragCoord, vec3 worldPos)
+{
+    float depth = -(u_viewMatrix * vec4(worldPos, 1.0)).z;
+    uvec2 tile = min(uvec2(fragCoord * u_clusterParams.xy), u_clusterDims.xy - 1u);
+    uint slice = uint(clamp(log(max(depth, 1e-6)) * u_clusterParams.z + u_clusterParams.w, 0.0, float(u_clusterDims.z - 1u)));
+    return u_lightClusters[(slice * u_clusterDims.y + tile.y) * u_clusterDims.x + tile.x];
+}
+
+struct ObjectData
+{
+    mat4 modelMatrix;
+    mat4 modelMatrixIT;
+    mat4 modelViewMatrix;
+    float receiveShadow;
 };
 
-layout(binding = 2, std140) uniform PerObject
+// The renderer binds the instances of each draw, so a vertex shader reads its object at gl_InstanceID
+layout(binding = 2, std430) readonly buffer PerObject
 {
-    mat4 u_modelMatrix;
-    mat4 u_modelMatrixIT;
-    mat4 u_modelViewMatrix;
-    float u_receiveShadow;
+    ObjectData u_objects[];
 };
 
 vec2 get_shadow_offsets(vec3 N, vec3 L) 
@@ -14,18 +14,23 @@ out vec2 v_texcoord;
 out vec3 v_tangent;
 out vec3 v_bitangent;
 out vec3 v_color;
+flat out float v_receiveShadow;
 
 uniform vec2 u_texCoordScale = vec2(1, 1);
 
 void main()
 {
-    vec4 worldPosition = u_modelMatrix * vec4(inPosition, 1.0);
+    mat4 modelMatrix = u_objects[gl_InstanceID].modelMatrix;
+    mat4 modelMatrixIT = u_objects[gl_InstanceID].modelMatrixIT;
+
+    vec4 worldPosition = modelMatrix * vec4(inPosition, 1.0);
     gl_Position = u_viewProjMatrix * worldPosition;
-    v_view_space_position = (u_modelViewMatrix * vec4(inPosition, 1.0)).xyz;
-    v_normal = normalize((u_modelMatrixIT * vec4(inNormal, 0)).xyz);
+    v_view_space_position = (u_objects[gl_InstanceID].modelViewMatrix * vec4(inPosition, 1.0)).xyz;
+    v_normal = normalize((modelMatrixIT * vec4(inNormal, 0)).xyz);
     v_world_position = worldPosition.xyz;
     v_texcoord = inTexCoord * u_texCoordScale;
-    v_tangent = (u_modelMatrixIT * vec4(inTangent, 0)).xyz;
-    v_bitangent = (u_modelMatrixIT * vec4(inBitangent, 0)).xyz;
+    v_tangent = (modelMatrixIT * vec4(inTangent, 0)).xyz;
+    v_bitangent = (modelMatrixIT * vec4(inBitangent, 0)).xyz;
     v_color = inColor;
+    v_receiveShadow = u_objects[gl_InstanceID].receiveShadow;
 }
\ No newline at end of file
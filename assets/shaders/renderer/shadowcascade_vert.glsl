@@ -1,9 +1,11 @@
-#version 450
+#include "renderer_common.glsl"
 
 layout(location = 0) in vec3 inPosition;
-uniform mat4 u_modelShadowMatrix;
+
+// Projection * view of the cascade being drawn; each cascade is a separate pass over its own casters
+uniform mat4 u_cascadeViewProj;
 
 void main()
 {
-    gl_Position = u_modelShadowMatrix * vec4(inPosition, 1);
+    gl_Position = u_cascadeViewProj * (u_objects[gl_InstanceID].modelMatrix * vec4(inPosition, 1));
 }
\ No newline at end of file
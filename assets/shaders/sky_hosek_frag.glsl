@@ -16,7 +16,6 @@ vec3 HosekWilkie(float cos_theta, float gamma, float cos_gamma)
 
 // clean this up to use shader include
 
-const int MAX_POINT_LIGHTS = 4;
 const int NUM_CASCADES = 2;
 
 struct DirectionalLight
@@ -26,17 +25,9 @@ struct DirectionalLight
     float amount;
 }; 
 
-struct PointLight
-{
-    vec3 color;
-    vec3 position;
-    float radius;
-};
-
 layout(binding = 0, std140) uniform PerScene
 {
     DirectionalLight u_directionalLight;
-    PointLight u_pointLights[MAX_POINT_LIGHTS];
     float u_time;
     int u_activePointLights;
     vec2 resolution;
@@ -1,31 +1,10 @@
 #include "polymer-gfx-gl/gl-particle-system.hpp"
 #include "polymer-gfx-gl/gl-api.hpp"
+#include "polymer-core/util/job-system.hpp"
 
 using namespace polymer;
 
-template<typename Fn>
-void particle_parallel_for(int n, Fn function, int target_concurrency = 0)
-{
-	const int hint = (target_concurrency == 0) ? std::thread::hardware_concurrency() : target_concurrency;
-	const int n_threads = std::min(n, (hint == 0) ? 4 : hint);
-	const int n_max_tasks_per_thread = (n / n_threads) + (n % n_threads == 0 ? 0 : 1);
-	const int n_lacking_tasks = n_max_tasks_per_thread * n_threads - n;
-
-	auto inner_loop = [&](const int thread_index)
-	{
-		const int n_lacking_tasks_so_far = std::max(thread_index - n_threads + n_lacking_tasks, 0);
-		const int inclusive_start_index = thread_index * n_max_tasks_per_thread - n_lacking_tasks_so_far;
-		const int exclusive_end_index = inclusive_start_index + n_max_tasks_per_thread - (thread_index - n_threads + n_lacking_tasks >= 0 ? 1 : 0);
-
-		for (int k = inclusive_start_index; k < exclusive_end_index; ++k)
-		{
-			function(k);
-		}
-	};
-	std::vector<std::thread> threads;
-	for (int j = 0; j < n_threads; ++j) { threads.push_back(std::thread(inner_loop, j)); }
-	for (auto & t : threads) { t.join(); }
-}
+static const size_t kParticleGrain = 8192; // particles per job when packing instance data
 
 gl_particle_system::gl_particle_system()
 {
@@ -120,23 +99,23 @@ void gl_particle_system::update(const float dt)
         //     particles.erase(it, std::end(particles));
         // }
      
-		for (int i = 0; i < particles.size(); ++i) 
+		// Apply trail modifiers. These touch shared particles, so they stay on this thread.
+		for (size_t trail_idx = 1; trail_idx < std::min(trail + 1, particles.size()); ++trail_idx)
+		{
+			particles[trail_idx].position -= particles[trail_idx].velocity * 0.001f;
+			particles[trail_idx].size *= 0.97f;
+		}
+
+		// Create instance particles
+		// @fixme - need to account for trail
+		parallel_for(particles.size(), kParticleGrain, [this](const size_t begin, const size_t end)
 		{
-			// Create instance particles, with an optional trail
-			for (int trail_idx = 0; trail_idx < (trail + 1); ++trail_idx)
+			for (size_t i = begin; i < end; ++i)
 			{
-				// Apply trail modifiers
-				if (trail_idx >= 1)
-				{
-					particles[trail_idx].position -= particles[trail_idx].velocity * 0.001f;
-					particles[trail_idx].size *= 0.97f;
-				}
-			
-				// @fixme - need to account for trail
 				instances[i].position_size = float4(particles[i].position, particles[i].size);
 				instances[i].color = float4(particles[i].color);
 			}
-		};
+		});
 	};
 
 	{
@@ -3,6 +3,7 @@
 #include "polymer-core/util/util.hpp"
 #include "polymer-core/util/timestamp.hpp"
 #include "polymer-core/math/math-spatial.hpp"
+#include "polymer-core/util/job-system.hpp"
 #include "polymer-gfx-gl/gl-api.hpp"
 
 #include "stb/stb_image_write.h"
@@ -203,7 +204,12 @@ int glfw_window::get_mods() const
 /////////////////////
 
 /// @fixme - theoretically gl_context is leaky
-polymer_app::polymer_app(int w, int h, const std::string title, int samples) : glfw_window(new gl_context(), w, h, title, samples) {}
+polymer_app::polymer_app(int w, int h, const std::string title, int samples) : glfw_window(new gl_context(), w, h, title, samples)
+{
+    // The shared job system is owned by the thread that creates it, which must be this one
+    default_job_system();
+}
+
 polymer_app::~polymer_app() {}
 
 void polymer_app::request_screenshot(const std::string & filename)
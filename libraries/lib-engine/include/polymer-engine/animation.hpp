@@ -0,0 +1,158 @@
+#pragma once
+
+#ifndef polymer_engine_animation_hpp
+#define polymer_engine_animation_hpp
+
+#include "polymer-core/math/math-core.hpp"
+#include "polymer-core/util/job-system.hpp"
+#include "polymer-model-io/model-io.hpp"
+
+#include <string>
+#include <vector>
+
+namespace polymer
+{
+    //////////////////////
+    //   skeleton_rig   //
+    //////////////////////
+
+    // Skeleton data shared by every instance of a character. Bones keep the order of the source skin so
+    // that palettes line up with runtime_skinned_mesh::boneIndices; evaluation_order lists them with
+    // every parent ahead of its children.
+    struct skeleton_rig
+    {
+        static const uint32_t kInvalidIndex = 0xFFFFFFFF;
+
+        std::vector<uint32_t> parents;
+        std::vector<uint32_t> evaluation_order;
+        std::vector<float4x4> inverse_bind_poses;
+
+        // Local rest pose, used by channels a clip does not animate
+        std::vector<float3> rest_translations;
+        std::vector<float4> rest_rotations; // quaternion xyzw
+        std::vector<float3> rest_scales;
+
+        size_t size() const { return parents.size(); }
+    };
+
+    // Rest poses are recovered from bone::initialPose (the joint's world transform) relative to the parent joint
+    skeleton_rig make_skeleton_rig(const std::vector<bone> & bones);
+
+    ///////////////////////
+    //   skeleton_pose   //
+    ///////////////////////
+
+    // Local transform of every bone of a rig, one array per component
+    struct skeleton_pose
+    {
+        std::vector<float3> translations;
+        std::vector<float4> rotations; // quaternion xyzw
+        std::vector<float3> scales;
+
+        size_t size() const { return translations.size(); }
+        void resize(const size_t n) { translations.resize(n); rotations.resize(n); scales.resize(n); }
+    };
+
+    ////////////////////////
+    //   animation_clip   //
+    ////////////////////////
+
+    // Runtime form of a skeletal_animation: no per-key allocations, every key of a channel contiguous. Each
+    // bone has a translation, a rotation and a scale channel; channel b of a component owns keys
+    // [offsets[b], offsets[b + 1]) of that component's times and values. Every channel has at least one key.
+    // Rotations are either float quaternions or four snorm16 components per key.
+    struct animation_clip
+    {
+        struct channel_keys
+        {
+            std::vector<uint32_t> offsets; // bone_count + 1
+            std::vector<float> times;      // seconds, ascending within a channel
+
+            uint32_t count(const uint32_t bone) const { return offsets[bone + 1] - offsets[bone]; }
+        };
+
+        std::string name;
+        float duration { 0.f };
+        uint32_t bone_count { 0 };
+
+        channel_keys translation_keys, rotation_keys, scale_keys;
+        std::vector<float3> translations;
+        std::vector<float3> scales;
+        std::vector<float4> rotations;           // empty when quantized
+        std::vector<int16_t> quantized_rotations; // 4 per key, xyzw * 32767
+
+        bool quantized() const { return !quantized_rotations.empty(); }
+        size_t memory_bytes() const;
+    };
+
+    struct animation_clip_options
+    {
+        float frames_per_second = 24.f;  // rate of skeletal_animation keyframe keys
+        bool quantize_rotations = false; // 8 bytes per rotation key instead of 16, ~3e-5 error per component
+        float tolerance = 0.f;           // drop keys that interpolating their neighbours reproduces within this; 0 drops only redundant keys
+    };
+
+    // Splits the keyframes of each track into per-component channels. skeletal_animation stores all three
+    // components on every keyframe, so a component that holds its default value (identity, zero, one) on every
+    // keyframe of a track is taken to be unanimated and uses the rig's rest pose, as do bones without a track.
+    animation_clip make_animation_clip(const skeletal_animation & animation, const skeleton_rig & rig, const animation_clip_options & options = {});
+
+    ///////////////////////////
+    //   animation_sampler   //
+    ///////////////////////////
+
+    // Evaluates every channel of a clip at once: translations and scales are lerped and rotations nlerped,
+    // four bones per SSE iteration. Each channel remembers the key it was last sampled at, so playback that
+    // moves forward finds its keys in amortized O(1); moving backwards (looping, seeking) binary searches.
+    class animation_sampler
+    {
+        const animation_clip * clip { nullptr };
+        std::vector<uint32_t> cursors; // translation, rotation and scale cursor per bone
+        float last_time { 0.f };
+
+        // Second key of each interpolation and the blend factors; the first key is gathered straight into the pose
+        std::vector<float3> next_translations, next_scales;
+        std::vector<float4> next_rotations;
+        std::vector<float> translation_alphas, rotation_alphas, scale_alphas;
+
+    public:
+
+        animation_sampler() = default;
+        explicit animation_sampler(const animation_clip & clip) { bind(clip); }
+
+        void bind(const animation_clip & clip);
+        const animation_clip * get_clip() const { return clip; }
+
+        // Writes the local pose at time (seconds, clamped to the clip) into pose, resized to the clip's bone count
+        void sample(const float time, skeleton_pose & pose);
+    };
+
+    ///////////////////
+    //   Skinning    //
+    ///////////////////
+
+    // palette[b] = model[b] * inverse_bind_poses[b], where model[b] is the pose composed through the rig's
+    // parents. Both arrays hold rig.size() matrices; palette is indexed like runtime_skinned_mesh::bones.
+    void compute_skinning_palette(const skeleton_rig & rig, const skeleton_pose & pose, float4x4 * model, float4x4 * palette);
+
+    // One animated character: a rig, a clip bound to its sampler and the matrices produced for it
+    struct animation_instance
+    {
+        const skeleton_rig * rig { nullptr };
+        animation_sampler sampler;
+        float time { 0.f };
+        float speed { 1.f };
+        bool loop { true };
+
+        skeleton_pose pose;
+        std::vector<float4x4> model_matrices;
+        std::vector<float4x4> palette;
+    };
+
+    // Advances, samples and skins every instance. Instances are independent and are spread over the job
+    // system a few at a time; a single instance is evaluated on one thread.
+    void update_animation_instances(animation_instance * instances, const size_t count, const float dt, job_system & jobs = default_job_system());
+
+} // end namespace polymer
+
+#endif // end polymer_engine_animation_hpp
@@ -0,0 +1,103 @@
+/*
+ * File: lib-engine/asset-catalog.hpp
+ * A persistent index of the files under one or more asset directories, used by the `asset_resolver` to
+ * find files by name. Entries are hashed by lowercase file stem and by extension, so a lookup costs
+ * O(1) instead of a walk over the tree. The directory structure of each root is cached in a json file
+ * that holds the last write time of every directory. On the next run, a directory whose write time has
+ * not changed reuses its cached listing. Adding, removing or renaming a file changes the write time of
+ * its parent, so only those directories are listed again. A warm start therefore costs one stat per
+ * directory instead of a listing per directory.
+ */
+
+#pragma once
+
+#ifndef polymer_asset_catalog_hpp
+#define polymer_asset_catalog_hpp
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace polymer
+{
+    struct asset_catalog_stats
+    {
+        size_t directories { 0 };
+        size_t listed_directories { 0 }; // directories that were new or whose write time changed
+        size_t files { 0 };
+        bool loaded_from_cache { false };
+    };
+
+    class asset_catalog
+    {
+    public:
+
+        struct entry
+        {
+            std::string path;      // full path, '/' separated
+            std::string name;      // path relative to its root, without extension
+            std::string stem;      // lowercase file name without extension
+            std::string extension; // lowercase, without the dot
+        };
+
+    private:
+
+        struct directory_listing
+        {
+            int64_t write_time { 0 };
+            std::vector<std::string> files;
+            std::vector<std::string> subdirectories;
+        };
+
+        struct catalog_root
+        {
+            std::string path;
+            std::unordered_map<std::string, directory_listing> directories; // keyed by path relative to the root, "" for the root itself
+            asset_catalog_stats stats;
+        };
+
+        std::string cache_directory;
+        std::vector<catalog_root> roots;
+
+        std::vector<entry> entries;
+        std::unordered_map<std::string, std::vector<uint32_t>> by_stem;
+        std::unordered_map<std::string, std::vector<uint32_t>> by_extension;
+
+        std::string cache_path(const catalog_root & root) const;
+        bool load_cache(catalog_root & root) const;
+        void save_cache(const catalog_root & root) const;
+        bool refresh_root(catalog_root & root); // returns true if anything changed
+        void rebuild_index();
+
+    public:
+
+        // Cache files are written to cache_directory, named by a hash of each root; empty disables caching
+        explicit asset_catalog(const std::string & cache_directory = default_cache_directory());
+
+        static std::string default_cache_directory();
+
+        // Indexes a directory recursively, starting from its cache file when there is one. Adding a root
+        // twice is a no-op.
+        void add_root(const std::string & root);
+
+        // Revalidates every root against the file system, listing only directories that changed, and
+        // rewrites the cache files of roots that changed
+        void refresh();
+
+        // Entries whose lowercase stem is stem, in the order the roots were added
+        std::vector<const entry *> find(const std::string & stem) const;
+
+        // Entries with a lowercase extension (without the dot)
+        std::vector<const entry *> find_extension(const std::string & extension) const;
+
+        size_t size() const { return entries.size(); }
+        bool contains_root(const std::string & root) const;
+
+        // Stats of the most recent refresh of a root, or empty stats for an unknown root
+        asset_catalog_stats get_stats(const std::string & root) const;
+    };
+
+} // end namespace polymer
+
+#endif // end polymer_asset_catalog_hpp
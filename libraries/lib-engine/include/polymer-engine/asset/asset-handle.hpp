@@ -18,12 +18,24 @@
 namespace polymer
 {
 
+    // Lifecycle of an asset in the handle table. Handles that are `loading` or `failed` hold a default
+    // constructed asset which the renderer treats as a placeholder (an empty gl_mesh draws nothing; an
+    // unassigned texture slot compiles the material variant without that map).
+    enum class asset_state : uint8_t
+    {
+        unresolved, // no entry, or default constructed by a lookup
+        loading,    // scheduled by the asset_resolver; decoding or waiting for its gpu upload
+        ready,      // assigned
+        failed      // the resolver could not load it
+    };
+
     // Note that the asset of `polymer_unique_asset` must be default constructable.
     template<typename T>
     struct polymer_unique_asset : public non_copyable
     {
         T asset;
         bool assigned{ false };
+        asset_state state{ asset_state::unresolved };
         uint64_t timestamp;
     };
 
@@ -40,6 +52,20 @@ namespace polymer
         // Private constructor for the static list() method below.
         asset_handle(const::std::string & id, std::shared_ptr<polymer_unique_asset<T>> h) : name(id), handle(h) {}
 
+        // Table entry for this name, created (without a warning) if missing
+        polymer_unique_asset<T> & entry() const
+        {
+            if (handle) return *handle;
+            auto & a = table[name];
+            if (!a)
+            {
+                a = std::make_shared<polymer_unique_asset<T>>();
+                a->timestamp = system_time_ns();
+            }
+            handle = a;
+            return *handle;
+        }
+
     public:
 
         std::string name;
@@ -105,6 +131,7 @@ namespace polymer
             handle = a;
             handle->asset = std::move(asset);
             handle->assigned = name.empty() || name == "empty" ? false : true;
+            handle->state = handle->assigned ? asset_state::ready : asset_state::unresolved;
             handle->timestamp = system_time_ns();
 
             #ifdef ASSET_DEBUG_SPAM
@@ -128,6 +155,28 @@ namespace polymer
             return false;
         }
 
+        asset_state get_state() const
+        {
+            if (handle) return handle->state;
+
+            // Search for it, but don't default construct
+            auto itr = table.find(name);
+            if (itr != table.end())
+            {
+                handle = itr->second;
+                return handle->state;
+            }
+            return asset_state::unresolved;
+        }
+
+        bool is_loading() const { return get_state() == asset_state::loading; }
+        bool is_ready() const { return get_state() == asset_state::ready; }
+
+        // Used by the asset_resolver, which owns the transitions between loading and ready/failed. Only a
+        // handle that is not yet ready can be marked; the placeholder stays in the table until assign().
+        void mark_loading() const { auto & e = entry(); if (e.state != asset_state::ready) e.state = asset_state::loading; }
+        void mark_failed() const { auto & e = entry(); if (e.state != asset_state::ready) e.state = asset_state::failed; }
+
         uint64_t get_timestamp() const
         {
             if (handle) return handle->timestamp;
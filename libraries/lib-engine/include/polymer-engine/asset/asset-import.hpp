@@ -214,6 +214,7 @@ namespace polymer
         {
             runtime_mesh mesh_copy = prim.mesh;
             rescale_geometry(mesh_copy, 1.f);
+            optimize_model(mesh_copy);
 
             std::string mesh_handle_name = name_no_ext + "/mesh_" + std::to_string(prim_idx);
 
@@ -321,6 +322,7 @@ namespace polymer
         {
             auto & mesh = m.second;
             rescale_geometry(mesh, 1.f);
+            optimize_model(mesh);
 
             const std::string handle_id = name_no_ext + "/" + m.first;
 
@@ -5,14 +5,17 @@
  * including `environment`, `material_library`, and `shader_library`. During deserialization, these
  * handles are not assocated with any actual resource. This class compares handles in the containers
  * to assigned assets in the `asset_handle<T>` table. If an unassigned resource is found, the asset
- * handle identifier is used as a key to recursively search an asset folder for a matching filename
+ * handle identifier is looked up in an `asset_catalog` of the search paths to find a matching filename
  * where the asset is loaded.
  *
  * (todo) Presently we assume that all handle identifiers refer to unique assets, however this is a weak
  * assumption and is likely untrue in practice and should be fixed.
  *
- * (todo) The asset_resolver is single-threaded and called on the main thread because it may also
- * touch GPU resources. This must be changed to load asynchronously. 
+ * Loading is asynchronous and split in two stages. Loader threads do the file IO, image decoding, model
+ * import and optimization, and `.material` parsing into CPU-side `staged_asset`s. `update()` runs on the
+ * main thread and drains them under a per-call byte budget, creating GL textures and meshes by streaming
+ * through a persistently mapped staging ring. Handles are marked `loading` when scheduled, so callers
+ * can draw placeholders (see `asset_state`) until they become `ready`.
  */
 
 #pragma once
@@ -22,14 +25,24 @@
 
 #include "polymer-engine/asset/asset-handle.hpp"
 #include "polymer-engine/asset/asset-handle-utils.hpp"
+#include "polymer-engine/asset/asset-catalog.hpp"
 #include "polymer-engine/renderer/renderer-pbr.hpp"
 #include "polymer-engine/material-library.hpp"
 
 #include "polymer-core/util/string-utils.hpp"
+#include "polymer-core/util/thread-pool.hpp"
+
+#include "polymer-gfx-gl/gl-mesh-util.hpp"
+#include "polymer-gfx-gl/gl-streaming-buffer.hpp"
 
 #include "polymer-model-io/model-io.hpp"
 #include "nlohmann/json.hpp"
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
 using namespace std::filesystem;
 
 namespace polymer
@@ -43,6 +56,18 @@ namespace polymer
 
         std::string find_asset_directory(const std::vector<std::string> search_paths)
         {
+            // Most layouts keep `assets` directly under one of the search paths; only walk when none does
+            for (const std::string & search_path : search_paths)
+            {
+                std::error_code ec;
+                const path candidate = path(search_path) / "assets";
+                if (std::filesystem::is_directory(candidate, ec) && !ec)
+                {
+                    log::get()->engine_log->info("found asset dir {}", candidate.string());
+                    return candidate.string();
+                }
+            }
+
             for (const std::string & search_path : search_paths)
             {
                 std::error_code ec;
@@ -105,14 +130,53 @@ namespace polymer
         else return name;
     }
 
+    // CPU-side result of loading one file on a loader thread, waiting for asset_resolver::update()
+    struct staged_asset
+    {
+        enum class asset_type : uint8_t { texture, cubemap, model, material };
+
+        asset_type type { asset_type::texture };
+        std::string path;
+        std::string name;  // handle id of a texture or cubemap; lowercase file stem of a model or material
+        std::string error; // non-empty if loading failed
+
+        // texture: tightly packed rows, as decoded
+        std::vector<uint8_t> pixels;
+        int32_t width { 0 }, height { 0 }, channels { 0 };
+        bool srgb { false };
+
+        // cubemap
+        gli::texture_cube cubemap;
+
+        // model: submesh name and geometry, rescaled and optimized, with its interleaved vertices
+        std::vector<std::pair<std::string, runtime_mesh>> meshes;
+        std::vector<interleaved_geometry> vertices;
+
+        // material
+        std::vector<material_library::material_instance> materials;
+
+        // Bytes this asset sends to the gpu, charged against the upload budget
+        size_t upload_bytes() const;
+    };
+
+    struct asset_resolver_options
+    {
+        uint32_t loader_threads = 2;                    // background threads for file io and decoding
+        size_t upload_budget_bytes = 16 * 1024 * 1024;  // default budget of update(); at least one asset is always uploaded
+        size_t staging_buffer_bytes = 32 * 1024 * 1024; // persistently mapped upload ring; larger assets upload directly, 0 disables
+        std::string catalog_cache_directory = asset_catalog::default_cache_directory(); // empty disables the catalog cache files
+    };
+
     // The purpose of an asset resolver is to match an asset_handle to a file on disk. This is done
     // for scene objects (meshes, geometry) and materials (shaders, textures, cubemaps). The asset
     // resolver works in two passes, namely because materials require other shaders and textures
-    // and we need to resolve those too. 
+    // and we need to resolve those too: once every scheduled material has been registered, the
+    // search paths are walked again for the textures those materials reference.
     class asset_resolver
     {
         scene * the_scene;
         material_library * mat_library;
+        asset_resolver_options options;
 
         // Unresolved asset names
         std::vector<std::string> mesh_names;
@@ -121,123 +185,61 @@ namespace polymer
         std::vector<std::string> texture_names;
 
         std::vector<std::string> search_paths;
+        asset_catalog catalog;
 
         std::unordered_map<uint32_t, bool> resolved;
 
-        // fixme - what to do if we find multiples? 
-        void walk_directory(path root)
-        {
-            for (auto & entry : recursive_directory_iterator(root))
-            {
-                const size_t root_len = root.string().length(), ext_len = entry.path().extension().string().length();
-                auto path = entry.path().string(), name = path.substr(root_len + 1, path.size() - root_len - ext_len - 1);
-                for (auto & chr : path) if (chr == '\\') chr = '/';
-
-                std::string ext = get_extension(path);
-                std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
-
-                std::string filename_no_ext = get_filename_without_extension(path);
-                std::transform(filename_no_ext.begin(), filename_no_ext.end(), filename_no_ext.begin(), ::tolower);
-
-                // returns true if not in the cache
-                auto asset_resolve_cache = [&](const std::string & name, const std::string & type_id) -> bool
-                {
-                    const uint32_t key = poly_hash_fnv1a(type_id + "/" + name);
-                    auto iter = resolved.find(key);
-
-                    if (iter == resolved.end())
-                    {
-                        resolved[key] = true;
-                        log::get()->engine_log->info("resolved: {} ({})", name, type_id);
-                        return true;
-                    }
-                    return false;
-                };
+        // Loader threads -> main thread
+        std::unique_ptr<simple_thread_pool> loaders;
+        std::mutex staged_mutex;
+        std::condition_variable staged_cv;
+        std::deque<std::unique_ptr<staged_asset>> staged;
+        uint32_t loads_in_flight { 0 }; // scheduled and not yet staged; guarded by staged_mutex
+        std::atomic<bool> cancelled { false };
+
+        // Main thread only
+        uint32_t materials_in_flight { 0 }; // material files scheduled and not yet registered
+        bool rescan_pending { false };      // a material was registered since the last walk
+        gl_streaming_buffer staging_buffer;
+
+        // Schedules every unresolved name that has a file in the catalog
+        // fixme - what to do if we find multiples?
+        void schedule_from_catalog();
+        void collect_shaders_and_textures();
+        void schedule(staged_asset::asset_type type, const std::string & path, const std::string & name);
+        void upload(staged_asset & asset);
+        uint8_t * allocate_staging(const size_t size_bytes, GLintptr & offset);
 
-                if (ext == "material")
-                {
-                    if (asset_resolve_cache(name, "material"))
-                    {
-                        mat_library->import_material(path);
-                    }
-                }
-                else if (ext == "png" || ext == "tga" || ext == "jpg" || ext == "jpeg")
-                {
-                    for (const auto & name : texture_names)
-                    {
-                        if (name == filename_no_ext)
-                        {
-                            if (asset_resolve_cache(name, typeid(gl_texture_2d).name()))
-                            {
-                                if (is_srgb_texture(path))
-                                {
-                                    create_handle_for_asset(name.c_str(), load_image_srgb(path, false));
-                                }
-                                else
-                                {
-                                    create_handle_for_asset(name.c_str(), load_image(path, false));
-                                }
-                            }
-                        }
-                    }
-                }
-                else if (ext == "dds")
-                {
-                    for (const auto & name : texture_names)
-                    {
-                        if (name == filename_no_ext)
-                        {
-                            if (asset_resolve_cache(name, "dds-cubemap"))
-                            {
-                                auto cubemap_binary = read_file_binary(path);
-                                gli::texture_cube cubemap_as_gli_cubemap(gli::load_dds((char *)cubemap_binary.data(), cubemap_binary.size()));
-                                create_handle_for_asset(filename_no_ext.c_str(), load_cubemap(cubemap_as_gli_cubemap));
+    public:
 
-                            }
-                        }
-                    }
-                }
-                else if (ext == "obj" || ext == "fbx" || ext == "ply" || ext == "mesh")
-                {
-                    // Name could either be something like "my_mesh" or "my_mesh/sub_component"
-                    // `mesh_names` contains both CPU and GPU geometry handle ids
-                    for (const auto & name : mesh_names)
-                    {
-                        // "my_mesh/sub_component" should match to "my_mesh.obj" or similar
-                        if (find_root(name) == filename_no_ext)
-                        {
-                            std::unordered_map<std::string, runtime_mesh> imported_models = import_model(path);
+        asset_resolver(polymer::scene * the_scene, material_library * mat_library, const asset_resolver_options & options = {})
+            : the_scene(the_scene), mat_library(mat_library), options(options), catalog(options.catalog_cache_directory) {}
 
-                            for (auto & m : imported_models)
-                            {
-                                if (asset_resolve_cache(name, typeid(gl_mesh).name()))
-                                {
-                                    auto & mesh = m.second;
-                                    rescale_geometry(mesh, 1.f);
+        ~asset_resolver();
 
-                                    const std::string handle_id = filename_no_ext + "/" + m.first;
+        // Schedules every unresolved asset referenced by the scene and its materials and returns immediately.
+        // Call update() every frame until pending() is false.
+        void resolve_async();
 
-                                    create_handle_for_asset(handle_id.c_str(), make_mesh_from_geometry(mesh));
-                                    create_handle_for_asset(handle_id.c_str(), std::move(mesh));
-                                }
-                            }
-                        }
-                    }
-                }
-            }
-        }
+        // Main thread. Uploads staged assets until budget_bytes have been sent to the gpu (at least one
+        // asset per call), and walks the search paths again once newly imported materials are registered.
+        void update(const size_t budget_bytes);
+        void update() { update(options.upload_budget_bytes); }
 
-    public:
+        // True while assets are being loaded, wait for upload, or a material rescan is outstanding
+        bool pending();
 
+        // Blocking form of resolve_async(): returns once every scheduled asset has been uploaded
         void resolve();
 
-        asset_resolver(polymer::scene * the_scene, material_library * mat_library)
-            : the_scene(the_scene), mat_library(mat_library) {}
-
+        // Search paths are indexed into the catalog when added, and revalidated by every resolve
         void add_search_path(const std::string & search_path)
         {
             search_paths.push_back(search_path);
+            catalog.add_root(search_path);
         }
+
+        const asset_catalog & get_catalog() const { return catalog; }
     };
 
 } // end namespace polymer
@@ -63,7 +63,9 @@ namespace polymer
             // element being added or because the "back" array is full.
             if (objects.empty() || objects.back().size() == page_size)
             {
-                objects.emplace_back(page_size);
+                // Reserve (rather than size) the page so that it never reallocates while filling
+                objects.emplace_back();
+                objects.back().reserve(page_size);
             }
 
             // Add the element to the "end" of the ArrayVector.
@@ -0,0 +1,189 @@
+#pragma once
+
+#ifndef polymer_component_store_hpp
+#define polymer_component_store_hpp
+
+#include "polymer-engine/ecs/typeid.hpp"
+#include "polymer-engine/ecs/core-ecs.hpp"
+#include "polymer-engine/ecs/component-pool.hpp"
+
+#include <memory>
+#include <tuple>
+#include <unordered_map>
+
+namespace polymer
+{
+    /////////////////////////
+    //   component_entry   //
+    /////////////////////////
+
+    // Components are stored by value next to the entity that owns them so that iterating a pool
+    // never has to leave the page it is walking to discover who a component belongs to.
+    template <typename T>
+    struct component_entry
+    {
+        entity e;
+        T value;
+        component_entry(const entity & e, const T & value) : e(e), value(value) {}
+    };
+
+    template <typename T>
+    struct component_entry_key
+    {
+        const entity & operator()(const component_entry<T> & c) const { return c.e; }
+    };
+
+    ////////////////////////
+    //   component_pool   //
+    ////////////////////////
+
+    class base_component_pool
+    {
+    public:
+        virtual ~base_component_pool() {}
+        virtual bool contains(const entity & e) const = 0;
+        virtual void destroy(const entity & e) = 0;
+        virtual void clear() = 0;
+        virtual size_t size() const = 0;
+    };
+
+    // Dense storage for a single component type. Components live in contiguous pages, so a
+    // pointer to a component remains valid until a component of the *same* type is removed
+    // (removal is a swap-and-pop). Do not hold component pointers across frames.
+    template <typename T>
+    class component_pool final : public base_component_pool
+    {
+        unordered_vector_map<entity, component_entry<T>, component_entry_key<T>> storage;
+        uint64_t version {0};
+
+    public:
+
+        explicit component_pool(size_t page_size = 1024) : storage(page_size) {}
+
+        T * emplace(const entity & e, const T & value)
+        {
+            if (auto * existing = storage.get(e))
+            {
+                existing->value = value;
+                return &existing->value;
+            }
+            return &storage.emplace(e, value)->value;
+        }
+
+        T * get(const entity & e)
+        {
+            auto * c = storage.get(e);
+            return c ? &c->value : nullptr;
+        }
+
+        const T * get(const entity & e) const
+        {
+            const auto * c = storage.get(e);
+            return c ? &c->value : nullptr;
+        }
+
+        // f(const entity &, T &)
+        template <typename F>
+        void for_each(F && f)
+        {
+            for (auto & c : storage) f(static_cast<const entity &>(c.e), c.value);
+        }
+
+        // Incremented whenever a removal may have relocated components, invalidating held pointers
+        uint64_t layout_version() const { return version; }
+
+        bool contains(const entity & e) const override final { return storage.contains(e); }
+        void destroy(const entity & e) override final { if (storage.contains(e)) { storage.destroy(e); ++version; } }
+        void clear() override final { storage.clear(); ++version; }
+        size_t size() const override final { return storage.size(); }
+    };
+
+    /////////////////////////
+    //   component_store   //
+    /////////////////////////
+
+    // Owns one component_pool per component type. The scene_graph keeps a single store and every
+    // base_object that has been added to the graph resolves get_component<T>() through it.
+    class component_store
+    {
+        std::unordered_map<poly_typeid, std::unique_ptr<base_component_pool>> pools;
+
+    public:
+
+        component_store() = default;
+        component_store(const component_store &) = delete;
+        component_store & operator = (const component_store &) = delete;
+
+        template <typename T>
+        component_pool<T> & pool()
+        {
+            auto & p = pools[get_typeid<T>()];
+            if (!p) p.reset(new component_pool<T>());
+            return *static_cast<component_pool<T> *>(p.get());
+        }
+
+        template <typename T>
+        component_pool<T> * find_pool()
+        {
+            auto it = pools.find(get_typeid<T>());
+            return (it != pools.end()) ? static_cast<component_pool<T> *>(it->second.get()) : nullptr;
+        }
+
+        // Adds or overwrites the component of type T owned by e
+        template <typename T>
+        T * add(const entity & e, const T & value) { return pool<T>().emplace(e, value); }
+
+        template <typename T>
+        T * get(const entity & e)
+        {
+            component_pool<T> * p = find_pool<T>();
+            return p ? p->get(e) : nullptr;
+        }
+
+        template <typename T>
+        bool contains(const entity & e)
+        {
+            component_pool<T> * p = find_pool<T>();
+            return p ? p->contains(e) : false;
+        }
+
+        template <typename T>
+        void remove(const entity & e)
+        {
+            if (component_pool<T> * p = find_pool<T>()) p->destroy(e);
+        }
+
+        void remove_all(const entity & e)
+        {
+            for (auto & p : pools) p.second->destroy(e);
+        }
+
+        void clear()
+        {
+            for (auto & p : pools) p.second->clear();
+        }
+
+        // Invokes f(const entity &, A &, B &, ...) for every entity that owns all of the listed
+        // component types. Iteration streams through the dense array of the first type and
+        // resolves the remaining types by O(1) lookup, so the rarest type should come first.
+        template <typename First, typename... Rest, typename F>
+        void view(F && f)
+        {
+            component_pool<First> * driver = find_pool<First>();
+            if (!driver) return;
+
+            std::tuple<component_pool<Rest> *...> others { find_pool<Rest>()... };
+            if (((std::get<component_pool<Rest> *>(others) == nullptr) || ...)) return;
+
+            driver->for_each([&](const entity & e, First & first)
+            {
+                std::tuple<Rest *...> rest { std::get<component_pool<Rest> *>(others)->get(e)... };
+                if (((std::get<Rest *>(rest) == nullptr) || ...)) return;
+                f(e, first, *std::get<Rest *>(rest)...);
+            });
+        }
+    };
+
+} // end namespace polymer
+
+#endif // end polymer_component_store_hpp
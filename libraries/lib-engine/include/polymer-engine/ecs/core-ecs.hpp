@@ -15,6 +15,27 @@ namespace polymer
     using entity = guid;
     const entity kInvalidEntity = guid(std::array<uint8_t, 16>{0000000000000000});
 
+    ///////////////////////
+    //   entity_handle   //
+    ///////////////////////
+
+    // A dense 32-bit handle issued by the scene_graph when an object is added. The low 24 bits
+    // index directly into the graph's handle table and the high 8 bits are a generation counter
+    // so that a handle to a destroyed object does not alias a newer object reusing its slot.
+    // Handles are runtime-only and are never serialized; the guid remains the persistent identity.
+    using entity_handle = uint32_t;
+    const entity_handle kInvalidEntityHandle = 0xFFFFFFFF;
+
+    constexpr uint32_t kEntityHandleIndexBits = 24;
+    constexpr uint32_t kEntityHandleIndexMask = (1u << kEntityHandleIndexBits) - 1;
+
+    inline uint32_t entity_handle_index(const entity_handle h) { return h & kEntityHandleIndexMask; }
+    inline uint32_t entity_handle_generation(const entity_handle h) { return h >> kEntityHandleIndexBits; }
+    inline entity_handle make_entity_handle(const uint32_t index, const uint32_t generation)
+    {
+        return ((generation & 0xFF) << kEntityHandleIndexBits) | (index & kEntityHandleIndexMask);
+    }
+
 } // end namespace polymer
 
 #endif // polymer_base_ecs_hpp
@@ -16,6 +16,7 @@
 #include "polymer-engine/renderer/renderer-debug.hpp"
 #include "polymer-engine/renderer/renderer-util.hpp"
 
+#include "polymer-engine/animation.hpp"
 #include "polymer-engine/profiling.hpp"
 #include "polymer-engine/logging.hpp"
 #include "polymer-engine/shader.hpp"
@@ -47,6 +47,11 @@ namespace polymer
         // Deserializes *.material file from disk, importing into the local instances and creating a handle in the global table
         void import_material(const std::string & path);
 
+        // The two halves of import_material. parse_material only reads and deserializes the file, so it can
+        // run on a worker thread; add_parsed_material registers the result and must run on the main thread.
+        static std::vector<material_instance> parse_material(const std::string & path);
+        void add_parsed_material(const std::vector<material_instance> & parsed);
+
         // Serializes a named material instance into a *.material file onto disk
         void export_material(const std::string & key);
 
@@ -50,6 +50,10 @@ namespace polymer
         mutable cached_variant compiled_shader{ nullptr };  // cached on first access (because needs to happen on GL thread)
         shader_handle shader;                               // typically set during object inflation / deserialization
         virtual void update_uniforms(material_component * comp = nullptr) {} // generic interface for overriding specific uniform sets
+        virtual void update_uniforms_shadow(GLuint handle) {}                                       // after update_uniforms, if the material receives shadows
+        virtual void update_uniforms_ibl(GLuint irradiance, GLuint radiance, GLuint dfg_lut) {}     // after update_uniforms, if the material uses image-based lighting
+        virtual void update_uniforms_refraction(GLuint scene_color, GLuint scene_depth, float2 resolution) {} // after update_uniforms, translucent materials only
+        virtual bool is_translucent() const { return false; } // drawn after opaques, back to front and blended, sampling the resolved scene
         virtual void use() {}                               // generic interface for binding the program
         virtual void resolve_variants() = 0;                // all overridden functions need to call this to cache the shader
         virtual uint32_t id() = 0;                          // returns the gl handle, used for sorting materials by type to minimize state changes in the renderer
@@ -83,7 +87,7 @@ namespace polymer
         virtual void resolve_variants() override final;
         virtual uint32_t id() override final;
         virtual void update_uniforms(material_component * comp = nullptr) override final;
-        std::function<void()> update_uniform_func;
+        std::function<void()> update_uniform_func; // called with the program bound
     };
     POLYMER_SETUP_TYPEID(polymer_procedural_material);
 
@@ -99,6 +103,7 @@ namespace polymer
     {
         float4 color{ 1, 1, 1, 1}; // opacity is actually taken from base_material
         polymer_wireframe_material();
+        virtual void update_uniforms(material_component * comp = nullptr) override final;
         virtual void use() override final;
         virtual void resolve_variants() override final;
         virtual uint32_t id() override final;
@@ -125,7 +130,7 @@ namespace polymer
         virtual uint32_t id() override final;
         virtual void update_uniforms(material_component * comp = nullptr) override final;
 
-        void update_uniforms_shadow(GLuint handle);
+        virtual void update_uniforms_shadow(GLuint handle) override final;
 
         float2 texcoordScale{ 1.f, 1.f };
 
@@ -191,8 +196,8 @@ namespace polymer
         virtual void resolve_variants() override final;
         virtual uint32_t id() override final;
 
-        void update_uniforms_shadow(GLuint handle);
-        void update_uniforms_ibl(GLuint irradiance, GLuint radiance, GLuint dfg_lut);
+        virtual void update_uniforms_shadow(GLuint handle) override final;
+        virtual void update_uniforms_ibl(GLuint irradiance, GLuint radiance, GLuint dfg_lut) override final;
 
         std::unordered_map<std::string, uniform_variant_t> uniform_table
         {
@@ -282,8 +287,9 @@ namespace polymer
         virtual void resolve_variants() override final;
         virtual uint32_t id() override final;
 
-        void update_uniforms_ibl(GLuint irradiance, GLuint radiance, GLuint dfg_lut);
-        void update_uniforms_refraction(GLuint scene_color, GLuint scene_depth, float2 resolution);
+        virtual void update_uniforms_ibl(GLuint irradiance, GLuint radiance, GLuint dfg_lut) override final;
+        virtual void update_uniforms_refraction(GLuint scene_color, GLuint scene_depth, float2 resolution) override final;
+        virtual bool is_translucent() const override final { return true; }
 
         std::unordered_map<std::string, uniform_variant_t> uniform_table
         {
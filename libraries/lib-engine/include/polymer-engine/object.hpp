@@ -13,6 +13,8 @@
 #include "polymer-engine/material-library.hpp"
 #include "polymer-engine/ecs/core-ecs.hpp"
 #include "polymer-engine/ecs/component-pool.hpp"
+#include "polymer-engine/ecs/component-store.hpp"
+#include "polymer-engine/system/system-transform.hpp"
 #include "nlohmann/json.hpp"
 
 #include "polymer-engine/renderer/renderer-procedural-sky.hpp"
@@ -454,12 +456,15 @@ namespace polymer
         friend class scene_graph;
     private: 
         polymer::transform world_pose;
+        polymer::float3 world_scale {1, 1, 1};
     public:
         polymer::transform local_pose;
         polymer::float3 local_scale {1, 1, 1};
         transform_component() {};
         transform_component(transform t, float3 s) : local_pose(t), local_scale(s) {};
         transform get_world_transform() const { return world_pose; }
+        float3 get_world_scale() const { return world_scale; }
+        float4x4 get_world_matrix() const { return world_pose.matrix() * make_scaling_matrix(world_scale); }
         virtual ~transform_component() {};
     };
     POLYMER_SETUP_TYPEID(transform_component);
@@ -509,12 +514,29 @@ namespace polymer
         friend class scene_graph;
 
         entity e {kInvalidEntity};
+        entity_handle handle {kInvalidEntityHandle}; // issued by the scene_graph, not serialized
+        uint32_t transform_index {transform_system::kInvalidIndex}; // slot in the scene_graph's flattened hierarchy
 
         entity parent {kInvalidEntity};
         std::vector<entity> children;
 
-        transform_component transform;
-        std::unordered_map<poly_typeid, std::shared_ptr<base_component>> components;
+        // Components added before the object is handed to a scene_graph are staged here. When the
+        // object is added to a graph they are committed into the graph's component_store and all
+        // subsequent component access goes through the store.
+        struct staged_component
+        {
+            std::shared_ptr<base_component> value;
+            void (*commit)(component_store & store, const entity & e, const base_component & value);
+        };
+
+        template <typename T>
+        static void commit_component(component_store & store, const entity & e, const base_component & value)
+        {
+            store.add<T>(e, static_cast<const T &>(value));
+        }
+
+        std::unordered_map<poly_typeid, staged_component> staged_components;
+        component_store * store {nullptr};
 
         // Back-pointer to owning scene (set by scene_graph when added)
         scene * owning_scene {nullptr};
@@ -528,23 +550,27 @@ namespace polymer
         base_object()
         {
             e = make_guid();
+            add_component(transform_component());
         }
 
         // only for serialization!
         base_object(const entity & from)
         {
             e = from;
+            add_component(transform_component());
         }
 
         base_object(const std::string & name) : name(name)
         {
             e = make_guid();
+            add_component(transform_component());
         }
 
         // Virtual destructor for inheritance
         virtual ~base_object() = default;
 
         entity get_entity() const { return e; }
+        entity_handle get_handle() const { return handle; }
 
         // Scene access
         scene * get_scene() const { return owning_scene; }
@@ -565,10 +591,17 @@ namespace polymer
         template <typename T>
         void add_component(const T & component)
         {
-            std::shared_ptr<T> shared = std::make_shared<T>();
-            *shared = component;
             auto tid = get_typeid<T>();
-            components[tid] = shared;
+
+            if (store != nullptr)
+            {
+                store->add<T>(e, component);
+            }
+            else
+            {
+                std::shared_ptr<T> shared = std::make_shared<T>(component);
+                staged_components[tid] = { shared, &commit_component<T> };
+            }
 
             // Auto-register with systems if we have a scene
             if (owning_scene != nullptr)
@@ -577,45 +610,37 @@ namespace polymer
             }
         }
 
-        template <>
-        void add_component(const transform_component & component)
-        {
-            transform = component;
-        }
-
         template <typename T>
         void remove_component()
         {
             auto tid = get_typeid<T>();
-            auto it = components.find(tid);
-            if (it != components.end())
+
+            if (store != nullptr)
             {
-                // Auto-unregister from systems
-                if (owning_scene != nullptr)
+                if (store->contains<T>(e))
                 {
-                    notify_component_removed(tid);
+                    // Auto-unregister from systems
+                    if (owning_scene != nullptr)
+                    {
+                        notify_component_removed(tid);
+                    }
+                    store->remove<T>(e);
                 }
-                components.erase(it);
+            }
+            else
+            {
+                staged_components.erase(tid);
             }
         }
 
         template <typename T>
         T * get_component()
         {
-            auto it = components.find(get_typeid<T>());
-            if (it != components.end())
-            {
-                auto & obj     = (it->second);
-                auto component = dynamic_cast<T *>(obj.get());
-                return component;
-            }
-            return nullptr;
-        }
+            if (store != nullptr) return store->get<T>(e);
 
-        template <>
-        transform_component * get_component()
-        {
-            return &transform;
+            auto it = staged_components.find(get_typeid<T>());
+            if (it != staged_components.end()) return static_cast<T *>(it->second.value.get());
+            return nullptr;
         }
 
     private:
@@ -638,26 +663,137 @@ namespace polymer
     {
         scene * owning_scene {nullptr};
 
-        void recalculate_world_transform(entity child)
+        // Dense per-type storage for the components of every object in the graph
+        component_store components;
+
+        // Flattened copy of the hierarchy used to propagate world transforms in one linear pass.
+        // flat_transforms[i] is the component for node i; those pointers are only valid while the
+        // transform pool's layout_version matches flat_layout_version.
+        transform_system transforms;
+        std::vector<transform_component *> flat_transforms;
+        uint64_t flat_layout_version {0};
+        bool transforms_topology_dirty {true};
+
+        // Immediately updates the world transform of a single subtree. Used after structural edits
+        // so that callers observe correct world poses without waiting for the next refresh().
+        void recalculate_world_transform(entity root)
         {
-            base_object & node = graph_objects[child];
+            std::vector<entity> stack = { root };
+            while (!stack.empty())
+            {
+                const entity child = stack.back();
+                stack.pop_back();
+
+                auto it = graph_objects.find(child);
+                if (it == graph_objects.end()) continue;
+                base_object & node = it->second;
+
+                transform_component * xform = components.get<transform_component>(child);
+                if (!xform) continue;
 
-            // If the node has a parent then we can compute a new world transform.
-            // Note that during deserialization we might not have created the parent yet
-            // so we are allowed to no-op given a null parent node
-            if (node.parent != kInvalidEntity)
+                // If the node has a parent then we can compute a new world transform.
+                // Note that during deserialization we might not have created the parent yet
+                // so we are allowed to no-op given a null parent node
+                transform_component * parent_xform = (node.parent != kInvalidEntity) ? components.get<transform_component>(node.parent) : nullptr;
+                if (parent_xform)
+                {
+                    compose_world_transform(parent_xform->world_pose, parent_xform->world_scale,
+                        xform->local_pose, xform->local_scale, xform->world_pose, xform->world_scale);
+                }
+                else
+                {
+                    // If the node has no parent, it should be considered already in world space.
+                    xform->world_pose = xform->local_pose;
+                    xform->world_scale = xform->local_scale;
+                }
+
+                for (const entity & c : node.children) stack.push_back(c);
+            }
+        }
+
+        // Visits the subtree under `root` in pre-order, appending each node to the flat hierarchy.
+        // Only follows child links that agree with the child's parent link.
+        void flatten_subtree(base_object & root, std::vector<base_object *> & stack)
+        {
+            stack.clear();
+            stack.push_back(&root);
+            while (!stack.empty())
             {
-                auto & parent_node = graph_objects[node.parent];
-                node.transform.world_pose = parent_node.transform.local_pose * node.transform.local_pose;
+                base_object * node = stack.back();
+                stack.pop_back();
+
+                transform_component * xform = components.get<transform_component>(node->e);
+                if (!xform) continue;
+
+                uint32_t parent_index = transform_system::kInvalidIndex;
+                if (node->parent != kInvalidEntity)
+                {
+                    auto p = graph_objects.find(node->parent);
+                    if (p != graph_objects.end()) parent_index = p->second.transform_index;
+                }
+
+                node->transform_index = transforms.add(parent_index, xform->local_pose, xform->local_scale);
+                flat_transforms.push_back(xform);
+
+                // Reverse so that children are laid out in their listed order
+                for (auto c = node->children.rbegin(); c != node->children.rend(); ++c)
+                {
+                    auto child = graph_objects.find(*c);
+                    if (child == graph_objects.end()) continue;
+                    if (child->second.parent != node->e) continue;
+                    if (child->second.transform_index != transform_system::kInvalidIndex) continue;
+                    stack.push_back(&child->second);
+                }
             }
-            else
+        }
+
+        void rebuild_transform_hierarchy(const bool repair_orphans = true)
+        {
+            transforms.clear();
+            flat_transforms.clear();
+            transforms.reserve(graph_objects.size());
+            flat_transforms.reserve(graph_objects.size());
+
+            for (auto & kv : graph_objects) kv.second.transform_index = transform_system::kInvalidIndex;
+
+            std::vector<base_object *> stack;
+            for (auto & kv : graph_objects)
+            {
+                base_object & obj = kv.second;
+                const bool is_root = (obj.parent == kInvalidEntity) || (graph_objects.find(obj.parent) == graph_objects.end());
+                if (is_root) flatten_subtree(obj, stack);
+            }
+
+            if (flat_transforms.size() < graph_objects.size())
             {
-                // If the node has no parent, it should be considered already in world space.
-                node.transform.world_pose = node.transform.local_pose;
+                // Something is missing from its parent's list of children. Repair and start over.
+                if (repair_orphans)
+                {
+                    fix_parent_child_orphans();
+                    rebuild_transform_hierarchy(false);
+                    return;
+                }
+
+                // Whatever is still unreachable hangs off a cycle or an object without a transform.
+                // Place each such subtree as a root of its own.
+                for (auto & kv : graph_objects)
+                {
+                    base_object & obj = kv.second;
+                    if (obj.transform_index != transform_system::kInvalidIndex) continue;
+                    const entity parent = obj.parent;
+                    obj.parent = kInvalidEntity;
+                    flatten_subtree(obj, stack);
+                    obj.parent = parent;
+                }
             }
 
-            // For each child, calculate its new world transform
-            for (const entity & c : node.children) recalculate_world_transform(c);
+            flat_layout_version = components.pool<transform_component>().layout_version();
+            transforms_topology_dirty = false;
+        }
+
+        bool flat_transforms_valid()
+        {
+            return !transforms_topology_dirty && flat_layout_version == components.pool<transform_component>().layout_version();
         }
 
         void destroy_recursive(entity child, std::vector<entity> & destroyed_entities)
@@ -681,7 +817,10 @@ namespace polymer
             destroyed_entities.push_back(child);
 
             // Erase graph node
+            release_handle(node.handle);
+            components.remove_all(child);
             graph_objects.erase(child);
+            transforms_topology_dirty = true;
         }
 
         // Resolve orphans. For instance, if we change the parent of an entity using the UI, it never gets added to
@@ -704,6 +843,52 @@ namespace polymer
             }
         }
 
+        // Dense handle table. Nodes of an unordered_map are never relocated by a rehash, so the
+        // object pointers stay valid until the object itself is erased from graph_objects.
+        struct handle_slot
+        {
+            base_object * object {nullptr};
+            uint32_t generation {0};
+        };
+
+        std::vector<handle_slot> handle_table;
+        std::vector<uint32_t> free_handles;
+
+        entity_handle acquire_handle(base_object & obj)
+        {
+            uint32_t index;
+            if (!free_handles.empty())
+            {
+                index = free_handles.back();
+                free_handles.pop_back();
+            }
+            else
+            {
+                if (handle_table.size() >= kEntityHandleIndexMask) throw std::runtime_error("scene_graph handle table exhausted");
+                index = static_cast<uint32_t>(handle_table.size());
+                handle_table.emplace_back();
+            }
+
+            handle_slot & slot = handle_table[index];
+            slot.object = &obj;
+            return make_entity_handle(index, slot.generation);
+        }
+
+        void release_handle(entity_handle h)
+        {
+            if (h == kInvalidEntityHandle) return;
+            const uint32_t index = entity_handle_index(h);
+            if (index >= handle_table.size()) return;
+
+            handle_slot & slot = handle_table[index];
+            if (slot.generation != entity_handle_generation(h)) return;
+
+            // Generation 255 with the maximum index is reserved for kInvalidEntityHandle
+            slot.object = nullptr;
+            slot.generation = (slot.generation + 1) % 255;
+            free_handles.push_back(index);
+        }
+
         // template <class F>
         // friend void visit_components(entity e, transform_system * system, F f);
 
@@ -718,6 +903,12 @@ namespace polymer
         void clear()
         {
             graph_objects.clear();
+            handle_table.clear();
+            free_handles.clear();
+            components.clear();
+            transforms.clear();
+            flat_transforms.clear();
+            transforms_topology_dirty = true;
         }
 
         // Set scene pointer (called by scene constructor)
@@ -730,24 +921,42 @@ namespace polymer
         void add_object(T && object)
         {
             entity ent = object.get_entity();
+
+            // Replacing an existing object retires its handle and components
+            auto existing = graph_objects.find(ent);
+            if (existing != graph_objects.end())
+            {
+                release_handle(existing->second.handle);
+                components.remove_all(ent);
+            }
+
             graph_objects[ent] = std::move(object);
 
             // Set back-pointer
             base_object & obj = graph_objects[ent];
             obj.owning_scene = owning_scene;
+            obj.handle = acquire_handle(obj);
+
+            // Move staged components into the store. Every object in the graph has a transform.
+            obj.store = &components;
+            for (auto & [tid, staged] : obj.staged_components) staged.commit(components, ent, *staged.value);
+            if (!components.contains<transform_component>(ent)) components.add(ent, transform_component());
 
             // Initialize world transform from local transform
+            transforms_topology_dirty = true;
             recalculate_world_transform(ent);
 
             // Retroactively register any existing components
             if (owning_scene)
             {
-                for (auto & [tid, comp] : obj.components)
+                for (auto & [tid, staged] : obj.staged_components)
                 {
                     obj.notify_component_added(tid);
                 }
             }
 
+            obj.staged_components.clear();
+
             // Invoke on_create callback
             obj.on_create();
         }
@@ -755,6 +964,30 @@ namespace polymer
         // todo: use optional? what about disabled objects?
         base_object & get_object(const entity & e) { return graph_objects[e]; }
 
+        component_store & get_components() { return components; }
+
+        // Streams through the dense component pools, invoking f(const entity &, A &, B &, ...) for
+        // every object that owns all of the listed component types. See component_store::view.
+        template <typename... Ts, typename F>
+        void view(F && f) { components.view<Ts...>(std::forward<F>(f)); }
+
+        // O(1) lookup that bypasses hashing entirely. Returns nullptr if the handle is stale.
+        base_object * get_object_from_handle(const entity_handle h)
+        {
+            if (h == kInvalidEntityHandle) return nullptr;
+            const uint32_t index = entity_handle_index(h);
+            if (index >= handle_table.size()) return nullptr;
+            const handle_slot & slot = handle_table[index];
+            if (slot.generation != entity_handle_generation(h)) return nullptr;
+            return slot.object;
+        }
+
+        entity_handle get_handle(const entity & e) const
+        {
+            auto it = graph_objects.find(e);
+            return (it != graph_objects.end()) ? it->second.handle : kInvalidEntityHandle;
+        }
+
         bool add_child(entity parent, entity child)
         {
             if (parent == child) throw std::invalid_argument("parent and child cannot be the same");
@@ -763,7 +996,8 @@ namespace polymer
 
             graph_objects[parent].children.push_back(child);  // add to children list if not a top level root node
             graph_objects[child].parent = parent;
-            recalculate_world_transform(parent); 
+            transforms_topology_dirty = true;
+            recalculate_world_transform(child);
 
             return true;
         }
@@ -845,6 +1079,7 @@ namespace polymer
                 base_object & parent_node = graph_objects[child_node.parent];
                 parent_node.children.erase(std::remove(parent_node.children.begin(), parent_node.children.end(), child), parent_node.children.end());
                 child_node.parent = kInvalidEntity;
+                transforms_topology_dirty = true;
                 recalculate_world_transform(child);
             }
         }
@@ -872,13 +1107,51 @@ namespace polymer
             return destroyed_entities;
         }
 
-        void refresh()
+        // Sets the local transform of e and marks it dirty. The world transforms of e and its
+        // descendants are brought up to date by the next update_world_transforms() or refresh().
+        void set_local_transform(const entity & e, const transform & local_pose, const float3 & local_scale)
         {
-            for (auto & t : graph_objects)
+            auto it = graph_objects.find(e);
+            if (it == graph_objects.end()) return;
+
+            transform_component * xform = components.get<transform_component>(e);
+            if (!xform) return;
+
+            xform->local_pose = local_pose;
+            xform->local_scale = local_scale;
+
+            const uint32_t idx = it->second.transform_index;
+            if (flat_transforms_valid() && idx != transform_system::kInvalidIndex) transforms.set_local_transform(idx, local_pose, local_scale);
+        }
+
+        // Propagates world transforms for nodes changed through set_local_transform (and everything,
+        // if the hierarchy changed since the last update). Independent root subtrees are spread
+        // across the job system when one is given. Returns the number of world transforms written.
+        uint32_t update_world_transforms(job_system * jobs = nullptr)
+        {
+            if (!flat_transforms_valid()) rebuild_transform_hierarchy();
+
+            return transforms.update(jobs, [this](const uint32_t i)
             {
-                const auto e = t.second.get_entity();
-                if (e != kInvalidEntity) recalculate_world_transform(e); 
-            };
+                flat_transforms[i]->world_pose = transforms.world_poses[i];
+                flat_transforms[i]->world_scale = transforms.world_scales[i];
+            });
+        }
+
+        // Recomputes every world transform. Needed after writing transform_component::local_pose
+        // or local_scale directly, since those writes are not tracked.
+        void refresh(job_system * jobs = nullptr)
+        {
+            if (!flat_transforms_valid()) rebuild_transform_hierarchy();
+
+            for (uint32_t i = 0; i < transforms.size(); ++i)
+            {
+                transforms.local_poses[i] = flat_transforms[i]->local_pose;
+                transforms.local_scales[i] = flat_transforms[i]->local_scale;
+            }
+            transforms.mark_all_dirty();
+
+            update_world_transforms(jobs);
         }
     };
 
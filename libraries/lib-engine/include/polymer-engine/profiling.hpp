@@ -3,6 +3,9 @@
  * These timers are completely unrelated, but use the notion of an implicit interface
  * at compile time, such that both objects implement function signatures for 
  * start(), stop(), and elapsed_ms().
+ *
+ * Besides timings, a profiler averages named counters (sort disorder, draw counts, ...)
+ * reported once per frame through record().
  */
 
 #pragma once
@@ -26,6 +29,7 @@ namespace polymer
         };
 
         std::unordered_map<std::string, data_point> dataPoints;
+        std::unordered_map<std::string, circular_queue<double>> counters;
 
         bool enabled{ true };
 
@@ -35,6 +39,7 @@ namespace polymer
         {
             enabled = newState;
             dataPoints.clear();
+            counters.clear();
         }
 
         void begin(const std::string & id)
@@ -51,6 +56,14 @@ namespace polymer
             if (t > 0.0) dataPoints[id].average.put(t);
         }
 
+        void record(const std::string & id, const double value)
+        {
+            if (!enabled) return;
+            auto it = counters.find(id);
+            if (it == counters.end()) it = counters.emplace(id, circular_queue<double>(30)).first;
+            it->second.put(value);
+        }
+
         std::vector<std::pair<std::string, float>> get_data()
         {
             std::vector<std::pair<std::string, float>> data;
@@ -60,6 +73,17 @@ namespace polymer
             }
             return data;
         }
+
+        // Averages of the values passed to record()
+        std::vector<std::pair<std::string, float>> get_counters()
+        {
+            std::vector<std::pair<std::string, float>> data;
+            for (auto & c : counters)
+            {
+                data.emplace_back(c.first, static_cast<float>(compute_mean(c.second)));
+            }
+            return data;
+        }
     };
 
 } // end namespace polymer
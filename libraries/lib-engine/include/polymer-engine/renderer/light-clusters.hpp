@@ -0,0 +1,108 @@
+/*
+ * File: lib-engine/renderer/light-clusters.hpp
+ * Clustered forward lighting. The view frustum is cut into a grid of froxels: screen tiles across, and slices
+ * in depth that grow exponentially from the near plane to the far plane, so that froxels stay roughly cubic.
+ * Each frame the bounding spheres of the lights are binned into every froxel they touch. The result is one
+ * compact list of light indices, holding a run per froxel, and the offset and count of each run. A fragment
+ * finds its froxel from its window position and view depth, and only shades the lights of that run.
+ *
+ * The view space bounds of a froxel are the box around its tile between the depths of its slice. Its x
+ * extent only depends on the column and slice of the tile, and its y extent on the row and slice, so the
+ * sphere test splits by axis. Four spheres at a time are tested against a slice. Each sphere that reaches
+ * it is tested against four rows of the slice at a time, and then against four froxels of each row it
+ * reaches. Slices are binned in parallel.
+ */
+
+#pragma once
+
+#ifndef polymer_light_clusters_hpp
+#define polymer_light_clusters_hpp
+
+#include "polymer-core/math/math-core.hpp"
+
+#include <stdint.h>
+#include <vector>
+
+namespace polymer
+{
+    ////////////////////////////
+    //   light_cluster_grid   //
+    ////////////////////////////
+
+    // The run of a froxel in the light index list. Matches the uvec2 elements of the LightClusters buffer.
+    struct light_cluster
+    {
+        uint32_t offset { 0 };
+        uint32_t count { 0 };
+    };
+
+    class light_cluster_grid
+    {
+        // Tiles of a slice that one light touches: a row, and a bit per column
+        struct footprint
+        {
+            uint32_t light;
+            uint32_t row;
+            uint32_t columns;
+        };
+
+        struct slice_scratch
+        {
+            std::vector<uint32_t> lights;   // lights touching the slice
+            std::vector<float> dz2;         // and their squared distance to it
+            std::vector<footprint> footprints;
+            std::vector<uint32_t> cursors;  // by tile, for the counting sort of footprints into runs
+            std::vector<uint32_t> indices;  // runs of the froxels of the slice, in froxel order
+        };
+
+        uint32_t tiles_x, tiles_y, slices;
+        uint32_t column_stride, row_stride; // tiles across and down, rounded up to a multiple of four
+        float slice_scale { 0.f }, slice_bias { 0.f };
+
+        std::vector<float> slice_near, slice_far;   // by slice, positive depths
+        std::vector<float> column_min, column_max;  // x extent by slice * column_stride + column
+        std::vector<float> row_min, row_max;        // y extent by slice * row_stride + row
+
+        // View space lights as a structure of arrays, padded to a multiple of four with lights that touch nothing
+        std::vector<float> light_x, light_y, light_z, light_r2;
+
+        std::vector<slice_scratch> scratch;
+        std::vector<light_cluster> clusters;
+        std::vector<uint32_t> indices;
+
+        void bin_slice(const uint32_t slice, const size_t padded_count);
+
+    public:
+
+        // Tiles across and down are limited to 32 each
+        light_cluster_grid(const uint32_t tiles_x = 16, const uint32_t tiles_y = 9, const uint32_t slices = 24);
+
+        // Lays the froxels out in the frustum of a perspective projection with GL conventions, which may be off
+        // center as for stereo views, between depths near and far. Throws for any other projection.
+        void set_projection(const float4x4 & projection, const float near, const float far);
+
+        // Whether set_projection accepts a projection
+        static bool is_perspective(const float4x4 & projection) { return projection[2][3] == -1.f && projection[3][3] == 0.f; }
+
+        // Bins count spheres, given by their world space center (xyz) and radius (w), into the froxels of a view.
+        // A sphere is binned into every froxel whose bounds it intersects, and is indexed by its position in
+        // the array. Spheres with a radius that is not positive are left out.
+        void bin(const float4x4 & view, const float4 * spheres, const size_t count);
+
+        const std::vector<light_cluster> & get_clusters() const { return clusters; }
+        const std::vector<uint32_t> & get_indices() const { return indices; }
+
+        uint3 dimensions() const { return { tiles_x, tiles_y, slices }; }
+        size_t size() const { return size_t(tiles_x) * tiles_y * slices; }
+        uint32_t cluster_index(const uint32_t x, const uint32_t y, const uint32_t z) const { return (z * tiles_y + y) * tiles_x + x; }
+
+        // View space bounds of froxel (x, y, z). The view looks down -z.
+        aabb_3d cluster_bounds(const uint32_t x, const uint32_t y, const uint32_t z) const;
+
+        // The slice holding a positive view depth is floor(log(depth) * x + y), clamped to the grid
+        float2 slice_params() const { return { slice_scale, slice_bias }; }
+    };
+
+} // end namespace polymer
+
+#endif // end polymer_light_clusters_hpp
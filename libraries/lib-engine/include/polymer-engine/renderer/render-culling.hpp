@@ -0,0 +1,77 @@
+/*
+ * File: lib-engine/renderer/render-culling.hpp
+ * Visibility of the render components of a frame against the frustums of its passes, i.e. the camera of
+ * each view and the ortho volume of each shadow cascade. World bounds are kept in a binned SAH hierarchy
+ * (see bvh.hpp) that is refit every frame and only rebuilt when objects come or go, or when refitting has
+ * let its cost grow too far. Subtrees near the root are culled in parallel, and each subtree is traversed
+ * once per frustum. A node that is entirely in front of a plane drops that plane for its children, and a
+ * node inside every plane accepts its whole subtree without visiting it.
+ */
+
+#pragma once
+
+#ifndef polymer_render_culling_hpp
+#define polymer_render_culling_hpp
+
+#include "polymer-core/math/math-core.hpp"
+#include "polymer-core/tools/bvh.hpp"
+
+#include <stdint.h>
+#include <vector>
+
+namespace polymer
+{
+    ///////////////////////
+    //   render_culler   //
+    ///////////////////////
+
+    class render_culler
+    {
+        std::vector<bvh_flat_node> nodes;
+        std::vector<uint32_t> node_end;      // one past the last node of each subtree
+        std::vector<uint32_t> node_first;    // first leaf slot of each subtree
+        std::vector<uint32_t> node_last;     // one past the last leaf slot of each subtree
+        std::vector<uint32_t> leaf_objects;  // object index of each leaf slot
+        std::vector<aabb_3d> leaf_bounds;    // world bounds of each leaf slot, gathered by refit
+        std::vector<uint32_t> unbounded;     // objects with empty bounds, which are never culled
+        std::vector<uint32_t> empty_objects;
+        std::vector<uint32_t> tasks;         // roots of the subtrees that are refit and traversed in parallel
+        std::vector<uint32_t> top;           // the nodes above them, parents before children
+        std::vector<float> task_areas;
+        uint32_t depth { 0 };
+        size_t object_count { 0 };
+        float built_cost { 0.f };
+        float cost { 0.f };
+        bool was_rebuilt { false };
+
+        void rebuild(const std::vector<aabb_3d> & world_bounds);
+        void refit(const std::vector<aabb_3d> & world_bounds);
+        void cull_subtree(const uint32_t root, const frustum & f, const uint32_t bit, uint32_t * masks) const;
+
+    public:
+
+        // Below this many bounded objects refits and queries stay on the calling thread
+        static const size_t kParallelThreshold = 2048;
+
+        // A refit tree whose SAH cost exceeds its cost after the last build by this factor is rebuilt
+        float rebuild_cost_ratio { 2.f };
+
+        // Refits the hierarchy to this frame's bounds, one per object. Objects with empty bounds (min > max,
+        // as compute_bounds gives for no vertices) are kept out of the tree and are visible to every frustum.
+        // The tree is rebuilt when the number of objects, or which of them are empty, changes.
+        void update(const std::vector<aabb_3d> & world_bounds);
+
+        // masks[i] receives bit q when object i intersects frustums[q], for up to 32 frustums. A box that only
+        // touches a plane is kept, as with frustum::intersects.
+        void cull(const frustum * frustums, const uint32_t count, std::vector<uint32_t> & masks) const;
+
+        bool rebuilt() const { return was_rebuilt; }   // whether the last update() rebuilt the tree
+        float sah_cost() const { return cost; }        // of the tree after the last update()
+        size_t size() const { return object_count; }
+        size_t node_count() const { return nodes.size(); }
+        void clear();
+    };
+
+} // end namespace polymer
+
+#endif // end polymer_render_culling_hpp
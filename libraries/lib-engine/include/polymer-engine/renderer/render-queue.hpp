@@ -0,0 +1,174 @@
+/*
+ * File: lib-engine/renderer/render-queue.hpp
+ * Sort keys for the draws of the forward pass. Each draw gets one 64-bit key per view. An ascending sort
+ * of the keys gives the submission order, so the queue can be radix sorted instead of compared through
+ * the material and mesh handles. The layout, msb first:
+ *
+ *   opaque       [63] 0 | [62:55] layer | [54:43] program | [42:30] material | [29:16] mesh | [15:0] depth
+ *   translucent  [63] 1 | [62:55] layer | [54:31] depth, far to near | [30:19] program | [18:6] material | [5:0] mesh
+ *
+ * Opaque draws are grouped by shader variant, then by material, then by mesh. Within a group they are drawn
+ * near to far, which helps early-z. Translucent draws come after every opaque draw, in any layer, because they
+ * sample the resolved opaque scene. They are drawn far to near so that blending composes correctly.
+ * Program, material and mesh only break ties between translucent draws at the same quantized depth.
+ */
+
+#pragma once
+
+#ifndef polymer_render_queue_hpp
+#define polymer_render_queue_hpp
+
+#include "polymer-core/math/math-core.hpp"
+
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+namespace polymer
+{
+    ////////////////////////
+    //   draw sort keys   //
+    ////////////////////////
+
+    namespace sort_key
+    {
+        static const uint32_t layer_bits = 8;
+
+        static const uint32_t opaque_program_bits = 12;
+        static const uint32_t opaque_material_bits = 13;
+        static const uint32_t opaque_mesh_bits = 14;
+        static const uint32_t opaque_depth_bits = 16;
+
+        static const uint32_t translucent_depth_bits = 24;
+        static const uint32_t translucent_program_bits = 12;
+        static const uint32_t translucent_material_bits = 13;
+        static const uint32_t translucent_mesh_bits = 6;
+
+        // Ids past the width of a field all share its largest value. Those draws lose their grouping but
+        // the key stays well formed.
+        inline uint64_t field(const uint32_t value, const uint32_t bits)
+        {
+            const uint64_t max_value = (uint64_t(1) << bits) - 1;
+            return value < max_value ? uint64_t(value) : max_value;
+        }
+
+        // depth is normalized to [0, 1] (0 at the eye). It is clamped, and NaN maps to 0.
+        inline uint64_t quantize_depth(const float depth, const uint32_t bits)
+        {
+            const float d = (depth > 0.f) ? (depth < 1.f ? depth : 1.f) : 0.f;
+            const uint64_t max_value = (uint64_t(1) << bits) - 1;
+            return static_cast<uint64_t>(d * static_cast<float>(max_value) + 0.5f);
+        }
+    }
+
+    inline uint64_t make_opaque_sort_key(const uint32_t layer, const uint32_t program, const uint32_t material, const uint32_t mesh, const float depth)
+    {
+        using namespace sort_key;
+        uint64_t key = field(layer, layer_bits);
+        key = (key << opaque_program_bits) | field(program, opaque_program_bits);
+        key = (key << opaque_material_bits) | field(material, opaque_material_bits);
+        key = (key << opaque_mesh_bits) | field(mesh, opaque_mesh_bits);
+        key = (key << opaque_depth_bits) | quantize_depth(depth, opaque_depth_bits);
+        return key;
+    }
+
+    inline uint64_t make_translucent_sort_key(const uint32_t layer, const uint32_t program, const uint32_t material, const uint32_t mesh, const float depth)
+    {
+        using namespace sort_key;
+        const uint64_t far_to_near = ((uint64_t(1) << translucent_depth_bits) - 1) - quantize_depth(depth, translucent_depth_bits);
+        uint64_t key = 1; // translucent bit
+        key = (key << layer_bits) | field(layer, layer_bits);
+        key = (key << translucent_depth_bits) | far_to_near;
+        key = (key << translucent_program_bits) | field(program, translucent_program_bits);
+        key = (key << translucent_material_bits) | field(material, translucent_material_bits);
+        key = (key << translucent_mesh_bits) | field(mesh, translucent_mesh_bits);
+        return key;
+    }
+
+    inline bool sort_key_is_translucent(const uint64_t key) { return (key >> 63) != 0; }
+    inline uint32_t sort_key_layer(const uint64_t key) { return static_cast<uint32_t>((key >> (63 - sort_key::layer_bits)) & ((1u << sort_key::layer_bits) - 1)); }
+
+    //////////////////////
+    //   sort_key_ids   //
+    //////////////////////
+
+    // Hands out small consecutive ids for programs, materials or meshes, in order of first use, so that
+    // they fit the key fields. A scene that does not change gets the same ids every frame. Its keys
+    // then stay the same, and the previous order of the queue only needs repairing.
+    class sort_key_ids
+    {
+        std::unordered_map<uint64_t, uint32_t> ids;
+
+    public:
+
+        uint32_t get(const uint64_t handle) { return ids.emplace(handle, static_cast<uint32_t>(ids.size())).first->second; }
+        uint32_t get(const void * handle) { return get(static_cast<uint64_t>(reinterpret_cast<uintptr_t>(handle))); }
+        size_t size() const { return ids.size(); }
+        void clear() { ids.clear(); }
+    };
+
+    ////////////////////
+    //   draw_batch   //
+    ////////////////////
+
+    // A run of neighbouring draws in a sorted queue that is submitted as one instanced draw
+    struct draw_batch
+    {
+        uint32_t first { 0 };  // position of the first draw in the sorted queue
+        uint32_t count { 0 };  // draws in the run, one instance each
+        uint64_t offset { 0 }; // byte offset of the instance data of the first draw
+    };
+
+    // Splits order[0, count) into runs in which can_batch(a, b) holds for every neighbouring pair of draws.
+    // The instance data of each run is a block of instance_size * run bytes. Blocks are laid out one after
+    // another from offset, each one starting on a multiple of alignment. Batches are appended, and the end of
+    // the last block is returned.
+    template <typename F>
+    uint64_t make_draw_batches(const uint32_t * order, const size_t count, F && can_batch,
+        const uint64_t instance_size, const uint64_t alignment, uint64_t offset, std::vector<draw_batch> & batches)
+    {
+        size_t i = 0;
+        while (i < count)
+        {
+            size_t end = i + 1;
+            while (end < count && can_batch(order[end - 1], order[end])) ++end;
+
+            draw_batch b;
+            b.first = static_cast<uint32_t>(i);
+            b.count = static_cast<uint32_t>(end - i);
+            b.offset = (offset + alignment - 1) / alignment * alignment;
+            batches.push_back(b);
+
+            offset = b.offset + instance_size * b.count;
+            i = end;
+        }
+        return offset;
+    }
+
+    ///////////////////////////////
+    //   render_state_counters   //
+    ///////////////////////////////
+
+    // GL state changes issued by the forward pass for one view
+    struct render_state_counters
+    {
+        uint32_t objects { 0 };        // draws before batching
+        uint32_t draws { 0 };          // draw calls issued
+        uint32_t program_binds { 0 };  // glUseProgram
+        uint32_t material_binds { 0 }; // uniform and texture updates of a material
+        uint32_t mesh_binds { 0 };     // vertex array + index buffer
+        uint32_t total() const { return program_binds + material_binds + mesh_binds; }
+    };
+
+    /////////////////////////////
+    //   per-object matrices   //
+    /////////////////////////////
+
+    // out[i] = inverse(transpose(in[i])), the matrix that carries normals and tangents. Affine matrices, which
+    // are nearly all model matrices, take an SSE path built from the cofactors of their upper 3x3. Any other
+    // matrix, or a singular one, falls back to the general inverse. in and out may alias.
+    void inverse_transpose_matrices(const float4x4 * in, float4x4 * out, const size_t count);
+
+} // end namespace polymer
+
+#endif // end polymer_render_queue_hpp
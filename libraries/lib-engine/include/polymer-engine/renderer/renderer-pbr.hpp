@@ -6,9 +6,11 @@
 #include "polymer-core/math/math-core.hpp"
 #include "polymer-core/util/simple-timer.hpp"
 #include "polymer-core/util/timestamp.hpp"
+#include "polymer-core/tools/incremental-sort.hpp"
 
 #include "polymer-gfx-gl/gl-async-gpu-timer.hpp"
 #include "polymer-gfx-gl/gl-particle-system.hpp"
+#include "polymer-gfx-gl/gl-streaming-buffer.hpp"
 
 #include "polymer-engine/ecs/typeid.hpp"
 #include "polymer-engine/ecs/core-ecs.hpp"
@@ -16,6 +18,9 @@
 #include "polymer-engine/object.hpp"
 
 #include "polymer-engine/renderer/renderer-uniforms.hpp"
+#include "polymer-engine/renderer/render-queue.hpp"
+#include "polymer-engine/renderer/render-culling.hpp"
+#include "polymer-engine/renderer/light-clusters.hpp"
 #include "polymer-engine/renderer/renderer-procedural-sky.hpp"
 
 #undef near
@@ -30,7 +35,7 @@ namespace polymer
     class stable_cascaded_shadows
     {
         gl_texture_3d shadowArrayDepth;
-        gl_framebuffer shadowArrayFramebuffer;
+        gl_framebuffer cascadeFramebuffers[uniforms::NUM_CASCADES]; // one layer of the array each
         shader_handle program = { "cascaded-shadows" };
 
     public:
@@ -49,8 +54,8 @@ namespace polymer
         stable_cascaded_shadows();
 
         void update_cascades(const float4x4 & view, const float near, const float far, const float aspectRatio, const float vfov, const float3 & lightDir);
-        void update_shadow_matrix(const float4x4 & shadowModelMatrix);
         void pre_draw();
+        void begin_cascade(const uint32_t cascade); // binds and clears its layer; draw its casters after
         void post_draw();
 
         GLuint get_output_texture() const;
@@ -78,6 +83,7 @@ namespace polymer
         float exposure{ 1.0f };
         float gamma{ 2.2f };
         int tonemapMode{ 2 };  // 0 = none, 1 = Reinhard, 2 = ACES
+        uint3 lightClusters{ 16, 9, 24 }; // froxels across, down and in depth for clustered lighting
     };
 
     struct view_data
@@ -127,7 +133,13 @@ namespace polymer
 
         gl_buffer perScene;
         gl_buffer perView;
-        gl_buffer perObject;
+
+        // Instance data of every batch of the frame, packed once per frame into a persistently mapped ring
+        // that holds three frames. Each batch binds its range of the ring as the PerObject storage buffer.
+        std::unique_ptr<gl_streaming_buffer> perObjectRing;
+        GLintptr perObjectFrameOffset { 0 };
+        GLint perObjectAlignment { 256 };
+        std::vector<float4x4> perObjectNormalMatrices;
 
         gl_texture_2d dfg_lut;
 
@@ -153,12 +165,81 @@ namespace polymer
         shader_handle renderPassParticle = { "particle-system" };
         shader_handle no_op = { "no-op" };
 
-        void update_per_object_uniform_buffer(const float4x4 & model_matrix, const bool receiveShadow, const view_data & d);
+        // A draw of the forward pass, resolved once per frame and shared by the views
+        struct queued_draw
+        {
+            const render_component * component;
+            base_material * material;
+            gl_mesh * mesh;
+            uint32_t program;
+            uint32_t layer;
+            uint32_t program_id, material_id, mesh_id; // dense ids for the sort key
+            uint32_t visibility; // bit v for view v, then one bit per shadow cascade (see cascade_bit)
+            bool translucent;
+            bool cast_shadows;
+            bool has_overrides; // sets uniforms of its own, so it is never batched
+        };
+
+        // World bounds of the render components, culled against every view and shadow cascade each frame.
+        // Components that no pass sees never enter the render queue.
+        render_culler culler;
+        std::vector<gl_mesh *> cullMeshes;
+        std::vector<aabb_3d> cullBounds;
+        std::vector<frustum> cullFrustums;
+        std::vector<uint32_t> cullMasks; // by render component, same bits as queued_draw::visibility
+
+        std::vector<queued_draw> renderQueue;
+        sort_key_ids programIds, materialIds, meshIds;
+
+        // Sort keys and their order, kept per view across frames so the order is usually only repaired
+        std::vector<incremental_sort<uint64_t>> renderQueueSorters;
+        std::vector<uint64_t> renderQueueKeys;
+        std::vector<std::vector<uint32_t>> viewOrders; // sorted draws visible to each view
+
+        // Runs of identical draws in each view's order, and of each cascade's shadow casters grouped by mesh
+        std::vector<std::vector<draw_batch>> viewBatches;
+        std::vector<uint32_t> cascadeOrders[uniforms::NUM_CASCADES];
+        std::vector<draw_batch> cascadeBatches[uniforms::NUM_CASCADES];
+        std::vector<uint32_t> shadowMeshCounts;
+
+        std::vector<render_state_counters> stateCounters;
+
+        // Profiler ids of each view and cascade, built once so that recording them does not allocate every frame
+        struct view_profile_ids
+        {
+            std::string lightIndices, depthPrepassDraws, visible, culled, sortDisorder, sortFull, objects, draws, stateChanges;
+            std::string depthPrepass, stencilPrepass, skyboxPass, forwardPass, particlePass, blit;
+        };
+        struct cascade_profile_ids { std::string objects, draws, culled; };
+        std::vector<view_profile_ids> viewProfileIds;
+        cascade_profile_ids cascadeProfileIds[uniforms::NUM_CASCADES];
+
+        // Clustered lighting (see light-clusters.hpp). The enabled point lights of the frame are uploaded once,
+        // and binned into the froxels of each view. The runs of a view are uploaded before it is drawn. Froxels
+        // need a perspective projection, so any other view gets a single cluster that holds every light.
+        gl_buffer pointLightBuffer;
+        gl_buffer lightClusterBuffer;
+        gl_buffer lightIndexBuffer;
+        std::vector<uniforms::point_light> pointLights;
+        std::vector<float4> pointLightSpheres;
+        std::vector<light_cluster_grid> lightGrids; // one per view
+        std::vector<bool> clusteredViews;           // by view, whether lightGrids holds its clusters
+        std::vector<uint32_t> allLightIndices;      // the run of the single cluster of the other views
+
+        uint32_t cascade_bit(const uint32_t cascade) const { return 1u << (settings.cameraCount + cascade); }
+
+        void cull_render_components(const render_payload & scene, const bool shadow_casters);
+        void build_render_queue(const render_payload & scene);
+        void sort_render_queue(const view_data & view);
+        void update_per_object_data(const render_payload & scene, const view_data & shadow_view, const bool shadow_casters);
+        void update_light_clusters(const render_payload & scene);
+        void bind_light_clusters(const uint32_t view);
+        void bind_per_object_data(const draw_batch & batch);
         void run_stencil_prepass(const view_data & view, const render_payload & scene);
         void run_depth_prepass(const view_data & view, const render_payload & scene);
         void run_skybox_pass(const view_data & view, const render_payload & scene);
         void run_shadow_pass(const view_data & view, const render_payload & scene);
-        void run_forward_pass(std::vector<const render_component *> & render_queue, const view_data & view, const render_payload & scene);
+        void run_forward_pass(const view_data & view, const render_payload & scene);
         void run_particle_pass(const view_data & view, const render_payload & scene);
         void run_post_pass(const view_data & view, const render_payload & scene);
 
@@ -181,6 +262,7 @@ namespace polymer
         void set_stencil_mask(const uint32_t idx, gl_mesh && m);
 
         stable_cascaded_shadows * get_shadow_pass() const;
+        const render_state_counters & get_state_counters(const uint32_t idx = 0) const { return stateCounters[idx]; } // forward pass of the last frame
         GLuint get_dfg_lut() const { return dfg_lut.id(); }
     };
 
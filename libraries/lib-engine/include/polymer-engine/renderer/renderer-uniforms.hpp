@@ -10,9 +10,14 @@ namespace polymer
 {
 namespace uniforms
 {
-    static const int MAX_POINT_LIGHTS = 4;
     static const int NUM_CASCADES = 2;
 
+    // Shader storage buffers (std430) of clustered lighting, see light-clusters.hpp
+    static const int POINT_LIGHTS_BINDING = 3;   // every enabled point_light of the frame
+    static const int LIGHT_CLUSTERS_BINDING = 4; // light_cluster of each froxel of the view
+    static const int LIGHT_INDICES_BINDING = 5;  // point light indices of the froxels of the view, run after run
+
+    // Also an element of the PointLights storage buffer
     struct point_light
     {
         ALIGNED(16) float3    color;
@@ -46,9 +51,8 @@ namespace uniforms
     {
         static const int      binding{ 0 };
         directional_light     directional_light;
-        point_light           point_lights[MAX_POINT_LIGHTS];
         float                 time;
-        int                   activePointLights;
+        int                   activePointLights; // in the PointLights storage buffer
         int                   sunlightActive;
         ALIGNED(8)  float2    resolution;
         ALIGNED(8)  float2    invResolution;
@@ -66,8 +70,11 @@ namespace uniforms
         ALIGNED(16) float4    eyePos;
         ALIGNED(16) float4    zBufferParams;
         ALIGNED(16) float4    projectionParams;
+        ALIGNED(16) uint4     clusterDims;   // froxels across, down and in depth
+        ALIGNED(16) float4    clusterParams; // x, y = froxels per pixel across and down, z, w = log depth to slice scale and bias
     };
 
+    // An element of the PerObject shader storage buffer (std430), one per instance
     struct per_object
     {
         static const int      binding{ 2 };
@@ -124,7 +124,6 @@ namespace polymer
             monitor.watch("cascaded-shadows",
                 base_path + "/shaders/renderer/shadowcascade_vert.glsl",
                 base_path + "/shaders/renderer/shadowcascade_frag.glsl",
-                base_path + "/shaders/renderer/shadowcascade_geom.glsl",
                 base_path + "/shaders/renderer");
 
             // [renderer-pbr] blinn-phong forward model
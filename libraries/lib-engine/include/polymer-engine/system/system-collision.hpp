@@ -8,10 +8,12 @@
 #include "polymer-engine/ecs/core-ecs.hpp"
 #include "polymer-engine/object.hpp"
 
-#include "polymer-core/tools/bvh.hpp"
+#include "polymer-core/tools/dynamic-bvh.hpp"
 #include "polymer-core/tools/geometry.hpp"
+#include "polymer-core/tools/mesh-bvh.hpp"
 
 #include <algorithm>
+#include <unordered_map>
 
 namespace polymer
 {
@@ -31,148 +33,216 @@ namespace polymer
         box,
     };
 
+    // Every collidable lives in a dynamic_bvh (top level) over its world bounds, which are derived
+    // from a cached local box of its geometry. Each geometry asset lazily gets a triangle mesh_bvh
+    // (bottom level) for refining raycasts. Adding, removing and moving collidables only touches
+    // their own leaves; nothing is rebuilt wholesale except when a large batch arrives at once.
     class collision_system
     {
         template<class F> friend void visit_components(entity e, collision_system * system, F f);
         friend class asset_resolver;
 
-    public:
+        // Shared by every collidable that references the same geometry asset (keyed by asset name)
+        struct mesh_collision_data
+        {
+            uint64_t timestamp {0};
+            size_t num_vertices {0};
+            aabb_3d local_bounds;
+            mesh_bvh bvh;
+        };
+
+        struct collidable
+        {
+            entity e;
+            bvh_node_data data;
+            uint32_t proxy {dynamic_bvh::kNull};
+            bool has_bounds {false};
+            transform pose;
+            float3 scale;
+            uint64_t geometry_timestamp {0};
+        };
+
+        struct bounds_task
+        {
+            collidable * c;
+            const transform_component * xform;
+            mesh_collision_data * mesh;
+            bool changed;
+        };
+
+        static const size_t kBoundsGrain = 1024;                 // collidables per task
+        static const size_t kParallelVertexThreshold = 262144;   // stale vertices worth spreading across threads
 
-        std::unique_ptr<bvh_tree> static_accelerator;
-        std::unique_ptr<bvh_tree> dynamic_accelerator; // unimplemented 
+        std::unordered_map<entity, collidable> collidables;
+        std::unordered_map<std::string, mesh_collision_data> mesh_cache;
+        bool refresh_all {false};
 
-        std::vector<bvh_node_data> collidable_objects;
+        // 8-wide collapse of the top-level tree for batched raycasts, rebuilt lazily after the tree
+        // changes shape. Leaves test the exact object bounds, so moves within a fattened leaf keep it valid.
+        bvh8_tree packet_accelerator;
+        bool packet_accelerator_dirty {true};
+
+    public:
+
+        dynamic_bvh accelerator;
 
         scene_graph & graph;
-        std::vector<entity> collidable_entities;
 
         collision_system(scene_graph & g) : graph(g) { }
 
         void add_collidable(const entity & e)
         {
-            // Prevent duplicate registration (idempotent)
-            if (std::find(collidable_entities.begin(), collidable_entities.end(), e)
-                == collidable_entities.end())
-            {
-                collidable_entities.push_back(e);
-                queue_acceleration_rebuild();
-            }
+            // Prevent duplicate registration (idempotent). Bounds are resolved on the next query,
+            // once the entity's geometry and transform have been assigned.
+            if (collidables.find(e) != collidables.end()) return;
+            collidable & c = collidables[e];
+            c.e = e;
+            c.data.user_data = &c.e;
         }
 
         void remove_collidable(const entity & e)
         {
-            auto it = std::find(collidable_entities.begin(), collidable_entities.end(), e);
-            if (it != collidable_entities.end())
+            auto it = collidables.find(e);
+            if (it == collidables.end()) return;
+            if (it->second.proxy != dynamic_bvh::kNull)
             {
-                collidable_entities.erase(it);
-                queue_acceleration_rebuild();
+                accelerator.remove(it->second.proxy);
+                packet_accelerator_dirty = true;
             }
+            collidables.erase(it);
         }
 
+        size_t num_collidables() const { return collidables.size(); }
+
         entity_hit_result raycast(const ray & world_ray, const raycast_type type = raycast_type::mesh)
         {
             setup_acceleration();
 
-            auto raycast_mesh = [&](entity e) -> raycast_result
-            {
-                auto & obj = graph.get_object(e);
-                geometry_component * geom_component = obj.get_component<geometry_component>();
-                transform_component * xform_component = obj.get_component<transform_component>();
-
-                const runtime_mesh & geometry = geom_component->geom.get();
-                if (geometry.vertices.empty()) return {};
-
-                const transform meshPose = xform_component->get_world_transform();
-                const float3 meshScale  = xform_component->local_scale;
-
-                ray localRay = meshPose.inverse() * world_ray;
-                localRay.origin /= meshScale;
-                localRay.direction /= meshScale;
-                float outT = 0.0f;
-                float3 outNormal = { 0, 0, 0 };
-                float2 outUv = { -1, -1 };
-                const bool hit = intersect_ray_mesh(localRay, geometry, &outT, &outNormal, &outUv);
-                return { hit, outT, outNormal, outUv };
-            };
-
-            // Raycasting onto a mesh is a two-step process. First, we find all the bounding boxes that
-            // collide with the ray, and then refine by testing each of the meshes in them for the best
-            // result (because the aabb isn't a tight fit). 
-            entity hit_entity = kInvalidEntity;
-            raycast_result out_result;
+            // Raycasting onto a mesh is a two-level query. First, we find all the bounding boxes that
+            // collide with the ray (top level), and then refine by querying the triangle bvh of each
+            // mesh in them for the best result (because the aabb isn't a tight fit). Box raycasts
+            // stop at the first level.
             std::vector<std::pair<bvh_node_data*, float>> box_hit_results;
-            if (static_accelerator->intersect(world_ray, box_hit_results))
-            {
-                float mesh_best_t = std::numeric_limits<float>::max();
+            accelerator.intersect(world_ray, box_hit_results);
+            return refine_box_hits(world_ray, box_hit_results, type);
+        }
 
-                for (auto & box_hit : box_hit_results)
-                {
-                    entity * e = static_cast<entity *>(box_hit.first->user_data);
-                    const raycast_result the_raycast = raycast_mesh(*e);
+        // Batched picking, e.g. a sweep over a block of pixels. The top level is traversed a packet of
+        // rays at a time through the wide tree, so coherent rays share their box tests; each ray is then
+        // refined on its own exactly as in the single raycast.
+        std::vector<entity_hit_result> raycast(const std::vector<ray> & world_rays, const raycast_type type = raycast_type::mesh)
+        {
+            setup_acceleration();
 
-                    if (the_raycast.hit)
-                    {
-                        if (the_raycast.distance < mesh_best_t)
-                        {
-                            mesh_best_t = the_raycast.distance;
-                            out_result = the_raycast;
-                            hit_entity  = *e;
-                        }
-                    }
-                }
+            if (packet_accelerator_dirty)
+            {
+                std::vector<bvh_flat_node> flat;
+                std::vector<bvh_node_data *> flat_objects;
+                accelerator.flatten(flat, flat_objects);
+                packet_accelerator.build(flat, flat_objects);
+                packet_accelerator_dirty = false;
             }
 
-            if (out_result.hit) { return { hit_entity, out_result }; }
-            else return { kInvalidEntity, raycast_result() };
+            std::vector<entity_hit_result> results(world_rays.size());
+            std::vector<std::pair<bvh_node_data*, float>> box_hit_results[bvh_ray_packet::kSize];
+            for (size_t i = 0; i < world_rays.size(); i += bvh_ray_packet::kSize)
+            {
+                const uint32_t count = static_cast<uint32_t>(std::min<size_t>(bvh_ray_packet::kSize, world_rays.size() - i));
+                for (uint32_t k = 0; k < count; ++k) box_hit_results[k].clear();
+                packet_accelerator.intersect_packet(world_rays.data() + i, count, box_hit_results);
+                for (uint32_t k = 0; k < count; ++k) results[i + k] = refine_box_hits(world_rays[i + k], box_hit_results[k], type);
+            }
+            return results;
         }
 
+        // For geometry edited in place, which asset timestamps don't reveal: drops the cached local
+        // bounds and triangle trees and re-derives every collidable's bounds on the next query. The
+        // top-level tree is updated leaf by leaf, not rebuilt.
         void queue_acceleration_rebuild()
         {
-            static_accelerator.reset();
-            dynamic_accelerator.reset();
-            collidable_objects.clear();
+            mesh_cache.clear();
+            refresh_all = true;
         }
 
+        // Brings the top-level tree up to date with newly added collidables and with any whose
+        // transform or geometry changed. Called implicitly by every query.
         void setup_acceleration()
         {
-            if (!static_accelerator)
+            // Resolve components and geometry serially (lookups into shared tables), then compute the
+            // local bounds of stale meshes and the world bounds of every collidable across threads.
+            // Only the tree updates at the end touch shared state.
+            std::vector<bounds_task> tasks;
+            std::vector<std::pair<mesh_collision_data *, const geometry *>> stale_meshes;
+            size_t stale_vertices = 0;
+            tasks.reserve(collidables.size());
+
+            for (auto & it : collidables)
             {
-                static_accelerator.reset(new bvh_tree());
+                collidable & c = it.second;
+                auto & obj = graph.get_object(c.e);
+                geometry_component * geom_component = obj.get_component<geometry_component>();
+                transform_component * xform_component = obj.get_component<transform_component>();
+                if (!geom_component || !xform_component) continue;
 
-                // @todo: this is parallelizable
-                for (auto & e : collidable_entities)
+                const geometry & geom = geom_component->geom.get();
+                mesh_collision_data & mesh = mesh_cache[geom_component->geom.name];
+                if (invalidate_mesh_data(mesh, geom_component->geom, geom))
                 {
-                    auto & obj = graph.get_object(e);
-                    geometry_component * geom_component = obj.get_component<geometry_component>();
-                    transform_component * xform_component = obj.get_component<transform_component>();
-
-                    const geometry & geom = geom_component->geom.get();
-                     
-                    const transform geom_transform = xform_component->get_world_transform();
-                    const float3 geom_scale = xform_component->local_scale;
-
-                    // Construct a world-space axis-aligned box that encompasses the rotated and
-                    // scaled position of the mesh
-                    std::vector<float3> verts = geom.vertices;
-                    for (auto & v : verts)
-                    {
-                        v *= geom_scale;
-                        v = geom_transform.transform_coord(v);
-                    }
-                    const auto world_bounds = compute_bounds(verts);
+                    stale_meshes.emplace_back(&mesh, &geom);
+                    stale_vertices += geom.vertices.size();
+                }
+
+                tasks.push_back({ &c, xform_component, &mesh, false });
+            }
 
-                    bvh_node_data node;
-                    node.bounds = world_bounds;
-                    node.user_data = &e;
-                    collidable_objects.push_back(node);
+            parallel_for(stale_meshes.size(), (stale_vertices >= kParallelVertexThreshold) ? 1 : stale_meshes.size(), [&](const size_t begin, const size_t end)
+            {
+                for (size_t i = begin; i < end; ++i) stale_meshes[i].first->local_bounds = compute_bounds(*stale_meshes[i].second);
+            });
+
+            parallel_for(tasks.size(), kBoundsGrain, [&](const size_t begin, const size_t end)
+            {
+                for (size_t i = begin; i < end; ++i) tasks[i].changed = update_world_bounds(*tasks[i].c, *tasks[i].xform, *tasks[i].mesh, refresh_all);
+            });
+
+            std::vector<collidable *> added;
+            for (const bounds_task & task : tasks)
+            {
+                collidable & c = *task.c;
+                if (c.proxy == dynamic_bvh::kNull)
+                {
+                    if (c.has_bounds) added.push_back(&c);
+                }
+                else if (task.changed)
+                {
+                    if (accelerator.update(c.proxy)) packet_accelerator_dirty = true;
                 }
+            }
+
+            refresh_all = false;
+            if (added.empty()) return;
+
+            packet_accelerator_dirty = true;
 
-                for (int i = 0; i < collidable_objects.size(); ++i)
+            // A large batch (e.g. loading a scene) gets one top-down SAH build instead of an insert per object
+            if (added.size() > accelerator.size())
+            {
+                std::vector<collidable *> all;
+                std::vector<bvh_node_data *> objects;
+                for (auto & it : collidables)
                 {
-                    static_accelerator->add(&collidable_objects[i]);
+                    if (!it.second.has_bounds) continue;
+                    all.push_back(&it.second);
+                    objects.push_back(&it.second.data);
                 }
 
-                static_accelerator->build();
+                std::vector<uint32_t> proxies;
+                accelerator.build(objects, proxies);
+                for (size_t i = 0; i < all.size(); ++i) all[i]->proxy = proxies[i];
+            }
+            else
+            {
+                for (collidable * c : added) c->proxy = accelerator.insert(&c->data);
             }
         }
 
@@ -180,7 +250,7 @@ namespace polymer
         {
             setup_acceleration();
 
-            auto visible_bvh_nodes = static_accelerator->find_visible_nodes(camera_frustum);
+            auto visible_bvh_nodes = accelerator.find_visible_nodes(camera_frustum);
 
             std::vector<entity> visible_entities;
             for (const bvh_node_data * n : visible_bvh_nodes)
@@ -191,6 +261,118 @@ namespace polymer
 
             return visible_entities;
         }
+
+    private:
+
+        // Returns true if the data was stale and reset, in which case local_bounds must be recomputed
+        static bool invalidate_mesh_data(mesh_collision_data & data, const cpu_mesh_handle & handle, const geometry & geom)
+        {
+            if (data.timestamp == handle.get_timestamp() && data.num_vertices == geom.vertices.size()) return false;
+            data.timestamp = handle.get_timestamp();
+            data.num_vertices = geom.vertices.size();
+            data.bvh.clear();
+            return true;
+        }
+
+        mesh_collision_data & get_mesh_data(const cpu_mesh_handle & handle)
+        {
+            const geometry & geom = handle.get();
+            mesh_collision_data & data = mesh_cache[handle.name];
+            if (invalidate_mesh_data(data, handle, geom)) data.local_bounds = compute_bounds(geom);
+            return data;
+        }
+
+        const mesh_bvh & get_mesh_accelerator(const cpu_mesh_handle & handle)
+        {
+            mesh_collision_data & data = get_mesh_data(handle);
+            const geometry & geom = handle.get();
+            if (data.bvh.empty() || !data.bvh.matches(geom)) data.bvh.build(geom);
+            return data.bvh;
+        }
+
+        // World bounds are the cached local box of the geometry under the entity's world transform.
+        // Returns true if they changed. Touches only `c`, so collidables can be updated concurrently.
+        static bool update_world_bounds(collidable & c, const transform_component & xform, const mesh_collision_data & mesh, const bool force)
+        {
+            if (mesh.num_vertices == 0) return false;
+
+            const transform pose = xform.get_world_transform();
+            const float3 scale = xform.get_world_scale();
+
+            if (!force && c.has_bounds && c.pose == pose && c.scale == scale && c.geometry_timestamp == mesh.timestamp) return false;
+
+            c.pose = pose;
+            c.scale = scale;
+            c.geometry_timestamp = mesh.timestamp;
+            c.data.bounds = transform_bounds(mesh.local_bounds, pose, scale);
+            c.has_bounds = true;
+            return true;
+        }
+
+        // The mesh is tested in its local space. The ray is only transformed (not renormalized), so
+        // t is the same in both spaces and `max_t` can prune the bottom-level traversal directly.
+        raycast_result raycast_mesh(const entity e, const ray & world_ray, const float max_t)
+        {
+            auto & obj = graph.get_object(e);
+            geometry_component * geom_component = obj.get_component<geometry_component>();
+            transform_component * xform_component = obj.get_component<transform_component>();
+
+            const runtime_mesh & geometry = geom_component->geom.get();
+            if (geometry.vertices.empty()) return {};
+
+            const transform meshPose = xform_component->get_world_transform();
+            const float3 meshScale  = xform_component->get_world_scale();
+
+            ray localRay = meshPose.inverse() * world_ray;
+            localRay.origin /= meshScale;
+            localRay.direction /= meshScale;
+            float outT = 0.0f;
+            float3 outNormal = { 0, 0, 0 };
+            float2 outUv = { -1, -1 };
+            const mesh_bvh & mesh_accelerator = get_mesh_accelerator(geom_component->geom);
+            const bool hit = intersect_ray_mesh(localRay, geometry, mesh_accelerator, &outT, &outNormal, &outUv, max_t);
+            return { hit, outT, outNormal, outUv };
+        }
+
+        entity_hit_result refine_box_hits(const ray & world_ray, const std::vector<std::pair<bvh_node_data*, float>> & box_hit_results, const raycast_type type)
+        {
+            // Box hits arrive sorted by entry distance, so for a box raycast the first one is the answer
+            if (type == raycast_type::box)
+            {
+                if (box_hit_results.empty()) return { kInvalidEntity, raycast_result() };
+
+                const bvh_node_data * nearest = box_hit_results.front().first;
+                float3 normal = { 0, 0, 0 };
+                intersect_ray_box(world_ray, nearest->bounds.min(), nearest->bounds.max(), nullptr, nullptr, &normal);
+                return { *static_cast<entity *>(nearest->user_data), { true, box_hit_results.front().second, normal, { -1, -1 } } };
+            }
+
+            entity hit_entity = kInvalidEntity;
+            raycast_result out_result;
+            float mesh_best_t = std::numeric_limits<float>::max();
+
+            // Once a box starts beyond the best mesh hit nothing further along the ray can beat it
+            for (auto & box_hit : box_hit_results)
+            {
+                if (box_hit.second > mesh_best_t) break;
+
+                entity * e = static_cast<entity *>(box_hit.first->user_data);
+                const raycast_result the_raycast = raycast_mesh(*e, world_ray, mesh_best_t);
+
+                if (the_raycast.hit)
+                {
+                    if (the_raycast.distance < mesh_best_t)
+                    {
+                        mesh_best_t = the_raycast.distance;
+                        out_result = the_raycast;
+                        hit_entity  = *e;
+                    }
+                }
+            }
+
+            if (out_result.hit) { return { hit_entity, out_result }; }
+            else return { kInvalidEntity, raycast_result() };
+        }
     };
 
 } // end namespace polymer
@@ -3,15 +3,231 @@
 #ifndef polymer_system_transform_hpp
 #define polymer_system_transform_hpp
 
-#include "polymer-engine/ecs/typeid.hpp"
-#include "polymer-engine/ecs/core-ecs.hpp"
-#include "polymer-engine/ecs/component-pool.hpp"
-#include "polymer-engine/serialization.hpp"
-#include "polymer-engine/scene.hpp"
+#include "polymer-core/math/math-core.hpp"
+#include "polymer-core/util/job-system.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
 
 namespace polymer
 {
+    // Composes a local pose and scale onto a parent's world pose and scale. The parent's scale is
+    // applied to the child's offset before rotation, so children of a scaled parent are spread out
+    // accordingly. Shear from rotated non-uniform scale is not representable and is dropped.
+    inline void compose_world_transform(const transform & parent_pose, const float3 & parent_scale,
+        const transform & local_pose, const float3 & local_scale,
+        transform & world_pose, float3 & world_scale)
+    {
+        world_pose.orientation = parent_pose.orientation * local_pose.orientation;
+        world_pose.position = parent_pose.position + qrot(parent_pose.orientation, parent_scale * local_pose.position);
+        world_scale = parent_scale * local_scale;
+    }
+
+    // Inverse of compose_world_transform: the local pose that places a child at `world_pose` under the given parent
+    inline transform make_local_transform(const transform & parent_pose, const float3 & parent_scale, const transform & world_pose)
+    {
+        const quatf inv_orientation = linalg::inverse(parent_pose.orientation);
+        return { inv_orientation * world_pose.orientation, qrot(inv_orientation, world_pose.position - parent_pose.position) / parent_scale };
+    }
+
+    //////////////////////////
+    //   transform_system   //
+    //////////////////////////
+
+    // Flattened world-transform propagation. Nodes are stored as parallel arrays in pre-order, so every
+    // parent precedes its children and the subtree under each root is one contiguous range. A single
+    // forward pass is therefore enough to bring every world transform up to date, and independent root
+    // subtrees can be handed to different threads. Only nodes marked dirty (and their descendants) are
+    // recomputed. The hierarchy is built by appending nodes in pre-order; structural edits are made by
+    // clearing and rebuilding, which the scene_graph does lazily when its topology changes.
+    class transform_system
+    {
+        struct root_range
+        {
+            uint32_t begin;
+            uint32_t end;
+            uint32_t first_dirty; // == end when the subtree is clean
+        };
+
+        std::vector<uint8_t> dirty;
+        std::vector<uint32_t> root_of; // index into roots for each node
+        std::vector<root_range> roots;
+
+        // Below this many dirty nodes, fanning out to the job system costs more than it saves
+        static const uint32_t kMinParallelNodes = 4096;
+
+        template <typename F>
+        uint32_t update_range(const root_range & r, F & on_updated)
+        {
+            uint32_t count = 0;
+            for (uint32_t i = r.first_dirty; i < r.end; ++i)
+            {
+                const uint32_t p = parents[i];
+
+                if (p != kInvalidIndex && p >= r.first_dirty) dirty[i] |= dirty[p];
+                if (!dirty[i]) continue;
+
+                if (p == kInvalidIndex)
+                {
+                    world_poses[i] = local_poses[i];
+                    world_scales[i] = local_scales[i];
+                }
+                else
+                {
+                    compose_world_transform(world_poses[p], world_scales[p], local_poses[i], local_scales[i], world_poses[i], world_scales[i]);
+                }
+
+                on_updated(i);
+                ++count;
+            }
+
+            std::fill(dirty.begin() + r.first_dirty, dirty.begin() + r.end, uint8_t(0));
+            return count;
+        }
+
+    public:
+
+        static const uint32_t kInvalidIndex = 0xFFFFFFFF;
+
+        std::vector<uint32_t> parents;
+        std::vector<transform> local_poses;
+        std::vector<float3> local_scales;
+        std::vector<transform> world_poses;
+        std::vector<float3> world_scales;
+
+        transform_system() = default;
+
+        uint32_t size() const { return static_cast<uint32_t>(parents.size()); }
+        uint32_t num_roots() const { return static_cast<uint32_t>(roots.size()); }
+
+        void reserve(size_t n)
+        {
+            parents.reserve(n); local_poses.reserve(n); local_scales.reserve(n);
+            world_poses.reserve(n); world_scales.reserve(n); dirty.reserve(n); root_of.reserve(n);
+        }
+
+        void clear()
+        {
+            parents.clear(); local_poses.clear(); local_scales.clear();
+            world_poses.clear(); world_scales.clear(); dirty.clear(); root_of.clear();
+            roots.clear();
+        }
+
+        // Appends a node and returns its index. Nodes must be added in pre-order: a child may only
+        // be added to a node in the subtree of the most recently added root.
+        uint32_t add(const uint32_t parent, const transform & local_pose, const float3 & local_scale)
+        {
+            const uint32_t index = size();
+            if (index == kInvalidIndex) throw std::runtime_error("transform_system is full");
+
+            if (parent == kInvalidIndex)
+            {
+                roots.push_back({ index, index + 1, index });
+            }
+            else
+            {
+                if (parent >= index) throw std::invalid_argument("parent must be added before its children");
+                if (root_of[parent] != roots.size() - 1) throw std::invalid_argument("nodes must be added in pre-order");
+                roots.back().end = index + 1;
+            }
+
+            parents.push_back(parent);
+            local_poses.push_back(local_pose);
+            local_scales.push_back(local_scale);
+            world_poses.push_back(local_pose);
+            world_scales.push_back(local_scale);
+            dirty.push_back(1);
+            root_of.push_back(static_cast<uint32_t>(roots.size() - 1));
+            return index;
+        }
+
+        void mark_dirty(const uint32_t i)
+        {
+            dirty[i] = 1;
+            root_range & r = roots[root_of[i]];
+            r.first_dirty = std::min(r.first_dirty, i);
+        }
+
+        void mark_all_dirty()
+        {
+            std::fill(dirty.begin(), dirty.end(), uint8_t(1));
+            for (auto & r : roots) r.first_dirty = r.begin;
+        }
+
+        void set_local_transform(const uint32_t i, const transform & local_pose, const float3 & local_scale)
+        {
+            local_poses[i] = local_pose;
+            local_scales[i] = local_scale;
+            mark_dirty(i);
+        }
+
+        // Recomputes the world transform of every dirty node and its descendants, invoking
+        // on_updated(index) for each node written. With a job system, dirty root subtrees are split
+        // into batches of similar node count and on_updated may be invoked concurrently from workers
+        // (never twice for the same index). Returns the number of nodes recomputed.
+        template <typename F>
+        uint32_t update(job_system * jobs, F && on_updated)
+        {
+            std::vector<uint32_t> dirty_roots;
+            uint32_t dirty_span = 0;
+            for (uint32_t r = 0; r < roots.size(); ++r)
+            {
+                if (roots[r].first_dirty == roots[r].end) continue;
+                dirty_roots.push_back(r);
+                dirty_span += roots[r].end - roots[r].first_dirty;
+            }
+
+            uint32_t count = 0;
+
+            if (jobs == nullptr || dirty_roots.size() < 2 || dirty_span < kMinParallelNodes)
+            {
+                for (const uint32_t r : dirty_roots) count += update_range(roots[r], on_updated);
+            }
+            else
+            {
+                // Contiguous batches of whole subtrees, a few per thread to smooth out uneven trees
+                const uint32_t num_batches = jobs->num_threads() * 4;
+                const uint32_t batch_target = std::max(1u, dirty_span / num_batches);
+
+                std::vector<std::pair<size_t, size_t>> batches;
+                size_t first = 0;
+                while (first < dirty_roots.size())
+                {
+                    size_t last = first;
+                    uint32_t batch_size = 0;
+                    while (last < dirty_roots.size() && batch_size < batch_target)
+                    {
+                        batch_size += roots[dirty_roots[last]].end - roots[dirty_roots[last]].first_dirty;
+                        ++last;
+                    }
+                    batches.emplace_back(first, last);
+                    first = last;
+                }
+
+                std::atomic<uint32_t> written { 0 };
+                jobs->parallel_for(batches.size(), 1, [&](const size_t begin, const size_t end)
+                {
+                    uint32_t n = 0;
+                    for (size_t b = begin; b < end; ++b)
+                    {
+                        for (size_t k = batches[b].first; k < batches[b].second; ++k) n += update_range(roots[dirty_roots[k]], on_updated);
+                    }
+                    written += n;
+                });
+                count = written;
+            }
+
+            for (const uint32_t r : dirty_roots) roots[r].first_dirty = roots[r].end;
+            return count;
+        }
+
+        uint32_t update(job_system * jobs = nullptr)
+        {
+            return update(jobs, [](uint32_t) {});
+        }
+    };
 
 } // end namespace polymer
 
-#endif // end polymer_system_transform_hpp
\ No newline at end of file
+#endif // end polymer_system_transform_hpp
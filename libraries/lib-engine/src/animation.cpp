@@ -0,0 +1,463 @@
+#include "polymer-engine/animation.hpp"
+#include "polymer-core/util/cpu-features.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace polymer;
+
+static_assert(sizeof(float3) == 3 * sizeof(float) && sizeof(float4) == 4 * sizeof(float), "animation blending treats vector arrays as flat floats");
+
+namespace
+{
+    inline float4 to_float4(const quatf & q) { return float4(q.x, q.y, q.z, q.w); }
+
+    inline float4 align_quat(const float4 & reference, const float4 & q) { return dot(reference, q) < 0.f ? -q : q; }
+
+    inline float4 decode_rotation(const int16_t * q)
+    {
+        const float s = 1.f / 32767.f;
+        return float4(q[0] * s, q[1] * s, q[2] * s, q[3] * s);
+    }
+
+    inline int16_t encode_snorm16(const float v)
+    {
+        return static_cast<int16_t>(std::lround(std::min(std::max(v, -1.f), 1.f) * 32767.f));
+    }
+
+    inline float max_difference(const float3 & a, const float3 & b) { return maxelem(abs(a - b)); }
+    inline float max_difference(const float4 & a, const float4 & b) { return maxelem(abs(a - align_quat(a, b))); }
+
+    inline float3 interpolate(const float3 & a, const float3 & b, const float t) { return a + (b - a) * t; }
+    inline float4 interpolate(const float4 & a, const float4 & b, const float t) { return normalize(a + (align_quat(a, b) - a) * t); }
+
+    // Appends one channel, keeping only the keys that interpolating between the kept keys around them does not
+    // reproduce within tolerance. A channel that ends up holding the same value twice collapses to one key.
+    template <typename T>
+    void append_channel(animation_clip::channel_keys & keys, std::vector<T> & values, const std::vector<float> & times, const std::vector<T> & source, const float tolerance)
+    {
+        const size_t n = times.size();
+        size_t kept = 0;
+        keys.times.push_back(times[0]);
+        values.push_back(source[0]);
+
+        for (size_t i = 1; i < n; ++i)
+        {
+            if (i + 1 < n)
+            {
+                // Dropping i means every key since the last kept one is rebuilt from the segment kept -> i + 1
+                const float span = times[i + 1] - times[kept];
+                bool redundant = true;
+                for (size_t j = kept + 1; j <= i && redundant; ++j)
+                {
+                    const float t = span > 0.f ? (times[j] - times[kept]) / span : 0.f;
+                    redundant = max_difference(interpolate(source[kept], source[i + 1], t), source[j]) <= tolerance;
+                }
+                if (redundant) continue;
+            }
+
+            keys.times.push_back(times[i]);
+            values.push_back(source[i]);
+            kept = i;
+        }
+
+        const size_t first = keys.offsets.back();
+        if (keys.times.size() - first == 2 && max_difference(values[first], values[first + 1]) <= tolerance)
+        {
+            keys.times.pop_back();
+            values.pop_back();
+        }
+
+        keys.offsets.push_back(static_cast<uint32_t>(keys.times.size()));
+    }
+
+    // Finds the keys around time for one channel and returns the blend factor between them
+    inline float locate_keys(const animation_clip::channel_keys & keys, const uint32_t bone, uint32_t & cursor, const float time, const bool rewind, uint32_t & k0)
+    {
+        const uint32_t first = keys.offsets[bone];
+        const uint32_t n = keys.offsets[bone + 1] - first;
+        const float * t = keys.times.data() + first;
+
+        if (rewind || cursor >= n)
+        {
+            const uint32_t upper = static_cast<uint32_t>(std::upper_bound(t, t + n, time) - t);
+            cursor = upper ? upper - 1 : 0;
+        }
+        while (cursor + 1 < n && t[cursor + 1] <= time) ++cursor;
+
+        k0 = first + cursor;
+        if (cursor + 1 >= n) return 0.f;
+
+        const float span = t[cursor + 1] - t[cursor];
+        const float alpha = span > 0.f ? (time - t[cursor]) / span : 0.f;
+        return std::min(std::max(alpha, 0.f), 1.f);
+    }
+
+    // a = lerp(a, b, alpha), per element
+    void blend_vectors(float3 * a, const float3 * b, const float * alpha, const size_t n)
+    {
+        size_t i = 0;
+    #if defined(POLYMER_SIMD_X86)
+        // Four float3 are three registers; the blend factors are spread to match their lanes
+        for (; i + 4 <= n; i += 4)
+        {
+            float * pa = &a[i].x;
+            const float * pb = &b[i].x;
+            const __m128 al = _mm_loadu_ps(alpha + i);
+            const __m128 w[3] = { _mm_shuffle_ps(al, al, _MM_SHUFFLE(1, 0, 0, 0)), _mm_shuffle_ps(al, al, _MM_SHUFFLE(2, 2, 1, 1)), _mm_shuffle_ps(al, al, _MM_SHUFFLE(3, 3, 3, 2)) };
+            for (int k = 0; k < 3; ++k)
+            {
+                const __m128 va = _mm_loadu_ps(pa + k * 4);
+                const __m128 vb = _mm_loadu_ps(pb + k * 4);
+                _mm_storeu_ps(pa + k * 4, _mm_add_ps(va, _mm_mul_ps(_mm_sub_ps(vb, va), w[k])));
+            }
+        }
+    #endif
+        for (; i < n; ++i) a[i] = interpolate(a[i], b[i], alpha[i]);
+    }
+
+    // a = nlerp(a, b, alpha) along the shorter arc, per element
+    void blend_rotations(float4 * a, const float4 * b, const float * alpha, const size_t n)
+    {
+        size_t i = 0;
+    #if defined(POLYMER_SIMD_X86)
+        // Transposed to one register per component so four quaternions blend and normalize together
+        const __m128 sign_mask = _mm_set1_ps(-0.f);
+        for (; i + 4 <= n; i += 4)
+        {
+            __m128 ax = _mm_loadu_ps(&a[i + 0].x), ay = _mm_loadu_ps(&a[i + 1].x), az = _mm_loadu_ps(&a[i + 2].x), aw = _mm_loadu_ps(&a[i + 3].x);
+            __m128 bx = _mm_loadu_ps(&b[i + 0].x), by = _mm_loadu_ps(&b[i + 1].x), bz = _mm_loadu_ps(&b[i + 2].x), bw = _mm_loadu_ps(&b[i + 3].x);
+            _MM_TRANSPOSE4_PS(ax, ay, az, aw);
+            _MM_TRANSPOSE4_PS(bx, by, bz, bw);
+
+            const __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_add_ps(_mm_mul_ps(az, bz), _mm_mul_ps(aw, bw)));
+            const __m128 flip = _mm_and_ps(d, sign_mask);
+            const __m128 al = _mm_loadu_ps(alpha + i);
+
+            __m128 rx = _mm_add_ps(ax, _mm_mul_ps(_mm_sub_ps(_mm_xor_ps(bx, flip), ax), al));
+            __m128 ry = _mm_add_ps(ay, _mm_mul_ps(_mm_sub_ps(_mm_xor_ps(by, flip), ay), al));
+            __m128 rz = _mm_add_ps(az, _mm_mul_ps(_mm_sub_ps(_mm_xor_ps(bz, flip), az), al));
+            __m128 rw = _mm_add_ps(aw, _mm_mul_ps(_mm_sub_ps(_mm_xor_ps(bw, flip), aw), al));
+
+            // rsqrt plus one Newton-Raphson step
+            const __m128 len2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(rx, rx), _mm_mul_ps(ry, ry)), _mm_add_ps(_mm_mul_ps(rz, rz), _mm_mul_ps(rw, rw)));
+            const __m128 est = _mm_rsqrt_ps(len2);
+            const __m128 inv = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), est), _mm_sub_ps(_mm_set1_ps(3.f), _mm_mul_ps(_mm_mul_ps(len2, est), est)));
+
+            rx = _mm_mul_ps(rx, inv); ry = _mm_mul_ps(ry, inv); rz = _mm_mul_ps(rz, inv); rw = _mm_mul_ps(rw, inv);
+            _MM_TRANSPOSE4_PS(rx, ry, rz, rw);
+            _mm_storeu_ps(&a[i + 0].x, rx); _mm_storeu_ps(&a[i + 1].x, ry); _mm_storeu_ps(&a[i + 2].x, rz); _mm_storeu_ps(&a[i + 3].x, rw);
+        }
+    #endif
+        for (; i < n; ++i) a[i] = interpolate(a[i], b[i], alpha[i]);
+    }
+
+    inline float4x4 make_trs_matrix(const float3 & t, const float4 & q, const float3 & s)
+    {
+        const float x2 = q.x + q.x, y2 = q.y + q.y, z2 = q.z + q.z;
+        const float xx = q.x * x2, yy = q.y * y2, zz = q.z * z2;
+        const float xy = q.x * y2, xz = q.x * z2, yz = q.y * z2;
+        const float wx = q.w * x2, wy = q.w * y2, wz = q.w * z2;
+        return {
+            { (1.f - (yy + zz)) * s.x, (xy + wz) * s.x, (xz - wy) * s.x, 0.f },
+            { (xy - wz) * s.y, (1.f - (xx + zz)) * s.y, (yz + wx) * s.y, 0.f },
+            { (xz + wy) * s.z, (yz - wx) * s.z, (1.f - (xx + yy)) * s.z, 0.f },
+            { t.x, t.y, t.z, 1.f }
+        };
+    }
+
+    inline void mul_matrix(const float4x4 & a, const float4x4 & b, float4x4 & out)
+    {
+    #if defined(POLYMER_SIMD_X86)
+        const __m128 a0 = _mm_loadu_ps(&a[0].x), a1 = _mm_loadu_ps(&a[1].x), a2 = _mm_loadu_ps(&a[2].x), a3 = _mm_loadu_ps(&a[3].x);
+        for (int j = 0; j < 4; ++j)
+        {
+            const __m128 r = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(a0, _mm_set1_ps(b[j].x)), _mm_mul_ps(a1, _mm_set1_ps(b[j].y))),
+                _mm_add_ps(_mm_mul_ps(a2, _mm_set1_ps(b[j].z)), _mm_mul_ps(a3, _mm_set1_ps(b[j].w))));
+            _mm_storeu_ps(&out[j].x, r);
+        }
+    #else
+        out = a * b;
+    #endif
+    }
+}
+
+//////////////////////
+//   skeleton_rig   //
+//////////////////////
+
+skeleton_rig polymer::make_skeleton_rig(const std::vector<bone> & bones)
+{
+    const uint32_t n = static_cast<uint32_t>(bones.size());
+
+    skeleton_rig rig;
+    rig.parents.resize(n);
+    rig.inverse_bind_poses.resize(n);
+    rig.rest_translations.resize(n);
+    rig.rest_rotations.resize(n);
+    rig.rest_scales.resize(n);
+
+    std::vector<std::vector<uint32_t>> children(n);
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        const uint32_t p = bones[i].parentIndex;
+        rig.parents[i] = (p < n && p != i) ? p : skeleton_rig::kInvalidIndex;
+        if (rig.parents[i] != skeleton_rig::kInvalidIndex) children[p].push_back(i);
+        rig.inverse_bind_poses[i] = bones[i].bindPose;
+    }
+
+    // Breadth first from the roots, so every parent is evaluated before its children
+    rig.evaluation_order.reserve(n);
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        if (rig.parents[i] == skeleton_rig::kInvalidIndex) rig.evaluation_order.push_back(i);
+    }
+    for (size_t k = 0; k < rig.evaluation_order.size(); ++k)
+    {
+        for (const uint32_t c : children[rig.evaluation_order[k]]) rig.evaluation_order.push_back(c);
+    }
+    if (rig.evaluation_order.size() != n) throw std::runtime_error("skeleton hierarchy contains a cycle");
+
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        const uint32_t p = rig.parents[i];
+        const float4x4 local = (p == skeleton_rig::kInvalidIndex) ? bones[i].initialPose : inverse(bones[p].initialPose) * bones[i].initialPose;
+
+        float3 scale = { length(local[0].xyz()), length(local[1].xyz()), length(local[2].xyz()) };
+        if (determinant(local) < 0.f) scale.x = -scale.x;
+
+        const float3x3 rotation = { local[0].xyz() / scale.x, local[1].xyz() / scale.y, local[2].xyz() / scale.z };
+        rig.rest_translations[i] = local[3].xyz();
+        rig.rest_rotations[i] = normalize(to_float4(make_rotation_quat_from_rotation_matrix(rotation)));
+        rig.rest_scales[i] = scale;
+    }
+
+    return rig;
+}
+
+////////////////////////
+//   animation_clip   //
+////////////////////////
+
+size_t animation_clip::memory_bytes() const
+{
+    size_t bytes = 0;
+    for (const channel_keys * keys : { &translation_keys, &rotation_keys, &scale_keys })
+    {
+        bytes += keys->offsets.size() * sizeof(uint32_t) + keys->times.size() * sizeof(float);
+    }
+    return bytes + (translations.size() + scales.size()) * sizeof(float3) + rotations.size() * sizeof(float4) + quantized_rotations.size() * sizeof(int16_t);
+}
+
+animation_clip polymer::make_animation_clip(const skeletal_animation & animation, const skeleton_rig & rig, const animation_clip_options & options)
+{
+    const uint32_t n = static_cast<uint32_t>(rig.size());
+
+    animation_clip clip;
+    clip.name = animation.name;
+    clip.bone_count = n;
+
+    const uint32_t start_frame = (animation.startFrame <= animation.endFrame) ? animation.startFrame : 0;
+    clip.duration = (animation.endFrame > start_frame) ? (animation.endFrame - start_frame) / options.frames_per_second : 0.f;
+
+    std::vector<const animation_track *> track_of(n, nullptr);
+    for (const auto & track : animation.tracks)
+    {
+        if (track && track->boneIndex < n && !track->keyframes.empty()) track_of[track->boneIndex] = track.get();
+    }
+
+    for (animation_clip::channel_keys * keys : { &clip.translation_keys, &clip.rotation_keys, &clip.scale_keys })
+    {
+        keys->offsets.reserve(n + 1);
+        keys->offsets.push_back(0);
+    }
+
+    std::vector<const animation_keyframe *> frames;
+    std::vector<float> times;
+    std::vector<float3> translations, scales;
+    std::vector<float4> rotations;
+    std::vector<float4> clip_rotations;
+
+    for (uint32_t b = 0; b < n; ++b)
+    {
+        frames.clear();
+        if (track_of[b])
+        {
+            for (const auto & kf : track_of[b]->keyframes) if (kf) frames.push_back(kf.get());
+            std::stable_sort(frames.begin(), frames.end(), [](const animation_keyframe * x, const animation_keyframe * y) { return x->key < y->key; });
+        }
+
+        bool moves = false, turns = false, grows = false;
+        for (const animation_keyframe * kf : frames)
+        {
+            moves |= kf->translation != float3(0, 0, 0);
+            turns |= kf->rotation != float4(0, 0, 0, 1);
+            grows |= kf->scale != float3(1, 1, 1);
+        }
+
+        times.assign(1, 0.f);
+        translations.assign(1, rig.rest_translations[b]);
+        rotations.assign(1, rig.rest_rotations[b]);
+        scales.assign(1, rig.rest_scales[b]);
+
+        if (!frames.empty())
+        {
+            times.clear();
+            for (const animation_keyframe * kf : frames) times.push_back((kf->key - std::min(kf->key, start_frame)) / options.frames_per_second);
+        }
+
+        if (moves)
+        {
+            translations.clear();
+            for (const animation_keyframe * kf : frames) translations.push_back(kf->translation);
+        }
+        if (turns)
+        {
+            rotations.clear();
+            for (const animation_keyframe * kf : frames) rotations.push_back(normalize(kf->rotation));
+        }
+        if (grows)
+        {
+            scales.clear();
+            for (const animation_keyframe * kf : frames) scales.push_back(kf->scale);
+        }
+
+        const std::vector<float> rest_time(1, 0.f);
+        append_channel(clip.translation_keys, clip.translations, moves ? times : rest_time, translations, options.tolerance);
+        append_channel(clip.rotation_keys, clip_rotations, turns ? times : rest_time, rotations, options.tolerance);
+        append_channel(clip.scale_keys, clip.scales, grows ? times : rest_time, scales, options.tolerance);
+    }
+
+    if (options.quantize_rotations)
+    {
+        clip.quantized_rotations.resize(clip_rotations.size() * 4);
+        for (size_t k = 0; k < clip_rotations.size(); ++k)
+        {
+            for (int c = 0; c < 4; ++c) clip.quantized_rotations[k * 4 + c] = encode_snorm16(clip_rotations[k][c]);
+        }
+    }
+    else
+    {
+        clip.rotations = std::move(clip_rotations);
+    }
+
+    return clip;
+}
+
+///////////////////////////
+//   animation_sampler   //
+///////////////////////////
+
+void animation_sampler::bind(const animation_clip & c)
+{
+    clip = &c;
+    last_time = 0.f;
+    cursors.assign(size_t(c.bone_count) * 3, 0);
+
+    next_translations.resize(c.bone_count);
+    next_rotations.resize(c.bone_count);
+    next_scales.resize(c.bone_count);
+    translation_alphas.resize(c.bone_count);
+    rotation_alphas.resize(c.bone_count);
+    scale_alphas.resize(c.bone_count);
+}
+
+void animation_sampler::sample(const float t, skeleton_pose & pose)
+{
+    if (!clip) throw std::runtime_error("animation_sampler has no clip");
+
+    const uint32_t n = clip->bone_count;
+    const float time = std::min(std::max(t, 0.f), clip->duration);
+    const bool rewind = time < last_time;
+    last_time = time;
+
+    pose.resize(n);
+
+    // Gather: the key at or before time goes into the pose, the one after it into the scratch arrays
+    uint32_t k0;
+    for (uint32_t b = 0; b < n; ++b)
+    {
+        translation_alphas[b] = locate_keys(clip->translation_keys, b, cursors[b * 3 + 0], time, rewind, k0);
+        pose.translations[b] = clip->translations[k0];
+        next_translations[b] = clip->translations[k0 + (translation_alphas[b] > 0.f)];
+
+        rotation_alphas[b] = locate_keys(clip->rotation_keys, b, cursors[b * 3 + 1], time, rewind, k0);
+        const uint32_t k1 = k0 + (rotation_alphas[b] > 0.f);
+        if (clip->quantized())
+        {
+            pose.rotations[b] = decode_rotation(&clip->quantized_rotations[k0 * 4]);
+            next_rotations[b] = decode_rotation(&clip->quantized_rotations[k1 * 4]);
+        }
+        else
+        {
+            pose.rotations[b] = clip->rotations[k0];
+            next_rotations[b] = clip->rotations[k1];
+        }
+
+        scale_alphas[b] = locate_keys(clip->scale_keys, b, cursors[b * 3 + 2], time, rewind, k0);
+        pose.scales[b] = clip->scales[k0];
+        next_scales[b] = clip->scales[k0 + (scale_alphas[b] > 0.f)];
+    }
+
+    blend_vectors(pose.translations.data(), next_translations.data(), translation_alphas.data(), n);
+    blend_rotations(pose.rotations.data(), next_rotations.data(), rotation_alphas.data(), n);
+    blend_vectors(pose.scales.data(), next_scales.data(), scale_alphas.data(), n);
+}
+
+///////////////////
+//   Skinning    //
+///////////////////
+
+void polymer::compute_skinning_palette(const skeleton_rig & rig, const skeleton_pose & pose, float4x4 * model, float4x4 * palette)
+{
+    for (const uint32_t b : rig.evaluation_order)
+    {
+        const float4x4 local = make_trs_matrix(pose.translations[b], pose.rotations[b], pose.scales[b]);
+        const uint32_t p = rig.parents[b];
+        if (p == skeleton_rig::kInvalidIndex) model[b] = local;
+        else mul_matrix(model[p], local, model[b]);
+    }
+
+    for (size_t b = 0; b < rig.size(); ++b) mul_matrix(model[b], rig.inverse_bind_poses[b], palette[b]);
+}
+
+void polymer::update_animation_instances(animation_instance * instances, const size_t count, const float dt, job_system & jobs)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        const animation_clip * clip = instances[i].sampler.get_clip();
+        if (instances[i].rig && clip && clip->bone_count != instances[i].rig->size())
+        {
+            throw std::invalid_argument("animation clip and skeleton rig have different bone counts");
+        }
+    }
+
+    jobs.parallel_for(count, 4, [&](const size_t begin, const size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            animation_instance & instance = instances[i];
+            const animation_clip * clip = instance.sampler.get_clip();
+            if (!instance.rig || !clip) continue;
+
+            instance.time += dt * instance.speed;
+            if (instance.loop && clip->duration > 0.f)
+            {
+                instance.time = std::fmod(instance.time, clip->duration);
+                if (instance.time < 0.f) instance.time += clip->duration;
+            }
+            else
+            {
+                instance.time = std::min(std::max(instance.time, 0.f), clip->duration);
+            }
+
+            instance.sampler.sample(instance.time, instance.pose);
+
+            instance.model_matrices.resize(instance.rig->size());
+            instance.palette.resize(instance.rig->size());
+            compute_skinning_palette(*instance.rig, instance.pose, instance.model_matrices.data(), instance.palette.data());
+        }
+    });
+}
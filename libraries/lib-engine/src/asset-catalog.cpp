@@ -0,0 +1,279 @@
+#include "polymer-engine/asset/asset-catalog.hpp"
+#include "polymer-engine/logging.hpp"
+
+#include "polymer-core/util/util.hpp"
+#include "polymer-core/util/file-io.hpp"
+
+#include "nlohmann/json.hpp"
+
+#include <algorithm>
+#include <filesystem>
+
+using namespace polymer;
+using json = nlohmann::json;
+
+namespace fs = std::filesystem;
+
+static const int kCatalogCacheVersion = 1;
+
+static std::string to_lower(std::string s)
+{
+    std::transform(s.begin(), s.end(), s.begin(), ::tolower);
+    return s;
+}
+
+static std::string normalize_root(std::string path)
+{
+    for (auto & chr : path) if (chr == '\\') chr = '/';
+    while (path.size() > 1 && path.back() == '/') path.pop_back();
+    return path;
+}
+
+static std::string join_relative(const std::string & parent, const std::string & child)
+{
+    return parent.empty() ? child : parent + "/" + child;
+}
+
+asset_catalog::asset_catalog(const std::string & cache_directory) : cache_directory(cache_directory) {}
+
+std::string asset_catalog::default_cache_directory()
+{
+    std::error_code ec;
+    const fs::path temp = fs::temp_directory_path(ec);
+    return ec ? std::string() : temp.generic_string();
+}
+
+std::string asset_catalog::cache_path(const catalog_root & root) const
+{
+    std::error_code ec;
+    fs::path absolute = fs::absolute(root.path, ec);
+    const std::string key = ec ? root.path : absolute.lexically_normal().generic_string();
+
+    char name[64];
+    snprintf(name, sizeof(name), "polymer-asset-catalog-%08x.json", poly_hash_fnv1a(key));
+    return cache_directory + "/" + name;
+}
+
+bool asset_catalog::load_cache(catalog_root & root) const
+{
+    if (cache_directory.empty()) return false;
+
+    const std::string path = cache_path(root);
+    std::error_code ec;
+    if (!fs::exists(path, ec) || ec) return false;
+
+    try
+    {
+        const json doc = json::parse(read_file_text(path));
+        if (doc.at("version").get<int>() != kCatalogCacheVersion) return false;
+        if (doc.at("root").get<std::string>() != root.path) return false; // hash collision
+
+        for (const json & d : doc.at("directories"))
+        {
+            directory_listing listing;
+            listing.write_time = d.at("write_time").get<int64_t>();
+            listing.files = d.at("files").get<std::vector<std::string>>();
+            listing.subdirectories = d.at("subdirectories").get<std::vector<std::string>>();
+            root.directories[d.at("path").get<std::string>()] = std::move(listing);
+        }
+    }
+    catch (const std::exception & e)
+    {
+        log::get()->engine_log->warn("ignoring asset catalog cache {}: {}", path, e.what());
+        root.directories.clear();
+        return false;
+    }
+
+    return true;
+}
+
+void asset_catalog::save_cache(const catalog_root & root) const
+{
+    if (cache_directory.empty()) return;
+
+    json directories = json::array();
+    for (const auto & d : root.directories)
+    {
+        directories.push_back({
+            { "path", d.first },
+            { "write_time", d.second.write_time },
+            { "files", d.second.files },
+            { "subdirectories", d.second.subdirectories }
+        });
+    }
+
+    const json doc = { { "version", kCatalogCacheVersion }, { "root", root.path }, { "directories", directories } };
+
+    try { write_file_text(cache_path(root), doc.dump()); }
+    catch (const std::exception & e) { log::get()->engine_log->warn("could not write asset catalog cache: {}", e.what()); }
+}
+
+bool asset_catalog::refresh_root(catalog_root & root)
+{
+    asset_catalog_stats stats;
+    stats.loaded_from_cache = root.stats.loaded_from_cache;
+
+    std::unordered_map<std::string, directory_listing> next;
+    std::vector<std::string> stack = { "" };
+    bool changed = false;
+
+    while (!stack.empty())
+    {
+        const std::string relative = std::move(stack.back());
+        stack.pop_back();
+
+        const fs::path absolute = relative.empty() ? fs::path(root.path) : fs::path(root.path) / relative;
+
+        std::error_code ec;
+        const auto write_time = fs::last_write_time(absolute, ec);
+        if (ec) continue; // removed since its parent was listed, or not readable
+
+        const int64_t write_time_count = static_cast<int64_t>(write_time.time_since_epoch().count());
+
+        directory_listing listing;
+        auto cached = root.directories.find(relative);
+        if (cached != root.directories.end() && cached->second.write_time == write_time_count)
+        {
+            listing = std::move(cached->second);
+        }
+        else
+        {
+            listing.write_time = write_time_count;
+            for (auto it = fs::directory_iterator(absolute, fs::directory_options::skip_permission_denied, ec); !ec && it != fs::directory_iterator(); it.increment(ec))
+            {
+                std::error_code entry_ec;
+                const std::string filename = it->path().filename().generic_string();
+
+                // Like recursive_directory_iterator, symlinked directories are not followed
+                if (it->is_symlink(entry_ec) && it->is_directory(entry_ec)) continue;
+
+                if (it->is_directory(entry_ec)) listing.subdirectories.push_back(filename);
+                else if (it->is_regular_file(entry_ec)) listing.files.push_back(filename);
+            }
+
+            // Listing order is unspecified; sort so lookups are deterministic
+            std::sort(listing.files.begin(), listing.files.end());
+            std::sort(listing.subdirectories.begin(), listing.subdirectories.end());
+
+            ++stats.listed_directories;
+            changed = true;
+        }
+
+        for (auto s = listing.subdirectories.rbegin(); s != listing.subdirectories.rend(); ++s) stack.push_back(join_relative(relative, *s));
+
+        stats.files += listing.files.size();
+        next[relative] = std::move(listing);
+    }
+
+    // Directories that disappeared
+    if (next.size() != root.directories.size()) changed = true;
+
+    stats.directories = next.size();
+    root.directories = std::move(next);
+    root.stats = stats;
+    return changed;
+}
+
+void asset_catalog::rebuild_index()
+{
+    entries.clear();
+    by_stem.clear();
+    by_extension.clear();
+
+    for (const catalog_root & root : roots)
+    {
+        // Depth first from the root, so entries are ordered the same way on every run
+        std::vector<std::string> stack = { "" };
+        while (!stack.empty())
+        {
+            const std::string relative = std::move(stack.back());
+            stack.pop_back();
+
+            auto d = root.directories.find(relative);
+            if (d == root.directories.end()) continue;
+
+            for (const std::string & file : d->second.files)
+            {
+                const size_t dot = file.find_last_of('.');
+                const std::string stem = dot == std::string::npos ? file : file.substr(0, dot);
+                const std::string extension = dot == std::string::npos ? std::string() : file.substr(dot + 1);
+
+                entry e;
+                e.path = root.path + "/" + join_relative(relative, file);
+                e.name = join_relative(relative, stem);
+                e.stem = to_lower(stem);
+                e.extension = to_lower(extension);
+
+                const uint32_t index = static_cast<uint32_t>(entries.size());
+                by_stem[e.stem].push_back(index);
+                by_extension[e.extension].push_back(index);
+                entries.push_back(std::move(e));
+            }
+
+            for (auto s = d->second.subdirectories.rbegin(); s != d->second.subdirectories.rend(); ++s) stack.push_back(join_relative(relative, *s));
+        }
+    }
+}
+
+void asset_catalog::add_root(const std::string & root_path)
+{
+    const std::string path = normalize_root(root_path);
+    if (contains_root(path)) return;
+
+    catalog_root root;
+    root.path = path;
+    root.stats.loaded_from_cache = load_cache(root);
+
+    const bool changed = refresh_root(root);
+    if (changed) save_cache(root);
+
+    log::get()->engine_log->info("asset catalog {}: {} files in {} directories ({} listed{})", path,
+        root.stats.files, root.stats.directories, root.stats.listed_directories, root.stats.loaded_from_cache ? ", from cache" : "");
+
+    roots.push_back(std::move(root));
+    rebuild_index();
+}
+
+void asset_catalog::refresh()
+{
+    bool any_changed = false;
+    for (catalog_root & root : roots)
+    {
+        if (refresh_root(root))
+        {
+            save_cache(root);
+            any_changed = true;
+        }
+    }
+    if (any_changed) rebuild_index();
+}
+
+std::vector<const asset_catalog::entry *> asset_catalog::find(const std::string & stem) const
+{
+    std::vector<const entry *> result;
+    auto itr = by_stem.find(stem);
+    if (itr != by_stem.end()) for (const uint32_t i : itr->second) result.push_back(&entries[i]);
+    return result;
+}
+
+std::vector<const asset_catalog::entry *> asset_catalog::find_extension(const std::string & extension) const
+{
+    std::vector<const entry *> result;
+    auto itr = by_extension.find(extension);
+    if (itr != by_extension.end()) for (const uint32_t i : itr->second) result.push_back(&entries[i]);
+    return result;
+}
+
+bool asset_catalog::contains_root(const std::string & root) const
+{
+    const std::string path = normalize_root(root);
+    for (const catalog_root & r : roots) if (r.path == path) return true;
+    return false;
+}
+
+asset_catalog_stats asset_catalog::get_stats(const std::string & root) const
+{
+    const std::string path = normalize_root(root);
+    for (const catalog_root & r : roots) if (r.path == path) return r.stats;
+    return {};
+}
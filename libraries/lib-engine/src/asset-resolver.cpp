@@ -2,13 +2,350 @@
 #include "polymer-engine/scene.hpp"
 #include "polymer-engine/object.hpp"
 
+#include "polymer-core/util/job-system.hpp"
+
 #include <cassert>
+#include <chrono>
 
 using namespace polymer;
 
 template <>global_asset_dir * polymer::singleton<global_asset_dir>::single = nullptr;
 
-void asset_resolver::resolve()
+////////////////////////
+//   Loader threads   //
+////////////////////////
+
+// Runs on a loader thread: no GL calls and no access to the asset_handle tables.
+static void load_staged_asset(staged_asset & a)
+{
+    switch (a.type)
+    {
+    case staged_asset::asset_type::texture:
+    {
+        const std::vector<uint8_t> binary_file = read_file_binary(a.path);
+
+        // Resolved textures are never flipped. The thread-local flag keeps loads on other threads,
+        // which set the global one, from racing with this decode.
+        stbi_set_flip_vertically_on_load_thread(0);
+
+        int width, height, num_channels;
+        uint8_t * data = stbi_load_from_memory(binary_file.data(), static_cast<int>(binary_file.size()), &width, &height, &num_channels, 0);
+        if (!data) throw std::runtime_error("failed to decode image " + a.path);
+
+        a.pixels.assign(data, data + size_t(width) * height * num_channels);
+        stbi_image_free(data);
+
+        a.width = width;
+        a.height = height;
+        a.channels = num_channels;
+        a.srgb = is_srgb_texture(a.path);
+        break;
+    }
+    case staged_asset::asset_type::cubemap:
+    {
+        const std::vector<uint8_t> binary_file = read_file_binary(a.path);
+        a.cubemap = gli::texture_cube(gli::load_dds((char *)binary_file.data(), binary_file.size()));
+        if (a.cubemap.empty()) throw std::runtime_error("failed to load cubemap " + a.path);
+        break;
+    }
+    case staged_asset::asset_type::model:
+    {
+        std::unordered_map<std::string, runtime_mesh> imported_models = import_model(a.path);
+        for (auto & m : imported_models)
+        {
+            runtime_mesh & mesh = m.second;
+            if (mesh.vertices.empty()) continue;
+            rescale_geometry(mesh, 1.f);
+            optimize_model(mesh);
+            a.vertices.push_back(interleave_geometry(mesh));
+            a.meshes.emplace_back(m.first, std::move(mesh));
+        }
+        break;
+    }
+    case staged_asset::asset_type::material:
+    {
+        a.materials = material_library::parse_material(a.path);
+        break;
+    }
+    }
+}
+
+size_t staged_asset::upload_bytes() const
+{
+    size_t bytes = pixels.size() + (cubemap.empty() ? 0 : cubemap.size());
+    for (size_t i = 0; i < meshes.size(); ++i)
+    {
+        bytes += vertices[i].size_bytes() + meshes[i].second.faces.size() * sizeof(uint3);
+    }
+    return bytes;
+}
+
+////////////////////////
+//   asset_resolver   //
+////////////////////////
+
+asset_resolver::~asset_resolver()
+{
+    // Queued loads are skipped; the ones already running finish before the threads join
+    cancelled = true;
+    loaders.reset();
+}
+
+void asset_resolver::schedule(staged_asset::asset_type type, const std::string & path, const std::string & name)
+{
+    // Model import on the loader threads runs on the shared job system, which they must not be the ones to create
+    assert(default_job_system().on_main_thread());
+    if (!loaders) loaders.reset(new simple_thread_pool(std::max(options.loader_threads, 1u)));
+
+    staged_asset * a = new staged_asset();
+    a->type = type;
+    a->path = path;
+    a->name = name;
+
+    if (type == staged_asset::asset_type::material) ++materials_in_flight;
+
+    {
+        std::lock_guard<std::mutex> lock(staged_mutex);
+        ++loads_in_flight;
+    }
+
+    loaders->enqueue([this, a]()
+    {
+        std::unique_ptr<staged_asset> asset(a);
+        if (cancelled) return;
+
+        try { load_staged_asset(*asset); }
+        catch (const std::exception & e) { asset->error = e.what(); }
+
+        {
+            std::lock_guard<std::mutex> lock(staged_mutex);
+            staged.push_back(std::move(asset));
+            --loads_in_flight;
+        }
+        staged_cv.notify_one();
+    });
+}
+
+void asset_resolver::schedule_from_catalog()
+{
+    // returns true if not in the cache
+    auto asset_resolve_cache = [&](const std::string & name, const std::string & type_id) -> bool
+    {
+        const uint32_t key = poly_hash_fnv1a(type_id + "/" + name);
+        auto iter = resolved.find(key);
+
+        if (iter == resolved.end())
+        {
+            resolved[key] = true;
+            log::get()->engine_log->info("resolving: {} ({})", name, type_id);
+            return true;
+        }
+        return false;
+    };
+
+    for (const asset_catalog::entry * e : catalog.find_extension("material"))
+    {
+        if (asset_resolve_cache(e->name, "material"))
+        {
+            schedule(staged_asset::asset_type::material, e->path, e->stem);
+        }
+    }
+
+    for (const auto & name : texture_names)
+    {
+        for (const asset_catalog::entry * e : catalog.find(name))
+        {
+            const std::string & ext = e->extension;
+            if (ext == "png" || ext == "tga" || ext == "jpg" || ext == "jpeg")
+            {
+                if (asset_resolve_cache(name, typeid(gl_texture_2d).name()))
+                {
+                    texture_handle(name).mark_loading();
+                    schedule(staged_asset::asset_type::texture, e->path, name);
+                }
+            }
+            else if (ext == "dds")
+            {
+                if (asset_resolve_cache(name, "dds-cubemap"))
+                {
+                    cubemap_handle(name).mark_loading();
+                    schedule(staged_asset::asset_type::cubemap, e->path, name);
+                }
+            }
+        }
+    }
+
+    // Name could either be something like "my_mesh" or "my_mesh/sub_component"
+    // `mesh_names` contains both CPU and GPU geometry handle ids
+    for (const auto & name : mesh_names)
+    {
+        // "my_mesh/sub_component" should match to "my_mesh.obj" or similar
+        const std::string root = find_root(name);
+        for (const asset_catalog::entry * e : catalog.find(root))
+        {
+            const std::string & ext = e->extension;
+            if (ext != "obj" && ext != "fbx" && ext != "ply" && ext != "mesh") continue;
+
+            gpu_mesh_handle(name).mark_loading();
+            cpu_mesh_handle(name).mark_loading();
+
+            // The whole file is imported once, creating handles for all of its submeshes
+            if (asset_resolve_cache(root, typeid(gl_mesh).name()))
+            {
+                schedule(staged_asset::asset_type::model, e->path, root);
+            }
+        }
+    }
+}
+
+void asset_resolver::collect_shaders_and_textures()
+{
+    for (auto & mat : mat_library->instances)
+    {
+        if (auto * pbr = dynamic_cast<polymer_pbr_standard*>(mat.second.instance.get()))
+        {
+            shader_names.push_back(pbr->shader.name);
+
+            texture_names.push_back(pbr->albedo.name);
+            texture_names.push_back(pbr->normal.name);
+            texture_names.push_back(pbr->metallic.name);
+            texture_names.push_back(pbr->roughness.name);
+            texture_names.push_back(pbr->emissive.name);
+            texture_names.push_back(pbr->height.name);
+            texture_names.push_back(pbr->occlusion.name);
+        }
+
+        if (auto * phong = dynamic_cast<polymer_blinn_phong_standard*>(mat.second.instance.get()))
+        {
+            shader_names.push_back(phong->shader.name);
+
+            texture_names.push_back(phong->diffuse.name);
+            texture_names.push_back(phong->normal.name);
+        }
+    }
+
+    remove_duplicates(shader_names);
+    remove_duplicates(texture_names);
+}
+
+uint8_t * asset_resolver::allocate_staging(const size_t size_bytes, GLintptr & offset)
+{
+    if (!options.staging_buffer_bytes || size_bytes > options.staging_buffer_bytes) return nullptr;
+    if (!staging_buffer.created()) staging_buffer.create(static_cast<GLsizeiptr>(options.staging_buffer_bytes));
+    return staging_buffer.allocate(static_cast<GLsizeiptr>(size_bytes), 16, offset);
+}
+
+void asset_resolver::upload(staged_asset & a)
+{
+    // Copies bytes into a buffer through the staging ring, or directly if it cannot hold them
+    auto stream_to_buffer = [this](gl_buffer & dst, const void * src, const size_t size_bytes)
+    {
+        GLintptr offset = 0;
+        if (uint8_t * ptr = allocate_staging(size_bytes, offset))
+        {
+            std::memcpy(ptr, src, size_bytes);
+            glCopyNamedBufferSubData(staging_buffer.id(), dst, offset, 0, static_cast<GLsizeiptr>(size_bytes));
+        }
+        else dst.set_buffer_sub_data(static_cast<GLsizeiptr>(size_bytes), 0, src);
+    };
+
+    if (!a.error.empty())
+    {
+        log::get()->engine_log->error("failed to load {}: {}", a.path, a.error);
+    }
+
+    switch (a.type)
+    {
+    case staged_asset::asset_type::texture:
+    {
+        if (!a.error.empty()) { texture_handle(a.name).mark_failed(); break; }
+
+        GLenum internal_fmt, format, type = GL_UNSIGNED_BYTE;
+        switch (a.channels)
+        {
+        case 1: internal_fmt = GL_RED; format = GL_RED; break;
+        case 2: internal_fmt = GL_RED; format = GL_RED; type = GL_UNSIGNED_SHORT; break;
+        case 3: internal_fmt = a.srgb ? GL_SRGB8 : GL_RGB; format = GL_RGB; break;
+        case 4: internal_fmt = a.srgb ? GL_SRGB8_ALPHA8 : GL_RGBA; format = GL_RGBA; break;
+        default:
+            log::get()->engine_log->error("unsupported number of channels ({}) in {}", a.channels, a.path);
+            texture_handle(a.name).mark_failed();
+            return;
+        }
+
+        gl_texture_2d tex;
+        tex.setup(a.width, a.height, internal_fmt, format, type, nullptr, true);
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        GLintptr offset = 0;
+        if (uint8_t * ptr = allocate_staging(a.pixels.size(), offset))
+        {
+            std::memcpy(ptr, a.pixels.data(), a.pixels.size());
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging_buffer.id());
+            glTextureSubImage2D(tex, 0, 0, 0, a.width, a.height, format, type, reinterpret_cast<const GLvoid *>(offset));
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+        else glTextureSubImage2D(tex, 0, 0, 0, a.width, a.height, format, type, a.pixels.data());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        glGenerateTextureMipmap(tex);
+        create_handle_for_asset(a.name.c_str(), std::move(tex));
+        break;
+    }
+    case staged_asset::asset_type::cubemap:
+    {
+        if (!a.error.empty()) { cubemap_handle(a.name).mark_failed(); break; }
+        create_handle_for_asset(a.name.c_str(), load_cubemap(a.cubemap));
+        break;
+    }
+    case staged_asset::asset_type::model:
+    {
+        for (size_t i = 0; i < a.meshes.size(); ++i)
+        {
+            runtime_mesh & mesh = a.meshes[i].second;
+            const interleaved_geometry & vertices = a.vertices[i];
+
+            gl_mesh m;
+            m.set_vertex_data(static_cast<GLsizeiptr>(vertices.size_bytes()), nullptr, GL_STATIC_DRAW);
+            set_interleaved_attributes(m, vertices);
+            stream_to_buffer(m.get_vertex_data_buffer(), vertices.vertices.data(), vertices.size_bytes());
+
+            // set_vertex_data cleared the bounds, which the renderer needs to cull the mesh
+            const aabb_3d bounds = compute_bounds(mesh.vertices);
+            m.set_bounds(bounds.min(), bounds.max());
+
+            if (mesh.faces.size() > 0)
+            {
+                m.set_index_data(GL_TRIANGLES, GL_UNSIGNED_INT, static_cast<GLsizei>(mesh.faces.size() * 3), nullptr, GL_STATIC_DRAW);
+                stream_to_buffer(m.get_index_data_buffer(), mesh.faces.data(), mesh.faces.size() * sizeof(uint3));
+            }
+
+            const std::string handle_id = a.name + "/" + a.meshes[i].first;
+            create_handle_for_asset(handle_id.c_str(), std::move(m));
+            create_handle_for_asset(handle_id.c_str(), std::move(mesh));
+        }
+
+        // References to submeshes the file did not contain
+        for (const auto & name : mesh_names)
+        {
+            if (find_root(name) != a.name) continue;
+            gpu_mesh_handle(name).mark_failed();
+            cpu_mesh_handle(name).mark_failed();
+        }
+        break;
+    }
+    case staged_asset::asset_type::material:
+    {
+        --materials_in_flight;
+        if (!a.error.empty()) break;
+        mat_library->add_parsed_material(a.materials);
+        rescan_pending = true;
+        break;
+    }
+    }
+}
+
+void asset_resolver::resolve_async()
 {
     assert(the_scene != nullptr);
     assert(mat_library != nullptr);
@@ -45,55 +382,65 @@ void asset_resolver::resolve()
     remove_duplicates(material_names);
     remove_duplicates(mesh_names);
 
-    auto collect_shaders_and_textures = [this]()
-    {
-        for (auto & mat : mat_library->instances)
-        {
-            if (auto * pbr = dynamic_cast<polymer_pbr_standard*>(mat.second.instance.get()))
-            {
-                shader_names.push_back(pbr->shader.name);
-
-                texture_names.push_back(pbr->albedo.name);
-                texture_names.push_back(pbr->normal.name);
-                texture_names.push_back(pbr->metallic.name);
-                texture_names.push_back(pbr->roughness.name);
-                texture_names.push_back(pbr->emissive.name);
-                texture_names.push_back(pbr->height.name);
-                texture_names.push_back(pbr->occlusion.name);
-            }
+    // First Pass. Grab shaders and textures programmatically defined.
+    collect_shaders_and_textures();
 
-            if (auto * phong = dynamic_cast<polymer_blinn_phong_standard*>(mat.second.instance.get()))
-            {
-                shader_names.push_back(phong->shader.name);
+    // Schedule known assets, including materials. The second pass runs from update() once the
+    // materials found here have been registered.
+    catalog.refresh();
+    schedule_from_catalog();
+}
 
-                texture_names.push_back(phong->diffuse.name);
-                texture_names.push_back(phong->normal.name);
-            }
+void asset_resolver::update(const size_t budget_bytes)
+{
+    size_t uploaded_bytes = 0;
+    bool uploaded_any = false;
+
+    while (!uploaded_any || uploaded_bytes < budget_bytes)
+    {
+        std::unique_ptr<staged_asset> asset;
+        {
+            std::lock_guard<std::mutex> lock(staged_mutex);
+            if (staged.empty()) break;
+            asset = std::move(staged.front());
+            staged.pop_front();
         }
 
-        remove_duplicates(shader_names);
-        remove_duplicates(texture_names);
-    };
+        uploaded_bytes += asset->upload_bytes();
+        uploaded_any = true;
+        upload(*asset);
+    }
 
-    // First Pass. Grab shaders and textures programmatically defined.
-    collect_shaders_and_textures();
+    // Everything read from the staging ring this frame has been issued
+    if (staging_buffer.created()) staging_buffer.fence();
 
-    // Resolve known assets, including materials.
-    for (auto & path : search_paths)
+    // Second Pass. Collect shaders and textures again, because materials might define them, and schedule
+    // the ones that are new. Waits for all scheduled materials so the directories are walked once.
+    if (rescan_pending && materials_in_flight == 0)
     {
-        log::get()->engine_log->info("[1] resolving directory " + path);
-        walk_directory(path);
+        rescan_pending = false;
+        collect_shaders_and_textures();
+        schedule_from_catalog();
     }
+}
 
-    // Second Pass. Collect shaders and textures again, because materials might define them and import them.
-    collect_shaders_and_textures();
+bool asset_resolver::pending()
+{
+    if (rescan_pending) return true;
+    std::lock_guard<std::mutex> lock(staged_mutex);
+    return loads_in_flight > 0 || !staged.empty();
+}
 
-    // Resolve known assets again, this time including shaders and textures that may
-    // have been identified by an imported material.
-    // @fixme - we need to remove already resolved assets from being imported a second time!
-    for (auto & path : search_paths)
+void asset_resolver::resolve()
+{
+    resolve_async();
+
+    while (pending())
     {
-        log::get()->engine_log->info("[2] resolving directory " + path);
-        walk_directory(path);
+        {
+            std::unique_lock<std::mutex> lock(staged_mutex);
+            staged_cv.wait_for(lock, std::chrono::milliseconds(10), [this]() { return !staged.empty() || loads_in_flight == 0; });
+        }
+        update(std::numeric_limits<size_t>::max());
     }
 }
@@ -0,0 +1,251 @@
+#include "polymer-engine/renderer/light-clusters.hpp"
+#include "polymer-core/util/job-system.hpp"
+#include "polymer-core/util/cpu-features.hpp"
+
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+using namespace polymer;
+
+namespace
+{
+    // Four spheres against one interval of an axis. The squared distance from each center p[k] to [lo, hi]
+    // is added to base[k]. Returns bit k when the sum is within r2[k], the squared radius.
+    inline uint32_t test_spheres(const float lo, const float hi, const float * p, const float * base, const float * r2, float * d2_out)
+    {
+    #if defined(POLYMER_SIMD_X86)
+        const __m128 c = _mm_loadu_ps(p);
+        const __m128 d = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(lo), c), _mm_sub_ps(c, _mm_set1_ps(hi))), _mm_setzero_ps());
+        const __m128 d2 = _mm_add_ps(_mm_mul_ps(d, d), _mm_loadu_ps(base));
+        if (d2_out) _mm_storeu_ps(d2_out, d2);
+        return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(d2, _mm_loadu_ps(r2))));
+    #else
+        uint32_t mask = 0;
+        for (uint32_t k = 0; k < 4; ++k)
+        {
+            const float d = std::max(std::max(lo - p[k], p[k] - hi), 0.f);
+            const float d2 = d * d + base[k];
+            if (d2_out) d2_out[k] = d2;
+            if (d2 <= r2[k]) mask |= 1u << k;
+        }
+        return mask;
+    #endif
+    }
+
+    // One sphere against four intervals [lo[k], hi[k]] of an axis, the same test the other way around
+    inline uint32_t test_intervals(const float * lo, const float * hi, const float p, const float base, const float r2, float * d2_out)
+    {
+    #if defined(POLYMER_SIMD_X86)
+        const __m128 c = _mm_set1_ps(p);
+        const __m128 d = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(lo), c), _mm_sub_ps(c, _mm_loadu_ps(hi))), _mm_setzero_ps());
+        const __m128 d2 = _mm_add_ps(_mm_mul_ps(d, d), _mm_set1_ps(base));
+        if (d2_out) _mm_storeu_ps(d2_out, d2);
+        return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(d2, _mm_set1_ps(r2))));
+    #else
+        uint32_t mask = 0;
+        for (uint32_t k = 0; k < 4; ++k)
+        {
+            const float d = std::max(std::max(lo[k] - p, p - hi[k]), 0.f);
+            const float d2 = d * d + base;
+            if (d2_out) d2_out[k] = d2;
+            if (d2 <= r2) mask |= 1u << k;
+        }
+        return mask;
+    #endif
+    }
+
+    inline uint32_t low_bits(const uint32_t n) { return n >= 32 ? 0xFFFFFFFFu : (1u << n) - 1; }
+
+    const float zeros[4] = { 0.f, 0.f, 0.f, 0.f };
+}
+
+light_cluster_grid::light_cluster_grid(const uint32_t tiles_x, const uint32_t tiles_y, const uint32_t slices)
+    : tiles_x(tiles_x), tiles_y(tiles_y), slices(slices), column_stride((tiles_x + 3) & ~3u), row_stride((tiles_y + 3) & ~3u)
+{
+    if (tiles_x == 0 || tiles_y == 0 || slices == 0) throw std::runtime_error("light cluster grid needs at least one froxel");
+    if (tiles_x > 32 || tiles_y > 32) throw std::runtime_error("light cluster grid has more than 32 tiles across or down");
+    clusters.resize(size());
+}
+
+void light_cluster_grid::set_projection(const float4x4 & projection, const float near, const float far)
+{
+    if (!is_perspective(projection)) throw std::runtime_error("light clusters need a perspective projection");
+    if (!(near > 0.f && far > near)) throw std::runtime_error("light clusters need 0 < near < far");
+
+    const float log_ratio = std::log(far / near);
+    slice_scale = float(slices) / log_ratio;
+    slice_bias = -float(slices) * std::log(near) / log_ratio;
+
+    slice_near.resize(slices);
+    slice_far.resize(slices);
+    for (uint32_t z = 0; z < slices; ++z)
+    {
+        slice_near[z] = z == 0 ? near : slice_far[z - 1];
+        slice_far[z] = z + 1 == slices ? far : near * std::pow(far / near, float(z + 1) / slices);
+    }
+
+    // A point at depth d that projects to ndc (nx, ny) has view x = d * (nx + P[2][0]) / P[0][0], and the same
+    // for y. Both are linear in d, so the extent of a tile over a slice comes from the depths at its ends.
+    const auto extent = [](const float n0, const float n1, const float d0, const float d1, float & lo, float & hi)
+    {
+        lo = std::min(std::min(n0 * d0, n0 * d1), std::min(n1 * d0, n1 * d1));
+        hi = std::max(std::max(n0 * d0, n0 * d1), std::max(n1 * d0, n1 * d1));
+    };
+
+    // Padding tiles are empty intervals, which no sphere reaches
+    const float inf = std::numeric_limits<float>::infinity();
+    column_min.assign(size_t(slices) * column_stride, inf);
+    column_max.assign(size_t(slices) * column_stride, -inf);
+    row_min.assign(size_t(slices) * row_stride, inf);
+    row_max.assign(size_t(slices) * row_stride, -inf);
+    for (uint32_t z = 0; z < slices; ++z)
+    {
+        for (uint32_t x = 0; x < tiles_x; ++x)
+        {
+            const float n0 = (-1.f + 2.f * x / tiles_x + projection[2][0]) / projection[0][0];
+            const float n1 = (-1.f + 2.f * (x + 1) / tiles_x + projection[2][0]) / projection[0][0];
+            extent(n0, n1, slice_near[z], slice_far[z], column_min[z * column_stride + x], column_max[z * column_stride + x]);
+        }
+        for (uint32_t y = 0; y < tiles_y; ++y)
+        {
+            const float n0 = (-1.f + 2.f * y / tiles_y + projection[2][1]) / projection[1][1];
+            const float n1 = (-1.f + 2.f * (y + 1) / tiles_y + projection[2][1]) / projection[1][1];
+            extent(n0, n1, slice_near[z], slice_far[z], row_min[z * row_stride + y], row_max[z * row_stride + y]);
+        }
+    }
+}
+
+aabb_3d light_cluster_grid::cluster_bounds(const uint32_t x, const uint32_t y, const uint32_t z) const
+{
+    return { { column_min[z * column_stride + x], row_min[z * row_stride + y], -slice_far[z] },
+             { column_max[z * column_stride + x], row_max[z * row_stride + y], -slice_near[z] } };
+}
+
+void light_cluster_grid::bin_slice(const uint32_t z, const size_t padded_count)
+{
+    slice_scratch & s = scratch[z];
+    s.lights.clear();
+    s.dz2.clear();
+    s.footprints.clear();
+    s.indices.clear();
+
+    // Spheres that reach the slab of the slice, with their squared distance to it
+    float d2[4];
+    for (size_t i = 0; i < padded_count; i += 4)
+    {
+        uint32_t mask = test_spheres(-slice_far[z], -slice_near[z], &light_z[i], zeros, &light_r2[i], d2);
+        for (uint32_t k = 0; mask; ++k, mask >>= 1)
+        {
+            if (!(mask & 1)) continue;
+            s.lights.push_back(static_cast<uint32_t>(i + k));
+            s.dz2.push_back(d2[k]);
+        }
+    }
+    if (s.lights.empty()) return;
+
+    // The rows each sphere reaches, then the froxels it reaches in each of those rows
+    const uint32_t tiles = tiles_x * tiles_y;
+    const float * rows_min = &row_min[z * row_stride];
+    const float * rows_max = &row_max[z * row_stride];
+    const float * columns_min = &column_min[z * column_stride];
+    const float * columns_max = &column_max[z * column_stride];
+
+    s.cursors.assign(tiles, 0);
+    float dyz2[32];
+    for (size_t j = 0; j < s.lights.size(); ++j)
+    {
+        const uint32_t i = s.lights[j];
+
+        uint32_t rows = 0;
+        for (uint32_t y = 0; y < tiles_y; y += 4) rows |= test_intervals(&rows_min[y], &rows_max[y], light_y[i], s.dz2[j], light_r2[i], &dyz2[y]) << y;
+        rows &= low_bits(tiles_y);
+
+        for (uint32_t y = 0; rows; ++y, rows >>= 1)
+        {
+            if (!(rows & 1)) continue;
+
+            uint32_t columns = 0;
+            for (uint32_t x = 0; x < tiles_x; x += 4) columns |= test_intervals(&columns_min[x], &columns_max[x], light_x[i], dyz2[y], light_r2[i], nullptr) << x;
+            columns &= low_bits(tiles_x);
+            if (!columns) continue;
+
+            s.footprints.push_back({ i, y, columns });
+            uint32_t * counts = &s.cursors[y * tiles_x];
+            for (uint32_t x = 0; columns; ++x, columns >>= 1) counts[x] += columns & 1;
+        }
+    }
+
+    // Counting sort of the footprints into runs. Lights were visited in ascending order, so each run is too.
+    light_cluster * slice_clusters = &clusters[size_t(z) * tiles];
+    uint32_t offset = 0;
+    for (uint32_t t = 0; t < tiles; ++t)
+    {
+        slice_clusters[t].count = s.cursors[t];
+        s.cursors[t] = offset;
+        offset += slice_clusters[t].count;
+    }
+
+    s.indices.resize(offset);
+    for (const footprint & f : s.footprints)
+    {
+        uint32_t * cursors = &s.cursors[f.row * tiles_x];
+        uint32_t columns = f.columns;
+        for (uint32_t x = 0; columns; ++x, columns >>= 1) if (columns & 1) s.indices[cursors[x]++] = f.light;
+    }
+}
+
+void light_cluster_grid::bin(const float4x4 & view, const float4 * spheres, const size_t count)
+{
+    if (slice_near.empty()) throw std::runtime_error("light cluster grid has no projection");
+
+    clusters.assign(size(), light_cluster());
+    indices.clear();
+    if (count == 0) return;
+
+    // Padding spheres have a negative squared radius, so they touch nothing
+    const size_t padded_count = (count + 3) & ~size_t(3);
+    light_x.assign(padded_count, 0.f);
+    light_y.assign(padded_count, 0.f);
+    light_z.assign(padded_count, 0.f);
+    light_r2.assign(padded_count, -1.f);
+
+    default_job_system().parallel_for(count, 1024, [&](const size_t begin, const size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            const float4 & s = spheres[i];
+            if (!(s.w > 0.f)) continue;
+            const float3 c = transform_coord(view, float3(s.x, s.y, s.z));
+            light_x[i] = c.x;
+            light_y[i] = c.y;
+            light_z[i] = c.z;
+            light_r2[i] = s.w * s.w;
+        }
+    });
+
+    scratch.resize(slices);
+    default_job_system().parallel_for(slices, 1, [&](const size_t begin, const size_t end)
+    {
+        for (size_t z = begin; z < end; ++z) bin_slice(static_cast<uint32_t>(z), padded_count);
+    });
+
+    // Froxels are numbered slice by slice, so the runs of each slice follow those of the one before
+    const size_t per_slice = size_t(tiles_x) * tiles_y;
+    uint32_t offset = 0;
+    for (light_cluster & c : clusters)
+    {
+        c.offset = offset;
+        offset += c.count;
+    }
+
+    indices.resize(offset);
+    default_job_system().parallel_for(slices, 4, [&](const size_t begin, const size_t end)
+    {
+        for (size_t z = begin; z < end; ++z)
+        {
+            const std::vector<uint32_t> & src = scratch[z].indices;
+            if (!src.empty()) std::memcpy(&indices[clusters[z * per_slice].offset], src.data(), src.size() * sizeof(uint32_t));
+        }
+    });
+}
@@ -51,14 +51,15 @@ void material_library::export_all()
     }
 }
 
-void material_library::import_material(const std::string & path)
+std::vector<material_library::material_instance> material_library::parse_material(const std::string & path)
 {
-    // todo - de-duplicate based on name
     const json instance_doc = json::parse(read_file_text(path));
     const std::string name = get_filename_without_extension(path);
     const std::string parent_path = parent_directory_from_filepath(path);
     assert(!name.empty());
 
+    std::vector<material_instance> parsed;
+
     for (auto inst = instance_doc.begin(); inst != instance_doc.end(); ++inst)
     {
         if (starts_with(inst.key(), "@"))
@@ -66,35 +67,45 @@ void material_library::import_material(const std::string & path)
             const std::string type_key = inst.key();
             const std::string type_name = type_key.substr(1);
 
+            material_instance parsed_inst;
+            parsed_inst.name = name;
+            parsed_inst.origin_path = parent_path;
+
             if (type_name == get_typename<polymer_pbr_standard>())
             {
                 std::shared_ptr<polymer_pbr_standard> new_instance(new polymer_pbr_standard());
                 *new_instance = inst.value();
-
-                material_instance inst;
-                inst.name = name;
-                inst.origin_path = parent_path;
-                inst.instance = new_instance;
-                instances[name] = inst;
-
-                create_handle_for_asset(name.c_str(), static_cast<std::shared_ptr<base_material>>(new_instance));
+                parsed_inst.instance = new_instance;
             }
             else if (type_name == get_typename<polymer_blinn_phong_standard>())
             {
                 std::shared_ptr<polymer_blinn_phong_standard> new_instance(new polymer_blinn_phong_standard());
                 *new_instance = inst.value();
-
-                material_instance inst;
-                inst.name = name;
-                inst.origin_path = parent_path;
-                inst.instance = new_instance;
-                instances[name] = inst;
-
-                create_handle_for_asset(name.c_str(), static_cast<std::shared_ptr<base_material>>(new_instance));
+                parsed_inst.instance = new_instance;
             }
+            else continue;
+
+            parsed.push_back(parsed_inst);
         }
         else throw std::runtime_error("type key mismatch!");
     }
+
+    return parsed;
+}
+
+void material_library::add_parsed_material(const std::vector<material_instance> & parsed)
+{
+    // todo - de-duplicate based on name
+    for (const material_instance & inst : parsed)
+    {
+        instances[inst.name] = inst;
+        create_handle_for_asset(inst.name.c_str(), std::shared_ptr<base_material>(inst.instance));
+    }
+}
+
+void material_library::import_material(const std::string & path)
+{
+    add_parsed_material(parse_material(path));
 }
 
 void material_library::export_material(const std::string & key)
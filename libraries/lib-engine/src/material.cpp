@@ -68,11 +68,10 @@ uint32_t polymer_procedural_material::id()
 
 void polymer_procedural_material::update_uniforms(material_component * comp)
 {
-    if (update_uniform_func)
-    {
-        resolve_variants();
-        update_uniform_func();
-    }
+    if (!shader.assigned()) return;
+    resolve_variants();
+    compiled_shader->shader.uniform("u_opacity", opacity);
+    if (update_uniform_func) update_uniform_func();
 }
 
 ////////////////////////////
@@ -85,11 +84,17 @@ polymer_wireframe_material::polymer_wireframe_material()
     cast_shadows = false;
 }
 
+void polymer_wireframe_material::update_uniforms(material_component * comp)
+{
+    resolve_variants();
+    compiled_shader->shader.uniform("u_color", float4(color.xyz(), opacity));
+}
+
 void polymer_wireframe_material::use()
 {
     resolve_variants();
     compiled_shader->shader.bind();
-    compiled_shader->shader.uniform("u_color", float4(color.xyz(), opacity));
+    update_uniforms();
 }
 
 void polymer_wireframe_material::resolve_variants()
@@ -160,7 +165,6 @@ void polymer_blinn_phong_standard::update_uniforms(material_component * comp)
 {
     resolve_variants();
     gl_shader & program = compiled_shader->shader;
-    program.bind();
 
     program.uniform("u_diffuseColor", diffuseColor);
     program.uniform("u_specularColor", specularColor);
@@ -173,8 +177,6 @@ void polymer_blinn_phong_standard::update_uniforms(material_component * comp)
 
     if (compiled_shader->enabled("HAS_DIFFUSE_MAP")) program.texture("s_diffuse", bindpoint++, diffuse.get(), GL_TEXTURE_2D);
     if (compiled_shader->enabled("HAS_NORMAL_MAP")) program.texture("s_normal", bindpoint++, normal.get(), GL_TEXTURE_2D);
-
-    program.unbind();
 }
 
 void polymer_blinn_phong_standard::update_uniforms_shadow(GLuint handle)
@@ -183,9 +185,7 @@ void polymer_blinn_phong_standard::update_uniforms_shadow(GLuint handle)
     gl_shader & program = compiled_shader->shader;
     if (!compiled_shader->enabled("ENABLE_SHADOWS")) throw std::runtime_error("should not be called unless ENABLE_SHADOWS is defined.");
 
-    program.bind();
     program.texture("s_csmArray", bindpoint++, handle, GL_TEXTURE_2D_ARRAY);
-    program.unbind();
 }
 
 //////////////////////////////////////////////////////
@@ -237,7 +237,6 @@ void polymer_pbr_standard::update_uniforms(material_component * comp)
 {
     resolve_variants();
     gl_shader & program = compiled_shader->shader;
-    program.bind();
 
     program.uniform("u_opacity", opacity);
 
@@ -268,8 +267,6 @@ void polymer_pbr_standard::update_uniforms(material_component * comp)
     if (compiled_shader->enabled("HAS_EMISSIVE_MAP"))  program.texture("s_emissive",  bindpoint++, emissive.get(),  GL_TEXTURE_2D);
     if (compiled_shader->enabled("HAS_HEIGHT_MAP"))    program.texture("s_height",    bindpoint++, height.get(),    GL_TEXTURE_2D);
     if (compiled_shader->enabled("HAS_OCCLUSION_MAP")) program.texture("s_occlusion", bindpoint++, occlusion.get(), GL_TEXTURE_2D);
-
-    program.unbind();
 }
 
 void polymer_pbr_standard::update_uniforms_ibl(GLuint irradiance, GLuint radiance, GLuint dfg_lut)
@@ -278,11 +275,9 @@ void polymer_pbr_standard::update_uniforms_ibl(GLuint irradiance, GLuint radianc
     gl_shader & program = compiled_shader->shader;
     if (!compiled_shader->enabled("USE_IMAGE_BASED_LIGHTING")) throw std::runtime_error("should not be called unless USE_IMAGE_BASED_LIGHTING is defined.");
 
-    program.bind();
     program.texture("sc_irradiance", bindpoint++, irradiance, GL_TEXTURE_CUBE_MAP);
     program.texture("sc_radiance", bindpoint++, radiance, GL_TEXTURE_CUBE_MAP);
     program.texture("s_dfg_lut", bindpoint++, dfg_lut, GL_TEXTURE_2D);
-    program.unbind();
 }
 
 void polymer_pbr_standard::update_uniforms_shadow(GLuint handle)
@@ -291,9 +286,7 @@ void polymer_pbr_standard::update_uniforms_shadow(GLuint handle)
     gl_shader & program = compiled_shader->shader;
     if (!compiled_shader->enabled("ENABLE_SHADOWS")) throw std::runtime_error("should not be called unless ENABLE_SHADOWS is defined.");
 
-    program.bind();
     program.texture("s_csmArray", bindpoint++, handle, GL_TEXTURE_2D_ARRAY);
-    program.unbind();
 }
 
 void polymer_pbr_standard::use()
@@ -345,7 +338,6 @@ void polymer_pbr_bubble::update_uniforms(material_component * comp)
 {
     resolve_variants();
     gl_shader & program = compiled_shader->shader;
-    program.bind();
 
     program.uniform("u_opacity", opacity);
 
@@ -371,8 +363,6 @@ void polymer_pbr_bubble::update_uniforms(material_component * comp)
 
     if (compiled_shader->enabled("HAS_NORMAL_MAP"))    program.texture("s_normal",    bindpoint++, normal.get(),    GL_TEXTURE_2D);
     if (compiled_shader->enabled("HAS_THICKNESS_MAP")) program.texture("s_thickness", bindpoint++, thickness.get(), GL_TEXTURE_2D);
-
-    program.unbind();
 }
 
 void polymer_pbr_bubble::update_uniforms_ibl(GLuint irradiance, GLuint radiance, GLuint dfg_lut)
@@ -381,11 +371,9 @@ void polymer_pbr_bubble::update_uniforms_ibl(GLuint irradiance, GLuint radiance,
     gl_shader & program = compiled_shader->shader;
     if (!compiled_shader->enabled("USE_IMAGE_BASED_LIGHTING")) throw std::runtime_error("should not be called unless USE_IMAGE_BASED_LIGHTING is defined.");
 
-    program.bind();
     program.texture("sc_irradiance", bindpoint++, irradiance, GL_TEXTURE_CUBE_MAP);
     program.texture("sc_radiance", bindpoint++, radiance, GL_TEXTURE_CUBE_MAP);
     program.texture("s_dfg_lut", bindpoint++, dfg_lut, GL_TEXTURE_2D);
-    program.unbind();
 }
 
 void polymer_pbr_bubble::update_uniforms_refraction(GLuint scene_color, GLuint scene_depth, float2 resolution)
@@ -394,11 +382,9 @@ void polymer_pbr_bubble::update_uniforms_refraction(GLuint scene_color, GLuint s
     gl_shader & program = compiled_shader->shader;
     if (!compiled_shader->enabled("USE_SCREEN_SPACE_REFRACTION")) throw std::runtime_error("should not be called unless USE_SCREEN_SPACE_REFRACTION is defined.");
 
-    program.bind();
     program.texture("s_sceneColor", bindpoint++, scene_color, GL_TEXTURE_2D);
     program.texture("s_sceneDepth", bindpoint++, scene_depth, GL_TEXTURE_2D);
     program.uniform("u_screenResolution", resolution);
-    program.unbind();
 }
 
 void polymer_pbr_bubble::use()
@@ -0,0 +1,278 @@
+#include "polymer-engine/renderer/render-culling.hpp"
+#include "polymer-core/util/job-system.hpp"
+
+#include <deque>
+
+using namespace polymer;
+
+namespace
+{
+    inline bool is_empty(const aabb_3d & b)
+    {
+        // Also true for NaN bounds, so those are never culled either
+        return !(b._min.x <= b._max.x && b._min.y <= b._max.y && b._min.z <= b._max.z);
+    }
+
+    inline float half_surface_area(const float3 & bmin, const float3 & bmax)
+    {
+        const float3 d = bmax - bmin;
+        return d.x * d.y + d.y * d.z + d.z * d.x;
+    }
+
+    // Clears the bits of `planes` whose plane the box is entirely in front of. Returns false if the box is
+    // entirely behind one of them. Same test as frustum::intersects, in center-extent form.
+    inline bool test_box(const frustum & f, const float3 & bmin, const float3 & bmax, uint32_t & planes)
+    {
+        const float3 center = (bmin + bmax) * 0.5f;
+        const float3 extent = (bmax - bmin) * 0.5f;
+        for (uint32_t p = 0; p < 6; ++p)
+        {
+            if (!(planes & (1u << p))) continue;
+            const float4 & eq = f.planes[p].equation;
+            const float s = eq.x * center.x + eq.y * center.y + eq.z * center.z + eq.w;
+            const float r = std::abs(eq.x) * extent.x + std::abs(eq.y) * extent.y + std::abs(eq.z) * extent.z;
+            if (s + r < 0.f) return false;
+            if (s - r >= 0.f) planes &= ~(1u << p);
+        }
+        return true;
+    }
+}
+
+void render_culler::clear()
+{
+    nodes.clear();
+    node_end.clear();
+    node_first.clear();
+    node_last.clear();
+    leaf_objects.clear();
+    leaf_bounds.clear();
+    unbounded.clear();
+    tasks.clear();
+    top.clear();
+    depth = 0;
+    object_count = 0;
+    built_cost = cost = 0.f;
+    was_rebuilt = false;
+}
+
+void render_culler::rebuild(const std::vector<aabb_3d> & world_bounds)
+{
+    nodes.clear();
+    leaf_objects.clear();
+    leaf_bounds.clear();
+    tasks.clear();
+    top.clear();
+    depth = 0;
+
+    std::vector<aabb_3d> bounds;
+    std::vector<uint32_t> objects;
+    bounds.reserve(world_bounds.size());
+    objects.reserve(world_bounds.size());
+    for (uint32_t i = 0; i < static_cast<uint32_t>(world_bounds.size()); ++i)
+    {
+        if (is_empty(world_bounds[i])) continue;
+        bounds.push_back(world_bounds[i]);
+        objects.push_back(i);
+    }
+
+    if (bounds.empty())
+    {
+        built_cost = cost = 0.f;
+        return;
+    }
+
+    std::vector<uint32_t> order;
+    depth = bvh_tree::build_binned_sah(std::move(bounds), nodes, order);
+
+    leaf_objects.resize(order.size());
+    leaf_bounds.resize(order.size());
+    for (size_t s = 0; s < order.size(); ++s) leaf_objects[s] = objects[order[s]];
+
+    // The tree is depth first with left children first, so every subtree is a contiguous run of nodes and
+    // of leaf slots. Children come after their parent, so a reverse pass sees them first.
+    const uint32_t num_nodes = static_cast<uint32_t>(nodes.size());
+    node_end.resize(num_nodes);
+    node_first.resize(num_nodes);
+    node_last.resize(num_nodes);
+    for (uint32_t i = num_nodes; i-- > 0;)
+    {
+        const bvh_flat_node & node = nodes[i];
+        if (node.is_leaf())
+        {
+            node_end[i] = i + 1;
+            node_first[i] = node.offset;
+            node_last[i] = node.offset + node.count;
+        }
+        else
+        {
+            node_end[i] = node_end[node.offset];
+            node_first[i] = node_first[i + 1];
+            node_last[i] = node_last[node.offset];
+        }
+    }
+
+    // Split breadth first from the root until there are a few subtrees per thread
+    const size_t target = leaf_objects.size() < kParallelThreshold ? 1 : size_t(4) * default_job_system().num_threads();
+    std::deque<uint32_t> frontier = { 0 };
+    while (!frontier.empty() && tasks.size() + frontier.size() < target)
+    {
+        const uint32_t i = frontier.front();
+        frontier.pop_front();
+        if (nodes[i].is_leaf())
+        {
+            tasks.push_back(i);
+            continue;
+        }
+        top.push_back(i);
+        frontier.push_back(i + 1);
+        frontier.push_back(nodes[i].offset);
+    }
+    tasks.insert(tasks.end(), frontier.begin(), frontier.end());
+
+    refit(world_bounds);
+    built_cost = cost;
+}
+
+void render_culler::refit(const std::vector<aabb_3d> & world_bounds)
+{
+    if (nodes.empty())
+    {
+        cost = 0.f;
+        return;
+    }
+
+    // Refits node i from its children or its objects. Returns its term of the SAH cost before normalization.
+    const auto refit_node = [this](const uint32_t i) -> float
+    {
+        bvh_flat_node & node = nodes[i];
+        if (node.is_leaf())
+        {
+            node.bmin = leaf_bounds[node.offset]._min;
+            node.bmax = leaf_bounds[node.offset]._max;
+            for (uint32_t s = node.offset + 1; s < node.offset + node.count; ++s)
+            {
+                node.bmin = linalg::min(node.bmin, leaf_bounds[s]._min);
+                node.bmax = linalg::max(node.bmax, leaf_bounds[s]._max);
+            }
+            return half_surface_area(node.bmin, node.bmax) * node.count;
+        }
+
+        const bvh_flat_node & l = nodes[i + 1];
+        const bvh_flat_node & r = nodes[node.offset];
+        node.bmin = linalg::min(l.bmin, r.bmin);
+        node.bmax = linalg::max(l.bmax, r.bmax);
+        return half_surface_area(node.bmin, node.bmax);
+    };
+
+    task_areas.assign(tasks.size(), 0.f);
+    default_job_system().parallel_for(tasks.size(), 1, [&](const size_t begin, const size_t end)
+    {
+        for (size_t t = begin; t < end; ++t)
+        {
+            const uint32_t root = tasks[t];
+            for (uint32_t s = node_first[root]; s < node_last[root]; ++s) leaf_bounds[s] = world_bounds[leaf_objects[s]];
+
+            float area = 0.f;
+            for (uint32_t i = node_end[root]; i-- > root;) area += refit_node(i);
+            task_areas[t] = area;
+        }
+    });
+
+    float area = 0.f;
+    for (const float a : task_areas) area += a;
+    for (auto i = top.rbegin(); i != top.rend(); ++i) area += refit_node(*i);
+
+    cost = area / std::max(half_surface_area(nodes[0].bmin, nodes[0].bmax), 1e-12f);
+}
+
+void render_culler::update(const std::vector<aabb_3d> & world_bounds)
+{
+    was_rebuilt = false;
+
+    // Which objects are in the tree decides its shape
+    empty_objects.clear();
+    for (uint32_t i = 0; i < static_cast<uint32_t>(world_bounds.size()); ++i) if (is_empty(world_bounds[i])) empty_objects.push_back(i);
+
+    if (world_bounds.size() != object_count || empty_objects != unbounded)
+    {
+        unbounded.swap(empty_objects);
+        object_count = world_bounds.size();
+        rebuild(world_bounds);
+        was_rebuilt = true;
+        return;
+    }
+
+    refit(world_bounds);
+
+    // Objects that moved far from where they were built leave large, overlapping nodes behind
+    if (cost > rebuild_cost_ratio * built_cost)
+    {
+        rebuild(world_bounds);
+        was_rebuilt = true;
+    }
+}
+
+void render_culler::cull_subtree(const uint32_t root, const frustum & f, const uint32_t bit, uint32_t * masks) const
+{
+    struct entry { uint32_t node; uint32_t planes; };
+
+    entry local_stack[64];
+    std::vector<entry> heap_stack;
+    entry * stack = local_stack;
+    if (depth > 64) { heap_stack.resize(depth); stack = heap_stack.data(); }
+    uint32_t stack_size = 0;
+    entry e = { root, 0x3F };
+
+    while (true)
+    {
+        const bvh_flat_node & node = nodes[e.node];
+        uint32_t planes = e.planes;
+
+        if (test_box(f, node.bmin, node.bmax, planes))
+        {
+            if (planes == 0)
+            {
+                // Inside every plane: accept the whole subtree without visiting it
+                for (uint32_t s = node_first[e.node]; s < node_last[e.node]; ++s) masks[leaf_objects[s]] |= bit;
+            }
+            else if (node.is_leaf())
+            {
+                // The bounds of a leaf with a single object are the object's bounds
+                for (uint32_t s = node.offset; s < node.offset + node.count; ++s)
+                {
+                    uint32_t object_planes = planes;
+                    if (node.count == 1 || test_box(f, leaf_bounds[s]._min, leaf_bounds[s]._max, object_planes)) masks[leaf_objects[s]] |= bit;
+                }
+            }
+            else
+            {
+                stack[stack_size++] = { node.offset, planes };
+                e = { e.node + 1, planes };
+                continue;
+            }
+        }
+
+        if (stack_size == 0) break;
+        e = stack[--stack_size];
+    }
+}
+
+void render_culler::cull(const frustum * frustums, const uint32_t count, std::vector<uint32_t> & masks) const
+{
+    assert(count <= 32);
+    const uint32_t all = count >= 32 ? 0xFFFFFFFFu : (1u << count) - 1;
+
+    masks.assign(object_count, 0);
+    for (const uint32_t i : unbounded) masks[i] = all;
+    if (nodes.empty() || count == 0) return;
+
+    // Every leaf slot belongs to exactly one subtree, so no two tasks write the same mask
+    uint32_t * out = masks.data();
+    default_job_system().parallel_for(tasks.size(), 1, [&](const size_t begin, const size_t end)
+    {
+        for (size_t t = begin; t < end; ++t)
+        {
+            for (uint32_t q = 0; q < count; ++q) cull_subtree(tasks[t], frustums[q], 1u << q, out);
+        }
+    });
+}
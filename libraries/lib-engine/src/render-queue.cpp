@@ -0,0 +1,73 @@
+#include "polymer-engine/renderer/render-queue.hpp"
+#include "polymer-core/util/cpu-features.hpp"
+
+using namespace polymer;
+
+namespace
+{
+    inline bool is_affine(const float4x4 & m)
+    {
+        return m[0].w == 0.f && m[1].w == 0.f && m[2].w == 0.f && m[3].w == 1.f;
+    }
+
+#if defined(POLYMER_SIMD_X86)
+    inline __m128 cross3(const __m128 a, const __m128 b)
+    {
+        const __m128 a_yzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+        const __m128 b_yzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+        const __m128 c = _mm_sub_ps(_mm_mul_ps(a, b_yzx), _mm_mul_ps(a_yzx, b));
+        return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+    }
+
+    inline __m128 dot3(const __m128 a, const __m128 b)
+    {
+        const __m128 p = _mm_mul_ps(a, b);
+        const __m128 s = _mm_add_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_ps(p, p, _MM_SHUFFLE(1, 1, 1, 1)));
+        return _mm_add_ps(s, _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 2, 2)));
+    }
+#endif
+}
+
+void polymer::inverse_transpose_matrices(const float4x4 * in, float4x4 * out, const size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        const float4x4 & m = in[i];
+
+    #if defined(POLYMER_SIMD_X86)
+        if (is_affine(m))
+        {
+            // For columns a0..a2 and translation t, the rows of inverse(A) are the cross products of the
+            // other two columns over det(A). Transposed, they become the columns of the result, and the
+            // translation of inverse(M) lands in the bottom row.
+            const __m128 w_mask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+            const __m128 a0 = _mm_and_ps(_mm_loadu_ps(&m[0].x), w_mask);
+            const __m128 a1 = _mm_and_ps(_mm_loadu_ps(&m[1].x), w_mask);
+            const __m128 a2 = _mm_and_ps(_mm_loadu_ps(&m[2].x), w_mask);
+            const __m128 t = _mm_and_ps(_mm_loadu_ps(&m[3].x), w_mask);
+
+            const __m128 c0 = cross3(a1, a2);
+            const __m128 det = dot3(a0, c0);
+
+            if (_mm_cvtss_f32(det) != 0.f)
+            {
+                const __m128 inv_det = _mm_div_ps(_mm_set1_ps(1.f), det);
+                __m128 r[3] = { _mm_mul_ps(c0, inv_det), _mm_mul_ps(cross3(a2, a0), inv_det), _mm_mul_ps(cross3(a0, a1), inv_det) };
+
+                // w of column k is -dot(r[k], t)
+                const __m128 neg_zero = _mm_set1_ps(-0.f);
+                for (int k = 0; k < 3; ++k)
+                {
+                    const __m128 w = _mm_xor_ps(dot3(r[k], t), neg_zero);
+                    const __m128 xyz = _mm_and_ps(r[k], w_mask);
+                    _mm_storeu_ps(&out[i][k].x, _mm_or_ps(xyz, _mm_andnot_ps(w_mask, w)));
+                }
+                _mm_storeu_ps(&out[i][3].x, _mm_set_ps(1.f, 0.f, 0.f, 0.f));
+                continue;
+            }
+        }
+    #endif
+
+        out[i] = inverse(transpose(m));
+    }
+}
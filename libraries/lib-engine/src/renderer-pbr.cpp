@@ -16,8 +16,11 @@ stable_cascaded_shadows::stable_cascaded_shadows()
 {
     const GLsizei size = static_cast<GLsizei>(resolution);
     shadowArrayDepth.setup(GL_TEXTURE_2D_ARRAY, size, size, uniforms::NUM_CASCADES, GL_DEPTH_COMPONENT, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
-    glNamedFramebufferTexture(shadowArrayFramebuffer, GL_DEPTH_ATTACHMENT, shadowArrayDepth, 0);
-    shadowArrayFramebuffer.check_complete();
+    for (int c = 0; c < uniforms::NUM_CASCADES; ++c)
+    {
+        glNamedFramebufferTextureLayer(cascadeFramebuffers[c], GL_DEPTH_ATTACHMENT, shadowArrayDepth, 0, c);
+        cascadeFramebuffers[c].check_complete();
+    }
     gl_check_error(__FILE__, __LINE__);
 }
 
@@ -114,21 +117,19 @@ void stable_cascaded_shadows::pre_draw()
     glEnable(GL_CULL_FACE);
     glCullFace(GL_FRONT);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, shadowArrayFramebuffer);
-    glViewport(0, 0, static_cast<GLsizei>(resolution), static_cast<GLsizei>(resolution));
-    glClear(GL_DEPTH_BUFFER_BIT);
-
     auto & shader = program.get()->get_variant()->shader;
-
     shader.bind();
-    shader.uniform("u_cascadeViewMatrixArray", uniforms::NUM_CASCADES, viewMatrices);
-    shader.uniform("u_cascadeProjMatrixArray", uniforms::NUM_CASCADES, projMatrices);
 }
 
-void stable_cascaded_shadows::update_shadow_matrix(const float4x4 & shadowModelMatrix)
+void stable_cascaded_shadows::begin_cascade(const uint32_t cascade)
 {
+    const GLfloat defaultDepth = 1.f;
+    glBindFramebuffer(GL_FRAMEBUFFER, cascadeFramebuffers[cascade]);
+    glViewport(0, 0, static_cast<GLsizei>(resolution), static_cast<GLsizei>(resolution));
+    glClearNamedFramebufferfv(cascadeFramebuffers[cascade], GL_DEPTH, 0, &defaultDepth);
+
     auto & shader = program.get()->get_variant()->shader;
-    shader.uniform("u_modelShadowMatrix", shadowModelMatrix);
+    shader.uniform("u_cascadeViewProj", shadowMatrices[cascade]);
 }
 
 void stable_cascaded_shadows::post_draw()
@@ -149,14 +150,170 @@ GLuint stable_cascaded_shadows::get_output_texture() const
 //   pbr_renderer implementation   //
 /////////////////////////////////////
 
-void pbr_renderer::update_per_object_uniform_buffer(const float4x4 & model_matrix, const bool recieveShadow, const view_data & d)
+// The std430 stride of ObjectData in renderer_common.glsl
+static_assert(sizeof(uniforms::per_object) == 208, "per_object must match the PerObject storage buffer");
+
+void pbr_renderer::update_per_object_data(const render_payload & scene, const view_data & shadow_view, const bool shadow_casters)
+{
+    const size_t count = renderQueue.size();
+    const uint64_t instance_size = sizeof(uniforms::per_object);
+
+    // Neighbours in a view's order that share program, material and mesh become one instanced draw
+    const auto same_state = [this](const uint32_t a, const uint32_t b)
+    {
+        const queued_draw & da = renderQueue[a];
+        const queued_draw & db = renderQueue[b];
+        return da.program == db.program && da.material == db.material && da.mesh == db.mesh && !da.has_overrides && !db.has_overrides;
+    };
+
+    uint64_t frame_bytes = 0;
+    for (size_t v = 0; v < viewOrders.size(); ++v)
+    {
+        viewBatches[v].clear();
+        frame_bytes = make_draw_batches(viewOrders[v].data(), viewOrders[v].size(), same_state, instance_size, perObjectAlignment, frame_bytes, viewBatches[v]);
+    }
+
+    // The shadow pass has a single program, so the casters of a cascade only need to share a mesh. They
+    // are grouped with a counting sort over the dense mesh ids.
+    const auto same_mesh = [this](const uint32_t a, const uint32_t b) { return renderQueue[a].mesh == renderQueue[b].mesh; };
+    for (uint32_t c = 0; c < uniforms::NUM_CASCADES; ++c)
+    {
+        cascadeOrders[c].clear();
+        cascadeBatches[c].clear();
+        if (!shadow_casters) continue;
+
+        const uint32_t bit = cascade_bit(c);
+        shadowMeshCounts.assign(meshIds.size() + 1, 0);
+        for (const queued_draw & d : renderQueue) if (d.visibility & bit) ++shadowMeshCounts[d.mesh_id + 1];
+        for (size_t m = 1; m < shadowMeshCounts.size(); ++m) shadowMeshCounts[m] += shadowMeshCounts[m - 1];
+
+        cascadeOrders[c].resize(shadowMeshCounts.back());
+        for (uint32_t i = 0; i < count; ++i) if (renderQueue[i].visibility & bit) cascadeOrders[c][shadowMeshCounts[renderQueue[i].mesh_id]++] = i;
+
+        frame_bytes = make_draw_batches(cascadeOrders[c].data(), cascadeOrders[c].size(), same_mesh, instance_size, perObjectAlignment, frame_bytes, cascadeBatches[c]);
+    }
+
+    if (frame_bytes == 0) return;
+
+    // Room for three frames in flight; grown in powers of two as the scene grows
+    const GLsizeiptr required = static_cast<GLsizeiptr>(3 * frame_bytes);
+    if (!perObjectRing || perObjectRing->size() < required)
+    {
+        GLsizeiptr capacity = 64 * 1024;
+        while (capacity < required) capacity *= 2;
+        perObjectRing.reset(new gl_streaming_buffer());
+        perObjectRing->create(capacity);
+    }
+
+    // Waits on the fence of the frame that last used this memory if the gpu is three frames behind
+    uint8_t * dst = perObjectRing->allocate(static_cast<GLsizeiptr>(frame_bytes), perObjectAlignment, perObjectFrameOffset);
+    if (!dst) throw std::runtime_error("timed out waiting for per-object data");
+
+    // Normal matrices are shared by every view and the shadow pass
+    perObjectNormalMatrices.resize(count);
+    default_job_system().parallel_for(count, 256, [&](const size_t begin, const size_t end)
+    {
+        for (size_t i = begin; i < end; ++i) perObjectNormalMatrices[i] = renderQueue[i].component->world_matrix;
+        inverse_transpose_matrices(&perObjectNormalMatrices[begin], &perObjectNormalMatrices[begin], end - begin);
+    });
+
+    struct batch_range
+    {
+        const draw_batch * batch;
+        const uint32_t * order;
+        const float4x4 * view_matrix;
+    };
+
+    std::vector<batch_range> ranges;
+    for (size_t v = 0; v < viewOrders.size(); ++v)
+    {
+        for (const draw_batch & b : viewBatches[v]) ranges.push_back({ &b, viewOrders[v].data(), &scene.views[v].viewMatrix });
+    }
+    for (uint32_t c = 0; c < uniforms::NUM_CASCADES; ++c)
+    {
+        for (const draw_batch & b : cascadeBatches[c]) ranges.push_back({ &b, cascadeOrders[c].data(), &shadow_view.viewMatrix });
+    }
+
+    default_job_system().parallel_for(ranges.size(), 64, [&](const size_t begin, const size_t end)
+    {
+        for (size_t r = begin; r < end; ++r)
+        {
+            const batch_range & range = ranges[r];
+            uniforms::per_object * instances = reinterpret_cast<uniforms::per_object *>(dst + range.batch->offset);
+            for (uint32_t k = 0; k < range.batch->count; ++k)
+            {
+                const uint32_t i = range.order[range.batch->first + k];
+                const render_component & c = *renderQueue[i].component;
+                uniforms::per_object & object = instances[k];
+                object.modelMatrix = c.world_matrix;
+                object.modelMatrixIT = perObjectNormalMatrices[i];
+                object.modelViewMatrix = *range.view_matrix * c.world_matrix;
+                object.receiveShadow = static_cast<float>(c.material->receive_shadow);
+            }
+        }
+    });
+}
+
+void pbr_renderer::bind_per_object_data(const draw_batch & batch)
+{
+    const GLintptr offset = perObjectFrameOffset + static_cast<GLintptr>(batch.offset);
+    const GLsizeiptr size = static_cast<GLsizeiptr>(batch.count * sizeof(uniforms::per_object));
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, uniforms::per_object::binding, perObjectRing->id(), offset, size);
+}
+
+// The std430 strides of PointLight and of the uvec2 clusters in renderer_common.glsl
+static_assert(sizeof(uniforms::point_light) == 32, "point_light must match the PointLights storage buffer");
+static_assert(sizeof(light_cluster) == 8, "light_cluster must match the LightClusters storage buffer");
+
+void pbr_renderer::update_light_clusters(const render_payload & scene)
+{
+    pointLights.clear();
+    pointLightSpheres.clear();
+    for (const point_light_component * light : scene.point_lights)
+    {
+        if (!light->enabled) continue;
+        pointLights.push_back(light->data);
+        pointLightSpheres.push_back(float4(light->data.position, light->data.radius));
+    }
+
+    allLightIndices.resize(pointLights.size());
+    for (uint32_t i = 0; i < allLightIndices.size(); ++i) allLightIndices[i] = i;
+
+    for (uint32_t v = 0; v < settings.cameraCount; ++v)
+    {
+        const view_data & view = scene.views[v];
+        clusteredViews[v] = light_cluster_grid::is_perspective(view.projectionMatrix);
+        if (!clusteredViews[v])
+        {
+            cpuProfiler.record(viewProfileIds[v].lightIndices, static_cast<double>(allLightIndices.size()));
+            continue;
+        }
+
+        lightGrids[v].set_projection(view.projectionMatrix, view.nearClip, view.farClip);
+        lightGrids[v].bin(view.viewMatrix, pointLightSpheres.data(), pointLightSpheres.size());
+        cpuProfiler.record(viewProfileIds[v].lightIndices, static_cast<double>(lightGrids[v].get_indices().size()));
+    }
+    cpuProfiler.record("point-lights", static_cast<double>(pointLights.size()));
+
+    // Storage buffers are never left empty, so that binding them is always valid
+    const uniforms::point_light none = {};
+    pointLightBuffer.set_buffer_data(std::max<size_t>(pointLights.size(), 1) * sizeof(uniforms::point_light), pointLights.empty() ? &none : pointLights.data(), GL_STREAM_DRAW);
+}
+
+void pbr_renderer::bind_light_clusters(const uint32_t view)
 {
-    uniforms::per_object object = {};
-    object.modelMatrix = model_matrix;
-    object.modelMatrixIT = inverse(transpose(object.modelMatrix));
-    object.modelViewMatrix = d.viewMatrix * object.modelMatrix;
-    object.receiveShadow = static_cast<float>(recieveShadow);
-    perObject.set_buffer_data(sizeof(object), &object, GL_STREAM_DRAW);
+    const bool clustered = clusteredViews[view];
+    const light_cluster all_lights = { 0, static_cast<uint32_t>(allLightIndices.size()) };
+    const size_t cluster_count = clustered ? lightGrids[view].size() : 1;
+    const light_cluster * clusters = clustered ? lightGrids[view].get_clusters().data() : &all_lights;
+    const std::vector<uint32_t> & indices = clustered ? lightGrids[view].get_indices() : allLightIndices;
+    const uint32_t none = 0;
+    lightClusterBuffer.set_buffer_data(cluster_count * sizeof(light_cluster), clusters, GL_STREAM_DRAW);
+    lightIndexBuffer.set_buffer_data(std::max<size_t>(indices.size(), 1) * sizeof(uint32_t), indices.empty() ? &none : indices.data(), GL_STREAM_DRAW);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, uniforms::POINT_LIGHTS_BINDING, pointLightBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, uniforms::LIGHT_CLUSTERS_BINDING, lightClusterBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, uniforms::LIGHT_INDICES_BINDING, lightIndexBuffer);
 }
 
 void pbr_renderer::run_stencil_prepass(const view_data & view, const render_payload & scene)
@@ -244,14 +401,25 @@ void pbr_renderer::run_depth_prepass(const view_data & view, const render_payloa
     auto & shader = renderPassEarlyZ.get()->get_variant()->shader;
     shader.bind();
 
-    for (const render_component & r : scene.render_components)
+    // Same batches (and near to far order) as the forward pass. Translucent draws do not write depth.
+    const std::vector<uint32_t> & order = viewOrders[view.index];
+    uint32_t draws = 0;
+    for (const draw_batch & b : viewBatches[view.index])
     {
-        update_per_object_uniform_buffer(r.world_matrix, r.material->receive_shadow, view);
-        r.mesh->draw();
+        const queued_draw & d = renderQueue[order[b.first]];
+        if (d.translucent) continue;
+
+        bind_per_object_data(b);
+        d.mesh->bind();
+        d.mesh->draw_bound(b.count > 1 ? b.count : 0);
+        ++draws;
     }
+    glBindVertexArray(0);
 
     shader.unbind();
 
+    cpuProfiler.record(viewProfileIds[view.index].depthPrepassDraws, draws);
+
     // Restore color mask state
     glColorMask(colorMask[0], colorMask[1], colorMask[2], colorMask[3]);
 }
@@ -293,138 +461,245 @@ void pbr_renderer::run_skybox_pass(const view_data & view, const render_payload
 
 void pbr_renderer::run_shadow_pass(const view_data & view, const render_payload & scene)
 {
-    shadow->update_cascades(view.viewMatrix,
-        view.nearClip,
-        view.farClip,
-        aspect_from_projection(view.projectionMatrix),
-        vfov_from_projection(view.projectionMatrix),
-        scene.sunlight->data.direction);
-
     shadow->pre_draw();
 
-    for (const render_component & r : scene.render_components)
+    // Each cascade draws only the casters inside its volume, one instanced draw per mesh
+    for (uint32_t c = 0; c < uniforms::NUM_CASCADES; ++c)
     {
-        if (r.material->material.get()->cast_shadows)
+        shadow->begin_cascade(c);
+        for (const draw_batch & b : cascadeBatches[c])
         {
-            // const float4x4 modelMatrix = (r.world_transform->world_pose.matrix() * make_scaling_matrix(r.local_transform->local_scale));
-            shadow->update_shadow_matrix(r.world_matrix);
-            r.mesh->draw();
+            gl_mesh * mesh = renderQueue[cascadeOrders[c][b.first]].mesh;
+            bind_per_object_data(b);
+            mesh->bind();
+            mesh->draw_bound(b.count > 1 ? b.count : 0);
         }
+
+        cpuProfiler.record(cascadeProfileIds[c].objects, static_cast<double>(cascadeOrders[c].size()));
+        cpuProfiler.record(cascadeProfileIds[c].draws, static_cast<double>(cascadeBatches[c].size()));
     }
+    glBindVertexArray(0);
 
     shadow->post_draw();
 
     gl_check_error(__FILE__, __LINE__);
 }
 
-void pbr_renderer::run_forward_pass(std::vector<const render_component *> & render_queue, const view_data & view, const render_payload & scene)
+void pbr_renderer::cull_render_components(const render_payload & scene, const bool shadow_casters)
 {
-    if (settings.useDepthPrepass)
-    {
-        glEnable(GL_DEPTH_TEST);
-        glDepthFunc(GL_LEQUAL);
-        glDepthMask(GL_FALSE); // depth already comes from the prepass
-    }
+    const size_t count = scene.render_components.size();
 
-    // Separate opaque and translucent materials for proper rendering order
-    std::vector<const render_component *> opaque_queue;
-    std::vector<const render_component *> translucent_queue;
+    // Asset handles resolve through a shared table, so meshes are looked up here on the calling thread
+    cullMeshes.resize(count);
+    for (size_t i = 0; i < count; ++i) cullMeshes[i] = &scene.render_components[i].mesh->mesh.get();
 
-    for (const render_component * render_comp : render_queue)
+    // Meshes without bounds get empty ones and are never culled
+    cullBounds.resize(count);
+    default_job_system().parallel_for(count, 1024, [&](const size_t begin, const size_t end)
     {
-        base_material * the_material = render_comp->material->material.get().get();
-        if (dynamic_cast<polymer_pbr_bubble*>(the_material))
+        for (size_t i = begin; i < end; ++i)
         {
-            translucent_queue.push_back(render_comp);
+            const gl_mesh & mesh = *cullMeshes[i];
+            if (mesh.has_bounds()) cullBounds[i] = transform_bounds(aabb_3d(mesh.get_bounds_min(), mesh.get_bounds_max()), scene.render_components[i].world_matrix);
+            else cullBounds[i] = aabb_3d(float3(1), float3(-1));
         }
-        else
-        {
-            opaque_queue.push_back(render_comp);
-        }
-    }
+    });
 
-    // Render opaque objects first
-    for (const render_component * render_comp : opaque_queue)
-    {
-        update_per_object_uniform_buffer(
-            render_comp->world_matrix,
-            render_comp->material->receive_shadow,
-            view);
+    culler.update(cullBounds);
 
-        base_material * the_material = render_comp->material->material.get().get();
+    // One frustum per view, then one per cascade, in the bit order of queued_draw::visibility
+    cullFrustums.clear();
+    for (const view_data & view : scene.views) cullFrustums.emplace_back(view.viewProjMatrix);
+    if (shadow_casters) for (const float4x4 & m : shadow->shadowMatrices) cullFrustums.emplace_back(m);
 
-        // update_uniforms must be called FIRST because it resets bindpoint to 0.
-        // Shadow and IBL textures are then appended to higher texture units.
-        the_material->update_uniforms(render_comp->material);
+    culler.cull(cullFrustums.data(), static_cast<uint32_t>(cullFrustums.size()), cullMasks);
 
-        if (auto * mr = dynamic_cast<polymer_pbr_standard*>(the_material))
-        {
-            if (settings.shadowsEnabled) mr->update_uniforms_shadow(shadow->get_output_texture());
-            if (scene.ibl_cubemap)
-            {
-                mr->update_uniforms_ibl(scene.ibl_cubemap->ibl_irradianceCubemap.get(),
-                    scene.ibl_cubemap->ibl_radianceCubemap.get(),
-                    dfg_lut.id());
-            }
-        }
+    cpuProfiler.record("cull-bvh-rebuilt", culler.rebuilt() ? 1.0 : 0.0);
+}
+
+void pbr_renderer::build_render_queue(const render_payload & scene)
+{
+    // Ids are handed out in scene order, so an unchanged scene keeps the keys of the previous frame
+    programIds.clear();
+    materialIds.clear();
+    meshIds.clear();
+
+    const uint32_t view_bits = (1u << settings.cameraCount) - 1;
+    std::vector<uint32_t> visible(settings.cameraCount, 0);
+    std::vector<uint32_t> casters(uniforms::NUM_CASCADES, 0);
+    uint32_t total_casters = 0;
+
+    renderQueue.clear();
+    for (size_t i = 0; i < scene.render_components.size(); ++i)
+    {
+        const render_component & r = scene.render_components[i];
+        base_material * material = r.material->material.get().get();
+
+        // Cascades only keep the components that cast shadows; nothing else is resolved for unseen ones
+        const uint32_t visibility = material->cast_shadows ? cullMasks[i] : (cullMasks[i] & view_bits);
+        for (uint32_t v = 0; v < settings.cameraCount; ++v) visible[v] += (visibility >> v) & 1;
+        for (uint32_t c = 0; c < uniforms::NUM_CASCADES; ++c) casters[c] += (visibility & cascade_bit(c)) ? 1 : 0;
+        total_casters += material->cast_shadows ? 1 : 0;
+        if (!visibility) continue;
+
+        renderQueue.emplace_back();
+        queued_draw & d = renderQueue.back();
+        d.component = &r;
+        d.material = material;
+        d.mesh = cullMeshes[i];
+        d.program = d.material->id(); // resolves the shader variant once per draw per frame
+        d.layer = r.render_sort_order;
+        d.visibility = visibility;
+        d.translucent = d.material->is_translucent();
+        d.cast_shadows = d.material->cast_shadows;
+        d.has_overrides = !r.material->override_table.table.empty();
+        d.program_id = programIds.get(static_cast<uint64_t>(d.program));
+        d.material_id = materialIds.get(d.material);
+        d.mesh_id = meshIds.get(d.mesh);
+    }
+
+    const double objects = static_cast<double>(scene.render_components.size());
+    for (uint32_t v = 0; v < settings.cameraCount; ++v)
+    {
+        cpuProfiler.record(viewProfileIds[v].visible, visible[v]);
+        cpuProfiler.record(viewProfileIds[v].culled, objects - visible[v]);
+    }
 
-        if (auto * mr = dynamic_cast<polymer_blinn_phong_standard*>(the_material))
+    // Cascades are only culled when the shadow pass runs, which records the casters it draws
+    if (cullFrustums.size() > settings.cameraCount)
+    {
+        for (uint32_t c = 0; c < uniforms::NUM_CASCADES; ++c)
         {
-            if (settings.shadowsEnabled) mr->update_uniforms_shadow(shadow->get_output_texture());
+            cpuProfiler.record(cascadeProfileIds[c].culled, static_cast<double>(total_casters) - casters[c]);
         }
+    }
+}
 
-        the_material->use();
-        render_comp->mesh->draw();
+void pbr_renderer::sort_render_queue(const view_data & view)
+{
+    // Only depth differs between views. View space z is negative in front of the camera.
+    renderQueueKeys.resize(renderQueue.size());
+    for (size_t i = 0; i < renderQueue.size(); ++i)
+    {
+        const queued_draw & d = renderQueue[i];
+        const float depth = -transform_coord(view.viewMatrix, d.component->world_matrix[3].xyz).z / view.farClip;
+        renderQueueKeys[i] = d.translucent ?
+            make_translucent_sort_key(d.layer, d.program_id, d.material_id, d.mesh_id, depth) :
+            make_opaque_sort_key(d.layer, d.program_id, d.material_id, d.mesh_id, depth);
     }
 
-    // Render translucent materials (bubble) after opaques
-    if (!translucent_queue.empty())
+    // The order barely changes between frames, so the sorter usually only repairs last frame's. The queue
+    // also holds draws that only another view or a cascade sees; they are dropped from this view's order.
+    incremental_sort<uint64_t> & sorter = renderQueueSorters[view.index];
+    const std::vector<uint32_t> & sorted = sorter.sort(renderQueueKeys.data(), renderQueueKeys.size());
+
+    const uint32_t bit = 1u << view.index;
+    std::vector<uint32_t> & order = viewOrders[view.index];
+    order.clear();
+    for (const uint32_t i : sorted) if (renderQueue[i].visibility & bit) order.push_back(i);
+
+    cpuProfiler.record(viewProfileIds[view.index].sortDisorder, sorter.disorder());
+    cpuProfiler.record(viewProfileIds[view.index].sortFull, sorter.full_sort() ? 1.0 : 0.0);
+}
+
+void pbr_renderer::run_forward_pass(const view_data & view, const render_payload & scene)
+{
+    if (settings.useDepthPrepass)
     {
-        // Resolve multisample to eye texture so translucent materials can sample scene color
-        glDisable(GL_MULTISAMPLE);
-        glBlitNamedFramebuffer(multisampleFramebuffer, eyeFramebuffers[view.index],
-            0, 0, settings.renderSize.x, settings.renderSize.y, 0, 0,
-            settings.renderSize.x, settings.renderSize.y, GL_COLOR_BUFFER_BIT, GL_LINEAR);
-        glBlitNamedFramebuffer(multisampleFramebuffer, eyeFramebuffers[view.index],
-            0, 0, settings.renderSize.x, settings.renderSize.y, 0, 0,
-            settings.renderSize.x, settings.renderSize.y, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
-
-        // Continue rendering translucents to the multisample buffer
-        glEnable(GL_MULTISAMPLE);
-        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, multisampleFramebuffer);
+        glEnable(GL_DEPTH_TEST);
+        glDepthFunc(GL_LEQUAL);
+        glDepthMask(GL_FALSE); // depth already comes from the prepass
+    }
+
+    render_state_counters & counters = stateCounters[view.index];
+    counters = {};
 
-        // Enable blending for translucent materials
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        glDepthMask(GL_FALSE);
+    // Program, material and mesh state is only touched when it differs from the previous batch
+    const std::vector<uint32_t> & order = viewOrders[view.index];
+    uint32_t bound_program = 0;
+    base_material * bound_material = nullptr;
+    bool bound_overrides = false;
+    gl_mesh * bound_mesh = nullptr;
+    bool blending = false;
 
-        for (const render_component * render_comp : translucent_queue)
+    for (const draw_batch & b : viewBatches[view.index])
+    {
+        const queued_draw & d = renderQueue[order[b.first]];
+        if (!d.program) continue; // e.g. a procedural material without a shader
+
+        // Translucent draws sort after every opaque draw
+        if (d.translucent && !blending)
         {
-            update_per_object_uniform_buffer(
-                render_comp->world_matrix,
-                render_comp->material->receive_shadow,
-                view);
+            // Resolve multisample to eye texture so translucent materials can sample scene color
+            glDisable(GL_MULTISAMPLE);
+            glBlitNamedFramebuffer(multisampleFramebuffer, eyeFramebuffers[view.index],
+                0, 0, settings.renderSize.x, settings.renderSize.y, 0, 0,
+                settings.renderSize.x, settings.renderSize.y, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+            glBlitNamedFramebuffer(multisampleFramebuffer, eyeFramebuffers[view.index],
+                0, 0, settings.renderSize.x, settings.renderSize.y, 0, 0,
+                settings.renderSize.x, settings.renderSize.y, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+            // Continue rendering translucents to the multisample buffer
+            glEnable(GL_MULTISAMPLE);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, multisampleFramebuffer);
 
-            base_material * the_material = render_comp->material->material.get().get();
+            // Enable blending for translucent materials
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            glDepthMask(GL_FALSE);
+            blending = true;
+        }
 
-            if (auto * mr = dynamic_cast<polymer_pbr_bubble*>(the_material))
+        bind_per_object_data(b);
+
+        if (d.program != bound_program)
+        {
+            glUseProgram(d.program);
+            bound_program = d.program;
+            ++counters.program_binds;
+        }
+
+        // Components with uniform overrides always set their own, and the next draw has to undo them
+        if (d.material != bound_material || d.has_overrides || bound_overrides)
+        {
+            // update_uniforms must be called FIRST because it resets bindpoint to 0.
+            // Shadow, IBL and refraction textures are then appended to higher texture units.
+            d.material->update_uniforms(d.component->material);
+            if (settings.shadowsEnabled) d.material->update_uniforms_shadow(shadow->get_output_texture());
+            if (scene.ibl_cubemap)
+            {
+                d.material->update_uniforms_ibl(scene.ibl_cubemap->ibl_irradianceCubemap.get(),
+                    scene.ibl_cubemap->ibl_radianceCubemap.get(),
+                    dfg_lut.id());
+            }
+            if (d.translucent)
             {
-                if (scene.ibl_cubemap)
-                {
-                    mr->update_uniforms_ibl(scene.ibl_cubemap->ibl_irradianceCubemap.get(),
-                        scene.ibl_cubemap->ibl_radianceCubemap.get(),
-                        dfg_lut.id());
-                }
-                mr->update_uniforms_refraction(eyeTextures[view.index].id(),
+                d.material->update_uniforms_refraction(eyeTextures[view.index].id(),
                     eyeDepthTextures[view.index].id(),
                     float2(settings.renderSize));
             }
+            bound_material = d.material;
+            bound_overrides = d.has_overrides;
+            ++counters.material_binds;
+        }
 
-            the_material->update_uniforms(render_comp->material);
-            the_material->use();
-            render_comp->mesh->draw();
+        if (d.mesh != bound_mesh)
+        {
+            d.mesh->bind();
+            bound_mesh = d.mesh;
+            ++counters.mesh_binds;
         }
 
+        d.mesh->draw_bound(b.count > 1 ? b.count : 0);
+        counters.objects += b.count;
+        ++counters.draws;
+    }
+
+    glBindVertexArray(0);
+    glUseProgram(0);
+
+    if (blending)
+    {
         glDisable(GL_BLEND);
         glDepthMask(GL_TRUE);
     }
@@ -433,6 +708,13 @@ void pbr_renderer::run_forward_pass(std::vector<const render_component *> & rend
     {
         glDepthMask(GL_TRUE); // cleanup state
     }
+
+    // Draw calls before and after batching
+    cpuProfiler.record(viewProfileIds[view.index].objects, counters.objects);
+    cpuProfiler.record(viewProfileIds[view.index].draws, counters.draws);
+    cpuProfiler.record(viewProfileIds[view.index].stateChanges, counters.total());
+
+    gl_check_error(__FILE__, __LINE__);
 }
 
 void pbr_renderer::run_particle_pass(const view_data & view, const render_payload & scene)
@@ -487,6 +769,39 @@ pbr_renderer::pbr_renderer(const renderer_settings settings) : settings(settings
     eyeFramebuffers.resize(settings.cameraCount);
     eyeTextures.resize(settings.cameraCount);
     eyeDepthTextures.resize(settings.cameraCount);
+    renderQueueSorters.resize(settings.cameraCount);
+    viewOrders.resize(settings.cameraCount);
+    viewBatches.resize(settings.cameraCount);
+    stateCounters.resize(settings.cameraCount);
+    lightGrids.assign(settings.cameraCount, light_cluster_grid(settings.lightClusters.x, settings.lightClusters.y, settings.lightClusters.z));
+    clusteredViews.assign(settings.cameraCount, false);
+
+    viewProfileIds.resize(settings.cameraCount);
+    for (uint32_t v = 0; v < settings.cameraCount; ++v)
+    {
+        const std::string n = std::to_string(v);
+        view_profile_ids & ids = viewProfileIds[v];
+        ids.lightIndices = "light-indices-" + n;
+        ids.depthPrepassDraws = "depth-prepass-draws-" + n;
+        ids.visible = "visible-" + n;
+        ids.culled = "culled-" + n;
+        ids.sortDisorder = "render-queue-sort-disorder-" + n;
+        ids.sortFull = "render-queue-sort-full-" + n;
+        ids.objects = "objects-" + n;
+        ids.draws = "draws-" + n;
+        ids.stateChanges = "state-changes-" + n;
+        ids.depthPrepass = "depth-prepass-" + n;
+        ids.stencilPrepass = "run_stencil_prepass-" + n;
+        ids.skyboxPass = "run_skybox_pass-" + n;
+        ids.forwardPass = "run_forward_pass-" + n;
+        ids.particlePass = "run_particle_pass-" + n;
+        ids.blit = "blit-" + n;
+    }
+    for (uint32_t c = 0; c < uniforms::NUM_CASCADES; ++c)
+    {
+        const std::string n = std::to_string(c);
+        cascadeProfileIds[c] = { "shadow-objects-" + n, "shadow-draws-" + n, "shadow-culled-" + n };
+    }
 
     // Generate multisample render buffers for color and depth, attach to multi-sampled framebuffer target
     glNamedRenderbufferStorageMultisample(multisampleRenderbuffers[0], settings.msaaSamples, GL_RGBA16F, settings.renderSize.x, settings.renderSize.y);
@@ -547,6 +862,9 @@ pbr_renderer::pbr_renderer(const renderer_settings settings) : settings(settings
     gpuProfiler.set_enabled(settings.performanceProfiling);
     cpuProfiler.set_enabled(settings.performanceProfiling);
 
+    // Batches of the per-object ring are bound with glBindBufferRange, so each has to start on this alignment
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &perObjectAlignment);
+
     timer.start();
 }
 
@@ -560,7 +878,7 @@ void pbr_renderer::render_frame(const render_payload & scene)
     assert(settings.cameraCount == scene.views.size());
 
     // @fixme - refactor to make optional
-    auto validate_materials = [this, scene]()
+    auto validate_materials = [&scene]()
     {
         for (const auto & render_comp : scene.render_components)
         {
@@ -587,14 +905,12 @@ void pbr_renderer::render_frame(const render_payload & scene)
 
     glBindBufferBase(GL_UNIFORM_BUFFER, uniforms::per_scene::binding, perScene);
     glBindBufferBase(GL_UNIFORM_BUFFER, uniforms::per_view::binding, perView);
-    glBindBufferBase(GL_UNIFORM_BUFFER, uniforms::per_object::binding, perObject);
 
     // Update per-scene uniform buffer
     uniforms::per_scene b = {};
     b.time = timer.milliseconds().count() / 1000.f; // expressed in seconds
     b.resolution = float2(settings.renderSize);
     b.invResolution = 1.f / b.resolution;
-    b.activePointLights = static_cast<int>(scene.point_lights.size());
     b.sunlightActive = 0;
 
     if (scene.sunlight)
@@ -605,15 +921,6 @@ void pbr_renderer::render_frame(const render_payload & scene)
         b.directional_light.amount = scene.sunlight->data.amount;
     }
 
-    assert(scene.point_lights.size() <= uniforms::MAX_POINT_LIGHTS);
-    uint32_t lightIdx = 0;
-    for (auto & light : scene.point_lights)
-    {
-        if (!light->enabled) continue;
-        b.point_lights[lightIdx] = light->data;
-        lightIdx++;
-    }
-
     GLfloat defaultColor[] = { scene.clear_color.x, scene.clear_color.y, scene.clear_color.z, scene.clear_color.w };
     GLfloat defaultDepth = 1.f;
     GLuint  defaultStencil = 0;
@@ -639,8 +946,43 @@ void pbr_renderer::render_frame(const render_payload & scene)
     }
 
     // Shadow pass can only run if we've configured a directional sunlight
+    const bool shadow_pass = settings.shadowsEnabled && scene.sunlight;
 
-    if (settings.shadowsEnabled && scene.sunlight)
+    // Cascades are fit first so that their volumes can be culled along with the views
+    if (shadow_pass)
+    {
+        shadow->update_cascades(shadowAndCullingView.viewMatrix,
+            shadowAndCullingView.nearClip,
+            shadowAndCullingView.farClip,
+            aspect_from_projection(shadowAndCullingView.projectionMatrix),
+            vfov_from_projection(shadowAndCullingView.projectionMatrix),
+            scene.sunlight->data.direction);
+    }
+
+    assert(settings.cameraCount + uniforms::NUM_CASCADES <= 32);
+    cpuProfiler.begin("cull-render-components");
+    cull_render_components(scene, shadow_pass);
+    cpuProfiler.end("cull-render-components");
+
+    // We follow the sorting strategy outlined here: http://realtimecollisiondetection.net/blog/?p=86
+    // Draws are resolved once here and sorted per view by 64-bit keys (see render-queue.hpp)
+    cpuProfiler.begin("build-render-queue");
+    build_render_queue(scene);
+    for (uint32_t camIdx = 0; camIdx < settings.cameraCount; ++camIdx) sort_render_queue(scene.views[camIdx]);
+    cpuProfiler.end("build-render-queue");
+
+    // Batches identical draws and packs their instance data for every pass of the frame
+    cpuProfiler.begin("update-per-object-data");
+    update_per_object_data(scene, shadowAndCullingView, shadow_pass);
+    cpuProfiler.end("update-per-object-data");
+
+    // Bins the point lights into the froxels of each view
+    cpuProfiler.begin("update-light-clusters");
+    update_light_clusters(scene);
+    b.activePointLights = static_cast<int>(pointLights.size());
+    cpuProfiler.end("update-light-clusters");
+
+    if (shadow_pass)
     {
         cpuProfiler.begin("run_shadow_pass");
         gpuProfiler.begin("run_shadow_pass");
@@ -660,39 +1002,6 @@ void pbr_renderer::render_frame(const render_payload & scene)
     // Per-scene can be uploaded now that the shadow pass has completed
     perScene.set_buffer_data(sizeof(b), &b, GL_STREAM_DRAW);
 
-    // We follow the sorting strategy outlined here: http://realtimecollisiondetection.net/blog/?p=86
-    //auto materialSortFunc = [this, scene, shadowAndCullingView](const render_component * lhs, const render_component * rhs)
-    //{
-    //    // Sort by material (expensive shader state change)
-    //    // @fixme - why is this so expensive? Adds an additional ~2ms to the sort
-    //    auto lid = lhs->material->material.get()->id();
-    //    auto rid = rhs->material->material.get()->id();
-    //    if (lid != rid) return lid < rid;
-    //
-    //    // Otherwise sort by distance
-    //    const float lDist = distance(shadowAndCullingView.pose.position, lhs->world_transform->world_pose.position);
-    //    const float rDist = distance(shadowAndCullingView.pose.position, rhs->world_transform->world_pose.position);
-    //    return lDist < rDist;
-    //};
-
-    cpuProfiler.begin("sort-render_queue_material");
-
-    std::vector<const render_component *> render_queue(scene.render_components.size());
-    auto render_priority_sort = [this, scene, shadowAndCullingView](const render_component * lhs, const render_component * rhs)
-    {
-        const uint32_t lso = lhs->render_sort_order;
-        const uint32_t rso = rhs->render_sort_order;
-        return lso < rso;
-    };
-
-    for (int i = 0; i < scene.render_components.size(); ++i) 
-    { 
-        render_queue[i] = (&(scene.render_components[i]));
-    }
-    std::sort(render_queue.begin(), render_queue.end(), render_priority_sort);
-
-    cpuProfiler.end("sort-render_queue_material");
-
     for (uint32_t camIdx = 0; camIdx < settings.cameraCount; ++camIdx)
     {
         // Update per-view uniform buffer
@@ -710,7 +1019,16 @@ void pbr_renderer::render_frame(const render_payload & scene)
         // x = 1 or -1 (-1 if projection is flipped), y = near plane, z = far plane, w = 1/far plane
         v.projectionParams = float4(1, scene.views[camIdx].nearClip, scene.views[camIdx].farClip, 1.f / scene.views[camIdx].farClip);
 
+        // Froxel of a fragment from its window position and view depth, see get_light_cluster. A view with a
+        // single cluster maps every fragment to it.
+        const bool clustered = clusteredViews[camIdx];
+        const uint3 clusterDims = clustered ? lightGrids[camIdx].dimensions() : uint3(1, 1, 1);
+        const float2 sliceParams = clustered ? lightGrids[camIdx].slice_params() : float2(0, 0);
+        v.clusterDims = uint4(clusterDims, 0);
+        v.clusterParams = float4(float(clusterDims.x) / settings.renderSize.x, float(clusterDims.y) / settings.renderSize.y, sliceParams.x, sliceParams.y);
+
         perView.set_buffer_data(sizeof(v), &v, GL_STREAM_DRAW);
+        bind_light_clusters(camIdx);
 
         // Render into multisampled fbo
         glEnable(GL_MULTISAMPLE);
@@ -722,45 +1040,45 @@ void pbr_renderer::render_frame(const render_payload & scene)
 
         if (settings.useDepthPrepass)
         {
-            gpuProfiler.begin("depth-prepass-" + std::to_string(camIdx));
+            gpuProfiler.begin(viewProfileIds[camIdx].depthPrepass);
             run_depth_prepass(scene.views[camIdx], scene);
-            gpuProfiler.end("depth-prepass-" + std::to_string(camIdx));
+            gpuProfiler.end(viewProfileIds[camIdx].depthPrepass);
         }
 
         // Hidden area mesh for stereo rendering with openvr
         if (using_stencil_mask)
         {
-            cpuProfiler.begin("run_stencil_prepass-" + std::to_string(camIdx));
-            gpuProfiler.begin("run_stencil_prepass-" + std::to_string(camIdx));
+            cpuProfiler.begin(viewProfileIds[camIdx].stencilPrepass);
+            gpuProfiler.begin(viewProfileIds[camIdx].stencilPrepass);
             run_stencil_prepass(scene.views[camIdx], scene);
-            gpuProfiler.end("run_stencil_prepass-" + std::to_string(camIdx));
-            cpuProfiler.end("run_stencil_prepass-" + std::to_string(camIdx));
+            gpuProfiler.end(viewProfileIds[camIdx].stencilPrepass);
+            cpuProfiler.end(viewProfileIds[camIdx].stencilPrepass);
         }
 
         // Execute the forward passes
-        gpuProfiler.begin("run_skybox_pass-" + std::to_string(camIdx));
-        cpuProfiler.begin("run_skybox_pass-" + std::to_string(camIdx));
+        gpuProfiler.begin(viewProfileIds[camIdx].skyboxPass);
+        cpuProfiler.begin(viewProfileIds[camIdx].skyboxPass);
         run_skybox_pass(scene.views[camIdx], scene);
-        cpuProfiler.end("run_skybox_pass-" + std::to_string(camIdx));
-        gpuProfiler.end("run_skybox_pass-" + std::to_string(camIdx));
+        cpuProfiler.end(viewProfileIds[camIdx].skyboxPass);
+        gpuProfiler.end(viewProfileIds[camIdx].skyboxPass);
 
-        gpuProfiler.begin("run_forward_pass-" + std::to_string(camIdx));
-        cpuProfiler.begin("run_forward_pass-" + std::to_string(camIdx));
-        run_forward_pass(render_queue, scene.views[camIdx], scene);
-        cpuProfiler.end("run_forward_pass-" + std::to_string(camIdx));
-        gpuProfiler.end("run_forward_pass-" + std::to_string(camIdx));
+        gpuProfiler.begin(viewProfileIds[camIdx].forwardPass);
+        cpuProfiler.begin(viewProfileIds[camIdx].forwardPass);
+        run_forward_pass(scene.views[camIdx], scene);
+        cpuProfiler.end(viewProfileIds[camIdx].forwardPass);
+        gpuProfiler.end(viewProfileIds[camIdx].forwardPass);
 
-        gpuProfiler.begin("run_particle_pass-" + std::to_string(camIdx));
-        cpuProfiler.begin("run_particle_pass-" + std::to_string(camIdx));
+        gpuProfiler.begin(viewProfileIds[camIdx].particlePass);
+        cpuProfiler.begin(viewProfileIds[camIdx].particlePass);
         run_particle_pass(scene.views[camIdx], scene);
-        cpuProfiler.end("run_particle_pass-" + std::to_string(camIdx));
-        gpuProfiler.end("run_particle_pass-" + std::to_string(camIdx));
+        cpuProfiler.end(viewProfileIds[camIdx].particlePass);
+        gpuProfiler.end(viewProfileIds[camIdx].particlePass);
 
         glDisable(GL_MULTISAMPLE);
 
         // Resolve multisample into per-view framebuffer
         {
-            gpuProfiler.begin("blit-" + std::to_string(camIdx));
+            gpuProfiler.begin(viewProfileIds[camIdx].blit);
 
             // blit color 
             glBlitNamedFramebuffer(multisampleFramebuffer, eyeFramebuffers[camIdx],
@@ -772,7 +1090,7 @@ void pbr_renderer::render_frame(const render_payload & scene)
                 0, 0, settings.renderSize.x, settings.renderSize.y, 0, 0,
                 settings.renderSize.x, settings.renderSize.y, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
 
-            gpuProfiler.end("blit-" + std::to_string(camIdx));
+            gpuProfiler.end(viewProfileIds[camIdx].blit);
         }
     }
 
@@ -788,6 +1106,9 @@ void pbr_renderer::render_frame(const render_payload & scene)
         gpuProfiler.end("run_post_pass");
     }
 
+    // The per-object data of this frame can be reused once the gpu has consumed every draw above
+    if (perObjectRing) perObjectRing->fence();
+
     glDisable(GL_FRAMEBUFFER_SRGB);
     cpuProfiler.end("render_frame");
 
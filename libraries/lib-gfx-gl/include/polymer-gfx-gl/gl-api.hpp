@@ -153,7 +153,7 @@ public:
     ~gl_handle() { if (handle) { factory_t::destroy(handle); handle = 0; } }
     gl_handle(const gl_handle & r) = delete;
     gl_handle & operator = (gl_handle & r) = delete;
-    gl_handle & operator = (gl_handle && r) { handle = r.handle; r.handle = 0; return *this; }
+    gl_handle & operator = (gl_handle && r) { if (this != &r) { if (handle) factory_t::destroy(handle); handle = r.handle; r.handle = 0; } return *this; }
     gl_handle(gl_handle && r) { handle = r.handle; r.handle = 0; }
     operator GLuint () const { if (!handle) factory_t::create(handle); return handle; }
     gl_handle & operator = (GLuint & other) { handle = other; return *this; } // assumes ownership
@@ -191,6 +191,7 @@ struct gl_buffer : public gl_buffer_object
     GLsizeiptr size{ 0 };
     gl_buffer() = default;
     void set_buffer_data(const GLsizeiptr s, const GLvoid * data, const GLenum usage) { this->size = s; glNamedBufferDataEXT(*this, size, data, usage);  }
+    void set_buffer_storage(const GLsizeiptr s, const GLvoid * data, const GLbitfield flags) { this->size = s; glNamedBufferStorage(*this, size, data, flags); } // immutable; assign a new gl_buffer to resize
     void set_buffer_data(const std::vector<GLubyte> & bytes, const GLenum usage) { set_buffer_data(bytes.size(), bytes.data(), usage); }
     void set_buffer_sub_data(const GLsizeiptr s, const GLintptr offset, const GLvoid * data) { glNamedBufferSubDataEXT(*this, offset, s, data);  }
     void set_buffer_sub_data(const std::vector<GLubyte> & bytes, const GLintptr offset, const GLenum usage) { set_buffer_sub_data(bytes.size(), offset, bytes.data()); }
@@ -240,7 +241,7 @@ struct gl_texture_2d : public gl_texture_2d_object
         glTextureParameteri(*this, GL_TEXTURE_MIN_FILTER, createMipmap ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
         glTextureParameteri(*this, GL_TEXTURE_WRAP_S, GL_REPEAT);
         glTextureParameteri(*this, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        if (createMipmap) glGenerateTextureMipmap(*this);
+        if (createMipmap && pixels) glGenerateTextureMipmap(*this); // otherwise the caller generates mips after filling level 0
         this->width = static_cast<float>(width);
         this->height = static_cast<float>(height);
     }
@@ -644,6 +645,10 @@ class gl_mesh
     GLenum indexType = 0;
     GLsizei vertexStride = 0, instanceStride = 0;
 
+    // Object space bounds of the vertices, for culling. Empty (min > max) until set_bounds().
+    linalg::aliases::float3 boundsMin { std::numeric_limits<float>::infinity() };
+    linalg::aliases::float3 boundsMax { -std::numeric_limits<float>::infinity() };
+
 public:
      
     gl_mesh() = default;
@@ -666,30 +671,54 @@ public:
     {
         if (vertexBuffer.size)
         {
-            glBindVertexArray(vao);
-
-            if (indexBuffers.size() >= 1)
-            {
-                submesh & idx = indexBuffers[submesh_index]; // note: will default construct
-
-                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, idx.indexBuffer);
-                if (instances) glDrawElementsInstanced(drawMode, idx.count, indexType, 0, instances);
-                else glDrawElements(drawMode, idx.count, indexType, nullptr);
-            }
-            else
-            {
-                if (instances) glDrawArraysInstanced(drawMode, 0, static_cast<GLsizei>(vertexBuffer.size / vertexStride), instances);
-                else glDrawArrays(drawMode, 0, static_cast<GLsizei>(vertexBuffer.size / vertexStride));
-            }
+            bind(submesh_index);
+            draw_bound(instances, submesh_index);
             glBindVertexArray(0);
 
             gl_check_error(__FILE__, __LINE__);
         }
     }
 
-    void set_vertex_data(GLsizeiptr size, const GLvoid * data, GLenum usage) { vertexBuffer.set_buffer_data(size, data, usage); }
+    // Binds the vertex array and the index buffer of a submesh for draw_bound(). Renderers that sort
+    // draws by mesh bind once per run of the same mesh instead of twice per draw_elements().
+    void bind(int submesh_index = 0)
+    {
+        glBindVertexArray(vao);
+        if (indexBuffers.size() >= 1) glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffers[submesh_index].indexBuffer); // note: will default construct
+    }
+
+    // Draws with whatever vertex array is bound; call bind() with the same submesh first
+    void draw_bound(int instances = 0, int submesh_index = 0)
+    {
+        if (!vertexBuffer.size) return;
+
+        if (indexBuffers.size() >= 1)
+        {
+            const submesh & idx = indexBuffers[submesh_index];
+            if (instances) glDrawElementsInstanced(drawMode, idx.count, indexType, 0, instances);
+            else glDrawElements(drawMode, idx.count, indexType, nullptr);
+        }
+        else
+        {
+            if (instances) glDrawArraysInstanced(drawMode, 0, static_cast<GLsizei>(vertexBuffer.size / vertexStride), instances);
+            else glDrawArrays(drawMode, 0, static_cast<GLsizei>(vertexBuffer.size / vertexStride));
+        }
+    }
+
+    // New vertex data invalidates the bounds; set them again after the upload
+    void set_vertex_data(GLsizeiptr size, const GLvoid * data, GLenum usage)
+    {
+        vertexBuffer.set_buffer_data(size, data, usage);
+        boundsMin = linalg::aliases::float3(std::numeric_limits<float>::infinity());
+        boundsMax = -boundsMin;
+    }
     gl_buffer & get_vertex_data_buffer() { return vertexBuffer; };
 
+    void set_bounds(const linalg::aliases::float3 & min, const linalg::aliases::float3 & max) { boundsMin = min; boundsMax = max; }
+    bool has_bounds() const { return boundsMin.x <= boundsMax.x && boundsMin.y <= boundsMax.y && boundsMin.z <= boundsMax.z; }
+    const linalg::aliases::float3 & get_bounds_min() const { return boundsMin; }
+    const linalg::aliases::float3 & get_bounds_max() const { return boundsMax; }
+
     void set_instance_data(GLsizeiptr size, const GLvoid * data, GLenum usage) { instanceBuffer.set_buffer_data(size, data, usage); }
 
     void set_index_data(GLenum mode, GLenum type, GLsizei count, const GLvoid * data, GLenum usage, int submesh_index = 0)
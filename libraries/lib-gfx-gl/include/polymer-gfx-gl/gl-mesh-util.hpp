@@ -23,48 +23,55 @@
 
 namespace polymer
 {
-    inline gl_mesh make_mesh_from_geometry(const geometry & geometry, const GLenum usage = GL_STATIC_DRAW)
+    // Vertex attributes of a geometry interleaved the way make_mesh_from_geometry lays them out. Building
+    // this does not touch GL, so it can be prepared on a worker thread and uploaded later.
+    struct interleaved_geometry
     {
-        assert(geometry.vertices.size() > 0);
+        std::vector<float> vertices;
+        int components = 3; // floats per vertex
 
-        gl_mesh m;
+        // Offsets in floats; 0 when the attribute is absent
+        int normal_offset = 0;
+        int color_offset = 0;
+        int texcoord_offset = 0;
+        int tangent_offset = 0;
+        int bitangent_offset = 0;
 
-        int vertexOffset = 0;
-        int normalOffset = 0;
-        int colorOffset = 0;
-        int texOffset = 0;
-        int tanOffset = 0;
-        int bitanOffset = 0;
+        GLsizei stride() const { return components * sizeof(float); }
+        size_t size_bytes() const { return vertices.size() * sizeof(float); }
+    };
 
-        int components = 3;
+    inline interleaved_geometry interleave_geometry(const geometry & geometry)
+    {
+        interleaved_geometry v;
 
         if (geometry.normals.size() != 0)
         {
-            normalOffset = components; components += 3;
+            v.normal_offset = v.components; v.components += 3;
         }
 
         if (geometry.colors.size() != 0)
         {
-            colorOffset = components; components += 3;
+            v.color_offset = v.components; v.components += 3;
         }
 
         if (geometry.texcoord0.size() != 0)
         {
-            texOffset = components; components += 2;
+            v.texcoord_offset = v.components; v.components += 2;
         }
 
         if (geometry.tangents.size() != 0)
         {
-            tanOffset = components; components += 3;
+            v.tangent_offset = v.components; v.components += 3;
         }
 
         if (geometry.bitangents.size() != 0)
         {
-            bitanOffset = components; components += 3;
+            v.bitangent_offset = v.components; v.components += 3;
         }
 
-        std::vector<float> buffer;
-        buffer.reserve(geometry.vertices.size() * components);
+        std::vector<float> & buffer = v.vertices;
+        buffer.reserve(geometry.vertices.size() * v.components);
 
         for (size_t i = 0; i < geometry.vertices.size(); ++i)
         {
@@ -72,34 +79,34 @@ namespace polymer
             buffer.push_back(geometry.vertices[i].y);
             buffer.push_back(geometry.vertices[i].z);
 
-            if (normalOffset)
+            if (v.normal_offset)
             {
                 buffer.push_back(geometry.normals[i].x);
                 buffer.push_back(geometry.normals[i].y);
                 buffer.push_back(geometry.normals[i].z);
             }
 
-            if (colorOffset)
+            if (v.color_offset)
             {
                 buffer.push_back(geometry.colors[i].x);
                 buffer.push_back(geometry.colors[i].y);
                 buffer.push_back(geometry.colors[i].z);
             }
 
-            if (texOffset)
+            if (v.texcoord_offset)
             {
                 buffer.push_back(geometry.texcoord0[i].x);
                 buffer.push_back(geometry.texcoord0[i].y);
             }
 
-            if (tanOffset)
+            if (v.tangent_offset)
             {
                 buffer.push_back(geometry.tangents[i].x);
                 buffer.push_back(geometry.tangents[i].y);
                 buffer.push_back(geometry.tangents[i].z);
             }
 
-            if (bitanOffset)
+            if (v.bitangent_offset)
             {
                 buffer.push_back(geometry.bitangents[i].x);
                 buffer.push_back(geometry.bitangents[i].y);
@@ -107,19 +114,39 @@ namespace polymer
             }
         }
 
-        m.set_vertex_data(buffer.size() * sizeof(float), buffer.data(), usage);
-        m.set_attribute(0, 3, GL_FLOAT, GL_FALSE, components * sizeof(float), ((float*)0) + vertexOffset);
-        if (normalOffset) m.set_attribute(1, 3, GL_FLOAT, GL_FALSE, components * sizeof(float), ((float*)0) + normalOffset);
-        if (colorOffset) m.set_attribute(2, 3, GL_FLOAT, GL_FALSE, components * sizeof(float), ((float*)0) + colorOffset);
-        if (texOffset) m.set_attribute(3, 2, GL_FLOAT, GL_FALSE, components * sizeof(float), ((float*)0) + texOffset);
-        if (tanOffset) m.set_attribute(4, 3, GL_FLOAT, GL_FALSE, components * sizeof(float), ((float*)0) + tanOffset);
-        if (bitanOffset) m.set_attribute(5, 3, GL_FLOAT, GL_FALSE, components * sizeof(float), ((float*)0) + bitanOffset);
+        return v;
+    }
+
+    // Points the vertex attributes of m at an interleaved layout; the vertex buffer must already be allocated
+    inline void set_interleaved_attributes(gl_mesh & m, const interleaved_geometry & v)
+    {
+        const GLsizei stride = v.stride();
+        m.set_attribute(0, 3, GL_FLOAT, GL_FALSE, stride, ((float*)0));
+        if (v.normal_offset) m.set_attribute(1, 3, GL_FLOAT, GL_FALSE, stride, ((float*)0) + v.normal_offset);
+        if (v.color_offset) m.set_attribute(2, 3, GL_FLOAT, GL_FALSE, stride, ((float*)0) + v.color_offset);
+        if (v.texcoord_offset) m.set_attribute(3, 2, GL_FLOAT, GL_FALSE, stride, ((float*)0) + v.texcoord_offset);
+        if (v.tangent_offset) m.set_attribute(4, 3, GL_FLOAT, GL_FALSE, stride, ((float*)0) + v.tangent_offset);
+        if (v.bitangent_offset) m.set_attribute(5, 3, GL_FLOAT, GL_FALSE, stride, ((float*)0) + v.bitangent_offset);
+    }
+
+    inline gl_mesh make_mesh_from_geometry(const geometry & geometry, const GLenum usage = GL_STATIC_DRAW)
+    {
+        assert(geometry.vertices.size() > 0);
+
+        const interleaved_geometry v = interleave_geometry(geometry);
+
+        gl_mesh m;
+        m.set_vertex_data(v.size_bytes(), v.vertices.data(), usage);
+        set_interleaved_attributes(m, v);
 
         if (geometry.faces.size() > 0)
         {
             m.set_elements(geometry.faces, usage);
         }
 
+        const aabb_3d bounds = compute_bounds(geometry);
+        m.set_bounds(bounds.min(), bounds.max());
+
         return m;
     }
 
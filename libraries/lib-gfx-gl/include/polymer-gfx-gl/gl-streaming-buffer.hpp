@@ -0,0 +1,126 @@
+#pragma once
+
+#ifndef polymer_gl_streaming_buffer_hpp
+#define polymer_gl_streaming_buffer_hpp
+
+#include "polymer-gfx-gl/gl-api.hpp"
+
+#include <stdint.h>
+#include <deque>
+
+namespace polymer
+{
+
+    // A persistently mapped, coherent buffer used as a ring of staging memory for uploads (as a
+    // GL_PIXEL_UNPACK_BUFFER for textures, or as the source of glCopyNamedBufferSubData for buffers).
+    // allocate() hands out a write pointer and its offset in the buffer; once the GL commands that read
+    // the allocations have been issued, fence() marks them. Memory is reused only after its fence has
+    // signalled, so the CPU never writes over bytes the GPU has yet to consume. A full ring fences the
+    // outstanding allocations itself, so issue the commands that read an allocation before requesting
+    // the next one. Main thread only.
+    class gl_streaming_buffer
+    {
+        struct fenced_range
+        {
+            GLsync fence;
+            uint64_t end; // ring position (monotonic, not wrapped) one past the last byte covered
+        };
+
+        gl_buffer buffer;
+        uint8_t * mapped { nullptr };
+        uint64_t capacity { 0 };
+        uint64_t head { 0 };   // next allocation
+        uint64_t tail { 0 };   // oldest byte still in use
+        uint64_t fenced { 0 }; // allocations before this are covered by a fence
+        std::deque<fenced_range> in_flight;
+
+        // Returns true if at least one range was released
+        bool release(bool wait)
+        {
+            bool released = false;
+            while (!in_flight.empty())
+            {
+                const GLuint64 timeout = wait ? GLuint64(1000000000) : 0; // 1 second
+                const GLenum status = glClientWaitSync(in_flight.front().fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, timeout);
+                if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) break;
+
+                glDeleteSync(in_flight.front().fence);
+                tail = in_flight.front().end;
+                in_flight.pop_front();
+                wait = false; // only block for the oldest range
+                released = true;
+            }
+            return released;
+        }
+
+    public:
+
+        gl_streaming_buffer() = default;
+        gl_streaming_buffer(const gl_streaming_buffer &) = delete;
+        gl_streaming_buffer & operator = (const gl_streaming_buffer &) = delete;
+
+        ~gl_streaming_buffer()
+        {
+            for (auto & r : in_flight) glDeleteSync(r.fence);
+            if (mapped) glUnmapNamedBuffer(buffer);
+        }
+
+        void create(const GLsizeiptr size_bytes)
+        {
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            buffer.set_buffer_storage(size_bytes, nullptr, flags);
+            mapped = static_cast<uint8_t *>(glMapNamedBufferRange(buffer, 0, size_bytes, flags));
+            if (!mapped) throw std::runtime_error("could not map streaming buffer");
+            capacity = static_cast<uint64_t>(size_bytes);
+        }
+
+        bool created() const { return mapped != nullptr; }
+        GLuint id() const { return buffer; }
+        GLsizeiptr size() const { return static_cast<GLsizeiptr>(capacity); }
+
+        // Reserves size_bytes at an offset that is a multiple of alignment. When the ring is full and wait
+        // is set, blocks on the oldest fence until enough has been released. Returns nullptr if the request
+        // can never fit, or if it does not fit right now and wait is false.
+        uint8_t * allocate(const GLsizeiptr size_bytes, const GLsizeiptr alignment, GLintptr & out_offset, bool wait = true)
+        {
+            const uint64_t size = static_cast<uint64_t>(size_bytes);
+            const uint64_t align = static_cast<uint64_t>(alignment > 0 ? alignment : 1);
+            if (!mapped || size > capacity) return nullptr;
+
+            release(false);
+
+            while (true)
+            {
+                // Pad up to the alignment, or to the start of the ring if the allocation would straddle the end
+                uint64_t offset = head % capacity;
+                uint64_t padding = (align - offset % align) % align;
+                if (offset + padding + size > capacity) padding = capacity - offset;
+                offset = (offset + padding) % capacity;
+
+                if (head + padding + size - tail <= capacity)
+                {
+                    head += padding + size;
+                    out_offset = static_cast<GLintptr>(offset);
+                    return mapped + offset;
+                }
+
+                if (!wait) return nullptr;
+
+                // Allocations made since the last fence() have to be fenced before anything can be waited on
+                if (fenced != head) fence();
+                if (in_flight.empty() || !release(true)) return nullptr;
+            }
+        }
+
+        // Call after issuing the GL commands that read everything allocated since the previous fence()
+        void fence()
+        {
+            if (fenced == head) return;
+            in_flight.push_back({ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), head });
+            fenced = head;
+        }
+    };
+
+} // end namespace polymer
+
+#endif // end polymer_gl_streaming_buffer_hpp
@@ -9,6 +9,7 @@
 
 namespace polymer
 {
+    // Layout read by the 3dgs compute shaders; produced on upload by pack_gaussian_vertices
     struct gaussian_vertex
     {
         float4 position;       // xyz + w=1
@@ -17,21 +18,80 @@ namespace polymer
         float shs[48];         // 16 SH coeffs x 3 RGB (interleaved)
     };
 
+    // SH coefficients per color channel for a given degree (1, 4, 9, 16)
+    inline uint32_t gaussian_sh_coefficients(const uint32_t sh_degree) { return (sh_degree + 1) * (sh_degree + 1); }
+
+    // Decoded splats, one array per attribute. SH only stores the coefficients the file
+    // provides, so a degree 0 capture costs 12 bytes per splat instead of 192.
     struct gaussian_splat_scene
     {
-        std::vector<gaussian_vertex> vertices;
+        std::vector<float3> positions;
+        std::vector<float3> scales;     // exp applied
+        std::vector<float> opacities;   // sigmoid applied
+        std::vector<float4> rotations;  // normalized, stored wxyz in xyzw for shader compatibility
+        std::vector<float> shs;         // sh_stride() floats per splat, interleaved RGB
         uint32_t sh_degree{ 3 };
+
+        size_t size() const { return positions.size(); }
+        bool empty() const { return positions.empty(); }
+        uint32_t sh_stride() const { return gaussian_sh_coefficients(sh_degree) * 3; }
+        size_t memory_bytes() const;
+    };
+
+    // Quantized splats at roughly 65 bytes each (degree 3) instead of 240. Splats are reordered along a
+    // Morton curve and grouped into chunks of chunk_size; positions and scales are quantized within the
+    // bounds of their chunk, which stay tight because neighbours on the curve are neighbours in space.
+    // Order differs from the source file.
+    struct compressed_gaussian_splats
+    {
+        static constexpr uint32_t chunk_size = 256;
+
+        struct chunk
+        {
+            float3 position_min, position_max;
+            float3 log_scale_min, log_scale_max;
+            float sh_range; // largest |coefficient| among the higher order SH of the chunk
+        };
+
+        std::vector<chunk> chunks;
+        std::vector<uint32_t> positions;  // 11-10-11 unorm within the chunk position bounds
+        std::vector<uint32_t> scales;     // 11-10-11 unorm of log(scale) within the chunk scale bounds
+        std::vector<uint32_t> rotations;  // smallest three: 2 bit index of the dropped component, 3x10 bit unorm
+        std::vector<uint16_t> colors;     // half float SH DC rgb + opacity
+        std::vector<int8_t> shs;          // higher order SH, sh_stride() per splat, snorm8 scaled by chunk sh_range
+        uint32_t sh_degree{ 3 };
+        size_t count{ 0 };
+
+        size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+        uint32_t sh_stride() const { return (gaussian_sh_coefficients(sh_degree) - 1) * 3; }
+        size_t memory_bytes() const;
+
+        float3 position(const size_t i) const;
+        void decode(const size_t i, gaussian_vertex & out) const;
+        gaussian_splat_scene decompress() const;
     };
 
     // Check if a PLY file contains gaussian splat data by looking for
     // characteristic properties: opacity, scale_0, rot_0, f_dc_0
     bool is_gaussian_splat_ply(const std::string & path);
 
-    // Import a gaussian splat PLY file
-    // Applies exp() to scales, sigmoid to opacity, normalizes quaternions,
-    // and reorganizes SH from PLY layout (all R, all G, all B) to interleaved RGB
+    // Import a binary gaussian splat PLY file. The file is memory mapped and decoded straight into
+    // the per-attribute arrays, in parallel. Applies exp() to scales, sigmoid to opacity, normalizes
+    // quaternions, and reorganizes SH from PLY layout (all R, all G, all B) to interleaved RGB.
+    // Prints the error and returns an empty scene when the file cannot be read.
     gaussian_splat_scene import_gaussian_splat_ply(const std::string & path);
 
+    // Import directly into the compressed representation; the full-precision splats never exist in
+    // memory, only 8 bytes per splat of Morton keys while the order is built
+    compressed_gaussian_splats import_gaussian_splat_ply_compressed(const std::string & path);
+
+    compressed_gaussian_splats compress_gaussian_splats(const gaussian_splat_scene & scene);
+
+    // Expand to the shader layout, e.g. directly into a mapped GPU buffer of size() vertices
+    void pack_gaussian_vertices(const gaussian_splat_scene & scene, gaussian_vertex * out);
+    void pack_gaussian_vertices(const compressed_gaussian_splats & splats, gaussian_vertex * out);
+
 } // end namespace polymer
 
 #endif // end polymer_gaussian_splat_io_hpp
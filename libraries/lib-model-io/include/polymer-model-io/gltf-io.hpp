@@ -96,6 +96,7 @@ namespace polymer
         bool load_textures = true;
         bool compute_tangents = true;
         bool compute_normals = true;
+        bool parallel = true; // decode compressed buffer views, primitives and animations on the job system
     };
 
     gltf_scene import_gltf_scene(const std::string & path, const gltf_import_options & options = {});
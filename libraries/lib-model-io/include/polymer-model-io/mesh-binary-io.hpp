@@ -0,0 +1,181 @@
+#pragma once
+
+#ifndef polymer_mesh_binary_io_hpp
+#define polymer_mesh_binary_io_hpp
+
+#include "polymer-model-io/model-io.hpp"
+#include "polymer-core/util/memory-mapped-file.hpp"
+
+#include <array>
+
+namespace polymer
+{
+    ///////////////////////////////////
+    //   *.mesh v2 container layout  //
+    ///////////////////////////////////
+
+    // [runtime_mesh_binary_header_v2][runtime_mesh_binary_section x sectionCount][section data ...]
+    //
+    // Every section starts on a kMeshSectionAlignment boundary, so uncompressed float32 streams can be
+    // used straight out of a memory mapping. Version 1 files (a runtime_mesh_binary_header followed by
+    // tightly packed streams) share the leading headerVersion field and remain readable.
+
+    static const uint32_t kMeshBinaryMagic = 0x48534d50; // 'PMSH'
+    static const uint64_t kMeshSectionAlignment = 64;
+
+    enum class mesh_section : uint32_t
+    {
+        vertices,
+        normals,
+        colors,
+        texcoord0,
+        texcoord1,
+        tangents,
+        bitangents,
+        faces,              // per level: 0 is the full mesh, 1..lodCount the simplified levels
+        material,           // per level
+        meshlets,           // per level, mesh_meshlet
+        meshlet_vertices,   // per level
+        meshlet_triangles,  // per level
+        count
+    };
+
+    enum class mesh_section_encoding : uint32_t
+    {
+        raw,                // stored as-is
+        meshopt_vertex,     // meshopt_encodeVertexBuffer
+        meshopt_index       // meshopt_encodeIndexBuffer (faces only; may rotate a triangle's indices, winding is kept)
+    };
+
+    // Component type of the stored elements, before any section encoding is undone
+    enum class mesh_component_format : uint32_t
+    {
+        float32,
+        unorm16,            // dequantized as value / 65535 * scale + bias
+        snorm16,            // dequantized as max(value / 32767, -1)
+        float16,
+        uint32
+    };
+
+    #pragma pack(push, 1)
+    struct runtime_mesh_binary_header_v2
+    {
+        uint32_t headerVersion{ runtime_mesh_binary_version };
+        uint32_t magic{ kMeshBinaryMagic };
+        uint32_t compressionVersion{ 0 };
+        uint32_t sectionCount{ 0 };
+        uint32_t lodCount{ 0 };
+        uint32_t flags{ 0 };
+        uint64_t fileBytes{ 0 };
+    };
+
+    struct runtime_mesh_binary_section
+    {
+        uint32_t type{ 0 };             // mesh_section
+        uint32_t level{ 0 };
+        uint32_t encoding{ 0 };         // mesh_section_encoding
+        uint32_t format{ 0 };           // mesh_component_format
+        uint32_t count{ 0 };            // elements
+        uint32_t stride{ 0 };           // bytes per stored element, including any padding component
+        uint32_t components{ 0 };       // meaningful components per element (the rest is padding)
+        uint32_t reserved{ 0 };
+        uint64_t offset{ 0 };           // from the start of the file
+        uint64_t bytes{ 0 };            // stored (possibly encoded) size
+        float scale[4] = { 1, 1, 1, 1 }; // unorm16 dequantization
+        float bias[4] = { 0, 0, 0, 0 };
+    };
+    #pragma pack(pop)
+
+    struct mesh_export_options
+    {
+        bool compress {false};          // meshopt vertex/index codecs on every section
+        bool quantize {false};          // unorm16 positions and texcoords, snorm16 normals/tangents, float16 colors
+        bool meshlets {false};          // build_meshlets over the full mesh and every LOD
+        uint32_t max_meshlet_vertices {64};
+        uint32_t max_meshlet_triangles {124};
+    };
+
+    // Writes a v2 *.mesh. `lods`, typically produced by optimize_model, are stored as extra face (and
+    // material) levels that index the same vertex streams.
+    void export_polymer_binary_model(const std::string & path, const runtime_mesh & mesh, const mesh_export_options & options, const std::vector<mesh_lod> * lods = nullptr);
+
+    // Contiguous read-only range, pointing either into a mapped file or into storage owned by the view
+    template <typename T>
+    struct mesh_stream_view
+    {
+        const T * data {nullptr};
+        size_t size {0};
+
+        bool empty() const { return size == 0; }
+        const T * begin() const { return data; }
+        const T * end() const { return data + size; }
+        const T & operator[](const size_t i) const { return data[i]; }
+        std::vector<T> to_vector() const { return std::vector<T>(begin(), end()); }
+    };
+
+    // Opens a *.mesh (v1 or v2) through a memory mapping. Sections stored as raw float32/uint32
+    // with the runtime layout are handed out as views into the mapping without a copy; quantized or
+    // compressed sections are decoded once, on open, into storage owned by this object. Views stay
+    // valid for the lifetime of the mapped_mesh. Throws std::runtime_error on malformed files: every
+    // section must lie within the mapping, decode to its recorded count, and face and meshlet indices
+    // must be in range, so the views can be used without further checks.
+    class mapped_mesh
+    {
+        struct section_data
+        {
+            const uint8_t * data {nullptr};
+            size_t count {0};
+        };
+
+        memory_mapped_file file;
+        uint32_t version {0};
+        uint32_t lods {0};
+        size_t decoded {0};
+        std::vector<std::array<section_data, size_t(mesh_section::count)>> levels;
+        std::vector<std::vector<uint8_t>> owned;
+
+        void open_v1();
+        void open_v2();
+        bool decode_section(const runtime_mesh_binary_section & s, std::vector<uint8_t> & storage);
+        void validate() const;
+
+        template <typename T>
+        mesh_stream_view<T> view(const mesh_section s, const uint32_t level) const
+        {
+            if (level >= levels.size()) return {};
+            const section_data & d = levels[level][size_t(s)];
+            return { reinterpret_cast<const T *>(d.data), d.count };
+        }
+
+    public:
+
+        explicit mapped_mesh(const std::string & path);
+
+        uint32_t file_version() const { return version; }
+        uint32_t lod_count() const { return lods; }
+
+        // Bytes served straight from the mapping vs. bytes that had to be decoded into owned storage
+        size_t mapped_bytes() const { return file.size(); }
+        size_t decoded_bytes() const { return decoded; }
+
+        mesh_stream_view<float3> vertices() const { return view<float3>(mesh_section::vertices, 0); }
+        mesh_stream_view<float3> normals() const { return view<float3>(mesh_section::normals, 0); }
+        mesh_stream_view<float4> colors() const { return view<float4>(mesh_section::colors, 0); }
+        mesh_stream_view<float2> texcoord0() const { return view<float2>(mesh_section::texcoord0, 0); }
+        mesh_stream_view<float2> texcoord1() const { return view<float2>(mesh_section::texcoord1, 0); }
+        mesh_stream_view<float3> tangents() const { return view<float3>(mesh_section::tangents, 0); }
+        mesh_stream_view<float3> bitangents() const { return view<float3>(mesh_section::bitangents, 0); }
+
+        mesh_stream_view<uint3> faces(const uint32_t level = 0) const { return view<uint3>(mesh_section::faces, level); }
+        mesh_stream_view<uint32_t> material(const uint32_t level = 0) const { return view<uint32_t>(mesh_section::material, level); }
+        mesh_stream_view<mesh_meshlet> meshlets(const uint32_t level = 0) const { return view<mesh_meshlet>(mesh_section::meshlets, level); }
+        mesh_stream_view<uint32_t> meshlet_vertices(const uint32_t level = 0) const { return view<uint32_t>(mesh_section::meshlet_vertices, level); }
+        mesh_stream_view<uint32_t> meshlet_triangles(const uint32_t level = 0) const { return view<uint32_t>(mesh_section::meshlet_triangles, level); }
+
+        // Copies the full-detail mesh out of the mapping
+        runtime_mesh to_runtime_mesh() const;
+    };
+
+} // end namespace polymer
+
+#endif // end polymer_mesh_binary_io_hpp
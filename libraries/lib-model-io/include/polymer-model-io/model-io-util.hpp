@@ -5,35 +5,118 @@
 
 #include "polymer-core/math/math-core.hpp"
 
-#include <unordered_map>
-#include <nmmintrin.h> // for _mm_crc32_u8
+#include <cstring>
+#include <vector>
+#include <nmmintrin.h> // for _mm_crc32_u64
 
 struct unique_vertex
 {
     polymer::float3 position; polymer::float2 texcoord; polymer::float3 normal;
 };
 
-template <typename KeyType, typename ValueType>
-struct unordered_map_generator
+inline float half_to_float(const uint16_t h)
 {
-    struct Hash
+    const uint32_t sign = uint32_t(h & 0x8000) << 16;
+    const uint32_t exponent = (h >> 10) & 0x1f;
+    const uint32_t mantissa = h & 0x3ff;
+
+    uint32_t bits;
+    if (exponent == 0x1f) bits = sign | 0x7f800000 | (mantissa << 13);               // inf / nan
+    else if (exponent != 0) bits = sign | ((exponent + 112) << 23) | (mantissa << 13); // normal
+    else if (mantissa == 0) bits = sign;                                             // zero
+    else
+    {
+        // subnormal half, normal float
+        uint32_t e = 113, m = mantissa;
+        while (!(m & 0x400)) { m <<= 1; --e; }
+        bits = sign | (e << 23) | ((m & 0x3ff) << 13);
+    }
+
+    float result;
+    std::memcpy(&result, &bits, sizeof(float));
+    return result;
+}
+
+// CRC32C over the bytes of a key without padding, eight bytes per instruction
+template <typename KeyType>
+inline uint32_t crc32_key_hash(const KeyType & key)
+{
+    const uint8_t * bytes = reinterpret_cast<const uint8_t *>(&key);
+    uint64_t digest = 0;
+    size_t i = 0;
+    for (; i + 8 <= sizeof(KeyType); i += 8)
     {
-        uint32_t operator()(const KeyType & a) const
+        uint64_t word;
+        std::memcpy(&word, bytes + i, 8);
+        digest = _mm_crc32_u64(digest, word);
+    }
+    for (; i + 4 <= sizeof(KeyType); i += 4)
+    {
+        uint32_t word;
+        std::memcpy(&word, bytes + i, 4);
+        digest = _mm_crc32_u32(static_cast<uint32_t>(digest), word);
+    }
+    for (; i < sizeof(KeyType); ++i) digest = _mm_crc32_u8(static_cast<uint32_t>(digest), bytes[i]);
+    return static_cast<uint32_t>(digest);
+}
+
+// Insert-only open-addressing (linear probing) map from a key compared bytewise to a dense uint32 index,
+// used to deduplicate vertices. Keys are stored in insertion order, so keys()[i] is the key given index i.
+// The slot array stays at most half full and stores the hash next to the index to skip most compares.
+template <typename KeyType>
+class flat_index_map
+{
+    struct slot { uint32_t hash; uint32_t index; }; // index == kEmpty marks a free slot
+
+    static constexpr uint32_t kEmpty = 0xffffffff;
+
+    std::vector<slot> slots;
+    std::vector<KeyType> entries;
+    size_t mask { 0 };
+
+    void rehash(const size_t capacity)
+    {
+        slots.assign(capacity, slot{ 0, kEmpty });
+        mask = capacity - 1;
+        for (uint32_t i = 0; i < entries.size(); ++i)
         {
-            uint32_t digest = 0;
-            for (size_t i = 0; i < sizeof(a); i++) digest = _mm_crc32_u8(digest, ((uint8_t*)&a)[i]);
-            return digest;
+            const uint32_t h = crc32_key_hash(entries[i]);
+            size_t s = h & mask;
+            while (slots[s].index != kEmpty) s = (s + 1) & mask;
+            slots[s] = { h, i };
         }
-    };
-    struct CompareEq
+    }
+
+public:
+
+    flat_index_map(const size_t expected = 64)
     {
-        bool operator()(const KeyType & a, const KeyType & b) const
+        size_t capacity = 16;
+        while (capacity < expected * 2) capacity <<= 1;
+        entries.reserve(expected);
+        rehash(capacity);
+    }
+
+    // Returns the index of key, inserting it with the next free index if it is not present yet
+    uint32_t insert(const KeyType & key)
+    {
+        const uint32_t h = crc32_key_hash(key);
+        size_t s = h & mask;
+        while (slots[s].index != kEmpty)
         {
-            return !memcmp(&a, &b, sizeof(a));
+            if (slots[s].hash == h && !std::memcmp(&entries[slots[s].index], &key, sizeof(KeyType))) return slots[s].index;
+            s = (s + 1) & mask;
         }
-    };
-    typedef std::unordered_map<KeyType, ValueType, Hash, CompareEq> Type;
-};
 
+        const uint32_t index = static_cast<uint32_t>(entries.size());
+        entries.push_back(key);
+        slots[s] = { h, index };
+        if (entries.size() * 2 > slots.size()) rehash(slots.size() * 2);
+        return index;
+    }
+
+    size_t size() const { return entries.size(); }
+    const std::vector<KeyType> & keys() const { return entries; }
+};
 
 #endif // end model_io_util_hpp
@@ -53,13 +53,14 @@ namespace polymer
         std::vector<float4> boneWeights;
     };
 
-    #define runtime_mesh_binary_version 1
+    #define runtime_mesh_binary_version 2
     #define runtime_mesh_compression_version 1
 
+    // Version 1 header, still readable by import_polymer_binary_model; see mesh-binary-io.hpp for v2
     #pragma pack(push, 1)
     struct runtime_mesh_binary_header
     {
-        uint32_t headerVersion{ runtime_mesh_binary_version };
+        uint32_t headerVersion{ 1 };
         uint32_t compressionVersion{ runtime_mesh_compression_version };
         uint32_t verticesBytes{ 0 };
         uint32_t normalsBytes{ 0 };
@@ -77,9 +78,11 @@ namespace polymer
     //   File Format IO  //
     ///////////////////////
 
-    // Polymer's own runtime-optimized *.mesh file format
+    // Polymer's own runtime-optimized *.mesh file format. Import reads v1 and v2 files through a
+    // memory mapping (see mapped_mesh for zero-copy access); export writes v2, optionally with the
+    // meshopt codecs. mesh-binary-io.hpp has the full set of export options (quantization, LODs, meshlets).
     runtime_mesh import_polymer_binary_model(const std::string & path);
-    void export_polymer_binary_model(const std::string & path, runtime_mesh & mesh, bool compressed = false);
+    void export_polymer_binary_model(const std::string & path, const runtime_mesh & mesh, bool compressed = false);
 
     // Load an OBJ model, assuming the path points to a valid *.obj
     std::unordered_map<std::string, runtime_mesh> import_obj_model(const std::string & path);
@@ -93,8 +96,70 @@ namespace polymer
     bool export_obj_model(const std::string & name, const std::string & filename, runtime_mesh & mesh);
     bool export_obj_multi_model(const std::vector<std::string> & names, const std::string & filename, std::vector<runtime_mesh *> & meshes);
 
-    // Currently a no-op
-    void optimize_model(runtime_mesh & input);
+    //////////////////////////
+    //   Mesh Optimization  //
+    //////////////////////////
+
+    struct mesh_optimization_options
+    {
+        bool deduplicate_vertices {true};   // merge vertices identical across every attribute stream, drop unreferenced ones
+        bool optimize_vertex_cache {true};  // reorder triangles for the post-transform cache
+        bool optimize_overdraw {true};      // reorder triangle clusters front-to-back without undoing the cache order
+        bool optimize_vertex_fetch {true};  // reorder vertices into first-use order
+        float overdraw_threshold {1.05f};   // how much ACMR may degrade in exchange for less overdraw
+        uint32_t cache_size {16};           // FIFO size used for the ACMR/ATVR statistics
+        uint32_t lod_count {0};             // number of simplified levels to generate
+        float lod_reduction {0.5f};         // triangle count of each level relative to the previous one
+    };
+
+    // A simplified level that shares the vertex streams of its source mesh
+    struct mesh_lod
+    {
+        std::vector<uint3> faces;
+        std::vector<uint32_t> material; // per-face, when the source mesh has per-face materials
+    };
+
+    // ACMR: transformed vertices per triangle (0.5 best, 3.0 worst). ATVR: transformed vertices per
+    // vertex (1.0 best). Overfetch: fetched vertex bytes per vertex buffer byte (1.0 best). Overdraw:
+    // shaded per covered pixel (1.0 best), only measured when optimize_overdraw is set.
+    struct mesh_optimization_stats
+    {
+        uint32_t vertices_before {0}, vertices_after {0};
+        uint32_t triangles {0};
+        float acmr_before {0}, acmr_after {0};
+        float atvr_before {0}, atvr_after {0};
+        float overfetch_before {0}, overfetch_after {0};
+        float overdraw_before {0}, overdraw_after {0};
+    };
+
+    // Runs the meshoptimizer passes over a triangle mesh in place, on import or offline ahead of
+    // export_polymer_binary_model. All per-vertex streams are remapped together. When `material` has
+    // one entry per face, faces are grouped by material and each group is optimized (and simplified)
+    // on its own, so the per-face material ids stay valid. Streams whose size does not match the vertex
+    // count prevent the passes that reorder vertices; the index-only passes still run.
+    mesh_optimization_stats optimize_model(runtime_mesh & input, const mesh_optimization_options & options = {}, std::vector<mesh_lod> * lods = nullptr);
+
+    // A cluster of at most max_vertices vertices and max_triangles triangles. Its vertices are
+    // meshlet_set::vertices[vertex_offset, vertex_offset + vertex_count) (indices into the mesh), and
+    // each triangle in meshlet_set::triangles packs three 8-bit local vertex indices as a | b << 8 | c << 16.
+    struct mesh_meshlet
+    {
+        uint32_t vertex_offset {0};
+        uint32_t triangle_offset {0};
+        uint32_t vertex_count {0};
+        uint32_t triangle_count {0};
+    };
+
+    struct meshlet_set
+    {
+        std::vector<mesh_meshlet> meshlets;
+        std::vector<uint32_t> vertices;
+        std::vector<uint32_t> triangles;
+    };
+
+    // Greedily splits faces into meshlets in their current order, so run it after the vertex cache
+    // pass of optimize_model, which already clusters neighbouring triangles. max_vertices <= 256.
+    meshlet_set build_meshlets(const std::vector<uint3> & faces, const size_t vertex_count, const uint32_t max_vertices = 64, const uint32_t max_triangles = 124);
 
 } // end namespace polymer
 
@@ -0,0 +1,624 @@
+#include "polymer-model-io/gaussian-splat-io.hpp"
+#include "polymer-model-io/model-io-util.hpp"
+
+#include "polymer-core/util/memory-mapped-file.hpp"
+#include "polymer-core/util/job-system.hpp"
+#include "polymer-core/math/math-morton.hpp"
+#include "polymer-core/tools/radix-sort.hpp"
+
+#include "meshoptimizer/meshoptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+using namespace polymer;
+
+/////////////////////////////////////
+//   Gaussian Splat PLY Decoding   //
+/////////////////////////////////////
+
+// Splat captures are a single binary vertex element with ~60 scalar properties per splat. Instead of
+// requesting each property separately (one copy per property), the header is parsed once into byte
+// offsets within a vertex record and every splat is decoded straight from the mapped file into its
+// destination, in parallel over ranges of splats.
+
+namespace
+{
+    static const size_t kSplatsPerJob = 8192;
+
+    enum class ply_type : uint8_t { int8, uint8, int16, uint16, int32, uint32, float32, float64 };
+
+    struct ply_field
+    {
+        uint32_t offset { 0 };
+        ply_type type { ply_type::float32 };
+        bool present { false };
+    };
+
+    // Byte layout of the vertex element of a binary PLY file
+    struct splat_layout
+    {
+        const uint8_t * data { nullptr }; // first vertex record
+        size_t count { 0 };
+        size_t stride { 0 };
+        bool swap { false };              // binary_big_endian
+        ply_field position[3], scale[3], opacity, rotation[4], dc[3];
+        std::vector<ply_field> rest;      // f_rest_0 .. f_rest_n, R coefficients then G then B
+        uint32_t sh_degree { 0 };
+    };
+
+    // A decoded splat: activations applied except for the scale, kept in log space for quantization
+    struct splat_record
+    {
+        float3 position;
+        float3 log_scale;
+        float opacity;
+        float4 rotation;
+        float shs[48];
+    };
+
+    size_t ply_type_size(const ply_type t)
+    {
+        switch (t)
+        {
+            case ply_type::int8: case ply_type::uint8: return 1;
+            case ply_type::int16: case ply_type::uint16: return 2;
+            case ply_type::float64: return 8;
+            default: return 4;
+        }
+    }
+
+    bool parse_ply_type(const std::string & name, ply_type & t)
+    {
+        if (name == "float" || name == "float32") t = ply_type::float32;
+        else if (name == "double" || name == "float64") t = ply_type::float64;
+        else if (name == "uchar" || name == "uint8") t = ply_type::uint8;
+        else if (name == "char" || name == "int8") t = ply_type::int8;
+        else if (name == "ushort" || name == "uint16") t = ply_type::uint16;
+        else if (name == "short" || name == "int16") t = ply_type::int16;
+        else if (name == "uint" || name == "uint32") t = ply_type::uint32;
+        else if (name == "int" || name == "int32") t = ply_type::int32;
+        else return false;
+        return true;
+    }
+
+    template <typename T>
+    T load_scalar(const uint8_t * p, const bool swap)
+    {
+        uint8_t bytes[sizeof(T)];
+        std::memcpy(bytes, p, sizeof(T));
+        if (swap) std::reverse(bytes, bytes + sizeof(T));
+        T value;
+        std::memcpy(&value, bytes, sizeof(T));
+        return value;
+    }
+
+    inline float read_field(const uint8_t * record, const ply_field & f, const bool swap)
+    {
+        if (!f.present) return 0.f;
+        const uint8_t * p = record + f.offset;
+        switch (f.type)
+        {
+            case ply_type::float32: return load_scalar<float>(p, swap);
+            case ply_type::float64: return static_cast<float>(load_scalar<double>(p, swap));
+            case ply_type::uint8: return static_cast<float>(*p);
+            case ply_type::int8: return static_cast<float>(static_cast<int8_t>(*p));
+            case ply_type::uint16: return static_cast<float>(load_scalar<uint16_t>(p, swap));
+            case ply_type::int16: return static_cast<float>(load_scalar<int16_t>(p, swap));
+            case ply_type::uint32: return static_cast<float>(load_scalar<uint32_t>(p, swap));
+            case ply_type::int32: return static_cast<float>(load_scalar<int32_t>(p, swap));
+        }
+        return 0.f;
+    }
+
+    // Resolves the vertex element layout from the header. Throws when the file is not a binary PLY, a
+    // required property is missing, or the body is shorter than the header claims.
+    splat_layout parse_splat_layout(const uint8_t * data, const size_t size)
+    {
+        const char * begin = reinterpret_cast<const char *>(data);
+        const char * end = begin + size;
+
+        static const char kEndHeader[] = "end_header";
+        const char * header_end = std::search(begin, end, kEndHeader, kEndHeader + sizeof(kEndHeader) - 1);
+        if (size < 3 || std::strncmp(begin, "ply", 3) || header_end == end) throw std::runtime_error("not a ply file");
+        const char * body = std::find(header_end, end, '\n');
+        if (body == end) throw std::runtime_error("truncated ply header");
+        ++body;
+
+        struct element { std::string name; size_t count { 0 }; size_t stride { 0 }; bool list { false }; };
+        std::vector<element> elements;
+        std::vector<std::pair<std::string, ply_field>> vertex_properties;
+
+        splat_layout layout;
+        bool binary = false;
+
+        const char * line = begin;
+        while (line < header_end)
+        {
+            const char * line_end = std::find(line, header_end, '\n');
+            std::vector<std::string> tokens;
+            for (const char * p = line; p < line_end;)
+            {
+                while (p < line_end && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+                const char * token = p;
+                while (p < line_end && *p != ' ' && *p != '\t' && *p != '\r') ++p;
+                if (p > token) tokens.emplace_back(token, p);
+            }
+            line = line_end + 1;
+
+            if (tokens.empty() || tokens[0] == "comment" || tokens[0] == "obj_info") continue;
+
+            if (tokens[0] == "format" && tokens.size() > 1)
+            {
+                if (tokens[1] == "binary_little_endian") binary = true;
+                else if (tokens[1] == "binary_big_endian") binary = layout.swap = true;
+                else throw std::runtime_error("only binary ply splat files are supported");
+            }
+            else if (tokens[0] == "element" && tokens.size() > 2)
+            {
+                elements.push_back({ tokens[1], std::strtoull(tokens[2].c_str(), nullptr, 10) });
+            }
+            else if (tokens[0] == "property" && tokens.size() > 2 && !elements.empty())
+            {
+                element & e = elements.back();
+                ply_type type;
+                if (tokens[1] == "list" || !parse_ply_type(tokens[1], type))
+                {
+                    e.list = true;
+                    continue;
+                }
+                if (e.name == "vertex") vertex_properties.push_back({ tokens[2], { static_cast<uint32_t>(e.stride), type, true } });
+                e.stride += ply_type_size(type);
+            }
+        }
+
+        if (!binary) throw std::runtime_error("missing ply format");
+
+        size_t offset = 0;
+        const element * vertex = nullptr;
+        for (const element & e : elements)
+        {
+            if (e.name == "vertex") { vertex = &e; break; }
+            if (e.list) throw std::runtime_error("ply element " + e.name + " with list properties precedes the vertices");
+            offset += e.count * e.stride;
+        }
+        if (!vertex) throw std::runtime_error("ply file has no vertex element");
+        if (vertex->list) throw std::runtime_error("ply vertex element has list properties");
+
+        layout.data = reinterpret_cast<const uint8_t *>(body) + offset;
+        layout.count = vertex->count;
+        layout.stride = vertex->stride;
+        if (size_t(end - body) < offset || size_t(end - body) - offset < layout.count * layout.stride) throw std::runtime_error("truncated ply file");
+
+        const auto find = [&](const std::string & name) -> ply_field
+        {
+            for (const auto & p : vertex_properties) if (p.first == name) return p.second;
+            return {};
+        };
+
+        const char * axes[3] = { "x", "y", "z" };
+        for (int i = 0; i < 3; ++i)
+        {
+            layout.position[i] = find(axes[i]);
+            layout.scale[i] = find("scale_" + std::to_string(i));
+            layout.dc[i] = find("f_dc_" + std::to_string(i));
+        }
+        for (int i = 0; i < 4; ++i) layout.rotation[i] = find("rot_" + std::to_string(i));
+        layout.opacity = find("opacity");
+
+        for (int i = 0; i < 3; ++i)
+        {
+            if (!layout.position[i].present) throw std::runtime_error("missing position");
+            if (!layout.scale[i].present) throw std::runtime_error("missing scales");
+        }
+        for (int i = 0; i < 4; ++i) if (!layout.rotation[i].present) throw std::runtime_error("missing rotations");
+        if (!layout.opacity.present) throw std::runtime_error("missing opacity");
+
+        for (int i = 0; ; ++i)
+        {
+            const ply_field f = find("f_rest_" + std::to_string(i));
+            if (!f.present) break;
+            layout.rest.push_back(f);
+        }
+
+        // SH degree 0: 1 coeff, degree 1: 4 coeffs, degree 2: 9 coeffs, degree 3: 16 coeffs
+        const uint32_t coefficients = 1 + static_cast<uint32_t>(layout.rest.size()) / 3;
+        while (layout.sh_degree < 3 && gaussian_sh_coefficients(layout.sh_degree + 1) <= coefficients) ++layout.sh_degree;
+
+        return layout;
+    }
+
+    struct ply_splat_source
+    {
+        const splat_layout & layout;
+
+        size_t size() const { return layout.count; }
+        uint32_t sh_degree() const { return layout.sh_degree; }
+
+        float3 position(const size_t i) const
+        {
+            const uint8_t * r = layout.data + i * layout.stride;
+            return { read_field(r, layout.position[0], layout.swap), read_field(r, layout.position[1], layout.swap), read_field(r, layout.position[2], layout.swap) };
+        }
+
+        void load(const size_t i, splat_record & s) const
+        {
+            const uint8_t * r = layout.data + i * layout.stride;
+            const bool swap = layout.swap;
+
+            s.position = position(i);
+            for (int c = 0; c < 3; ++c) s.log_scale[c] = read_field(r, layout.scale[c], swap);
+            s.opacity = 1.0f / (1.0f + std::exp(-read_field(r, layout.opacity, swap)));
+
+            // Rotation quaternion, wxyz in the file, normalized and kept in wxyz order for the shaders
+            float4 q;
+            for (int c = 0; c < 4; ++c) q[c] = read_field(r, layout.rotation[c], swap);
+            const float len = length(q);
+            s.rotation = (len > 0.0f) ? q / len : float4(1, 0, 0, 0);
+
+            // SH: the file stores [all R coeffs][all G coeffs][all B coeffs], interleave to [RGB0][RGB1]...
+            const uint32_t coefficients = gaussian_sh_coefficients(layout.sh_degree);
+            const size_t per_channel = layout.rest.size() / 3;
+            for (int c = 0; c < 3; ++c) s.shs[c] = read_field(r, layout.dc[c], swap);
+            for (uint32_t k = 1; k < coefficients; ++k)
+            {
+                for (int c = 0; c < 3; ++c) s.shs[k * 3 + c] = read_field(r, layout.rest[c * per_channel + k - 1], swap);
+            }
+        }
+    };
+
+    struct scene_splat_source
+    {
+        const gaussian_splat_scene & scene;
+
+        size_t size() const { return scene.size(); }
+        uint32_t sh_degree() const { return scene.sh_degree; }
+        float3 position(const size_t i) const { return scene.positions[i]; }
+
+        void load(const size_t i, splat_record & s) const
+        {
+            s.position = scene.positions[i];
+            for (int c = 0; c < 3; ++c) s.log_scale[c] = std::log(std::max(scene.scales[i][c], std::numeric_limits<float>::min()));
+            s.opacity = scene.opacities[i];
+            s.rotation = scene.rotations[i];
+            const uint32_t stride = scene.sh_stride();
+            std::memcpy(s.shs, scene.shs.data() + i * stride, stride * sizeof(float));
+        }
+    };
+
+    ////////////////////////////
+    //   Splat Quantization   //
+    ////////////////////////////
+
+    static const float kSqrt2 = 1.41421356f;
+
+    uint32_t pack_11_10_11(const float3 & t)
+    {
+        return uint32_t(meshopt_quantizeUnorm(t.x, 11)) << 21 | uint32_t(meshopt_quantizeUnorm(t.y, 10)) << 11 | uint32_t(meshopt_quantizeUnorm(t.z, 11));
+    }
+
+    float3 unpack_11_10_11(const uint32_t v)
+    {
+        return { (v >> 21) / 2047.f, ((v >> 11) & 1023) / 1023.f, (v & 2047) / 2047.f };
+    }
+
+    // Each remaining component of a unit quaternion is at most 1/sqrt(2) in magnitude once the largest
+    // one is dropped, and q and -q are the same rotation, so the dropped component is made positive
+    uint32_t pack_rotation(const float4 & q)
+    {
+        uint32_t largest = 0;
+        for (uint32_t c = 1; c < 4; ++c) if (std::abs(q[c]) > std::abs(q[largest])) largest = c;
+        const float sign = (q[largest] < 0.f) ? -1.f : 1.f;
+
+        uint32_t packed = largest << 30;
+        int shift = 20;
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            if (c == largest) continue;
+            packed |= uint32_t(meshopt_quantizeUnorm(q[c] * sign * kSqrt2 * 0.5f + 0.5f, 10)) << shift;
+            shift -= 10;
+        }
+        return packed;
+    }
+
+    float4 unpack_rotation(const uint32_t packed)
+    {
+        const uint32_t largest = packed >> 30;
+        float4 q;
+        float sum = 0.f;
+        int shift = 20;
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            if (c == largest) continue;
+            q[c] = (((packed >> shift) & 1023) / 1023.f * 2.f - 1.f) / kSqrt2;
+            sum += q[c] * q[c];
+            shift -= 10;
+        }
+        q[largest] = std::sqrt(std::max(0.f, 1.f - sum));
+        return q;
+    }
+
+    float3 normalize_within(const float3 & v, const float3 & min, const float3 & max)
+    {
+        const float3 extent = max - min;
+        return { extent.x > 0 ? (v.x - min.x) / extent.x : 0.f, extent.y > 0 ? (v.y - min.y) / extent.y : 0.f, extent.z > 0 ? (v.z - min.z) / extent.z : 0.f };
+    }
+
+    template <typename Source>
+    compressed_gaussian_splats compress_splats(const Source & source)
+    {
+        compressed_gaussian_splats out;
+        out.count = source.size();
+        out.sh_degree = source.sh_degree();
+        if (out.count == 0) return out;
+
+        job_system & jobs = default_job_system();
+        const size_t n = out.count;
+        const uint32_t chunk_size = compressed_gaussian_splats::chunk_size;
+
+        // Scene bounds, reduced per block of splats
+        const size_t block_count = (n + kSplatsPerJob - 1) / kSplatsPerJob;
+        std::vector<float3> block_min(block_count, float3(std::numeric_limits<float>::max()));
+        std::vector<float3> block_max(block_count, float3(std::numeric_limits<float>::lowest()));
+        jobs.parallel_for(block_count, 1, [&](const size_t begin, const size_t end)
+        {
+            for (size_t b = begin; b < end; ++b)
+            {
+                for (size_t i = b * kSplatsPerJob; i < std::min(n, (b + 1) * kSplatsPerJob); ++i)
+                {
+                    const float3 p = source.position(i);
+                    block_min[b] = linalg::min(block_min[b], p);
+                    block_max[b] = linalg::max(block_max[b], p);
+                }
+            }
+        });
+        float3 scene_min = block_min[0], scene_max = block_max[0];
+        for (size_t b = 1; b < block_count; ++b)
+        {
+            scene_min = linalg::min(scene_min, block_min[b]);
+            scene_max = linalg::max(scene_max, block_max[b]);
+        }
+
+        // 10 bits per axis keeps the code in 32 bits, which the radix sort handles in three passes
+        std::vector<uint32_t> codes(n), order(n);
+        jobs.parallel_for(n, kSplatsPerJob, [&](const size_t begin, const size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                const float3 t = normalize_within(source.position(i), scene_min, scene_max);
+                const auto q = [](const float x) { return static_cast<uint32_t>(std::min(x * 1024.f, 1023.f)); };
+                codes[i] = static_cast<uint32_t>(morton_3d(q(t.x), q(t.y), q(t.z)));
+                order[i] = static_cast<uint32_t>(i);
+            }
+        });
+        radix_sort sorter;
+        sorter.sort_pairs(codes.data(), order.data(), n);
+        std::vector<uint32_t>().swap(codes);
+
+        const uint32_t sh_stride = out.sh_stride();
+        out.chunks.resize((n + chunk_size - 1) / chunk_size);
+        out.positions.resize(n);
+        out.scales.resize(n);
+        out.rotations.resize(n);
+        out.colors.resize(n * 4);
+        out.shs.resize(n * sh_stride);
+
+        jobs.parallel_for(out.chunks.size(), 1, [&](const size_t begin, const size_t end)
+        {
+            std::vector<splat_record> records(chunk_size);
+            for (size_t c = begin; c < end; ++c)
+            {
+                const size_t first = c * chunk_size;
+                const size_t last = std::min(n, first + chunk_size);
+
+                compressed_gaussian_splats::chunk & bounds = out.chunks[c];
+                bounds.position_min = bounds.log_scale_min = float3(std::numeric_limits<float>::max());
+                bounds.position_max = bounds.log_scale_max = float3(std::numeric_limits<float>::lowest());
+                bounds.sh_range = 0.f;
+
+                for (size_t i = first; i < last; ++i)
+                {
+                    splat_record & s = records[i - first];
+                    source.load(order[i], s);
+                    bounds.position_min = linalg::min(bounds.position_min, s.position);
+                    bounds.position_max = linalg::max(bounds.position_max, s.position);
+                    bounds.log_scale_min = linalg::min(bounds.log_scale_min, s.log_scale);
+                    bounds.log_scale_max = linalg::max(bounds.log_scale_max, s.log_scale);
+                    for (uint32_t k = 0; k < sh_stride; ++k) bounds.sh_range = std::max(bounds.sh_range, std::abs(s.shs[3 + k]));
+                }
+
+                const float sh_scale = bounds.sh_range > 0.f ? 1.f / bounds.sh_range : 0.f;
+                for (size_t i = first; i < last; ++i)
+                {
+                    const splat_record & s = records[i - first];
+                    out.positions[i] = pack_11_10_11(normalize_within(s.position, bounds.position_min, bounds.position_max));
+                    out.scales[i] = pack_11_10_11(normalize_within(s.log_scale, bounds.log_scale_min, bounds.log_scale_max));
+                    out.rotations[i] = pack_rotation(s.rotation);
+                    for (int k = 0; k < 3; ++k) out.colors[i * 4 + k] = meshopt_quantizeHalf(s.shs[k]);
+                    out.colors[i * 4 + 3] = meshopt_quantizeHalf(s.opacity);
+                    for (uint32_t k = 0; k < sh_stride; ++k) out.shs[i * sh_stride + k] = static_cast<int8_t>(meshopt_quantizeSnorm(s.shs[3 + k] * sh_scale, 8));
+                }
+            }
+        });
+
+        return out;
+    }
+
+} // end anonymous namespace
+
+size_t gaussian_splat_scene::memory_bytes() const
+{
+    return positions.size() * sizeof(float3) + scales.size() * sizeof(float3) + opacities.size() * sizeof(float) +
+        rotations.size() * sizeof(float4) + shs.size() * sizeof(float);
+}
+
+size_t compressed_gaussian_splats::memory_bytes() const
+{
+    return chunks.size() * sizeof(chunk) + (positions.size() + scales.size() + rotations.size()) * sizeof(uint32_t) +
+        colors.size() * sizeof(uint16_t) + shs.size() * sizeof(int8_t);
+}
+
+float3 compressed_gaussian_splats::position(const size_t i) const
+{
+    const chunk & c = chunks[i / chunk_size];
+    return c.position_min + unpack_11_10_11(positions[i]) * (c.position_max - c.position_min);
+}
+
+void compressed_gaussian_splats::decode(const size_t i, gaussian_vertex & out) const
+{
+    const chunk & c = chunks[i / chunk_size];
+    const float3 log_scale = c.log_scale_min + unpack_11_10_11(scales[i]) * (c.log_scale_max - c.log_scale_min);
+
+    out.position = float4(position(i), 1.f);
+    out.scale_opacity = float4(std::exp(log_scale.x), std::exp(log_scale.y), std::exp(log_scale.z), half_to_float(colors[i * 4 + 3]));
+    out.rotation = unpack_rotation(rotations[i]);
+
+    std::memset(out.shs, 0, sizeof(out.shs));
+    for (int k = 0; k < 3; ++k) out.shs[k] = half_to_float(colors[i * 4 + k]);
+    const uint32_t stride = sh_stride();
+    const float sh_scale = c.sh_range / 127.f;
+    for (uint32_t k = 0; k < stride; ++k) out.shs[3 + k] = shs[i * stride + k] * sh_scale;
+}
+
+gaussian_splat_scene compressed_gaussian_splats::decompress() const
+{
+    gaussian_splat_scene scene;
+    scene.sh_degree = sh_degree;
+    scene.positions.resize(count);
+    scene.scales.resize(count);
+    scene.opacities.resize(count);
+    scene.rotations.resize(count);
+    scene.shs.resize(count * scene.sh_stride());
+
+    const uint32_t stride = scene.sh_stride();
+    default_job_system().parallel_for(count, kSplatsPerJob, [&](const size_t begin, const size_t end)
+    {
+        gaussian_vertex v;
+        for (size_t i = begin; i < end; ++i)
+        {
+            decode(i, v);
+            scene.positions[i] = v.position.xyz();
+            scene.scales[i] = v.scale_opacity.xyz();
+            scene.opacities[i] = v.scale_opacity.w;
+            scene.rotations[i] = v.rotation;
+            std::memcpy(scene.shs.data() + i * stride, v.shs, stride * sizeof(float));
+        }
+    });
+    return scene;
+}
+
+bool polymer::is_gaussian_splat_ply(const std::string & path)
+{
+    try
+    {
+        memory_mapped_file file(path);
+        const splat_layout layout = parse_splat_layout(file.data(), file.size());
+        return layout.dc[0].present;
+    }
+    catch (const std::exception &)
+    {
+        return false;
+    }
+}
+
+gaussian_splat_scene polymer::import_gaussian_splat_ply(const std::string & path)
+{
+    gaussian_splat_scene scene;
+
+    try
+    {
+        memory_mapped_file file(path);
+        const splat_layout layout = parse_splat_layout(file.data(), file.size());
+        file.prefetch();
+
+        const size_t n = layout.count;
+        scene.sh_degree = layout.sh_degree;
+        scene.positions.resize(n);
+        scene.scales.resize(n);
+        scene.opacities.resize(n);
+        scene.rotations.resize(n);
+        scene.shs.resize(n * scene.sh_stride());
+
+        const ply_splat_source source { layout };
+        const uint32_t stride = scene.sh_stride();
+        default_job_system().parallel_for(n, kSplatsPerJob, [&](const size_t begin, const size_t end)
+        {
+            splat_record s;
+            for (size_t i = begin; i < end; ++i)
+            {
+                source.load(i, s);
+                scene.positions[i] = s.position;
+                scene.scales[i] = float3(std::exp(s.log_scale.x), std::exp(s.log_scale.y), std::exp(s.log_scale.z));
+                scene.opacities[i] = s.opacity;
+                scene.rotations[i] = s.rotation;
+                std::memcpy(scene.shs.data() + i * stride, s.shs, stride * sizeof(float));
+            }
+        });
+
+        std::cout << "Loaded gaussian splat: " << n << " gaussians, SH degree " << scene.sh_degree << std::endl;
+    }
+    catch (const std::exception & e)
+    {
+        std::cerr << "Failed to load gaussian splat: " << e.what() << std::endl;
+        scene = {};
+    }
+
+    return scene;
+}
+
+compressed_gaussian_splats polymer::import_gaussian_splat_ply_compressed(const std::string & path)
+{
+    compressed_gaussian_splats splats;
+
+    try
+    {
+        memory_mapped_file file(path);
+        const splat_layout layout = parse_splat_layout(file.data(), file.size());
+        file.prefetch();
+
+        splats = compress_splats(ply_splat_source { layout });
+        std::cout << "Loaded gaussian splat: " << splats.size() << " gaussians, SH degree " << splats.sh_degree << " (compressed)" << std::endl;
+    }
+    catch (const std::exception & e)
+    {
+        std::cerr << "Failed to load gaussian splat: " << e.what() << std::endl;
+        splats = {};
+    }
+
+    return splats;
+}
+
+compressed_gaussian_splats polymer::compress_gaussian_splats(const gaussian_splat_scene & scene)
+{
+    return compress_splats(scene_splat_source { scene });
+}
+
+void polymer::pack_gaussian_vertices(const gaussian_splat_scene & scene, gaussian_vertex * out)
+{
+    const uint32_t stride = scene.sh_stride();
+    default_job_system().parallel_for(scene.size(), kSplatsPerJob, [&](const size_t begin, const size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            gaussian_vertex & v = out[i];
+            v.position = float4(scene.positions[i], 1.f);
+            v.scale_opacity = float4(scene.scales[i], scene.opacities[i]);
+            v.rotation = scene.rotations[i];
+            std::memcpy(v.shs, scene.shs.data() + i * stride, stride * sizeof(float));
+            std::memset(v.shs + stride, 0, (48 - stride) * sizeof(float));
+        }
+    });
+}
+
+void polymer::pack_gaussian_vertices(const compressed_gaussian_splats & splats, gaussian_vertex * out)
+{
+    default_job_system().parallel_for(splats.size(), kSplatsPerJob, [&](const size_t begin, const size_t end)
+    {
+        for (size_t i = begin; i < end; ++i) splats.decode(i, out[i]);
+    });
+}
@@ -1,16 +1,27 @@
 #include "polymer-model-io/gltf-io.hpp"
 #include "polymer-core/util/file-io.hpp"
 #include "polymer-core/util/string-utils.hpp"
+#include "polymer-core/util/memory-mapped-file.hpp"
+#include "polymer-core/util/job-system.hpp"
 
 #define CGLTF_IMPLEMENTATION
 #include "cgltf/cgltf.h"
 
+#include "meshoptimizer/meshoptimizer.h"
+
 #include <iostream>
 #include <fstream>
 #include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <type_traits>
 
 using namespace polymer;
 
+// Pointer differences against the cgltf arrays, so every lookup is O(1)
 inline int32_t find_node_index(const cgltf_data * data, const cgltf_node * node)
 {
     if (!node) return -1;
@@ -41,49 +52,356 @@ inline int32_t find_mesh_index(const cgltf_data * data, const cgltf_mesh * mesh)
     return static_cast<int32_t>(mesh - data->meshes);
 }
 
-inline std::vector<float2> extract_vec2_accessor(const cgltf_accessor * accessor)
+//////////////////////////////
+//   Memory mapped loading  //
+//////////////////////////////
+
+// cgltf file callbacks that memory map the .gltf/.glb and any external buffers instead of reading
+// them into heap copies. The GLB binary chunk and external .bin files are then used in place and
+// only the pages that accessors touch are ever read.
+struct gltf_mapped_files
 {
-    std::vector<float2> result;
-    if (!accessor) return result;
+    std::vector<std::unique_ptr<memory_mapped_file>> files;
+};
 
-    result.resize(accessor->count);
-    cgltf_accessor_unpack_floats(accessor, reinterpret_cast<float *>(result.data()), accessor->count * 2);
-    return result;
+static cgltf_result gltf_map_file(const cgltf_memory_options *, const cgltf_file_options * file_options, const char * path, cgltf_size * size, void ** data)
+{
+    auto * mapped = static_cast<gltf_mapped_files *>(file_options->user_data);
+    try
+    {
+        auto file = std::make_unique<memory_mapped_file>(path);
+        *size = file->size();
+        *data = const_cast<uint8_t *>(file->data()); // cgltf only reads through this pointer
+        mapped->files.push_back(std::move(file));
+        return cgltf_result_success;
+    }
+    catch (const std::exception &)
+    {
+        return cgltf_result_file_not_found;
+    }
 }
 
-inline std::vector<float3> extract_vec3_accessor(const cgltf_accessor * accessor)
+static void gltf_unmap_file(const cgltf_memory_options *, const cgltf_file_options * file_options, void * data, cgltf_size)
 {
-    std::vector<float3> result;
-    if (!accessor) return result;
+    auto & files = static_cast<gltf_mapped_files *>(file_options->user_data)->files;
+    for (auto it = files.begin(); it != files.end(); ++it)
+    {
+        if ((*it)->data() == data) { files.erase(it); return; }
+    }
+}
 
-    result.resize(accessor->count);
-    cgltf_accessor_unpack_floats(accessor, reinterpret_cast<float *>(result.data()), accessor->count * 3);
+///////////////////////////////////
+//   EXT_meshopt_compression     //
+///////////////////////////////////
+
+// The attribute and triangle codecs are meshoptimizer's own; the index sequence codec and the filters
+// are small enough to live here, following the extension specification.
+
+static unsigned int meshopt_decode_vbyte(const unsigned char *& data)
+{
+    unsigned char lead = *data++;
+    if (lead < 128) return lead;
+
+    unsigned int result = lead & 127;
+    unsigned int shift = 7;
+    for (int i = 0; i < 4; ++i)
+    {
+        unsigned char group = *data++;
+        result |= unsigned(group & 127) << shift;
+        shift += 7;
+        if (group < 128) break;
+    }
     return result;
 }
 
-inline std::vector<float4> extract_vec4_accessor(const cgltf_accessor * accessor)
+// Mode INDICES: zigzag deltas against one of two running baselines
+static int meshopt_decode_index_sequence(void * destination, const size_t index_count, const size_t index_size, const unsigned char * buffer, const size_t buffer_size)
+{
+    if (buffer_size < 1 + index_count + 4) return -2;
+    if ((buffer[0] & 0xf0) != 0xd0 || (buffer[0] & 0x0f) > 1) return -1;
+
+    const unsigned char * data = buffer + 1;
+    const unsigned char * data_safe_end = buffer + buffer_size - 4;
+    unsigned int last[2] = { 0, 0 };
+
+    for (size_t i = 0; i < index_count; ++i)
+    {
+        if (data >= data_safe_end) return -2;
+
+        unsigned int v = meshopt_decode_vbyte(data);
+        const unsigned int baseline = v & 1;
+        v >>= 1;
+        const unsigned int index = last[baseline] + ((v >> 1) ^ (0u - (v & 1)));
+        last[baseline] = index;
+
+        if (index_size == 2) static_cast<uint16_t *>(destination)[i] = static_cast<uint16_t>(index);
+        else static_cast<uint32_t *>(destination)[i] = index;
+    }
+
+    return (data == data_safe_end) ? 0 : -3;
+}
+
+// Octahedral filter: x, y and a z that encodes 1.0 are turned back into a unit vector; the fourth component is kept
+template <typename T>
+static void meshopt_decode_oct_filter(T * data, const size_t count)
+{
+    const float max = float((1 << (sizeof(T) * 8 - 1)) - 1);
+    for (size_t i = 0; i < count; ++i)
+    {
+        float x = float(data[i * 4 + 0]);
+        float y = float(data[i * 4 + 1]);
+        const float z = float(data[i * 4 + 2]) - std::fabs(x) - std::fabs(y);
+
+        const float t = (z >= 0.f) ? 0.f : z;
+        x += (x >= 0.f) ? t : -t;
+        y += (y >= 0.f) ? t : -t;
+
+        const float s = max / std::sqrt(x * x + y * y + z * z);
+        data[i * 4 + 0] = T(int(x * s + (x >= 0.f ? 0.5f : -0.5f)));
+        data[i * 4 + 1] = T(int(y * s + (y >= 0.f ? 0.5f : -0.5f)));
+        data[i * 4 + 2] = T(int(z * s + (z >= 0.f ? 0.5f : -0.5f)));
+    }
+}
+
+// Quaternion filter: three components scaled by 1/sqrt(2), the largest one rebuilt, its index in the low bits of w
+static void meshopt_decode_quat_filter(int16_t * data, const size_t count)
+{
+    const float scale = 1.f / std::sqrt(2.f);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const int sf = data[i * 4 + 3] | 3;
+        const float ss = scale / float(sf);
+
+        const float x = float(data[i * 4 + 0]) * ss;
+        const float y = float(data[i * 4 + 1]) * ss;
+        const float z = float(data[i * 4 + 2]) * ss;
+        const float ww = 1.f - x * x - y * y - z * z;
+        const float w = std::sqrt(ww >= 0.f ? ww : 0.f);
+
+        const int qc = data[i * 4 + 3] & 3;
+        data[i * 4 + ((qc + 1) & 3)] = int16_t(int(x * 32767.f + (x >= 0.f ? 0.5f : -0.5f)));
+        data[i * 4 + ((qc + 2) & 3)] = int16_t(int(y * 32767.f + (y >= 0.f ? 0.5f : -0.5f)));
+        data[i * 4 + ((qc + 3) & 3)] = int16_t(int(z * 32767.f + (z >= 0.f ? 0.5f : -0.5f)));
+        data[i * 4 + ((qc + 0) & 3)] = int16_t(int(w * 32767.f + 0.5f));
+    }
+}
+
+// Exponential filter: 24 bit signed mantissa and 8 bit signed exponent per 32 bit float
+static void meshopt_decode_exp_filter(uint32_t * data, const size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        const int32_t m = int32_t(data[i] << 8) >> 8;
+        const int32_t e = int32_t(data[i]) >> 24;
+        const float f = std::ldexp(float(m), e);
+        std::memcpy(&data[i], &f, sizeof(float));
+    }
+}
+
+// Decodes into a buffer owned by the view (cgltf_free releases view->data), which cgltf_buffer_view_data
+// then prefers over the uncompressed fallback buffer
+static bool gltf_decode_meshopt_view(cgltf_buffer_view & view)
 {
-    std::vector<float4> result;
+    const cgltf_meshopt_compression & mc = view.meshopt_compression;
+    if (!mc.buffer || !mc.buffer->data) return false;
+
+    const unsigned char * source = static_cast<const unsigned char *>(mc.buffer->data) + mc.offset;
+    void * decoded = std::malloc(mc.count * mc.stride);
+    if (!decoded) return false;
+    view.data = decoded;
+
+    int result = -1;
+    switch (mc.mode)
+    {
+        case cgltf_meshopt_compression_mode_attributes: result = meshopt_decodeVertexBuffer(decoded, mc.count, mc.stride, source, mc.size); break;
+        case cgltf_meshopt_compression_mode_triangles: result = meshopt_decodeIndexBuffer(decoded, mc.count, mc.stride, source, mc.size); break;
+        case cgltf_meshopt_compression_mode_indices: result = meshopt_decode_index_sequence(decoded, mc.count, mc.stride, source, mc.size); break;
+        default: break;
+    }
+    if (result != 0) return false;
+
+    switch (mc.filter)
+    {
+        case cgltf_meshopt_compression_filter_octahedral:
+            if (mc.stride == 4) meshopt_decode_oct_filter(static_cast<int8_t *>(decoded), mc.count);
+            else meshopt_decode_oct_filter(static_cast<int16_t *>(decoded), mc.count);
+            break;
+        case cgltf_meshopt_compression_filter_quaternion: meshopt_decode_quat_filter(static_cast<int16_t *>(decoded), mc.count); break;
+        case cgltf_meshopt_compression_filter_exponential: meshopt_decode_exp_filter(static_cast<uint32_t *>(decoded), mc.count * mc.stride / 4); break;
+        default: break;
+    }
+    return true;
+}
+
+// Parsed file plus everything its buffers point into; frees the cgltf data before unmapping
+struct gltf_document
+{
+    gltf_mapped_files mapped;
+    cgltf_data * data { nullptr };
+
+    gltf_document() = default;
+    gltf_document(const gltf_document &) = delete;
+    gltf_document & operator= (const gltf_document &) = delete;
+    ~gltf_document() { if (data) cgltf_free(data); }
+
+    bool load(const std::string & path, const bool parallel)
+    {
+        cgltf_options cgltf_opts = {};
+        cgltf_opts.file.read = &gltf_map_file;
+        cgltf_opts.file.release = &gltf_unmap_file;
+        cgltf_opts.file.user_data = &mapped;
+
+        if (cgltf_parse_file(&cgltf_opts, path.c_str(), &data) != cgltf_result_success)
+        {
+            data = nullptr;
+            std::cerr << "[gltf-io] Error: Failed to parse glTF file: " << path << std::endl;
+            return false;
+        }
+
+        if (cgltf_load_buffers(&cgltf_opts, data, path.c_str()) != cgltf_result_success)
+        {
+            std::cerr << "[gltf-io] Error: Failed to load glTF buffers: " << path << std::endl;
+            return false;
+        }
+
+        std::vector<cgltf_buffer_view *> compressed;
+        for (size_t i = 0; i < data->buffer_views_count; ++i)
+        {
+            if (data->buffer_views[i].has_meshopt_compression && !data->buffer_views[i].data) compressed.push_back(&data->buffer_views[i]);
+        }
+
+        std::atomic<bool> decoded { true };
+        parallel_for(compressed.size(), parallel ? 1 : compressed.size(), [&](const size_t begin, const size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                if (!gltf_decode_meshopt_view(*compressed[i])) decoded = false;
+            }
+        });
+
+        if (!decoded)
+        {
+            std::cerr << "[gltf-io] Error: Failed to decode EXT_meshopt_compression data: " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+};
+
+///////////////////////////
+//   Accessor decoding   //
+///////////////////////////
+
+template <typename S>
+static void gltf_convert_elements(const uint8_t * src, const cgltf_accessor * accessor, const size_t in_components, float * out, const size_t out_components, const float fill)
+{
+    // KHR_mesh_quantization: unorm is c / max, snorm is max(c / max, -1), unnormalized integers are taken as is
+    float scale = 1.f;
+    if constexpr (std::is_integral<S>::value) scale = accessor->normalized ? 1.f / float(std::numeric_limits<S>::max()) : 1.f;
+    const bool clamp = accessor->normalized && std::is_signed<S>::value;
+    const size_t n = std::min(in_components, out_components);
+
+    for (size_t i = 0; i < accessor->count; ++i, src += accessor->stride, out += out_components)
+    {
+        for (size_t c = 0; c < n; ++c)
+        {
+            S v;
+            std::memcpy(&v, src + c * sizeof(S), sizeof(S));
+            const float f = float(v) * scale;
+            out[c] = (clamp && f < -1.f) ? -1.f : f;
+        }
+        for (size_t c = n; c < out_components; ++c) out[c] = fill;
+    }
+}
+
+// Reads accessor->count elements of out_components floats. Tightly packed floats are copied in bulk and
+// quantized attributes are converted in a loop specialized on the component type; components the accessor
+// lacks are set to fill (e.g. alpha for RGB colors). Sparse accessors go through cgltf.
+static void gltf_unpack_floats(const cgltf_accessor * accessor, float * out, const size_t out_components, const float fill = 0.f)
+{
+    const size_t in_components = cgltf_num_components(accessor->type);
+    const bool vector_type = accessor->type >= cgltf_type_scalar && accessor->type <= cgltf_type_vec4;
+    const uint8_t * src = (accessor->buffer_view && !accessor->is_sparse && vector_type) ? cgltf_buffer_view_data(accessor->buffer_view) : nullptr;
+
+    if (!src)
+    {
+        float element[16];
+        for (size_t i = 0; i < accessor->count; ++i, out += out_components)
+        {
+            std::fill(element, element + 16, fill);
+            cgltf_accessor_read_float(accessor, i, element, 16);
+            std::copy(element, element + out_components, out);
+        }
+        return;
+    }
+
+    src += accessor->offset;
+    if (accessor->component_type == cgltf_component_type_r_32f && in_components == out_components && accessor->stride == out_components * sizeof(float))
+    {
+        std::memcpy(out, src, accessor->count * out_components * sizeof(float));
+        return;
+    }
+
+    switch (accessor->component_type)
+    {
+        case cgltf_component_type_r_32f: gltf_convert_elements<float>(src, accessor, in_components, out, out_components, fill); break;
+        case cgltf_component_type_r_16: gltf_convert_elements<int16_t>(src, accessor, in_components, out, out_components, fill); break;
+        case cgltf_component_type_r_16u: gltf_convert_elements<uint16_t>(src, accessor, in_components, out, out_components, fill); break;
+        case cgltf_component_type_r_8: gltf_convert_elements<int8_t>(src, accessor, in_components, out, out_components, fill); break;
+        case cgltf_component_type_r_8u: gltf_convert_elements<uint8_t>(src, accessor, in_components, out, out_components, fill); break;
+        case cgltf_component_type_r_32u: gltf_convert_elements<uint32_t>(src, accessor, in_components, out, out_components, fill); break;
+        default: std::fill(out, out + accessor->count * out_components, fill); break;
+    }
+}
+
+template <typename T>
+static std::vector<T> gltf_read_floats(const cgltf_accessor * accessor, const float fill = 0.f)
+{
+    std::vector<T> result;
     if (!accessor) return result;
 
     result.resize(accessor->count);
-    cgltf_accessor_unpack_floats(accessor, reinterpret_cast<float *>(result.data()), accessor->count * 4);
+    gltf_unpack_floats(accessor, reinterpret_cast<float *>(result.data()), sizeof(T) / sizeof(float), fill);
     return result;
 }
 
-inline std::vector<int4> extract_ivec4_accessor(const cgltf_accessor * accessor)
+template <typename S>
+static void gltf_widen_elements(const uint8_t * src, const size_t stride, const size_t components, uint32_t * out, const size_t count)
 {
-    std::vector<int4> result;
-    if (!accessor) return result;
+    for (size_t i = 0; i < count; ++i, src += stride, out += components)
+    {
+        for (size_t c = 0; c < components; ++c)
+        {
+            S v;
+            std::memcpy(&v, src + c * sizeof(S), sizeof(S));
+            out[c] = v;
+        }
+    }
+}
 
-    result.resize(accessor->count);
-    for (size_t i = 0; i < accessor->count; ++i)
+// Unsigned integer elements (indices, joints) widened to 32 bits; a memcpy when they already are
+static void gltf_unpack_uints(const cgltf_accessor * accessor, uint32_t * out, const size_t count) // count elements
+{
+    const size_t components = cgltf_num_components(accessor->type);
+    const uint8_t * src = (accessor->buffer_view && !accessor->is_sparse) ? cgltf_buffer_view_data(accessor->buffer_view) : nullptr;
+
+    if (!src)
     {
-        cgltf_uint out[4] = {0, 0, 0, 0};
-        cgltf_accessor_read_uint(accessor, i, out, 4);
-        result[i] = int4(static_cast<int>(out[0]), static_cast<int>(out[1]), static_cast<int>(out[2]), static_cast<int>(out[3]));
+        for (size_t i = 0; i < count; ++i) cgltf_accessor_read_uint(accessor, i, out + i * components, components);
+        return;
+    }
+
+    src += accessor->offset;
+    switch (accessor->component_type)
+    {
+        case cgltf_component_type_r_8u: gltf_widen_elements<uint8_t>(src, accessor->stride, components, out, count); break;
+        case cgltf_component_type_r_16u: gltf_widen_elements<uint16_t>(src, accessor->stride, components, out, count); break;
+        case cgltf_component_type_r_32u:
+            if (accessor->stride == components * sizeof(uint32_t)) std::memcpy(out, src, count * components * sizeof(uint32_t));
+            else gltf_widen_elements<uint32_t>(src, accessor->stride, components, out, count);
+            break;
+        default: std::fill(out, out + count * components, 0u); break;
     }
-    return result;
 }
 
 inline std::vector<uint3> extract_indices(const cgltf_accessor * accessor)
@@ -91,19 +409,31 @@ inline std::vector<uint3> extract_indices(const cgltf_accessor * accessor)
     std::vector<uint3> result;
     if (!accessor) return result;
 
-    size_t num_triangles = accessor->count / 3;
-    result.resize(num_triangles);
+    result.resize(accessor->count / 3);
+    gltf_unpack_uints(accessor, reinterpret_cast<uint32_t *>(result.data()), result.size() * 3);
+    return result;
+}
 
-    for (size_t i = 0; i < num_triangles; ++i)
-    {
-        result[i].x = static_cast<uint32_t>(cgltf_accessor_read_index(accessor, i * 3 + 0));
-        result[i].y = static_cast<uint32_t>(cgltf_accessor_read_index(accessor, i * 3 + 1));
-        result[i].z = static_cast<uint32_t>(cgltf_accessor_read_index(accessor, i * 3 + 2));
-    }
+inline std::vector<int4> extract_joints(const cgltf_accessor * accessor)
+{
+    std::vector<int4> result;
+    if (!accessor || accessor->type != cgltf_type_vec4) return result;
 
+    result.resize(accessor->count);
+    gltf_unpack_uints(accessor, reinterpret_cast<uint32_t *>(result.data()), result.size());
     return result;
 }
 
+inline float4x4 float4x4_from_column_major(const float * m)
+{
+    return float4x4(
+        {m[0], m[1], m[2], m[3]},
+        {m[4], m[5], m[6], m[7]},
+        {m[8], m[9], m[10], m[11]},
+        {m[12], m[13], m[14], m[15]}
+    );
+}
+
 inline float4x4 get_node_local_transform(const cgltf_node * node)
 {
     float matrix[16];
@@ -239,8 +569,7 @@ inline runtime_mesh gltf_load_primitive(const cgltf_primitive * prim)
         return mesh;
     }
 
-    // Store tangent vec4 temporarily (w is handedness for bitangent computation)
-    std::vector<float4> tangents_vec4;
+    const cgltf_accessor * tangent_accessor = nullptr;
 
     for (size_t i = 0; i < prim->attributes_count; ++i)
     {
@@ -248,63 +577,37 @@ inline runtime_mesh gltf_load_primitive(const cgltf_primitive * prim)
 
         switch (attr->type)
         {
-            case cgltf_attribute_type_position:
-                mesh.vertices = extract_vec3_accessor(attr->data);
-                break;
-
-            case cgltf_attribute_type_normal:
-                mesh.normals = extract_vec3_accessor(attr->data);
-                break;
-
-            case cgltf_attribute_type_tangent:
-            {
-                // glTF tangents are vec4 where XYZ is the tangent direction and W is the handedness
-                // Store the full vec4 so we can compute bitangents after normals are loaded
-                tangents_vec4 = extract_vec4_accessor(attr->data);
-                mesh.tangents.resize(tangents_vec4.size());
-                for (size_t j = 0; j < tangents_vec4.size(); ++j)
-                {
-                    mesh.tangents[j] = float3(tangents_vec4[j].x, tangents_vec4[j].y, tangents_vec4[j].z);
-                }
-                break;
-            }
+            case cgltf_attribute_type_position: mesh.vertices = gltf_read_floats<float3>(attr->data); break;
+            case cgltf_attribute_type_normal: mesh.normals = gltf_read_floats<float3>(attr->data); break;
+            case cgltf_attribute_type_tangent: tangent_accessor = attr->data; break;
 
             case cgltf_attribute_type_texcoord:
-                if (attr->index == 0)
-                {
-                    mesh.texcoord0 = extract_vec2_accessor(attr->data);
-                }
-                else if (attr->index == 1)
-                {
-                    mesh.texcoord1 = extract_vec2_accessor(attr->data);
-                }
+                if (attr->index == 0) mesh.texcoord0 = gltf_read_floats<float2>(attr->data);
+                else if (attr->index == 1) mesh.texcoord1 = gltf_read_floats<float2>(attr->data);
                 break;
 
+            // RGB colors are opaque
             case cgltf_attribute_type_color:
-            {
-                std::vector<float4> colors_rgba = extract_vec4_accessor(attr->data);
-                mesh.colors.resize(colors_rgba.size());
-                for (size_t j = 0; j < colors_rgba.size(); ++j)
-                {
-                    mesh.colors[j] = colors_rgba[j];
-                }
+                if (attr->index == 0) mesh.colors = gltf_read_floats<float4>(attr->data, 1.f);
                 break;
-            }
 
             default:
                 break;
         }
     }
 
-    // Compute bitangents from normals and tangents (with handedness from w component)
-    // Bitangent = cross(normal, tangent) * handedness
-    if (!tangents_vec4.empty() && mesh.normals.size() == tangents_vec4.size())
+    // glTF tangents are vec4 where xyz is the tangent direction and w the handedness of the
+    // bitangent: cross(normal, tangent) * w
+    if (tangent_accessor)
     {
-        mesh.bitangents.resize(tangents_vec4.size());
-        for (size_t j = 0; j < tangents_vec4.size(); ++j)
+        const std::vector<float4> tangents = gltf_read_floats<float4>(tangent_accessor);
+        mesh.tangents.resize(tangents.size());
+        for (size_t j = 0; j < tangents.size(); ++j) mesh.tangents[j] = tangents[j].xyz;
+
+        if (mesh.normals.size() == tangents.size())
         {
-            float3 bitangent = cross(mesh.normals[j], mesh.tangents[j]) * tangents_vec4[j].w;
-            mesh.bitangents[j] = bitangent;
+            mesh.bitangents.resize(tangents.size());
+            for (size_t j = 0; j < tangents.size(); ++j) mesh.bitangents[j] = cross(mesh.normals[j], mesh.tangents[j]) * tangents[j].w;
         }
     }
 
@@ -316,22 +619,53 @@ inline runtime_mesh gltf_load_primitive(const cgltf_primitive * prim)
     return mesh;
 }
 
-inline runtime_skinned_mesh gltf_load_skinned_primitive(const cgltf_data * data, const cgltf_primitive * prim, const cgltf_skin * skin)
+// Joint index per node (-1 for nodes outside the skin) so parent and channel target lookups are O(1)
+inline std::vector<int32_t> gltf_joint_lookup(const cgltf_data * data, const cgltf_skin * skin)
+{
+    std::vector<int32_t> lookup(data->nodes_count, -1);
+    if (skin)
+    {
+        for (size_t j = 0; j < skin->joints_count; ++j) lookup[find_node_index(data, skin->joints[j])] = static_cast<int32_t>(j);
+    }
+    return lookup;
+}
+
+inline std::vector<bone> gltf_load_skeleton(const cgltf_data * data, const cgltf_skin * skin, const std::vector<int32_t> & joint_lookup)
+{
+    std::vector<bone> bones;
+    if (!skin) return bones;
+
+    std::vector<float4x4> inverse_bind_matrices;
+    if (skin->inverse_bind_matrices) inverse_bind_matrices = gltf_read_floats<float4x4>(skin->inverse_bind_matrices);
+
+    bones.resize(skin->joints_count);
+    for (size_t i = 0; i < skin->joints_count; ++i)
+    {
+        bone & b = bones[i];
+        const cgltf_node * joint = skin->joints[i];
+
+        if (joint->name) b.name = joint->name;
+        b.parentIndex = 0xFFFFFFFF;
+        if (joint->parent && joint_lookup[find_node_index(data, joint->parent)] >= 0)
+        {
+            b.parentIndex = static_cast<uint32_t>(joint_lookup[find_node_index(data, joint->parent)]);
+        }
+
+        b.initialPose = get_node_world_transform(joint);
+        if (i < inverse_bind_matrices.size()) b.bindPose = inverse_bind_matrices[i];
+    }
+
+    return bones;
+}
+
+inline runtime_skinned_mesh gltf_load_skinned_primitive(const cgltf_primitive * prim, const std::vector<bone> & skeleton)
 {
     runtime_skinned_mesh mesh;
 
     if (!prim) return mesh;
 
     runtime_mesh base_mesh = gltf_load_primitive(prim);
-    mesh.vertices = std::move(base_mesh.vertices);
-    mesh.normals = std::move(base_mesh.normals);
-    mesh.tangents = std::move(base_mesh.tangents);
-    mesh.bitangents = std::move(base_mesh.bitangents);
-    mesh.texcoord0 = std::move(base_mesh.texcoord0);
-    mesh.texcoord1 = std::move(base_mesh.texcoord1);
-    mesh.colors = std::move(base_mesh.colors);
-    mesh.faces = std::move(base_mesh.faces);
-    mesh.material = std::move(base_mesh.material);
+    static_cast<runtime_mesh &>(mesh) = std::move(base_mesh);
 
     for (size_t i = 0; i < prim->attributes_count; ++i)
     {
@@ -339,57 +673,20 @@ inline runtime_skinned_mesh gltf_load_skinned_primitive(const cgltf_data * data,
 
         if (attr->type == cgltf_attribute_type_joints && attr->index == 0)
         {
-            mesh.boneIndices = extract_ivec4_accessor(attr->data);
+            mesh.boneIndices = extract_joints(attr->data);
         }
         else if (attr->type == cgltf_attribute_type_weights && attr->index == 0)
         {
-            mesh.boneWeights = extract_vec4_accessor(attr->data);
+            mesh.boneWeights = gltf_read_floats<float4>(attr->data);
         }
     }
 
-    if (skin)
-    {
-        mesh.bones.resize(skin->joints_count);
-        for (size_t i = 0; i < skin->joints_count; ++i)
-        {
-            bone & b = mesh.bones[i];
-            const cgltf_node * joint = skin->joints[i];
-
-            if (joint->name) b.name = joint->name;
-            b.parentIndex = 0xFFFFFFFF;
-
-            if (joint->parent)
-            {
-                for (size_t j = 0; j < skin->joints_count; ++j)
-                {
-                    if (skin->joints[j] == joint->parent)
-                    {
-                        b.parentIndex = static_cast<uint32_t>(j);
-                        break;
-                    }
-                }
-            }
-
-            b.initialPose = get_node_world_transform(joint);
-
-            if (skin->inverse_bind_matrices)
-            {
-                float ibm[16];
-                cgltf_accessor_read_float(skin->inverse_bind_matrices, i, ibm, 16);
-                b.bindPose = float4x4(
-                    {ibm[0], ibm[1], ibm[2], ibm[3]},
-                    {ibm[4], ibm[5], ibm[6], ibm[7]},
-                    {ibm[8], ibm[9], ibm[10], ibm[11]},
-                    {ibm[12], ibm[13], ibm[14], ibm[15]}
-                );
-            }
-        }
-    }
+    mesh.bones = skeleton;
 
     return mesh;
 }
 
-inline skeletal_animation gltf_load_animation(const cgltf_data * data, const cgltf_animation * anim, const cgltf_skin * skin)
+inline skeletal_animation gltf_load_animation(const cgltf_data * data, const cgltf_animation * anim, const cgltf_skin * skin, const std::vector<int32_t> & joint_lookup)
 {
     skeletal_animation result;
 
@@ -397,106 +694,82 @@ inline skeletal_animation gltf_load_animation(const cgltf_data * data, const cgl
 
     if (anim->name) result.name = anim->name;
 
-    std::unordered_map<int32_t, std::shared_ptr<animation_track>> node_tracks;
+    // Tracks in order of first appearance; keyframes looked up by frame within each track
+    struct track_builder
+    {
+        std::shared_ptr<animation_track> track;
+        std::unordered_map<uint32_t, std::shared_ptr<animation_keyframe>> frames;
+    };
+    std::vector<track_builder> builders;
+    std::unordered_map<int32_t, size_t> builder_of_bone;
+
+    std::vector<float> times;
+    std::vector<float> values;
 
     for (size_t c = 0; c < anim->channels_count; ++c)
     {
         const cgltf_animation_channel * channel = &anim->channels[c];
         const cgltf_animation_sampler * sampler = channel->sampler;
 
-        if (!channel->target_node) continue;
-
-        int32_t node_idx = find_node_index(data, channel->target_node);
+        if (!channel->target_node || !sampler || !sampler->input || !sampler->output) continue;
 
-        int32_t bone_idx = -1;
-        if (skin)
-        {
-            for (size_t j = 0; j < skin->joints_count; ++j)
-            {
-                if (skin->joints[j] == channel->target_node)
-                {
-                    bone_idx = static_cast<int32_t>(j);
-                    break;
-                }
-            }
-        }
-        else
-        {
-            bone_idx = node_idx;
-        }
+        const size_t components = (channel->target_path == cgltf_animation_path_type_rotation) ? 4 :
+                                  (channel->target_path == cgltf_animation_path_type_translation || channel->target_path == cgltf_animation_path_type_scale) ? 3 : 0;
+        if (components == 0) continue;
 
+        const int32_t node_idx = find_node_index(data, channel->target_node);
+        const int32_t bone_idx = skin ? joint_lookup[node_idx] : node_idx;
         if (bone_idx < 0) continue;
 
-        if (node_tracks.find(bone_idx) == node_tracks.end())
+        auto found = builder_of_bone.find(bone_idx);
+        if (found == builder_of_bone.end())
         {
-            auto track = std::make_shared<animation_track>();
-            track->boneIndex = static_cast<uint32_t>(bone_idx);
-            node_tracks[bone_idx] = track;
+            found = builder_of_bone.emplace(bone_idx, builders.size()).first;
+            builders.push_back({ std::make_shared<animation_track>(), {} });
+            builders.back().track->boneIndex = static_cast<uint32_t>(bone_idx);
         }
+        track_builder & builder = builders[found->second];
 
-        auto & track = node_tracks[bone_idx];
-
-        std::vector<float> times;
         times.resize(sampler->input->count);
-        cgltf_accessor_unpack_floats(sampler->input, times.data(), times.size());
+        gltf_unpack_floats(sampler->input, times.data(), 1);
+        values.resize(sampler->output->count * components);
+        gltf_unpack_floats(sampler->output, values.data(), components);
 
-        for (size_t t = 0; t < times.size(); ++t)
+        // Cubic spline outputs are (in-tangent, value, out-tangent) triplets; only the value is kept
+        const size_t value_stride = (sampler->interpolation == cgltf_interpolation_type_cubic_spline) ? 3 : 1;
+        const size_t value_offset = (value_stride == 3) ? 1 : 0;
+        const size_t key_count = std::min(times.size(), sampler->output->count / value_stride);
+
+        for (size_t t = 0; t < key_count; ++t)
         {
-            uint32_t frame_key = static_cast<uint32_t>(times[t] * 24.0f);
+            const uint32_t frame_key = static_cast<uint32_t>(times[t] * 24.0f);
 
             if (frame_key < result.startFrame) result.startFrame = frame_key;
             if (frame_key > result.endFrame) result.endFrame = frame_key;
 
-            std::shared_ptr<animation_keyframe> keyframe;
-            for (auto & kf : track->keyframes)
-            {
-                if (kf->key == frame_key)
-                {
-                    keyframe = kf;
-                    break;
-                }
-            }
-
+            std::shared_ptr<animation_keyframe> & keyframe = builder.frames[frame_key];
             if (!keyframe)
             {
                 keyframe = std::make_shared<animation_keyframe>();
                 keyframe->key = frame_key;
-                track->keyframes.push_back(keyframe);
+                builder.track->keyframes.push_back(keyframe);
             }
 
+            const float * v = &values[(t * value_stride + value_offset) * components];
             switch (channel->target_path)
             {
-                case cgltf_animation_path_type_translation:
-                {
-                    float val[3];
-                    cgltf_accessor_read_float(sampler->output, t, val, 3);
-                    keyframe->translation = float3(val[0], val[1], val[2]);
-                    break;
-                }
-                case cgltf_animation_path_type_rotation:
-                {
-                    float val[4];
-                    cgltf_accessor_read_float(sampler->output, t, val, 4);
-                    keyframe->rotation = float4(val[0], val[1], val[2], val[3]);
-                    break;
-                }
-                case cgltf_animation_path_type_scale:
-                {
-                    float val[3];
-                    cgltf_accessor_read_float(sampler->output, t, val, 3);
-                    keyframe->scale = float3(val[0], val[1], val[2]);
-                    break;
-                }
-                default:
-                    break;
+                case cgltf_animation_path_type_translation: keyframe->translation = float3(v[0], v[1], v[2]); break;
+                case cgltf_animation_path_type_rotation: keyframe->rotation = float4(v[0], v[1], v[2], v[3]); break;
+                case cgltf_animation_path_type_scale: keyframe->scale = float3(v[0], v[1], v[2]); break;
+                default: break;
             }
         }
     }
 
-    for (auto & [bone_idx, track] : node_tracks)
+    for (auto & builder : builders)
     {
-        track->keyframeCount = static_cast<uint32_t>(track->keyframes.size());
-        result.tracks.push_back(track);
+        builder.track->keyframeCount = static_cast<uint32_t>(builder.track->keyframes.size());
+        result.tracks.push_back(builder.track);
     }
 
     result.trackCount = static_cast<uint32_t>(result.tracks.size());
@@ -504,27 +777,22 @@ inline skeletal_animation gltf_load_animation(const cgltf_data * data, const cgl
     return result;
 }
 
-gltf_scene polymer::import_gltf_scene(const std::string & path, const gltf_import_options & options)
+inline bool gltf_primitive_is_skinned(const cgltf_primitive * prim)
 {
-    gltf_scene scene;
-
-    cgltf_options cgltf_opts = {};
-    cgltf_data * data = nullptr;
-
-    cgltf_result result = cgltf_parse_file(&cgltf_opts, path.c_str(), &data);
-    if (result != cgltf_result_success)
+    for (size_t a = 0; a < prim->attributes_count; ++a)
     {
-        std::cerr << "[gltf-io] Error: Failed to parse glTF file: " << path << std::endl;
-        return scene;
+        if (prim->attributes[a].type == cgltf_attribute_type_joints || prim->attributes[a].type == cgltf_attribute_type_weights) return true;
     }
+    return false;
+}
 
-    result = cgltf_load_buffers(&cgltf_opts, data, path.c_str());
-    if (result != cgltf_result_success)
-    {
-        std::cerr << "[gltf-io] Error: Failed to load glTF buffers: " << path << std::endl;
-        cgltf_free(data);
-        return scene;
-    }
+gltf_scene polymer::import_gltf_scene(const std::string & path, const gltf_import_options & options)
+{
+    gltf_scene scene;
+
+    gltf_document document;
+    if (!document.load(path, options.parallel)) return scene;
+    const cgltf_data * data = document.data;
 
     if (options.load_textures)
     {
@@ -542,6 +810,7 @@ gltf_scene polymer::import_gltf_scene(const std::string & path, const gltf_impor
         }
     }
 
+    scene.nodes.reserve(data->nodes_count);
     for (size_t i = 0; i < data->nodes_count; ++i)
     {
         const cgltf_node * node = &data->nodes[i];
@@ -571,108 +840,61 @@ gltf_scene polymer::import_gltf_scene(const std::string & path, const gltf_impor
     }
 
     const cgltf_skin * primary_skin = (data->skins_count > 0) ? &data->skins[0] : nullptr;
+    const std::vector<int32_t> joint_lookup = gltf_joint_lookup(data, primary_skin);
+    scene.skeleton = gltf_load_skeleton(data, primary_skin, joint_lookup);
 
+    // Every primitive gets its output slot up front so they can be decoded in any order
+    struct primitive_job { const cgltf_primitive * prim; bool skinned; size_t slot; };
+    std::vector<primitive_job> jobs;
     for (size_t m = 0; m < data->meshes_count; ++m)
     {
         const cgltf_mesh * mesh = &data->meshes[m];
-        std::string mesh_name = mesh->name ? mesh->name : ("mesh_" + std::to_string(m));
-
         for (size_t p = 0; p < mesh->primitives_count; ++p)
         {
             const cgltf_primitive * prim = &mesh->primitives[p];
-
-            bool has_skinning = false;
-            for (size_t a = 0; a < prim->attributes_count; ++a)
-            {
-                if (prim->attributes[a].type == cgltf_attribute_type_joints ||
-                    prim->attributes[a].type == cgltf_attribute_type_weights)
-                {
-                    has_skinning = true;
-                    break;
-                }
-            }
-
-            if (has_skinning && primary_skin)
-            {
-                gltf_skinned_primitive skinned_prim;
-                skinned_prim.mesh = gltf_load_skinned_primitive(data, prim, primary_skin);
-                skinned_prim.material_index = find_material_index(data, prim->material);
-
-                if (options.compute_normals && skinned_prim.mesh.normals.empty())
-                {
-                    compute_normals(skinned_prim.mesh);
-                }
-                if (options.compute_tangents && skinned_prim.mesh.tangents.empty())
-                {
-                    compute_tangents(skinned_prim.mesh);
-                }
-
-                scene.skinned_primitives.push_back(std::move(skinned_prim));
-            }
-            else
-            {
-                gltf_primitive gp;
-                gp.mesh = gltf_load_primitive(prim);
-                gp.material_index = find_material_index(data, prim->material);
-
-                if (options.compute_normals && gp.mesh.normals.empty())
-                {
-                    compute_normals(gp.mesh);
-                }
-                if (options.compute_tangents && gp.mesh.tangents.empty())
-                {
-                    compute_tangents(gp.mesh);
-                }
-
-                scene.primitives.push_back(std::move(gp));
-            }
+            const bool skinned = primary_skin && gltf_primitive_is_skinned(prim);
+            jobs.push_back({ prim, skinned, skinned ? scene.skinned_primitives.size() : scene.primitives.size() });
+            if (skinned) scene.skinned_primitives.emplace_back();
+            else scene.primitives.emplace_back();
         }
     }
 
-    if (primary_skin)
+    parallel_for(jobs.size(), options.parallel ? 1 : jobs.size(), [&](const size_t begin, const size_t end)
     {
-        for (size_t i = 0; i < primary_skin->joints_count; ++i)
+        for (size_t j = begin; j < end; ++j)
         {
-            bone b;
-            const cgltf_node * joint = primary_skin->joints[i];
-            if (joint->name) b.name = joint->name;
-
-            b.parentIndex = 0xFFFFFFFF;
-            if (joint->parent)
+            const primitive_job & job = jobs[j];
+            if (job.skinned)
             {
-                for (size_t j = 0; j < primary_skin->joints_count; ++j)
-                {
-                    if (primary_skin->joints[j] == joint->parent)
-                    {
-                        b.parentIndex = static_cast<uint32_t>(j);
-                        break;
-                    }
-                }
-            }
+                gltf_skinned_primitive & skinned_prim = scene.skinned_primitives[job.slot];
+                skinned_prim.mesh = gltf_load_skinned_primitive(job.prim, scene.skeleton);
+                skinned_prim.material_index = find_material_index(data, job.prim->material);
 
-            b.initialPose = get_node_world_transform(joint);
-
-            if (primary_skin->inverse_bind_matrices)
-            {
-                float ibm[16];
-                cgltf_accessor_read_float(primary_skin->inverse_bind_matrices, i, ibm, 16);
-                b.bindPose = float4x4(
-                    {ibm[0], ibm[1], ibm[2], ibm[3]},
-                    {ibm[4], ibm[5], ibm[6], ibm[7]},
-                    {ibm[8], ibm[9], ibm[10], ibm[11]},
-                    {ibm[12], ibm[13], ibm[14], ibm[15]}
-                );
+                if (options.compute_normals && skinned_prim.mesh.normals.empty()) compute_normals(skinned_prim.mesh);
+                if (options.compute_tangents && skinned_prim.mesh.tangents.empty()) compute_tangents(skinned_prim.mesh);
             }
+            else
+            {
+                gltf_primitive & gp = scene.primitives[job.slot];
+                gp.mesh = gltf_load_primitive(job.prim);
+                gp.material_index = find_material_index(data, job.prim->material);
 
-            scene.skeleton.push_back(b);
+                if (options.compute_normals && gp.mesh.normals.empty()) compute_normals(gp.mesh);
+                if (options.compute_tangents && gp.mesh.tangents.empty()) compute_tangents(gp.mesh);
+            }
         }
-    }
+    });
 
     if (options.load_animations)
     {
-        for (size_t i = 0; i < data->animations_count; ++i)
+        std::vector<skeletal_animation> animations(data->animations_count);
+        parallel_for(animations.size(), options.parallel ? 1 : animations.size(), [&](const size_t begin, const size_t end)
+        {
+            for (size_t i = begin; i < end; ++i) animations[i] = gltf_load_animation(data, &data->animations[i], primary_skin, joint_lookup);
+        });
+
+        for (auto & anim : animations)
         {
-            skeletal_animation anim = gltf_load_animation(data, &data->animations[i], primary_skin);
             if (anim.tracks.size() > 0)
             {
                 scene.animations.push_back(std::move(anim));
@@ -680,8 +902,6 @@ gltf_scene polymer::import_gltf_scene(const std::string & path, const gltf_impor
         }
     }
 
-    cgltf_free(data);
-
     return scene;
 }
 
@@ -689,24 +909,11 @@ std::unordered_map<std::string, runtime_mesh> polymer::import_gltf_model(const s
 {
     std::unordered_map<std::string, runtime_mesh> result;
 
-    cgltf_options cgltf_opts = {};
-    cgltf_data * data = nullptr;
-
-    cgltf_result cgltf_res = cgltf_parse_file(&cgltf_opts, path.c_str(), &data);
-    if (cgltf_res != cgltf_result_success)
-    {
-        std::cerr << "[gltf-io] Error: Failed to parse glTF file: " << path << std::endl;
-        return result;
-    }
-
-    cgltf_res = cgltf_load_buffers(&cgltf_opts, data, path.c_str());
-    if (cgltf_res != cgltf_result_success)
-    {
-        std::cerr << "[gltf-io] Error: Failed to load glTF buffers: " << path << std::endl;
-        cgltf_free(data);
-        return result;
-    }
+    gltf_document document;
+    if (!document.load(path, true)) return result;
+    const cgltf_data * data = document.data;
 
+    std::vector<std::pair<std::string, const cgltf_primitive *>> primitives;
     for (size_t m = 0; m < data->meshes_count; ++m)
     {
         const cgltf_mesh * mesh = &data->meshes[m];
@@ -714,25 +921,32 @@ std::unordered_map<std::string, runtime_mesh> polymer::import_gltf_model(const s
 
         for (size_t p = 0; p < mesh->primitives_count; ++p)
         {
-            const cgltf_primitive * prim = &mesh->primitives[p];
-            runtime_mesh loaded_mesh = gltf_load_primitive(prim);
-
-            if (loaded_mesh.normals.empty() && !loaded_mesh.vertices.empty())
-            {
-                compute_normals(loaded_mesh);
-            }
-
             std::string prim_name = mesh_name;
             if (mesh->primitives_count > 1)
             {
                 prim_name += "_prim" + std::to_string(p);
             }
-
-            result[prim_name] = std::move(loaded_mesh);
+            primitives.emplace_back(std::move(prim_name), &mesh->primitives[p]);
         }
     }
 
-    cgltf_free(data);
+    std::vector<runtime_mesh> meshes(primitives.size());
+    parallel_for(primitives.size(), 1, [&](const size_t begin, const size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            meshes[i] = gltf_load_primitive(primitives[i].second);
+            if (meshes[i].normals.empty() && !meshes[i].vertices.empty())
+            {
+                compute_normals(meshes[i]);
+            }
+        }
+    });
+
+    for (size_t i = 0; i < primitives.size(); ++i)
+    {
+        result[primitives[i].first] = std::move(meshes[i]);
+    }
 
     return result;
 }
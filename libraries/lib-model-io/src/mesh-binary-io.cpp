@@ -0,0 +1,473 @@
+#include "polymer-model-io/mesh-binary-io.hpp"
+#include "polymer-model-io/model-io-util.hpp"
+#include "polymer-core/util/job-system.hpp"
+
+#include "meshoptimizer/meshoptimizer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+using namespace polymer;
+
+namespace
+{
+    struct section_payload
+    {
+        runtime_mesh_binary_section header;
+        std::vector<uint8_t> bytes;
+    };
+
+    // Element size of each section as handed out by mapped_mesh
+    size_t runtime_stride(const mesh_section s)
+    {
+        switch (s)
+        {
+            case mesh_section::colors: return sizeof(float4);
+            case mesh_section::texcoord0:
+            case mesh_section::texcoord1: return sizeof(float2);
+            case mesh_section::faces: return sizeof(uint3);
+            case mesh_section::material:
+            case mesh_section::meshlet_vertices:
+            case mesh_section::meshlet_triangles: return sizeof(uint32_t);
+            case mesh_section::meshlets: return sizeof(mesh_meshlet);
+            default: return sizeof(float3);
+        }
+    }
+
+    bool per_vertex(const mesh_section s) { return s < mesh_section::faces; }
+
+    uint64_t align_up(const uint64_t value, const uint64_t alignment) { return (value + alignment - 1) / alignment * alignment; }
+
+    template <typename T>
+    section_payload make_raw(const mesh_section type, const uint32_t level, const T * data, const size_t count, const mesh_component_format format)
+    {
+        section_payload p;
+        p.header.type = uint32_t(type);
+        p.header.level = level;
+        p.header.format = uint32_t(format);
+        p.header.count = static_cast<uint32_t>(count);
+        p.header.stride = sizeof(T);
+        p.header.components = sizeof(T) / 4;
+        p.bytes.resize(count * sizeof(T));
+        if (count) std::memcpy(p.bytes.data(), data, p.bytes.size());
+        return p;
+    }
+
+    // Quantizes `components` floats per element into 16-bit values padded to an even component count,
+    // which keeps the stored stride a multiple of 4 as the meshopt vertex codec requires
+    section_payload make_quantized(const mesh_section type, const float * data, const size_t count, const uint32_t components, const mesh_component_format format)
+    {
+        const uint32_t stored_components = (components + 1) & ~1u;
+
+        section_payload p;
+        p.header.type = uint32_t(type);
+        p.header.format = uint32_t(format);
+        p.header.count = static_cast<uint32_t>(count);
+        p.header.stride = stored_components * sizeof(uint16_t);
+        p.header.components = components;
+        p.bytes.resize(count * p.header.stride, 0);
+
+        if (format == mesh_component_format::unorm16)
+        {
+            float lo[4] = { 0, 0, 0, 0 }, hi[4] = { 0, 0, 0, 0 };
+            for (uint32_t c = 0; c < components; ++c)
+            {
+                lo[c] = hi[c] = count ? data[c] : 0.f;
+                for (size_t i = 1; i < count; ++i)
+                {
+                    lo[c] = std::min(lo[c], data[i * components + c]);
+                    hi[c] = std::max(hi[c], data[i * components + c]);
+                }
+                p.header.bias[c] = lo[c];
+                p.header.scale[c] = hi[c] - lo[c];
+            }
+
+            uint16_t * out = reinterpret_cast<uint16_t *>(p.bytes.data());
+            for (size_t i = 0; i < count; ++i)
+            {
+                for (uint32_t c = 0; c < components; ++c)
+                {
+                    const float range = p.header.scale[c];
+                    const float t = range > 0.f ? (data[i * components + c] - lo[c]) / range : 0.f;
+                    out[i * stored_components + c] = static_cast<uint16_t>(meshopt_quantizeUnorm(t, 16));
+                }
+            }
+        }
+        else
+        {
+            uint16_t * out = reinterpret_cast<uint16_t *>(p.bytes.data());
+            for (size_t i = 0; i < count; ++i)
+            {
+                for (uint32_t c = 0; c < components; ++c)
+                {
+                    const float v = data[i * components + c];
+                    out[i * stored_components + c] = (format == mesh_component_format::snorm16) ? static_cast<uint16_t>(int16_t(meshopt_quantizeSnorm(v, 16))) : meshopt_quantizeHalf(v);
+                }
+            }
+        }
+
+        return p;
+    }
+
+    void compress(section_payload & p)
+    {
+        if (p.header.count == 0) return;
+
+        std::vector<uint8_t> encoded;
+        if (mesh_section(p.header.type) == mesh_section::faces)
+        {
+            const size_t index_count = size_t(p.header.count) * 3;
+            uint32_t max_index = 0;
+            const uint32_t * indices = reinterpret_cast<const uint32_t *>(p.bytes.data());
+            for (size_t i = 0; i < index_count; ++i) max_index = std::max(max_index, indices[i]);
+
+            encoded.resize(meshopt_encodeIndexBufferBound(index_count, size_t(max_index) + 1));
+            encoded.resize(meshopt_encodeIndexBuffer(encoded.data(), encoded.size(), indices, index_count));
+            p.header.encoding = uint32_t(mesh_section_encoding::meshopt_index);
+        }
+        else
+        {
+            encoded.resize(meshopt_encodeVertexBufferBound(p.header.count, p.header.stride));
+            encoded.resize(meshopt_encodeVertexBuffer(encoded.data(), encoded.size(), p.bytes.data(), p.header.count, p.header.stride));
+            p.header.encoding = uint32_t(mesh_section_encoding::meshopt_vertex);
+        }
+
+        p.bytes = std::move(encoded);
+    }
+}
+
+void polymer::export_polymer_binary_model(const std::string & path, const runtime_mesh & mesh, bool compressed)
+{
+    mesh_export_options options;
+    options.compress = compressed;
+    export_polymer_binary_model(path, mesh, options);
+}
+
+void polymer::export_polymer_binary_model(const std::string & path, const runtime_mesh & mesh, const mesh_export_options & options, const std::vector<mesh_lod> * lods)
+{
+    std::vector<section_payload> sections;
+
+    const auto add_floats = [&](const mesh_section type, const float * data, const size_t count, const uint32_t components, const mesh_component_format quantized)
+    {
+        if (count == 0) return;
+        if (options.quantize)
+        {
+            sections.push_back(make_quantized(type, data, count, components, quantized));
+        }
+        else
+        {
+            sections.push_back(make_raw(type, 0, data, count * components, mesh_component_format::float32));
+            sections.back().header.count = static_cast<uint32_t>(count);
+            sections.back().header.stride = components * sizeof(float);
+            sections.back().header.components = components;
+        }
+    };
+
+    add_floats(mesh_section::vertices, reinterpret_cast<const float *>(mesh.vertices.data()), mesh.vertices.size(), 3, mesh_component_format::unorm16);
+    add_floats(mesh_section::normals, reinterpret_cast<const float *>(mesh.normals.data()), mesh.normals.size(), 3, mesh_component_format::snorm16);
+    add_floats(mesh_section::colors, reinterpret_cast<const float *>(mesh.colors.data()), mesh.colors.size(), 4, mesh_component_format::float16);
+    add_floats(mesh_section::texcoord0, reinterpret_cast<const float *>(mesh.texcoord0.data()), mesh.texcoord0.size(), 2, mesh_component_format::unorm16);
+    add_floats(mesh_section::texcoord1, reinterpret_cast<const float *>(mesh.texcoord1.data()), mesh.texcoord1.size(), 2, mesh_component_format::unorm16);
+    add_floats(mesh_section::tangents, reinterpret_cast<const float *>(mesh.tangents.data()), mesh.tangents.size(), 3, mesh_component_format::snorm16);
+    add_floats(mesh_section::bitangents, reinterpret_cast<const float *>(mesh.bitangents.data()), mesh.bitangents.size(), 3, mesh_component_format::snorm16);
+
+    const uint32_t lod_count = lods ? static_cast<uint32_t>(lods->size()) : 0;
+    for (uint32_t level = 0; level <= lod_count; ++level)
+    {
+        const std::vector<uint3> & faces = level ? (*lods)[level - 1].faces : mesh.faces;
+        const std::vector<uint32_t> & material = level ? (*lods)[level - 1].material : mesh.material;
+
+        if (faces.size()) sections.push_back(make_raw(mesh_section::faces, level, faces.data(), faces.size(), mesh_component_format::uint32));
+        if (material.size()) sections.push_back(make_raw(mesh_section::material, level, material.data(), material.size(), mesh_component_format::uint32));
+
+        if (options.meshlets && faces.size())
+        {
+            const meshlet_set set = build_meshlets(faces, mesh.vertices.size(), options.max_meshlet_vertices, options.max_meshlet_triangles);
+            sections.push_back(make_raw(mesh_section::meshlets, level, set.meshlets.data(), set.meshlets.size(), mesh_component_format::uint32));
+            sections.push_back(make_raw(mesh_section::meshlet_vertices, level, set.vertices.data(), set.vertices.size(), mesh_component_format::uint32));
+            sections.push_back(make_raw(mesh_section::meshlet_triangles, level, set.triangles.data(), set.triangles.size(), mesh_component_format::uint32));
+        }
+    }
+
+    if (options.compress) for (auto & s : sections) compress(s);
+
+    runtime_mesh_binary_header_v2 header;
+    header.compressionVersion = options.compress ? runtime_mesh_compression_version : 0;
+    header.sectionCount = static_cast<uint32_t>(sections.size());
+    header.lodCount = lod_count;
+
+    uint64_t offset = align_up(sizeof(header) + sections.size() * sizeof(runtime_mesh_binary_section), kMeshSectionAlignment);
+    for (auto & s : sections)
+    {
+        s.header.offset = offset;
+        s.header.bytes = s.bytes.size();
+        offset = align_up(offset + s.bytes.size(), kMeshSectionAlignment);
+    }
+    header.fileBytes = offset;
+
+    std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) throw std::runtime_error("could not open binary ofstream to path " + path);
+
+    const char padding[kMeshSectionAlignment] = {};
+    const auto pad_to = [&](const uint64_t position)
+    {
+        const uint64_t current = static_cast<uint64_t>(file.tellp());
+        if (position > current) file.write(padding, static_cast<std::streamsize>(position - current));
+    };
+
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    for (const auto & s : sections) file.write(reinterpret_cast<const char *>(&s.header), sizeof(s.header));
+    for (const auto & s : sections)
+    {
+        pad_to(s.header.offset);
+        file.write(reinterpret_cast<const char *>(s.bytes.data()), static_cast<std::streamsize>(s.bytes.size()));
+    }
+    pad_to(header.fileBytes);
+
+    if (!file.good()) throw std::runtime_error("failed writing " + path);
+}
+
+///////////////////////
+//   mapped_mesh     //
+///////////////////////
+
+mapped_mesh::mapped_mesh(const std::string & path) : file(path)
+{
+    if (file.size() < sizeof(uint32_t)) throw std::runtime_error("not a polymer mesh: " + path);
+
+    std::memcpy(&version, file.data(), sizeof(uint32_t));
+    if (version == 1) open_v1();
+    else if (version == 2) open_v2();
+    else throw std::runtime_error("unsupported mesh version " + std::to_string(version) + ": " + path);
+
+    validate();
+}
+
+void mapped_mesh::open_v1()
+{
+    if (file.size() < sizeof(runtime_mesh_binary_header)) throw std::runtime_error("truncated v1 mesh header");
+
+    runtime_mesh_binary_header h;
+    std::memcpy(&h, file.data(), sizeof(h));
+
+    levels.resize(1);
+    size_t offset = sizeof(h);
+
+    // v1 streams are tightly packed float/uint32 arrays, so every one of them is 4-byte aligned
+    const auto map_stream = [&](const mesh_section s, const uint32_t bytes, const size_t element_size)
+    {
+        if (offset + bytes > file.size()) throw std::runtime_error("truncated v1 mesh stream");
+        levels[0][size_t(s)] = { file.data() + offset, bytes / element_size };
+        offset += bytes;
+    };
+
+    map_stream(mesh_section::vertices, h.verticesBytes, sizeof(float3));
+    map_stream(mesh_section::normals, h.normalsBytes, sizeof(float3));
+
+    // v1 writers sized colors as float3 while writing float4 data, so only the first colorsBytes of
+    // the float4 array were stored. Rebuild the array the v1 importer produced (zero-filled tail).
+    {
+        if (offset + h.colorsBytes > file.size()) throw std::runtime_error("truncated v1 mesh stream");
+        const size_t count = h.colorsBytes / sizeof(float3);
+        if (count)
+        {
+            owned.emplace_back(count * sizeof(float4), 0);
+            std::memcpy(owned.back().data(), file.data() + offset, h.colorsBytes);
+            levels[0][size_t(mesh_section::colors)] = { owned.back().data(), count };
+            decoded += owned.back().size();
+        }
+        offset += h.colorsBytes;
+    }
+
+    map_stream(mesh_section::texcoord0, h.texcoord0Bytes, sizeof(float2));
+    map_stream(mesh_section::texcoord1, h.texcoord1Bytes, sizeof(float2));
+    map_stream(mesh_section::tangents, h.tangentsBytes, sizeof(float3));
+    map_stream(mesh_section::bitangents, h.bitangentsBytes, sizeof(float3));
+    map_stream(mesh_section::faces, h.facesBytes, sizeof(uint3));
+    map_stream(mesh_section::material, h.materialsBytes, sizeof(uint32_t));
+}
+
+void mapped_mesh::open_v2()
+{
+    if (file.size() < sizeof(runtime_mesh_binary_header_v2)) throw std::runtime_error("truncated v2 mesh header");
+
+    runtime_mesh_binary_header_v2 h;
+    std::memcpy(&h, file.data(), sizeof(h));
+
+    if (h.magic != kMeshBinaryMagic) throw std::runtime_error("bad v2 mesh magic");
+    if (h.compressionVersion > runtime_mesh_compression_version) throw std::runtime_error("unsupported mesh compression version");
+    if (h.fileBytes > file.size()) throw std::runtime_error("truncated v2 mesh");
+    if (h.lodCount > h.sectionCount) throw std::runtime_error("bad v2 mesh lod count");
+
+    const uint64_t toc_bytes = uint64_t(h.sectionCount) * sizeof(runtime_mesh_binary_section);
+    if (sizeof(h) + toc_bytes > file.size()) throw std::runtime_error("truncated v2 mesh section table");
+
+    std::vector<runtime_mesh_binary_section> sections(h.sectionCount);
+    if (h.sectionCount) std::memcpy(sections.data(), file.data() + sizeof(h), toc_bytes);
+
+    lods = h.lodCount;
+    levels.resize(size_t(lods) + 1);
+
+    std::vector<uint8_t> seen(levels.size() * size_t(mesh_section::count), 0);
+    for (const auto & s : sections)
+    {
+        if (s.type >= uint32_t(mesh_section::count)) throw std::runtime_error("unknown mesh section");
+        if (s.level > lods || (s.level > 0 && per_vertex(mesh_section(s.type)))) throw std::runtime_error("mesh section level out of range");
+        if (s.offset + s.bytes > file.size() || s.offset + s.bytes < s.offset) throw std::runtime_error("mesh section out of bounds");
+        if (seen[s.level * size_t(mesh_section::count) + s.type]++) throw std::runtime_error("duplicate mesh section");
+    }
+
+    // Sections decode independently; each writes only its own slot in `levels` and `owned`
+    std::vector<std::vector<uint8_t>> storage(sections.size());
+    std::vector<uint8_t> valid(sections.size(), 0);
+
+    parallel_for(sections.size(), 1, [&](const size_t begin, const size_t end)
+    {
+        for (size_t i = begin; i < end; ++i) valid[i] = decode_section(sections[i], storage[i]);
+    });
+
+    if (std::find(valid.begin(), valid.end(), uint8_t(0)) != valid.end()) throw std::runtime_error("malformed mesh section");
+
+    for (auto & s : storage)
+    {
+        if (s.empty()) continue;
+        decoded += s.size();
+        owned.push_back(std::move(s));
+    }
+}
+
+bool mapped_mesh::decode_section(const runtime_mesh_binary_section & s, std::vector<uint8_t> & storage)
+{
+    const mesh_section type = mesh_section(s.type);
+    const mesh_component_format format = mesh_component_format(s.format);
+    const mesh_section_encoding encoding = mesh_section_encoding(s.encoding);
+    const size_t stride = runtime_stride(type);
+    const size_t stored_bytes = size_t(s.count) * s.stride;
+    const uint8_t * source = file.data() + s.offset;
+
+    section_data & slot = levels[s.level][s.type];
+    if (s.count == 0) return true;
+    if (s.stride == 0 || s.stride > 256) return false;
+
+    // Undo the section encoding
+    std::vector<uint8_t> unpacked;
+    if (encoding == mesh_section_encoding::raw)
+    {
+        if (s.bytes != stored_bytes) return false;
+    }
+    else if (encoding == mesh_section_encoding::meshopt_vertex)
+    {
+        // The codec spends at least 2 bits on every 16 bytes of a byte lane, so a count that would
+        // decode to more than 64 bytes per stored byte is corrupt (and is not worth allocating for)
+        if (s.stride % 4 || stored_bytes / 64 > s.bytes) return false;
+        unpacked.resize(stored_bytes);
+        if (meshopt_decodeVertexBuffer(unpacked.data(), s.count, s.stride, source, size_t(s.bytes)) != 0) return false;
+        source = unpacked.data();
+    }
+    else if (encoding == mesh_section_encoding::meshopt_index)
+    {
+        // At least the header, a byte per triangle and the 16-byte code table
+        if (type != mesh_section::faces || s.stride != sizeof(uint3) || s.bytes < 1 + uint64_t(s.count) + 16) return false;
+        unpacked.resize(stored_bytes);
+        if (meshopt_decodeIndexBuffer(unpacked.data(), size_t(s.count) * 3, sizeof(uint32_t), source, size_t(s.bytes)) != 0) return false;
+        source = unpacked.data();
+    }
+    else return false;
+
+    // Stored with the runtime layout: either point into the mapping or keep the decoded bytes
+    if ((format == mesh_component_format::float32 || format == mesh_component_format::uint32) && s.stride == stride)
+    {
+        if (unpacked.empty())
+        {
+            if (s.offset % sizeof(uint32_t)) return false;
+            slot = { source, s.count };
+        }
+        else
+        {
+            storage = std::move(unpacked);
+            slot = { storage.data(), s.count };
+        }
+        return true;
+    }
+
+    // Quantized vertex attributes expand to float components
+    const uint32_t out_components = static_cast<uint32_t>(stride / sizeof(float));
+    if (!per_vertex(type) || s.components > out_components) return false;
+    if (format != mesh_component_format::unorm16 && format != mesh_component_format::snorm16 && format != mesh_component_format::float16) return false;
+    if (s.components > 4 || s.stride < s.components * sizeof(uint16_t)) return false;
+
+    storage.assign(size_t(s.count) * stride, 0);
+    float * out = reinterpret_cast<float *>(storage.data());
+    for (size_t i = 0; i < s.count; ++i)
+    {
+        uint16_t q[4];
+        std::memcpy(q, source + i * s.stride, s.components * sizeof(uint16_t));
+        for (uint32_t c = 0; c < s.components; ++c)
+        {
+            float v;
+            if (format == mesh_component_format::unorm16) v = float(q[c]) / 65535.f * s.scale[c & 3] + s.bias[c & 3];
+            else if (format == mesh_component_format::snorm16) v = std::max(float(int16_t(q[c])) / 32767.f, -1.f);
+            else v = half_to_float(q[c]);
+            out[i * out_components + c] = v;
+        }
+    }
+
+    slot = { storage.data(), s.count };
+    return true;
+}
+
+void mapped_mesh::validate() const
+{
+    const size_t vertex_count = vertices().size;
+    for (uint32_t level = 0; level < levels.size(); ++level)
+    {
+        for (const uint3 & f : faces(level))
+        {
+            if (f.x >= vertex_count || f.y >= vertex_count || f.z >= vertex_count) throw std::runtime_error("mesh face index out of range");
+        }
+
+        const mesh_stream_view<uint32_t> local_vertices = meshlet_vertices(level);
+        const mesh_stream_view<uint32_t> local_triangles = meshlet_triangles(level);
+        for (const uint32_t v : local_vertices)
+        {
+            if (v >= vertex_count) throw std::runtime_error("meshlet vertex out of range");
+        }
+        for (const mesh_meshlet & m : meshlets(level))
+        {
+            if (uint64_t(m.vertex_offset) + m.vertex_count > local_vertices.size || uint64_t(m.triangle_offset) + m.triangle_count > local_triangles.size)
+            {
+                throw std::runtime_error("meshlet out of range");
+            }
+            for (uint32_t t = 0; t < m.triangle_count; ++t)
+            {
+                const uint32_t packed = local_triangles[m.triangle_offset + t];
+                if ((packed & 0xff) >= m.vertex_count || ((packed >> 8) & 0xff) >= m.vertex_count || ((packed >> 16) & 0xff) >= m.vertex_count)
+                {
+                    throw std::runtime_error("meshlet triangle out of range");
+                }
+            }
+        }
+    }
+}
+
+runtime_mesh mapped_mesh::to_runtime_mesh() const
+{
+    runtime_mesh mesh;
+    mesh.vertices = vertices().to_vector();
+    mesh.normals = normals().to_vector();
+    mesh.colors = colors().to_vector();
+    mesh.texcoord0 = texcoord0().to_vector();
+    mesh.texcoord1 = texcoord1().to_vector();
+    mesh.tangents = tangents().to_vector();
+    mesh.bitangents = bitangents().to_vector();
+    mesh.faces = faces().to_vector();
+    mesh.material = material().to_vector();
+    return mesh;
+}
+
+runtime_mesh polymer::import_polymer_binary_model(const std::string & path)
+{
+    return mapped_mesh(path).to_runtime_mesh();
+}
@@ -5,8 +5,6 @@
 #include <cstring>
 
 #include "polymer-model-io/model-io.hpp"
-#include "polymer-model-io/model-io-util.hpp"
-#include "polymer-model-io/gaussian-splat-io.hpp"
 #include "polymer-model-io/gltf-io.hpp"
 
 #include "polymer-core/util/file-io.hpp"
@@ -15,8 +13,6 @@
 #define TINYPLY_IMPLEMENTATION
 #include "tinyply/tinyply.h"
 
-#include "tinyobj/tiny_obj_loader.h"
-
 #include "meshoptimizer/meshoptimizer.h"
 
 using namespace polymer;
@@ -63,92 +59,6 @@ std::unordered_map<std::string, runtime_mesh> polymer::import_model(const std::s
     return models;
 }
 
-std::unordered_map<std::string, runtime_mesh> polymer::import_obj_model(const std::string & path)
-{
-    std::unordered_map<std::string, runtime_mesh> meshes;
-
-    tinyobj::attrib_t attrib;
-    std::vector<tinyobj::shape_t> shapes;
-    std::vector<tinyobj::material_t> materials;
-
-    std::string parentDir = parent_directory_from_filepath(path) + "/";
-
-    std::string err;
-    bool status = tinyobj::LoadObj(&attrib, &shapes, &materials, &err, path.c_str(), parentDir.c_str());
-
-    // if (status && !err.empty()) std::cerr << "tinyobj warning: " << err << std::endl;
-
-    // Append `default` material
-    materials.push_back(tinyobj::material_t());
-
-    // std::cout << "# of shapes    : " << shapes.size() << std::endl;
-    // std::cout << "# of materials : " << materials.size() << std::endl;
-
-    // Parse tinyobj data into geometry struct
-    for (unsigned int i = 0; i < shapes.size(); i++)
-    {
-        tinyobj::shape_t * shape = &shapes[i];
-        tinyobj::mesh_t * mesh = &shapes[i].mesh;
-
-        runtime_mesh & g = meshes[shape->name];
-
-        // std::cout << "Submesh Name:  " << shape->name << std::endl;
-        // std::cout << "Num Indices:   " << mesh->indices.size() << std::endl;
-        // std::cout << "Num TexCoords: " << attrib.texcoords.size() << std::endl;
-
-        size_t indexOffset = 0;
-
-        // de-duplicate vertices
-        unordered_map_generator<unique_vertex, uint32_t>::Type uniqueVertexMap;
-        bool shouldGenerateNormals = false;
-
-        for (size_t f = 0; f < mesh->num_face_vertices.size(); f++)
-        {
-            assert(mesh->num_face_vertices[f] == 3);
-
-            uint3 indices;
-            for (int v = 0; v < 3; v++)
-            {
-                const tinyobj::index_t idx = mesh->indices[indexOffset + v];
-
-                unique_vertex vertex;
-                vertex.position = { attrib.vertices[3 * idx.vertex_index + 0], attrib.vertices[3 * idx.vertex_index + 1], attrib.vertices[3 * idx.vertex_index + 2] };
-                if (attrib.normals.size()) vertex.normal = { attrib.normals[3 * idx.normal_index + 0], attrib.normals[3 * idx.normal_index + 1], attrib.normals[3 * idx.normal_index + 2] };
-                else shouldGenerateNormals = true;
-
-                if (idx.texcoord_index != -1) vertex.texcoord = { attrib.texcoords[2 * idx.texcoord_index + 0], attrib.texcoords[2 * idx.texcoord_index + 1] };
-
-                auto it = uniqueVertexMap.find(vertex);
-                if (it != uniqueVertexMap.end())
-                {
-                    indices[v] = it->second; // found duplicated vertex
-                }
-                else
-                {
-                    // we haven't run into this vertex yet
-                    uint32_t index = uint32_t(g.vertices.size());
-
-                    uniqueVertexMap[vertex] = index;
-                    indices[v] = index;
-
-                    g.vertices.push_back(vertex.position);
-                    if (attrib.normals.size()) g.normals.push_back(vertex.normal);
-                    if (idx.texcoord_index != -1) g.texcoord0.push_back(vertex.texcoord);
-                }
-            }
-
-            if (mesh->material_ids[f] > 0) g.material.push_back(mesh->material_ids[f]);
-            g.faces.push_back(indices);
-            indexOffset += 3;
-        }
-
-        // Optionally generate normals if the mesh was provided without them
-        if (shouldGenerateNormals) compute_normals(g);
-    }
-
-    return meshes;
-}
-
 std::unordered_map<std::string, runtime_mesh> polymer::import_ply_model(const std::string & path)
 {
     std::unordered_map<std::string, runtime_mesh> result;
@@ -219,80 +129,241 @@ std::unordered_map<std::string, runtime_mesh> polymer::import_ply_model(const st
     return result;
 }
 
-void polymer::optimize_model(runtime_mesh & input)
+namespace
 {
-    // @todo - implement mesh-optimizer workflow
+    // Applies f to every per-vertex attribute stream of a mesh, positions first
+    template <typename F>
+    void for_each_vertex_stream(runtime_mesh & m, F && f)
+    {
+        f(m.vertices);
+        f(m.normals);
+        f(m.colors);
+        f(m.texcoord0);
+        f(m.texcoord1);
+        f(m.tangents);
+        f(m.bitangents);
+    }
+
+    // Remaps every non-empty stream through remap (old index -> new index) into unique_count vertices
+    void remap_vertex_streams(runtime_mesh & m, const std::vector<uint32_t> & remap, const size_t unique_count)
+    {
+        const size_t vertex_count = m.vertices.size();
+        for_each_vertex_stream(m, [&](auto & stream)
+        {
+            if (stream.empty()) return;
+            using stream_t = typename std::decay<decltype(stream)>::type;
+            stream_t remapped(unique_count);
+            meshopt_remapVertexBuffer(remapped.data(), stream.data(), vertex_count, sizeof(typename stream_t::value_type), remap.data());
+            stream = std::move(remapped);
+        });
+    }
+
+    void remap_faces(std::vector<uint3> & faces, const std::vector<uint32_t> & remap)
+    {
+        unsigned int * indices = reinterpret_cast<unsigned int *>(faces.data());
+        meshopt_remapIndexBuffer(indices, indices, faces.size() * 3, remap.data());
+    }
+
+    // Contiguous face ranges sharing a material, or one range covering the mesh
+    std::vector<std::pair<size_t, size_t>> material_ranges(const std::vector<uint32_t> & material, const size_t face_count)
+    {
+        std::vector<std::pair<size_t, size_t>> ranges;
+        if (material.size() != face_count)
+        {
+            if (face_count) ranges.emplace_back(0, face_count);
+            return ranges;
+        }
+
+        size_t first = 0;
+        for (size_t f = 1; f <= face_count; ++f)
+        {
+            if (f == face_count || material[f] != material[first])
+            {
+                ranges.emplace_back(first, f);
+                first = f;
+            }
+        }
+        return ranges;
+    }
+
+    void measure(const runtime_mesh & m, const mesh_optimization_options & options, const size_t vertex_size, float & acmr, float & atvr, float & overfetch, float & overdraw)
+    {
+        const unsigned int * indices = reinterpret_cast<const unsigned int *>(m.faces.data());
+        const size_t index_count = m.faces.size() * 3;
+        const size_t vertex_count = m.vertices.size();
+
+        const meshopt_VertexCacheStatistics cache = meshopt_analyzeVertexCache(indices, index_count, vertex_count, options.cache_size, 0, 0);
+        acmr = cache.acmr;
+        atvr = cache.atvr;
+        overfetch = meshopt_analyzeVertexFetch(indices, index_count, vertex_count, vertex_size).overfetch;
+        if (options.optimize_overdraw) overdraw = meshopt_analyzeOverdraw(indices, index_count, &m.vertices[0].x, vertex_count, sizeof(float3)).overdraw;
+    }
 }
 
-runtime_mesh polymer::import_polymer_binary_model(const std::string & path)
+mesh_optimization_stats polymer::optimize_model(runtime_mesh & input, const mesh_optimization_options & options, std::vector<mesh_lod> * lods)
 {
-    std::ifstream file(path, std::ios::binary | std::ios::ate);
-    if (!file.good()) throw std::runtime_error("couldn't open");
-
-    file.seekg(0, std::ios::end);
-    std::streamsize size = file.tellg();
-    file.seekg(0, std::ios::beg);
-
-    runtime_mesh_binary_header h;
-    file.read((char*)&h, sizeof(runtime_mesh_binary_header));
-
-    assert(h.headerVersion == runtime_mesh_binary_version);
-    if (h.compressionVersion > 0) assert(h.compressionVersion == runtime_mesh_compression_version);
-
-    runtime_mesh mesh;
-
-    mesh.vertices.resize(h.verticesBytes / sizeof(float3));
-    mesh.normals.resize(h.normalsBytes / sizeof(float3));
-    mesh.colors.resize(h.colorsBytes / sizeof(float3));
-    mesh.texcoord0.resize(h.texcoord0Bytes / sizeof(float2));
-    mesh.texcoord1.resize(h.texcoord1Bytes / sizeof(float2));
-    mesh.tangents.resize(h.tangentsBytes / sizeof(float3));
-    mesh.bitangents.resize(h.bitangentsBytes / sizeof(float3));
-    mesh.faces.resize(h.facesBytes / sizeof(uint3));
-    mesh.material.resize(h.materialsBytes / sizeof(uint32_t));
-
-    file.read((char*)mesh.vertices.data(), h.verticesBytes);
-    file.read((char*)mesh.normals.data(), h.normalsBytes);
-    file.read((char*)mesh.colors.data(), h.colorsBytes);
-    file.read((char*)mesh.texcoord0.data(), h.texcoord0Bytes);
-    file.read((char*)mesh.texcoord1.data(), h.texcoord1Bytes);
-    file.read((char*)mesh.tangents.data(), h.tangentsBytes);
-    file.read((char*)mesh.bitangents.data(), h.bitangentsBytes);
-    file.read((char*)mesh.faces.data(), h.facesBytes);
-    file.read((char*)mesh.material.data(), h.materialsBytes);
-
-    return mesh;
+    mesh_optimization_stats stats;
+    if (lods) lods->clear();
+    if (input.faces.empty() || input.vertices.empty()) return stats;
+
+    const size_t face_count = input.faces.size();
+    const bool per_face_material = (input.material.size() == face_count);
+
+    // Streams that are not per-vertex cannot follow a vertex reordering
+    size_t vertex_size = 0;
+    bool streams_match = true;
+    for_each_vertex_stream(input, [&](auto & stream)
+    {
+        if (stream.empty()) return;
+        if (stream.size() != input.vertices.size()) streams_match = false;
+        vertex_size += sizeof(stream[0]);
+    });
+
+    stats.triangles = static_cast<uint32_t>(face_count);
+    stats.vertices_before = static_cast<uint32_t>(input.vertices.size());
+    measure(input, options, vertex_size, stats.acmr_before, stats.atvr_before, stats.overfetch_before, stats.overdraw_before);
+
+    // Group faces by material so each group is a contiguous index range
+    if (per_face_material && !std::is_sorted(input.material.begin(), input.material.end()))
+    {
+        std::vector<uint32_t> order(face_count);
+        for (uint32_t f = 0; f < face_count; ++f) order[f] = f;
+        std::stable_sort(order.begin(), order.end(), [&](const uint32_t a, const uint32_t b) { return input.material[a] < input.material[b]; });
+
+        std::vector<uint3> faces(face_count);
+        std::vector<uint32_t> material(face_count);
+        for (size_t f = 0; f < face_count; ++f)
+        {
+            faces[f] = input.faces[order[f]];
+            material[f] = input.material[order[f]];
+        }
+        input.faces = std::move(faces);
+        input.material = std::move(material);
+    }
+
+    // Deduplicate across all attribute streams at once by keying on the interleaved vertex
+    if (options.deduplicate_vertices && streams_match)
+    {
+        const size_t vertex_count = input.vertices.size();
+        std::vector<uint8_t> interleaved(vertex_count * vertex_size);
+
+        size_t offset = 0;
+        for_each_vertex_stream(input, [&](auto & stream)
+        {
+            if (stream.empty()) return;
+            const size_t element_size = sizeof(stream[0]);
+            for (size_t v = 0; v < vertex_count; ++v) std::memcpy(&interleaved[v * vertex_size + offset], &stream[v], element_size);
+            offset += element_size;
+        });
+
+        std::vector<uint32_t> remap(vertex_count);
+        const size_t unique_count = meshopt_generateVertexRemap(remap.data(), reinterpret_cast<const unsigned int *>(input.faces.data()), face_count * 3, interleaved.data(), vertex_count, vertex_size);
+        remap_faces(input.faces, remap);
+        remap_vertex_streams(input, remap, unique_count);
+    }
+
+    const size_t vertex_count = input.vertices.size();
+    const auto ranges = material_ranges(input.material, face_count);
+
+    // Cache, then overdraw: the overdraw pass only reorders clusters found by the cache pass. Both support in-place output.
+    for (const auto & r : ranges)
+    {
+        unsigned int * indices = reinterpret_cast<unsigned int *>(input.faces.data() + r.first);
+        const size_t index_count = (r.second - r.first) * 3;
+        if (options.optimize_vertex_cache) meshopt_optimizeVertexCache(indices, indices, index_count, vertex_count);
+        if (options.optimize_overdraw) meshopt_optimizeOverdraw(indices, indices, index_count, &input.vertices[0].x, vertex_count, sizeof(float3), options.overdraw_threshold);
+    }
+
+    // Each level simplifies the previous one, per material range, then gets its own cache ordering
+    if (lods && options.lod_count > 0)
+    {
+        const mesh_lod * source = nullptr;
+        for (uint32_t level = 0; level < options.lod_count; ++level)
+        {
+            const std::vector<uint3> & src_faces = source ? source->faces : input.faces;
+            const std::vector<uint32_t> & src_material = source ? source->material : input.material;
+
+            mesh_lod lod;
+            for (const auto & r : material_ranges(src_material, src_faces.size()))
+            {
+                const unsigned int * indices = reinterpret_cast<const unsigned int *>(src_faces.data() + r.first);
+                const size_t index_count = (r.second - r.first) * 3;
+                const size_t target_index_count = std::max<size_t>(3, static_cast<size_t>(index_count * options.lod_reduction) / 3 * 3);
+
+                std::vector<unsigned int> simplified(index_count);
+                simplified.resize(meshopt_simplify(simplified.data(), indices, index_count, &input.vertices[0].x, vertex_count, sizeof(float3), target_index_count));
+                if (simplified.empty()) continue;
+
+                meshopt_optimizeVertexCache(simplified.data(), simplified.data(), simplified.size(), vertex_count);
+
+                for (size_t i = 0; i < simplified.size(); i += 3) lod.faces.push_back({ simplified[i], simplified[i + 1], simplified[i + 2] });
+                if (per_face_material) lod.material.resize(lod.faces.size(), src_material[r.first]);
+            }
+
+            if (lod.faces.empty()) break;
+            lods->push_back(std::move(lod));
+            source = &lods->back();
+        }
+    }
+
+    // Vertex fetch last, since it depends on the final triangle order. Simplified levels only
+    // reference vertices the full mesh already uses, so the same remap covers them.
+    if (options.optimize_vertex_fetch && streams_match)
+    {
+        std::vector<uint32_t> remap(vertex_count);
+        const size_t unique_count = meshopt_optimizeVertexFetchRemap(remap.data(), reinterpret_cast<const unsigned int *>(input.faces.data()), face_count * 3, vertex_count);
+        remap_faces(input.faces, remap);
+        if (lods) for (auto & lod : *lods) remap_faces(lod.faces, remap);
+        remap_vertex_streams(input, remap, unique_count);
+    }
+
+    stats.vertices_after = static_cast<uint32_t>(input.vertices.size());
+    measure(input, options, vertex_size, stats.acmr_after, stats.atvr_after, stats.overfetch_after, stats.overdraw_after);
+    return stats;
 }
 
-void polymer::export_polymer_binary_model(const std::string & path, runtime_mesh & mesh, bool compressed)
+meshlet_set polymer::build_meshlets(const std::vector<uint3> & faces, const size_t vertex_count, const uint32_t max_vertices, const uint32_t max_triangles)
 {
-    auto file = std::ofstream(path, std::ios::out | std::ios::binary);
-
-    runtime_mesh_binary_header header;
-    header.headerVersion = runtime_mesh_binary_version;
-    header.compressionVersion = (compressed) ? runtime_mesh_compression_version : 0;
-    header.verticesBytes = (uint32_t)mesh.vertices.size() * sizeof(float3);
-    header.normalsBytes = (uint32_t)mesh.normals.size() * sizeof(float3);
-    header.colorsBytes = (uint32_t)mesh.colors.size() * sizeof(float3);
-    header.texcoord0Bytes = (uint32_t)mesh.texcoord0.size() * sizeof(float2);
-    header.texcoord1Bytes = (uint32_t)mesh.texcoord1.size() * sizeof(float2);
-    header.tangentsBytes = (uint32_t)mesh.tangents.size() * sizeof(float3);
-    header.bitangentsBytes = (uint32_t)mesh.bitangents.size() * sizeof(float3);
-    header.facesBytes = (uint32_t)mesh.faces.size() * sizeof(uint3);
-    header.materialsBytes = (uint32_t)mesh.material.size() * sizeof(uint32_t);
-
-    file.write(reinterpret_cast<char*>(&header), sizeof(runtime_mesh_binary_header));
-    file.write(reinterpret_cast<char*>(mesh.vertices.data()), header.verticesBytes);
-    file.write(reinterpret_cast<char*>(mesh.normals.data()), header.normalsBytes);
-    file.write(reinterpret_cast<char*>(mesh.colors.data()), header.colorsBytes);
-    file.write(reinterpret_cast<char*>(mesh.texcoord0.data()), header.texcoord0Bytes);
-    file.write(reinterpret_cast<char*>(mesh.texcoord1.data()), header.texcoord1Bytes);
-    file.write(reinterpret_cast<char*>(mesh.tangents.data()), header.tangentsBytes);
-    file.write(reinterpret_cast<char*>(mesh.bitangents.data()), header.bitangentsBytes);
-    file.write(reinterpret_cast<char*>(mesh.faces.data()), header.facesBytes);
-    file.write(reinterpret_cast<char*>(mesh.material.data()), header.materialsBytes);
+    if (max_vertices < 3 || max_vertices > 256 || max_triangles < 1) throw std::invalid_argument("meshlet limits out of range");
 
-    file.close();
+    meshlet_set result;
+    const uint16_t unassigned = 0xffff;
+    std::vector<uint16_t> local(vertex_count, unassigned); // local index of each mesh vertex in the open meshlet
+    mesh_meshlet current;
+
+    const auto close_meshlet = [&]()
+    {
+        if (current.triangle_count == 0) return;
+        for (uint32_t i = 0; i < current.vertex_count; ++i) local[result.vertices[current.vertex_offset + i]] = unassigned;
+        result.meshlets.push_back(current);
+        current.vertex_offset = static_cast<uint32_t>(result.vertices.size());
+        current.triangle_offset = static_cast<uint32_t>(result.triangles.size());
+        current.vertex_count = current.triangle_count = 0;
+    };
+
+    for (const uint3 & f : faces)
+    {
+        const uint32_t new_vertices = (local[f.x] == unassigned) + (local[f.y] == unassigned && f.y != f.x) + (local[f.z] == unassigned && f.z != f.x && f.z != f.y);
+        if (current.vertex_count + new_vertices > max_vertices || current.triangle_count == max_triangles) close_meshlet();
+
+        uint32_t packed = 0;
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            const uint32_t v = f[k];
+            if (local[v] == unassigned)
+            {
+                local[v] = static_cast<uint16_t>(current.vertex_count++);
+                result.vertices.push_back(v);
+            }
+            packed |= uint32_t(local[v]) << (8 * k);
+        }
+
+        result.triangles.push_back(packed);
+        current.triangle_count++;
+    }
+
+    close_meshlet();
+    return result;
 }
 
 void export_obj_data(std::ofstream & file, runtime_mesh & mesh)
@@ -352,199 +423,3 @@ bool polymer::export_obj_multi_model(const std::vector<std::string> & names, con
 
     return true;
 }
-
-/////////////////////////////////////
-//   Gaussian Splat PLY Loading    //
-/////////////////////////////////////
-
-bool polymer::is_gaussian_splat_ply(const std::string & path)
-{
-    try
-    {
-        std::ifstream ss(path, std::ios::binary);
-        if (ss.fail()) return false;
-
-        PlyFile file;
-        file.parse_header(ss);
-
-        // Check for characteristic gaussian splat properties
-        bool has_opacity = false;
-        bool has_scale = false;
-        bool has_rotation = false;
-        bool has_sh = false;
-
-        for (const auto & element : file.get_elements())
-        {
-            if (element.name == "vertex")
-            {
-                for (const auto & prop : element.properties)
-                {
-                    if (prop.name == "opacity") has_opacity = true;
-                    if (prop.name == "scale_0") has_scale = true;
-                    if (prop.name == "rot_0") has_rotation = true;
-                    if (prop.name == "f_dc_0") has_sh = true;
-                }
-            }
-        }
-
-        return has_opacity && has_scale && has_rotation && has_sh;
-    }
-    catch (const std::exception &)
-    {
-        return false;
-    }
-}
-
-gaussian_splat_scene polymer::import_gaussian_splat_ply(const std::string & path)
-{
-    gaussian_splat_scene scene;
-
-    try
-    {
-        std::ifstream ss(path, std::ios::binary);
-        if (ss.fail()) throw std::runtime_error("failed to open " + path);
-
-        PlyFile file;
-        file.parse_header(ss);
-
-        // Request position
-        std::shared_ptr<PlyData> positions, scales, opacities, rotations;
-        std::shared_ptr<PlyData> f_dc[3];  // DC components (RGB)
-        std::shared_ptr<PlyData> f_rest[45]; // Rest of SH coefficients (15 per channel)
-
-        try { positions = file.request_properties_from_element("vertex", { "x", "y", "z" }); }
-        catch (const std::exception & e) { throw std::runtime_error(std::string("Missing position: ") + e.what()); }
-
-        try { scales = file.request_properties_from_element("vertex", { "scale_0", "scale_1", "scale_2" }); }
-        catch (const std::exception & e) { throw std::runtime_error(std::string("Missing scales: ") + e.what()); }
-
-        try { opacities = file.request_properties_from_element("vertex", { "opacity" }); }
-        catch (const std::exception & e) { throw std::runtime_error(std::string("Missing opacity: ") + e.what()); }
-
-        try { rotations = file.request_properties_from_element("vertex", { "rot_0", "rot_1", "rot_2", "rot_3" }); }
-        catch (const std::exception & e) { throw std::runtime_error(std::string("Missing rotations: ") + e.what()); }
-
-        // Request SH DC components
-        try { f_dc[0] = file.request_properties_from_element("vertex", { "f_dc_0" }); }
-        catch (const std::exception &) { }
-        try { f_dc[1] = file.request_properties_from_element("vertex", { "f_dc_1" }); }
-        catch (const std::exception &) { }
-        try { f_dc[2] = file.request_properties_from_element("vertex", { "f_dc_2" }); }
-        catch (const std::exception &) { }
-
-        // Request SH rest components (f_rest_0 through f_rest_44)
-        for (int i = 0; i < 45; ++i)
-        {
-            try { f_rest[i] = file.request_properties_from_element("vertex", { "f_rest_" + std::to_string(i) }); }
-            catch (const std::exception &) { }
-        }
-
-        file.read(ss);
-
-        const size_t num_vertices = positions->count;
-        scene.vertices.resize(num_vertices);
-
-        // Get raw pointers
-        const float * pos_data = reinterpret_cast<const float *>(positions->buffer.get());
-        const float * scale_data = reinterpret_cast<const float *>(scales->buffer.get());
-        const float * opacity_data = reinterpret_cast<const float *>(opacities->buffer.get());
-        const float * rot_data = reinterpret_cast<const float *>(rotations->buffer.get());
-
-        const float * f_dc_data[3] = { nullptr, nullptr, nullptr };
-        for (int c = 0; c < 3; ++c)
-        {
-            if (f_dc[c]) f_dc_data[c] = reinterpret_cast<const float *>(f_dc[c]->buffer.get());
-        }
-
-        const float * f_rest_data[45] = { nullptr };
-        for (int i = 0; i < 45; ++i)
-        {
-            if (f_rest[i]) f_rest_data[i] = reinterpret_cast<const float *>(f_rest[i]->buffer.get());
-        }
-
-        // Determine SH degree based on available coefficients
-        // SH degree 0: 1 coeff, degree 1: 4 coeffs, degree 2: 9 coeffs, degree 3: 16 coeffs
-        int available_sh_coeffs = 1; // DC is always there
-        for (int i = 0; i < 45; ++i)
-        {
-            if (f_rest_data[i]) available_sh_coeffs = 1 + (i + 1) / 3 + 1;
-        }
-
-        if (available_sh_coeffs >= 16) scene.sh_degree = 3;
-        else if (available_sh_coeffs >= 9) scene.sh_degree = 2;
-        else if (available_sh_coeffs >= 4) scene.sh_degree = 1;
-        else scene.sh_degree = 0;
-
-        // Helper: sigmoid function
-        auto sigmoid = [](float x) { return 1.0f / (1.0f + std::exp(-x)); };
-
-        for (size_t i = 0; i < num_vertices; ++i)
-        {
-            gaussian_vertex & v = scene.vertices[i];
-
-            // Position (xyz, w=1)
-            v.position.x = pos_data[i * 3 + 0];
-            v.position.y = pos_data[i * 3 + 1];
-            v.position.z = pos_data[i * 3 + 2];
-            v.position.w = 1.0f;
-
-            // Scale (apply exp) and opacity (apply sigmoid)
-            v.scale_opacity.x = std::exp(scale_data[i * 3 + 0]);
-            v.scale_opacity.y = std::exp(scale_data[i * 3 + 1]);
-            v.scale_opacity.z = std::exp(scale_data[i * 3 + 2]);
-            v.scale_opacity.w = sigmoid(opacity_data[i]);
-
-            // Rotation quaternion (wxyz in PLY -> xyzw normalized)
-            float qw = rot_data[i * 4 + 0];
-            float qx = rot_data[i * 4 + 1];
-            float qy = rot_data[i * 4 + 2];
-            float qz = rot_data[i * 4 + 3];
-            float len = std::sqrt(qw * qw + qx * qx + qy * qy + qz * qz);
-            if (len > 0.0f)
-            {
-                qw /= len;
-                qx /= len;
-                qy /= len;
-                qz /= len;
-            }
-            v.rotation.x = qw;  // Store as wxyz for shader compatibility
-            v.rotation.y = qx;
-            v.rotation.z = qy;
-            v.rotation.w = qz;
-
-            // Initialize SH coefficients to zero
-            std::memset(v.shs, 0, sizeof(v.shs));
-
-            // SH coefficients: PLY stores [all R coeffs][all G coeffs][all B coeffs]
-            // We need to interleave to [RGB0][RGB1]...[RGB15]
-            // DC component (f_dc_0, f_dc_1, f_dc_2) -> sh[0], sh[1], sh[2]
-            if (f_dc_data[0]) v.shs[0] = f_dc_data[0][i];
-            if (f_dc_data[1]) v.shs[1] = f_dc_data[1][i];
-            if (f_dc_data[2]) v.shs[2] = f_dc_data[2][i];
-
-            // Rest of SH coefficients
-            // f_rest layout: [R1..R15][G1..G15][B1..B15]
-            // f_rest_0..f_rest_14 = R coeffs 1-15
-            // f_rest_15..f_rest_29 = G coeffs 1-15
-            // f_rest_30..f_rest_44 = B coeffs 1-15
-            for (int sh_idx = 1; sh_idx < 16; ++sh_idx)
-            {
-                int r_idx = sh_idx - 1;
-                int g_idx = sh_idx - 1 + 15;
-                int b_idx = sh_idx - 1 + 30;
-
-                if (f_rest_data[r_idx]) v.shs[sh_idx * 3 + 0] = f_rest_data[r_idx][i];
-                if (f_rest_data[g_idx]) v.shs[sh_idx * 3 + 1] = f_rest_data[g_idx][i];
-                if (f_rest_data[b_idx]) v.shs[sh_idx * 3 + 2] = f_rest_data[b_idx][i];
-            }
-        }
-
-        std::cout << "Loaded gaussian splat: " << num_vertices << " gaussians, SH degree " << scene.sh_degree << std::endl;
-    }
-    catch (const std::exception & e)
-    {
-        std::cerr << "Failed to load gaussian splat: " << e.what() << std::endl;
-    }
-
-    return scene;
-}
@@ -0,0 +1,488 @@
+#include "polymer-model-io/model-io.hpp"
+#include "polymer-model-io/model-io-util.hpp"
+
+#include "polymer-core/util/memory-mapped-file.hpp"
+#include "polymer-core/util/job-system.hpp"
+#include "polymer-core/util/string-utils.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+using namespace polymer;
+
+//////////////////////////////
+//   Parallel OBJ Importer  //
+//////////////////////////////
+
+// The file is memory mapped and split into newline-aligned chunks that are parsed concurrently. Each
+// chunk collects its own attributes, triangulated corners and group/material switches. Relative (negative)
+// indices and the group/material state at the start of a chunk depend on earlier chunks, so they are
+// resolved in a short serial pass once every chunk is parsed. Shapes are then deduplicated and built
+// concurrently, one job per shape.
+
+namespace
+{
+    static const size_t kMinChunkBytes = 1 << 20;
+
+    struct obj_corner { int32_t v, t, n; }; // 0-based, -1 when absent
+
+    struct obj_event
+    {
+        uint32_t face;      // first triangle in the chunk the switch applies to
+        bool material;      // usemtl, otherwise g/o
+        std::string name;
+    };
+
+    struct obj_chunk
+    {
+        const char * begin { nullptr };
+        const char * end { nullptr };
+        std::vector<float> positions;   // xyz
+        std::vector<float> texcoords;   // uv
+        std::vector<float> normals;     // xyz
+        std::vector<obj_corner> corners;  // three per triangle
+        std::vector<uint32_t> relative;   // corner * 3 + component, for indices relative to this chunk
+        std::vector<obj_event> events;
+        std::vector<std::string> mtllibs;
+    };
+
+    // A range of triangles sharing a shape and a material
+    struct obj_run
+    {
+        uint32_t chunk;
+        uint32_t first, last;
+        uint32_t material;
+    };
+
+    static const uint32_t kNoMaterial = 0xffffffff;
+
+    inline bool is_digit(const char c) { return c >= '0' && c <= '9'; }
+    inline bool is_space(const char c) { return c == ' ' || c == '\t'; }
+    inline bool is_newline(const char c) { return c == '\n' || c == '\r'; }
+
+    inline const char * skip_space(const char * p, const char * end)
+    {
+        while (p < end && is_space(*p)) ++p;
+        return p;
+    }
+
+    inline const char * skip_line(const char * p, const char * end)
+    {
+        while (p < end && *p != '\n') ++p;
+        return p < end ? p + 1 : end;
+    }
+
+    // Parses a decimal float without locale handling or allocation. Up to 19 significant digits are
+    // accumulated exactly into an integer and scaled once by a power of ten, which is exact for the
+    // 6-9 digit values OBJ exporters write. Anything else (inf, nan, hex) falls back to strtof.
+    const char * parse_float(const char * p, const char * end, float & out)
+    {
+        static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12,
+            1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+        const char * start = p;
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+')) negative = (*p++ == '-');
+
+        uint64_t mantissa = 0;
+        int32_t exponent = 0, significant = 0;
+        bool any_digits = false;
+
+        for (; p < end && is_digit(*p); ++p)
+        {
+            any_digits = true;
+            if (significant < 19) { mantissa = mantissa * 10 + uint64_t(*p - '0'); significant += (mantissa != 0); }
+            else ++exponent;
+        }
+
+        if (p < end && *p == '.')
+        {
+            for (++p; p < end && is_digit(*p); ++p)
+            {
+                any_digits = true;
+                if (significant < 19) { mantissa = mantissa * 10 + uint64_t(*p - '0'); significant += (mantissa != 0); --exponent; }
+            }
+        }
+
+        if (!any_digits)
+        {
+            char token[64] = {};
+            const size_t length = std::min<size_t>(sizeof(token) - 1, size_t(end - start));
+            std::memcpy(token, start, length);
+            char * token_end = token;
+            out = std::strtof(token, &token_end);
+            return start + (token_end - token);
+        }
+
+        if (p < end && (*p == 'e' || *p == 'E'))
+        {
+            const char * q = p + 1;
+            bool negative_exponent = false;
+            if (q < end && (*q == '-' || *q == '+')) negative_exponent = (*q++ == '-');
+            if (q < end && is_digit(*q))
+            {
+                int32_t e = 0;
+                for (; q < end && is_digit(*q); ++q) if (e < 10000) e = e * 10 + (*q - '0');
+                exponent += negative_exponent ? -e : e;
+                p = q;
+            }
+        }
+
+        double value = static_cast<double>(mantissa);
+        if (mantissa != 0)
+        {
+            if (exponent < 0) value = (exponent >= -22) ? value / powers[-exponent] : value * std::pow(10.0, exponent);
+            else if (exponent > 0) value = (exponent <= 22) ? value * powers[exponent] : value * std::pow(10.0, exponent);
+        }
+
+        out = static_cast<float>(negative ? -value : value);
+        return p;
+    }
+
+    inline const char * parse_int(const char * p, const char * end, int64_t & out)
+    {
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+')) negative = (*p++ == '-');
+        int64_t value = 0;
+        for (; p < end && is_digit(*p); ++p) value = value * 10 + (*p - '0');
+        out = negative ? -value : value;
+        return p;
+    }
+
+    // Rest of the line, without trailing whitespace or a comment
+    std::string parse_name(const char * p, const char * end)
+    {
+        p = skip_space(p, end);
+        const char * q = p;
+        while (q < end && !is_newline(*q) && *q != '#') ++q;
+        while (q > p && is_space(q[-1])) --q;
+        return std::string(p, q);
+    }
+
+    template <size_t N>
+    const char * parse_floats(const char * p, const char * end, std::vector<float> & out)
+    {
+        for (size_t i = 0; i < N; ++i)
+        {
+            float value = 0.f;
+            p = skip_space(p, end);
+            if (p < end && !is_newline(*p)) p = parse_float(p, end, value);
+            out.push_back(value);
+        }
+        return p;
+    }
+
+    void parse_chunk(obj_chunk & chunk)
+    {
+        const char * p = chunk.begin;
+        const char * end = chunk.end;
+
+        std::vector<obj_corner> polygon;
+        std::vector<uint8_t> polygon_relative; // bit k set when component k of the corner is chunk-relative
+
+        while (p < end)
+        {
+            p = skip_space(p, end);
+            if (p >= end) break;
+
+            const char c = *p;
+            const char next = (p + 1 < end) ? p[1] : '\n';
+
+            if (c == 'v' && is_space(next)) p = parse_floats<3>(p + 1, end, chunk.positions);
+            else if (c == 'v' && next == 't') p = parse_floats<2>(p + 2, end, chunk.texcoords);
+            else if (c == 'v' && next == 'n') p = parse_floats<3>(p + 2, end, chunk.normals);
+            else if (c == 'f' && is_space(next))
+            {
+                polygon.clear();
+                polygon_relative.clear();
+                p += 1;
+
+                const int64_t counts[3] = { int64_t(chunk.positions.size() / 3), int64_t(chunk.texcoords.size() / 2), int64_t(chunk.normals.size() / 3) };
+
+                while (true)
+                {
+                    p = skip_space(p, end);
+                    if (p >= end || !(is_digit(*p) || *p == '-' || *p == '+')) break;
+
+                    int32_t indices[3] = { -1, -1, -1 };
+                    uint8_t relative = 0;
+                    for (uint32_t k = 0; k < 3; ++k)
+                    {
+                        if (k > 0)
+                        {
+                            if (p >= end || *p != '/') break;
+                            ++p;
+                        }
+                        if (p < end && (is_digit(*p) || *p == '-' || *p == '+'))
+                        {
+                            int64_t index;
+                            p = parse_int(p, end, index);
+                            if (index > 0) indices[k] = int32_t(index - 1);
+                            else if (index < 0) { indices[k] = int32_t(counts[k] + index); relative |= uint8_t(1u << k); }
+                        }
+                    }
+
+                    polygon.push_back({ indices[0], indices[1], indices[2] });
+                    polygon_relative.push_back(relative);
+                }
+
+                // Fan triangulation
+                for (size_t i = 1; i + 1 < polygon.size(); ++i)
+                {
+                    for (const size_t corner : { size_t(0), i, i + 1 })
+                    {
+                        const uint32_t slot = static_cast<uint32_t>(chunk.corners.size()) * 3;
+                        for (uint32_t k = 0; k < 3; ++k) if (polygon_relative[corner] & (1u << k)) chunk.relative.push_back(slot + k);
+                        chunk.corners.push_back(polygon[corner]);
+                    }
+                }
+            }
+            else if ((c == 'g' || c == 'o') && (is_space(next) || is_newline(next)))
+            {
+                chunk.events.push_back({ static_cast<uint32_t>(chunk.corners.size() / 3), false, parse_name(p + 1, end) });
+            }
+            else if (c == 'u' && size_t(end - p) > 6 && !std::strncmp(p, "usemtl", 6) && is_space(p[6]))
+            {
+                chunk.events.push_back({ static_cast<uint32_t>(chunk.corners.size() / 3), true, parse_name(p + 6, end) });
+            }
+            else if (c == 'm' && size_t(end - p) > 6 && !std::strncmp(p, "mtllib", 6) && is_space(p[6]))
+            {
+                chunk.mtllibs.push_back(parse_name(p + 6, end));
+            }
+
+            p = skip_line(p, end);
+        }
+    }
+
+    // Material names in `newmtl` order, matching the ids tinyobjloader assigned
+    void read_material_names(const std::string & path, std::vector<std::string> & names)
+    {
+        try
+        {
+            memory_mapped_file file(path);
+            const char * p = reinterpret_cast<const char *>(file.data());
+            const char * end = p + file.size();
+            while (p < end)
+            {
+                p = skip_space(p, end);
+                if (size_t(end - p) > 6 && !std::strncmp(p, "newmtl", 6) && is_space(p[6])) names.push_back(parse_name(p + 6, end));
+                p = skip_line(p, end);
+            }
+        }
+        catch (const std::exception &) {} // a missing material library leaves materials unnamed, as before
+    }
+
+    // Area-weighted smooth normals, welding vertices that share a position (texcoord seams)
+    void compute_welded_normals(runtime_mesh & g)
+    {
+        flat_index_map<float3> welded(g.vertices.size());
+        std::vector<uint32_t> weld(g.vertices.size());
+        for (size_t i = 0; i < g.vertices.size(); ++i) weld[i] = welded.insert(g.vertices[i]);
+
+        std::vector<float3> accumulated(welded.size(), float3(0, 0, 0));
+        for (const uint3 & f : g.faces)
+        {
+            const float3 n = cross(g.vertices[f.y] - g.vertices[f.x], g.vertices[f.z] - g.vertices[f.x]);
+            accumulated[weld[f.x]] += n;
+            accumulated[weld[f.y]] += n;
+            accumulated[weld[f.z]] += n;
+        }
+
+        g.normals.resize(g.vertices.size());
+        for (size_t i = 0; i < g.vertices.size(); ++i) g.normals[i] = safe_normalize(accumulated[weld[i]]);
+    }
+}
+
+std::unordered_map<std::string, runtime_mesh> polymer::import_obj_model(const std::string & path)
+{
+    memory_mapped_file file(path);
+    file.prefetch();
+
+    const char * data = reinterpret_cast<const char *>(file.data());
+    const size_t size = file.size();
+
+    // Newline-aligned chunks, a few per thread so uneven line mixes still balance
+    job_system & jobs = default_job_system();
+    const size_t target_chunks = std::max<size_t>(1, std::min<size_t>(jobs.num_threads() * 4, size / kMinChunkBytes));
+
+    std::vector<obj_chunk> chunks;
+    {
+        const char * cursor = data;
+        for (size_t c = 0; c < target_chunks && cursor < data + size; ++c)
+        {
+            const char * split = (c + 1 == target_chunks) ? data + size : std::max(cursor, data + size * (c + 1) / target_chunks);
+            while (split < data + size && split[-1] != '\n') ++split;
+            chunks.emplace_back();
+            chunks.back().begin = cursor;
+            chunks.back().end = split;
+            cursor = split;
+        }
+    }
+
+    jobs.parallel_for(chunks.size(), 1, [&](const size_t begin, const size_t end)
+    {
+        for (size_t c = begin; c < end; ++c) parse_chunk(chunks[c]);
+    });
+
+    // Attribute offsets of each chunk; rebase chunk-relative indices and check ranges
+    std::vector<int64_t> position_base(chunks.size()), texcoord_base(chunks.size()), normal_base(chunks.size());
+    int64_t position_count = 0, texcoord_count = 0, normal_count = 0;
+    for (size_t c = 0; c < chunks.size(); ++c)
+    {
+        position_base[c] = position_count;
+        texcoord_base[c] = texcoord_count;
+        normal_base[c] = normal_count;
+        position_count += chunks[c].positions.size() / 3;
+        texcoord_count += chunks[c].texcoords.size() / 2;
+        normal_count += chunks[c].normals.size() / 3;
+    }
+
+    std::vector<float> positions(size_t(position_count) * 3), texcoords(size_t(texcoord_count) * 2), normals(size_t(normal_count) * 3);
+    std::vector<uint8_t> chunk_valid(chunks.size(), 1);
+
+    jobs.parallel_for(chunks.size(), 1, [&](const size_t begin, const size_t end)
+    {
+        for (size_t c = begin; c < end; ++c)
+        {
+            obj_chunk & chunk = chunks[c];
+            std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + position_base[c] * 3);
+            std::copy(chunk.texcoords.begin(), chunk.texcoords.end(), texcoords.begin() + texcoord_base[c] * 2);
+            std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + normal_base[c] * 3);
+
+            const int64_t bases[3] = { position_base[c], texcoord_base[c], normal_base[c] };
+            int32_t * components = reinterpret_cast<int32_t *>(chunk.corners.data());
+            for (const uint32_t slot : chunk.relative) components[slot] = int32_t(components[slot] + bases[slot % 3]);
+
+            for (const obj_corner & corner : chunk.corners)
+            {
+                if (corner.v < 0 || corner.v >= position_count) chunk_valid[c] = 0;
+                if (corner.t >= texcoord_count || corner.n >= normal_count || corner.t < -1 || corner.n < -1) chunk_valid[c] = 0;
+            }
+        }
+    });
+
+    if (std::find(chunk_valid.begin(), chunk_valid.end(), uint8_t(0)) != chunk_valid.end()) throw std::runtime_error("obj face index out of range in " + path);
+
+    // Material ids follow the order of `newmtl` in the referenced libraries; unknown names are appended
+    std::vector<std::string> material_names;
+    const bool has_parent = path.find_last_of("/\\") != std::string::npos;
+    const std::string parent_dir = has_parent ? parent_directory_from_filepath(path) + "/" : std::string();
+    for (const obj_chunk & chunk : chunks) for (const std::string & lib : chunk.mtllibs) read_material_names(parent_dir + lib, material_names);
+
+    std::unordered_map<std::string, uint32_t> material_ids;
+    for (uint32_t i = 0; i < material_names.size(); ++i) material_ids.emplace(material_names[i], i);
+
+    // Walk group/material switches in file order to assign every triangle range to a shape
+    std::vector<std::string> shape_names;
+    std::unordered_map<std::string, uint32_t> shape_ids;
+    std::vector<std::vector<obj_run>> shape_runs;
+    bool any_material = false;
+    {
+        std::string shape_name;
+        uint32_t material = kNoMaterial;
+
+        for (uint32_t c = 0; c < chunks.size(); ++c)
+        {
+            const obj_chunk & chunk = chunks[c];
+            const uint32_t triangle_count = static_cast<uint32_t>(chunk.corners.size() / 3);
+
+            uint32_t first = 0;
+            for (size_t e = 0; e <= chunk.events.size(); ++e)
+            {
+                const uint32_t last = (e < chunk.events.size()) ? chunk.events[e].face : triangle_count;
+                if (last > first)
+                {
+                    auto it = shape_ids.find(shape_name);
+                    if (it == shape_ids.end())
+                    {
+                        it = shape_ids.emplace(shape_name, static_cast<uint32_t>(shape_names.size())).first;
+                        shape_names.push_back(shape_name);
+                        shape_runs.emplace_back();
+                    }
+                    shape_runs[it->second].push_back({ c, first, last, material });
+                }
+                first = last;
+
+                if (e == chunk.events.size()) break;
+                const obj_event & event = chunk.events[e];
+                if (event.material)
+                {
+                    any_material = true;
+                    auto id = material_ids.find(event.name);
+                    if (id == material_ids.end()) id = material_ids.emplace(event.name, static_cast<uint32_t>(material_ids.size())).first;
+                    material = id->second;
+                }
+                else shape_name = event.name;
+            }
+        }
+    }
+
+    // Faces without usemtl get the id one past the named materials, like the default material appended before
+    const uint32_t default_material = static_cast<uint32_t>(material_ids.size());
+
+    std::vector<runtime_mesh> shapes(shape_names.size());
+    jobs.parallel_for(shapes.size(), 1, [&](const size_t begin, const size_t end)
+    {
+        for (size_t s = begin; s < end; ++s)
+        {
+            runtime_mesh & g = shapes[s];
+
+            size_t triangle_count = 0;
+            for (const obj_run & run : shape_runs[s]) triangle_count += run.last - run.first;
+
+            flat_index_map<unique_vertex> unique_vertices(triangle_count);
+            g.faces.reserve(triangle_count);
+            if (any_material) g.material.reserve(triangle_count);
+
+            bool has_texcoords = false, has_normals = false;
+            for (const obj_run & run : shape_runs[s])
+            {
+                const obj_corner * corners = chunks[run.chunk].corners.data();
+                for (uint32_t t = run.first; t < run.last; ++t)
+                {
+                    uint3 face;
+                    for (uint32_t k = 0; k < 3; ++k)
+                    {
+                        const obj_corner & corner = corners[t * 3 + k];
+
+                        unique_vertex vertex = {};
+                        vertex.position = { positions[corner.v * 3 + 0], positions[corner.v * 3 + 1], positions[corner.v * 3 + 2] };
+                        if (corner.t >= 0) { vertex.texcoord = { texcoords[corner.t * 2 + 0], texcoords[corner.t * 2 + 1] }; has_texcoords = true; }
+                        if (corner.n >= 0) { vertex.normal = { normals[corner.n * 3 + 0], normals[corner.n * 3 + 1], normals[corner.n * 3 + 2] }; has_normals = true; }
+
+                        face[k] = unique_vertices.insert(vertex);
+                    }
+
+                    g.faces.push_back(face);
+                    if (any_material) g.material.push_back(run.material == kNoMaterial ? default_material : run.material);
+                }
+            }
+
+            const std::vector<unique_vertex> & keys = unique_vertices.keys();
+            g.vertices.resize(keys.size());
+            for (size_t i = 0; i < keys.size(); ++i) g.vertices[i] = keys[i].position;
+
+            if (has_texcoords)
+            {
+                g.texcoord0.resize(keys.size());
+                for (size_t i = 0; i < keys.size(); ++i) g.texcoord0[i] = keys[i].texcoord;
+            }
+
+            // Optionally generate normals if the mesh was provided without them
+            if (has_normals)
+            {
+                g.normals.resize(keys.size());
+                for (size_t i = 0; i < keys.size(); ++i) g.normals[i] = keys[i].normal;
+            }
+            else compute_welded_normals(g);
+        }
+    });
+
+    std::unordered_map<std::string, runtime_mesh> meshes;
+    for (size_t s = 0; s < shapes.size(); ++s) meshes[shape_names[s]] = std::move(shapes[s]);
+    return meshes;
+}
@@ -333,7 +333,10 @@ int meshopt_decodeIndexBuffer(void* destination, size_t index_count, size_t inde
 	if (buffer_size < 1 + index_count / 3 + 16)
 		return -2;
 
-	if (buffer[0] != kIndexHeader)
+	// version 1 streams (written by newer encoders, e.g. in EXT_meshopt_compression files) add the reset
+	// and the +-1 deltas to the last free index (fec 13 and 14) below
+	int version = buffer[0] & 0x0f;
+	if ((buffer[0] & 0xf0) != kIndexHeader || version > 1)
 		return -1;
 
 	EdgeFifo edgefifo;
@@ -348,6 +351,8 @@ int meshopt_decodeIndexBuffer(void* destination, size_t index_count, size_t inde
 	unsigned int next = 0;
 	unsigned int last = 0;
 
+	int fecmax = version >= 1 ? 13 : 15;
+
 	// since we store 16-byte codeaux table at the end, triangle data has to begin before data_safe_end
 	const unsigned char* code = buffer + 1;
 	const unsigned char* data = code + index_count / 3;
@@ -377,7 +382,7 @@ int meshopt_decodeIndexBuffer(void* destination, size_t index_count, size_t inde
 
 			// note: this is the most common path in the entire decoder
 			// inside this if we try to stay branchless (by using cmov/etc.) since these aren't predictable
-			if (fec != 15)
+			if (fec < fecmax)
 			{
 				// fifo reads are wrapped around 16 entry buffer
 				unsigned int cf = vertexfifo[(vertexfifooffset - 1 - fec) & 15];
@@ -399,8 +404,9 @@ int meshopt_decodeIndexBuffer(void* destination, size_t index_count, size_t inde
 			{
 				unsigned int c = 0;
 
+				// fec - (fec ^ 3) decodes 13, 14 into -1, 1
 				// note that we need to update the last index since free indices are delta-encoded
-				last = c = decodeIndex(data, next, last);
+				last = c = (fec != 15) ? last + (fec - (fec ^ 3)) : decodeIndex(data, next, last);
 
 				// output triangle
 				writeTriangle(destination, i, index_size, a, b, c);
@@ -460,6 +466,10 @@ int meshopt_decodeIndexBuffer(void* destination, size_t index_count, size_t inde
 				int feb = codeaux >> 4;
 				int fec = codeaux & 15;
 
+				// reset: codeaux is 0 but encoded as not-a-table
+				if (codeaux == 0 && version >= 1)
+					next = 0;
+
 				// fifo reads are wrapped around 16 entry buffer
 				// also note that we increment next for all three vertices before decoding indices - this matches encoder behavior
 				unsigned int a = (fea == 0) ? next++ : 0;
@@ -10,8 +10,10 @@
 #include "polymer-core/util/simple-timer.hpp"
 #include "polymer-core/util/memory-pool.hpp"
 #include "polymer-core/util/file-io.hpp"
+#include "polymer-core/util/memory-mapped-file.hpp"
 #include "polymer-core/util/bit-mask.hpp"
 #include "polymer-core/util/thread-pool.hpp"
+#include "polymer-core/util/job-system.hpp"
 #include "polymer-core/util/guid.hpp"
 #include "polymer-core/util/timestamp.hpp"
 
@@ -20,6 +22,7 @@
 #include "polymer-core/tools/splines.hpp"
 #include "polymer-core/tools/simplex-noise.hpp"
 #include "polymer-core/tools/radix-sort.hpp"
+#include "polymer-core/tools/incremental-sort.hpp"
 #include "polymer-core/tools/quick-hull.hpp"
 #include "polymer-core/tools/poisson-disk.hpp"
 #include "polymer-core/tools/parallel-transport-frames.hpp"
@@ -29,6 +32,8 @@
 #include "polymer-core/tools/movement-tracker.hpp"
 #include "polymer-core/tools/algo-misc.hpp"
 #include "polymer-core/tools/bvh.hpp"
+#include "polymer-core/tools/mesh-bvh.hpp"
+#include "polymer-core/tools/dynamic-bvh.hpp"
 #include "polymer-core/tools/oriented-bounding-box.hpp"
 #include "polymer-core/tools/polynomial-solvers.hpp"
 #include "polymer-core/tools/colormap.hpp"
@@ -40,5 +45,6 @@
 #include "polymer-core/queues/queue-mpmc-bounded.hpp"
 #include "polymer-core/queues/queue-mpmc-blocking.hpp"
 #include "polymer-core/queues/queue-circular.hpp"
+#include "polymer-core/queues/queue-work-stealing.hpp"
 
 #endif // end lib_polymer_hpp
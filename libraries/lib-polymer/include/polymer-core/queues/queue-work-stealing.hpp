@@ -0,0 +1,141 @@
+// Chase-Lev work-stealing deque, using the C11 memory orderings from:
+// "Correct and Efficient Work-Stealing for Weak Memory Models" (Le, Pop, Cohen, Zappa Nardelli, PPoPP 2013)
+
+#pragma once
+
+#ifndef polymer_queue_work_stealing_hpp
+#define polymer_queue_work_stealing_hpp
+
+#include <assert.h>
+#include <atomic>
+#include <stdint.h>
+#include <memory>
+#include <vector>
+#include <type_traits>
+
+namespace polymer
+{
+    // The owning thread pushes and pops at the bottom (LIFO, cache-warm); any other thread may steal
+    // from the top (FIFO, oldest and usually largest work first). The ring grows on push and retired
+    // rings are kept alive until destruction, since a concurrent thief may still be reading one.
+    template<typename T>
+    class work_stealing_deque
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "work_stealing_deque stores items in std::atomic<T>");
+
+        struct ring
+        {
+            const int64_t capacity;
+            const int64_t mask;
+            std::unique_ptr<std::atomic<T>[]> items;
+
+            ring(const int64_t capacity) : capacity(capacity), mask(capacity - 1), items(new std::atomic<T>[capacity]) {}
+
+            T get(const int64_t i) const { return items[i & mask].load(std::memory_order_relaxed); }
+            void put(const int64_t i, const T x) { items[i & mask].store(x, std::memory_order_relaxed); }
+
+            ring * grow(const int64_t bottom, const int64_t top) const
+            {
+                ring * r = new ring(capacity * 2);
+                for (int64_t i = top; i != bottom; ++i) r->put(i, get(i));
+                return r;
+            }
+        };
+
+        typedef char cache_line_pad_t[64];
+
+        std::atomic<int64_t> top { 0 };
+        cache_line_pad_t pad0;
+        std::atomic<int64_t> bottom { 0 };
+        std::atomic<ring *> array;
+        cache_line_pad_t pad1;
+        std::vector<std::unique_ptr<ring>> rings; // owner-only
+
+        work_stealing_deque(const work_stealing_deque &) = delete;
+        work_stealing_deque & operator= (const work_stealing_deque &) = delete;
+
+    public:
+
+        work_stealing_deque(const int64_t capacity = 1024)
+        {
+            assert((capacity != 0) && ((capacity & (capacity - 1)) == 0)); // enforce power of 2
+            rings.emplace_back(new ring(capacity));
+            array.store(rings.back().get(), std::memory_order_relaxed);
+        }
+
+        // Owner thread only
+        void push(const T x)
+        {
+            const int64_t b = bottom.load(std::memory_order_relaxed);
+            const int64_t t = top.load(std::memory_order_acquire);
+            ring * a = array.load(std::memory_order_relaxed);
+
+            if (b - t > a->capacity - 1)
+            {
+                rings.emplace_back(a->grow(b, t));
+                a = rings.back().get();
+                array.store(a, std::memory_order_release);
+            }
+
+            // Release on bottom (rather than a standalone fence) publishes both the slot and whatever x
+            // points at to a thief that acquires bottom, and is something race detectors can follow
+            a->put(b, x);
+            bottom.store(b + 1, std::memory_order_release);
+        }
+
+        // Owner thread only
+        bool pop(T & output)
+        {
+            const int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+            ring * a = array.load(std::memory_order_relaxed);
+            bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t t = top.load(std::memory_order_relaxed);
+
+            if (t > b)
+            {
+                // Empty
+                bottom.store(b + 1, std::memory_order_relaxed);
+                return false;
+            }
+
+            output = a->get(b);
+            if (t == b)
+            {
+                // Last item, race against thieves for it
+                const bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+                bottom.store(b + 1, std::memory_order_relaxed);
+                return won;
+            }
+
+            return true;
+        }
+
+        // Any thread
+        bool steal(T & output)
+        {
+            int64_t t = top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            const int64_t b = bottom.load(std::memory_order_acquire);
+
+            if (t >= b) return false;
+
+            ring * a = array.load(std::memory_order_consume);
+            output = a->get(t);
+            return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        }
+
+        // Approximate when called concurrently with push/pop/steal
+        size_t size() const
+        {
+            const int64_t b = bottom.load(std::memory_order_relaxed);
+            const int64_t t = top.load(std::memory_order_relaxed);
+            return static_cast<size_t>(b > t ? b - t : 0);
+        }
+
+        bool empty() const { return size() == 0; }
+    };
+
+} // end namespace polymer
+
+#endif // end polymer_queue_work_stealing_hpp
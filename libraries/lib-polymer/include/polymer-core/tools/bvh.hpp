@@ -14,8 +14,13 @@
 
 #include "polymer-core/math/math-core.hpp"
 #include "polymer-core/util/util.hpp"
+#include "polymer-core/util/cpu-features.hpp"
+#include "polymer-core/util/job-system.hpp"
+#include "polymer-core/tools/radix-sort.hpp"
 
 #include <sstream>
+#include <atomic>
+#include <thread>
 
 #define POLYMER_BVH_DEBUG_SPAM
 
@@ -48,7 +53,7 @@ namespace polymer
             inline bool all() const { return _mm_movemask_ps(v) == 0xF; }
         };
 
-        inline bool intersect_ray_box_avx2(const ray & ray, const aabb_3d & box, float & out_t)
+        POLYMER_TARGET_AVX2 inline bool intersect_ray_box_avx2(const ray & ray, const aabb_3d & box, float & out_t)
         {
             float4_simd invDir = float4_simd(ray.inverse_direction());
             float4_simd divDir = float4_simd(ray.origin / invDir.l.xyz());
@@ -111,15 +116,45 @@ namespace polymer
         bvh_node_type type { bvh_node_type::root };
     };
 
+    // Depth-first flattened node (32 bytes, two per cache line). The left child of an internal node
+    // immediately follows it in the array and the right child lives at `offset`. Leaves instead reference
+    // `count` objects starting at `offset` in the flattened object list.
+    struct alignas(32) bvh_flat_node
+    {
+        float3 bmin;
+        uint32_t offset {0};
+        float3 bmax;
+        uint32_t count {0}; // 0 for internal nodes
+
+        bool is_leaf() const { return count > 0; }
+        aabb_3d bounds() const { return { bmin, bmax }; }
+    };
+    static_assert(sizeof(bvh_flat_node) == 32, "bvh_flat_node should be 32 bytes");
+
     // "The main disadvantage of the LBVH algorithm is that it does not build hierarchies that are optimized for 
     // performance in raytracing since it uniormly subdivides space at the median" [2]. It's also non-ideal for scenes
     // with highly non-uniform distributions, which might be improved by using [3].
+    //
+    // binned_sah builds top-down, choosing each split with the surface area heuristic evaluated over a fixed
+    // number of centroid bins ("On fast Construction of SAH-based Bounding Volume Hierarchies", Wald 2007).
+    // It is slower to build but produces far better trees for large static scenes. Incremental insert/remove
+    // is only supported by the lbvh mode; in binned_sah mode those operations rebuild.
+    enum class bvh_build_mode
+    {
+        lbvh,
+        binned_sah
+    };
 
     class bvh_tree
     {
-        typedef std::pair<uint64_t, bvh_node_data*> bvh_morton_pair;
+        bvh_build_mode mode { bvh_build_mode::lbvh };
 
-        bvh_node * root {nullptr};                  // Root scene node of the tree
+        bvh_node * root {nullptr};                  // Root scene node of the tree (lbvh mode only)
+
+        // Both build modes produce these for traversal
+        std::vector<bvh_flat_node> flat_nodes;
+        std::vector<bvh_node_data *> flat_objects;
+        uint32_t flat_depth {0};
 
         std::vector<bvh_node_data *> objects;         // Convenience container for tree reconstruction (prevents the need of a full-traversal).
         std::vector<bvh_node_data *> staged_objects;  // Newly added objects that are waiting to be added to the tree.
@@ -128,6 +163,11 @@ namespace polymer
         float3 morton_scale{ 0.f };
         float3 morton_offset{ 0.f };
 
+        // Sorted morton codes and their objects for the lbvh build, kept to reuse memory across rebuilds
+        std::vector<uint64_t> morton_codes;
+        std::vector<bvh_node_data *> morton_objects;
+        radix_sort morton_sorter;
+
         const uint64_t get_normalized_morton(const float3 & coordinate) const
         {
             assert(morton_scale != float3(0.f));
@@ -157,17 +197,19 @@ namespace polymer
 
     public:
 
-        bvh_tree() = default;
+        bvh_tree(const bvh_build_mode mode = bvh_build_mode::lbvh) : mode(mode) {}
         ~bvh_tree() { destroy(); }
 
+        bvh_build_mode get_build_mode() const { return mode; }
+
         void destroy()
         {
-            if (root)
-            {
-                destroy_recursive(root);
-                objects.clear();
-                staged_objects.clear();
-            }
+            destroy_recursive(root);
+            root = nullptr;
+            objects.clear();
+            staged_objects.clear();
+            flat_nodes.clear();
+            flat_objects.clear();
         }
 
         bool contains(bvh_node_data * object, bool check_new) const 
@@ -190,7 +232,23 @@ namespace polymer
         {
             bool result = false;
 
-            if (object)
+            if (object && mode == bvh_build_mode::binned_sah)
+            {
+                auto staged = std::find(staged_objects.begin(), staged_objects.end(), object);
+                if (staged != staged_objects.end())
+                {
+                    staged_objects.erase(staged);
+                    return true;
+                }
+
+                auto found = std::find(objects.begin(), objects.end(), object);
+                if (found == objects.end()) return false;
+                objects.erase(found);
+                build_binned_sah();
+                return true;
+            }
+
+            if (object && root)
             {
                 bvh_node * leaf = find_parent_leaf_for_object(root, object);
 
@@ -275,6 +333,7 @@ namespace polymer
                         }
                     }
 
+                    flatten_lbvh();
                     result = true;
                 }
             }
@@ -342,13 +401,32 @@ namespace polymer
             print_recursive(print_recursive, root);
         } 
 
+        // Read-only view of the flattened tree, e.g. for debug drawing
+        const std::vector<bvh_flat_node> & get_flat_nodes() const { return flat_nodes; }
+        const std::vector<bvh_node_data *> & get_flat_objects() const { return flat_objects; }
+
+        // Expected cost of a random ray query under the surface area heuristic (traversal and
+        // intersection cost of 1). Lower is better; useful for comparing build modes.
+        float compute_sah_cost() const
+        {
+            if (flat_nodes.empty()) return 0.f;
+            const float root_area = std::max(half_surface_area(flat_nodes[0].bmin, flat_nodes[0].bmax), 1e-12f);
+            float cost = 0.f;
+            for (const bvh_flat_node & n : flat_nodes)
+            {
+                const float a = half_surface_area(n.bmin, n.bmax) / root_area;
+                cost += n.is_leaf() ? a * n.count : a;
+            }
+            return cost;
+        }
+
         bool intersect(const ray & ray, std::vector<std::pair<bvh_node_data*, float>> & results) const
         {
             {
                 //scoped_timer t("bvh-intersect");
                 results.reserve(objects.size()); // worst case
 
-                intersect_internal(root, ray, results);
+                intersect_internal(ray, results);
 
                 std::sort(results.begin(), results.end(), [](auto & first, auto & second) -> bool
                 {
@@ -364,58 +442,113 @@ namespace polymer
         std::vector<bvh_node_data*> find_visible_nodes(const frustum & camera_frustum)
         {
             std::vector<bvh_node_data*> visible_set;
-            find_visible_nodes_internal(root, camera_frustum, visible_set);
+            find_visible_nodes_internal(camera_frustum, visible_set);
             return visible_set;
         }
 
     private: 
 
-        void intersect_internal(bvh_node * node, const ray & ray, std::vector<std::pair<bvh_node_data*, float>> & results) const
+        static float half_surface_area(const float3 & bmin, const float3 & bmax)
         {
-            if (node)
-            {   
-                // Non-SIMD path
-                float outMinT;
-                const bool hit = intersect_ray_box(ray, node->bounds.min(), node->bounds.max(), &outMinT);
+            const float3 d = bmax - bmin;
+            return d.x * d.y + d.y * d.z + d.z * d.x;
+        }
+
+        // Slab test against a node with the ray's reciprocal direction precomputed. Matches the
+        // conventions of intersect_ray_box: the ray starts at t = 0 and tmin is 0 for an origin inside.
+        static bool intersect_ray_node(const float3 & origin, const float3 & inv_dir, const bvh_flat_node & node)
+        {
+            const float3 t1 = (node.bmin - origin) * inv_dir;
+            const float3 t2 = (node.bmax - origin) * inv_dir;
+            const float3 near = linalg::min(t1, t2);
+            const float3 far = linalg::max(t1, t2);
+            const float tmin = std::max(maxelem(near), 0.f);
+            const float tmax = minelem(far);
+            return tmin <= tmax && tmax > PLANE_EPSILON;
+        }
+
+        // Iterative traversal over the flattened tree with an explicit stack. Internal nodes are culled
+        // with a branch-light slab test; objects in leaves are tested with intersect_ray_box so the
+        // reported distances are unchanged from the pointer-based traversal.
+        void intersect_internal(const ray & ray, std::vector<std::pair<bvh_node_data*, float>> & results) const
+        {
+            if (flat_nodes.empty()) return;
+
+            const float3 inv_dir = ray.inverse_direction();
+
+            uint32_t local_stack[64];
+            std::vector<uint32_t> heap_stack;
+            uint32_t * stack = local_stack;
+            if (flat_depth > 64) { heap_stack.resize(flat_depth); stack = heap_stack.data(); }
+            uint32_t stack_size = 0;
+            uint32_t node_index = 0;
 
-                // AVX2 SIMD path
-                //float outMinT;
-                //const bool hit = simd::intersect_ray_box_avx2(ray, node->bounds, outMinT);
+            while (true)
+            {
+                const bvh_flat_node & node = flat_nodes[node_index];
+                hit_test_count++;
 
-                if (hit)
+                if (intersect_ray_node(ray.origin, inv_dir, node))
                 {
-                    // Check for object on this node (handles both leaf nodes and single-object root case)
-                    if (node->object)
+                    if (node.is_leaf())
                     {
-                        results.emplace_back(std::make_pair(node->object, outMinT));
+                        for (uint32_t i = node.offset; i < node.offset + node.count; ++i)
+                        {
+                            float outMinT;
+                            const aabb_3d & b = flat_objects[i]->bounds;
+                            if (intersect_ray_box(ray, b.min(), b.max(), &outMinT)) results.emplace_back(flat_objects[i], outMinT);
+                        }
                     }
                     else
                     {
-                        intersect_internal(node->left, ray, results);
-                        intersect_internal(node->right, ray, results);
+                        stack[stack_size++] = node.offset;
+                        node_index = node_index + 1;
+                        continue;
                     }
                 }
-                hit_test_count++;
+
+                if (stack_size == 0) break;
+                node_index = stack[--stack_size];
             }
         }
 
-        void find_visible_nodes_internal(bvh_node * node, const frustum & camera_frustum, std::vector<bvh_node_data*> & objects) const
+        void find_visible_nodes_internal(const frustum & camera_frustum, std::vector<bvh_node_data*> & visible) const
         {
-            if (node)
+            if (flat_nodes.empty()) return;
+
+            uint32_t local_stack[64];
+            std::vector<uint32_t> heap_stack;
+            uint32_t * stack = local_stack;
+            if (flat_depth > 64) { heap_stack.resize(flat_depth); stack = heap_stack.data(); }
+            uint32_t stack_size = 0;
+            uint32_t node_index = 0;
+
+            while (true)
             {
-                if (camera_frustum.intersects(node->bounds.center(), node->bounds.size()))
+                const bvh_flat_node & node = flat_nodes[node_index];
+                const float3 center = (node.bmin + node.bmax) * 0.5f;
+                const float3 size = node.bmax - node.bmin;
+
+                if (camera_frustum.intersects(center, size))
                 {
-                    // Check for object on this node (handles both leaf nodes and single-object root case)
-                    if (node->object)
+                    if (node.is_leaf())
                     {
-                        objects.emplace_back(node->object);
+                        for (uint32_t i = node.offset; i < node.offset + node.count; ++i)
+                        {
+                            const aabb_3d & b = flat_objects[i]->bounds;
+                            if (node.count == 1 || camera_frustum.intersects(b.center(), b.size())) visible.emplace_back(flat_objects[i]);
+                        }
                     }
                     else
                     {
-                        find_visible_nodes_internal(node->left, camera_frustum, objects);
-                        find_visible_nodes_internal(node->right, camera_frustum, objects);
+                        stack[stack_size++] = node.offset;
+                        node_index = node_index + 1;
+                        continue;
                     }
                 }
+
+                if (stack_size == 0) break;
+                node_index = stack[--stack_size];
             }
         }
 
@@ -424,6 +557,7 @@ namespace polymer
         void rebuild_internal()
         {
             destroy_recursive(root);
+            root = nullptr;
 
             if (staged_objects.size() > 0)
             {
@@ -432,11 +566,45 @@ namespace polymer
                 staged_objects.clear();
             }
 
-            build_internal();
+            if (mode == bvh_build_mode::binned_sah)
+            {
+                build_binned_sah();
+            }
+            else
+            {
+                build_internal();
+                flatten_lbvh();
+            }
         }
 
         void refit_internal()
         {
+            if (mode == bvh_build_mode::binned_sah)
+            {
+                // New objects need a rebuild; otherwise refit the flattened bounds in place. Children
+                // always follow their parent in the depth-first array, so a reverse sweep is bottom-up.
+                if (!staged_objects.empty()) { rebuild_internal(); return; }
+
+                for (size_t n = flat_nodes.size(); n-- > 0;)
+                {
+                    bvh_flat_node & node = flat_nodes[n];
+                    aabb_3d b;
+                    if (node.is_leaf())
+                    {
+                        b = flat_objects[node.offset]->bounds;
+                        for (uint32_t i = node.offset + 1; i < node.offset + node.count; ++i) b.surround(flat_objects[i]->bounds);
+                    }
+                    else
+                    {
+                        b = flat_nodes[n + 1].bounds();
+                        b.surround(flat_nodes[node.offset].bounds());
+                    }
+                    node.bmin = b.min();
+                    node.bmax = b.max();
+                }
+                return;
+            }
+
             for (auto & staged_obj : staged_objects)
             {
                 objects.push_back(staged_obj);
@@ -446,8 +614,329 @@ namespace polymer
             staged_objects.clear();
 
             fit_bounds_recursive(root);
+            flatten_lbvh();
+        }
+
+        // Writes the pointer-based lbvh into the depth-first flat layout used for traversal
+        void flatten_lbvh()
+        {
+            flat_nodes.clear();
+            flat_objects.clear();
+            flat_depth = 0;
+            if (!root) return;
+
+            flat_nodes.reserve(objects.size() * 2);
+            flat_objects.reserve(objects.size());
+
+            struct pending { const bvh_node * node; uint32_t patch; uint32_t depth; };
+            std::vector<pending> stack = { { root, UINT32_MAX, 1 } };
+
+            while (!stack.empty())
+            {
+                const pending p = stack.back();
+                stack.pop_back();
+
+                const bvh_node * node = p.node;
+
+                // Collapse the single-child root so that every internal node has two children
+                if (!node->object && (!node->left || !node->right))
+                {
+                    const bvh_node * only = node->left ? node->left : node->right;
+                    if (only) stack.push_back({ only, p.patch, p.depth });
+                    continue;
+                }
+
+                const uint32_t index = static_cast<uint32_t>(flat_nodes.size());
+                if (p.patch != UINT32_MAX) flat_nodes[p.patch].offset = index;
+                flat_depth = std::max(flat_depth, p.depth);
+
+                bvh_flat_node flat;
+                flat.bmin = node->bounds.min();
+                flat.bmax = node->bounds.max();
+
+                if (node->object)
+                {
+                    flat.offset = static_cast<uint32_t>(flat_objects.size());
+                    flat.count = 1;
+                    flat_objects.push_back(node->object);
+                    flat_nodes.push_back(flat);
+                }
+                else
+                {
+                    flat_nodes.push_back(flat);
+                    stack.push_back({ node->right, index, p.depth + 1 });
+                    stack.push_back({ node->left, UINT32_MAX, p.depth + 1 });
+                }
+            }
+        }
+
+        /////////////////////////////////
+        //   binned SAH construction   //
+        /////////////////////////////////
+
+        static const uint32_t kSahBins = 16;
+        static const uint32_t kSahMaxLeafSize = 4;
+        static const uint32_t kSahParallelThreshold = 4096; // below this many objects a subtree is built serially
+
+        struct sah_build_state
+        {
+            std::vector<aabb_3d> bounds;
+            std::vector<float3> centroids;
+            std::vector<uint32_t> indices;
+        };
+
+        struct sah_range
+        {
+            uint32_t first, last;   // [first, last) into sah_build_state::indices
+            aabb_3d bounds;
+        };
+
+        // Finds the best binned SAH split of a range and partitions the indices around it. Returns the
+        // partition point, or `r.first` when the range should become a leaf.
+        static uint32_t partition_sah(sah_build_state & state, const sah_range & r)
+        {
+            const uint32_t count = r.last - r.first;
+            if (count <= 1) return r.first;
+
+            aabb_3d centroid_bounds(state.centroids[state.indices[r.first]], state.centroids[state.indices[r.first]]);
+            for (uint32_t i = r.first + 1; i < r.last; ++i) centroid_bounds.surround(state.centroids[state.indices[i]]);
+
+            struct bin { aabb_3d bounds; uint32_t count {0}; };
+
+            float best_cost = std::numeric_limits<float>::max();
+            int best_axis = -1;
+            uint32_t best_bin = 0;
+
+            const float3 cmin = centroid_bounds.min();
+            const float3 extent = centroid_bounds.size();
+
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                if (extent[axis] <= 1e-12f) continue;
+                const float scale = kSahBins / extent[axis];
+
+                bin bins[kSahBins];
+                for (uint32_t i = r.first; i < r.last; ++i)
+                {
+                    const uint32_t prim = state.indices[i];
+                    const uint32_t b = std::min(kSahBins - 1, static_cast<uint32_t>((state.centroids[prim][axis] - cmin[axis]) * scale));
+                    if (bins[b].count++ == 0) bins[b].bounds = state.bounds[prim];
+                    else bins[b].bounds.surround(state.bounds[prim]);
+                }
+
+                // Sweep from the right to accumulate suffix areas, then from the left to evaluate each plane
+                float right_area[kSahBins];
+                uint32_t right_count[kSahBins];
+                aabb_3d acc; uint32_t n = 0;
+                for (uint32_t b = kSahBins - 1; b > 0; --b)
+                {
+                    if (bins[b].count) { acc = n ? acc.add(bins[b].bounds) : bins[b].bounds; n += bins[b].count; }
+                    right_area[b] = n ? half_surface_area(acc.min(), acc.max()) : 0.f;
+                    right_count[b] = n;
+                }
+
+                n = 0;
+                for (uint32_t b = 0; b < kSahBins - 1; ++b)
+                {
+                    if (bins[b].count) { acc = n ? acc.add(bins[b].bounds) : bins[b].bounds; n += bins[b].count; }
+                    if (n == 0 || right_count[b + 1] == 0) continue;
+                    const float cost = half_surface_area(acc.min(), acc.max()) * n + right_area[b + 1] * right_count[b + 1];
+                    if (cost < best_cost) { best_cost = cost; best_axis = axis; best_bin = b; }
+                }
+            }
+
+            // Compare against not splitting at all (traversal and intersection costs of 1)
+            const float parent_area = std::max(half_surface_area(r.bounds.min(), r.bounds.max()), 1e-12f);
+            const float split_cost = 1.f + best_cost / parent_area;
+
+            if (best_axis < 0)
+            {
+                // All centroids coincide: nothing to gain from SAH, but keep leaves bounded
+                if (count <= kSahMaxLeafSize) return r.first;
+                return r.first + count / 2;
+            }
+
+            if (count <= kSahMaxLeafSize && split_cost >= static_cast<float>(count)) return r.first;
+
+            const float scale = kSahBins / extent[best_axis];
+            const auto mid = std::partition(state.indices.begin() + r.first, state.indices.begin() + r.last, [&](const uint32_t prim)
+            {
+                const uint32_t b = std::min(kSahBins - 1, static_cast<uint32_t>((state.centroids[prim][best_axis] - cmin[best_axis]) * scale));
+                return b <= best_bin;
+            });
+
+            return static_cast<uint32_t>(mid - state.indices.begin());
+        }
+
+        static aabb_3d compute_range_bounds(const sah_build_state & state, const uint32_t first, const uint32_t last)
+        {
+            aabb_3d b = state.bounds[state.indices[first]];
+            for (uint32_t i = first + 1; i < last; ++i) b.surround(state.bounds[state.indices[i]]);
+            return b;
+        }
+
+        // Builds the subtree over a range into `out` in depth-first order. Internal node offsets are
+        // relative to the start of `out`; leaf offsets index sah_build_state::indices directly.
+        static uint32_t build_sah_subtree(sah_build_state & state, const sah_range & root_range, std::vector<bvh_flat_node> & out)
+        {
+            struct pending { sah_range r; uint32_t patch; uint32_t depth; };
+            std::vector<pending> stack = { { root_range, UINT32_MAX, 1 } };
+            uint32_t max_depth = 0;
+
+            while (!stack.empty())
+            {
+                const pending p = stack.back();
+                stack.pop_back();
+
+                const uint32_t index = static_cast<uint32_t>(out.size());
+                if (p.patch != UINT32_MAX) out[p.patch].offset = index;
+                max_depth = std::max(max_depth, p.depth);
+
+                bvh_flat_node node;
+                node.bmin = p.r.bounds.min();
+                node.bmax = p.r.bounds.max();
+
+                const uint32_t mid = partition_sah(state, p.r);
+                if (mid == p.r.first)
+                {
+                    node.offset = p.r.first;
+                    node.count = p.r.last - p.r.first;
+                    out.push_back(node);
+                }
+                else
+                {
+                    out.push_back(node);
+                    const sah_range left = { p.r.first, mid, compute_range_bounds(state, p.r.first, mid) };
+                    const sah_range right = { mid, p.r.last, compute_range_bounds(state, mid, p.r.last) };
+                    stack.push_back({ right, index, p.depth + 1 });
+                    stack.push_back({ left, UINT32_MAX, p.depth + 1 });
+                }
+            }
+
+            return max_depth;
+        }
+
+        void build_binned_sah()
+        {
+            #ifdef POLYMER_BVH_DEBUG_SPAM
+            scoped_timer t("[bvh_tree] build_binned_sah - " + std::to_string(objects.size()) + " objects.");
+            #endif
+
+            flat_objects.clear();
+
+            std::vector<aabb_3d> bounds(objects.size());
+            for (size_t i = 0; i < objects.size(); ++i) bounds[i] = objects[i]->bounds;
+
+            std::vector<uint32_t> order;
+            flat_depth = build_binned_sah(std::move(bounds), flat_nodes, order);
+
+            flat_objects.resize(order.size());
+            for (size_t i = 0; i < order.size(); ++i) flat_objects[i] = objects[order[i]];
+        }
+
+    public:
+
+        // Builds a binned SAH hierarchy directly over primitive bounds, for callers that would rather not
+        // allocate a bvh_node_data per primitive (e.g. the triangles of a mesh). On return `order` lists the
+        // primitive indices in leaf order, which is what leaf offsets index. Returns the depth of the tree.
+        static uint32_t build_binned_sah(std::vector<aabb_3d> bounds, std::vector<bvh_flat_node> & flat_nodes, std::vector<uint32_t> & order)
+        {
+            flat_nodes.clear();
+            order.clear();
+            uint32_t flat_depth = 0;
+
+            const uint32_t num_objects = static_cast<uint32_t>(bounds.size());
+            if (num_objects == 0) return 0;
+
+            sah_build_state state;
+            state.bounds = std::move(bounds);
+            state.centroids.resize(num_objects);
+            state.indices.resize(num_objects);
+            for (uint32_t i = 0; i < num_objects; ++i)
+            {
+                state.centroids[i] = state.bounds[i].center();
+                state.indices[i] = i;
+            }
+
+            // Split serially near the root until there are enough independent subtrees to keep every
+            // core busy, then build those subtrees in parallel and splice them together depth-first.
+            struct top_node { aabb_3d bounds; int32_t left {-1}; int32_t right {-1}; int32_t task {-1}; };
+            std::vector<top_node> top;
+            std::vector<sah_range> tasks;
+
+            const uint32_t num_threads = default_job_system().num_threads();
+            const uint32_t top_depth = (num_threads > 1) ? std::min(8u, 2u + static_cast<uint32_t>(std::log2(num_threads))) : 0;
+
+            const auto split_top = [&](const auto & self, const sah_range & r, const uint32_t depth) -> int32_t
+            {
+                const int32_t index = static_cast<int32_t>(top.size());
+                top.push_back({ r.bounds });
+
+                const uint32_t mid = (depth < top_depth && (r.last - r.first) > kSahParallelThreshold) ? partition_sah(state, r) : r.first;
+                if (mid == r.first)
+                {
+                    top[index].task = static_cast<int32_t>(tasks.size());
+                    tasks.push_back(r);
+                    return index;
+                }
+
+                const int32_t l = self(self, { r.first, mid, compute_range_bounds(state, r.first, mid) }, depth + 1);
+                const int32_t rr = self(self, { mid, r.last, compute_range_bounds(state, mid, r.last) }, depth + 1);
+                top[index].left = l;
+                top[index].right = rr;
+                return index;
+            };
+
+            split_top(split_top, { 0, num_objects, compute_range_bounds(state, 0, num_objects) }, 0);
+
+            std::vector<std::vector<bvh_flat_node>> subtrees(tasks.size());
+            std::vector<uint32_t> subtree_depths(tasks.size(), 0);
+
+            // Subtrees touch disjoint ranges of state.indices, so jobs never share writes
+            parallel_for(tasks.size(), 1, [&](const size_t begin, const size_t end)
+            {
+                for (size_t k = begin; k < end; ++k) subtree_depths[k] = build_sah_subtree(state, tasks[k], subtrees[k]);
+            });
+
+            // Splice the top nodes and subtrees into one depth-first array
+            size_t total_nodes = top.size();
+            for (const auto & st : subtrees) total_nodes += st.size();
+            flat_nodes.reserve(total_nodes);
+
+            const auto splice = [&](const auto & self, const int32_t index, const uint32_t depth) -> void
+            {
+                const top_node & n = top[index];
+                if (n.task >= 0)
+                {
+                    const uint32_t base = static_cast<uint32_t>(flat_nodes.size());
+                    for (bvh_flat_node node : subtrees[n.task])
+                    {
+                        if (!node.is_leaf()) node.offset += base;
+                        flat_nodes.push_back(node);
+                    }
+                    flat_depth = std::max(flat_depth, depth + subtree_depths[n.task]);
+                    return;
+                }
+
+                const uint32_t flat_index = static_cast<uint32_t>(flat_nodes.size());
+                bvh_flat_node node;
+                node.bmin = n.bounds.min();
+                node.bmax = n.bounds.max();
+                flat_nodes.push_back(node);
+
+                self(self, n.left, depth + 1);
+                flat_nodes[flat_index].offset = static_cast<uint32_t>(flat_nodes.size());
+                self(self, n.right, depth + 1);
+            };
+
+            splice(splice, 0, 0);
+
+            order = std::move(state.indices);
+            return flat_depth;
         }
 
+    private:
+
         void destroy_recursive(bvh_node * node) const
         {
             if (node)
@@ -583,9 +1072,7 @@ namespace polymer
             scoped_timer t("[bvh_tree] build_internal");
             #endif
 
-            // Generate the morton codes for each scene object and sort them.
-            // This first block could be parallelized across multiple threads. 
-            std::vector<bvh_morton_pair> sorted_pairs;
+            // Generate the morton codes for each scene object and sort them, both across threads
             {
                 #ifdef POLYMER_BVH_DEBUG_SPAM
                 scoped_timer t("[bvh_tree] compute and sort morton codes - " + std::to_string(objects.size()) + " objects.");
@@ -593,17 +1080,18 @@ namespace polymer
 
                 compute_normalized_morton_scale();
 
-                // Create and sort codes
-                for (bvh_node_data * object : objects)
+                morton_codes.resize(objects.size());
+                morton_objects.resize(objects.size());
+                parallel_for(objects.size(), kMortonGrain, [&](const size_t begin, const size_t end)
                 {
-                    const auto morton_code = get_normalized_morton(object->bounds.center());
-                    sorted_pairs.push_back(std::make_pair(morton_code, object));
-                }
-
-                std::sort(sorted_pairs.begin(), sorted_pairs.end(), [](bvh_morton_pair const & a, bvh_morton_pair const & b)
-                {
-                    return (a.first < b.first);
+                    for (size_t i = begin; i < end; ++i)
+                    {
+                        morton_codes[i] = get_normalized_morton(objects[i]->bounds.center());
+                        morton_objects[i] = objects[i];
+                    }
                 });
+
+                morton_sorter.sort_pairs(morton_codes, morton_objects);
             }
 
             /* @todo - handle duplicate morton codes */
@@ -618,7 +1106,7 @@ namespace polymer
 
                 if (num_objects > 0)
                 {
-                    root = make_tree_recursive(nullptr, sorted_pairs, 0, num_objects - 1);
+                    root = make_tree_recursive(nullptr, 0, num_objects - 1);
                     root->type = bvh_node_type::root;
                 }
                 else
@@ -638,8 +1126,10 @@ namespace polymer
             }
         }
 
+        static const size_t kMortonGrain = 16384; // objects per task when computing codes
+
         // Recursively generates the tree in a top-down manner beginning at the root
-        bvh_node * make_tree_recursive(bvh_node * parent, std::vector<bvh_morton_pair> const & pairs, const uint32_t first, const uint32_t last) const
+        bvh_node * make_tree_recursive(bvh_node * parent, const uint32_t first, const uint32_t last) const
         {
             bvh_node * result = new bvh_node();
             result->parent = parent;
@@ -648,28 +1138,28 @@ namespace polymer
             if (first == last)
             {
                 result->type = bvh_node_type::leaf;
-                result->morton = pairs[first].first;
-                result->object = pairs[first].second;
+                result->morton = morton_codes[first];
+                result->object = morton_objects[first];
             }
             else
             {
                 // The split has multiple objects (internal node)
-                const uint32_t split = find_split(pairs, first, last);
+                const uint32_t split = find_split(first, last);
                 result->type = bvh_node_type::internal;
-                result->left = make_tree_recursive(result, pairs, first, split);
-                result->right = make_tree_recursive(result, pairs, split + 1, last);
+                result->left = make_tree_recursive(result, first, split);
+                result->right = make_tree_recursive(result, split + 1, last);
             }
 
             return result;
         }
 
         // Finds the index to split the remaining objects to fit the tree
-        uint32_t find_split(const std::vector<bvh_morton_pair> & pairs, const uint32_t first, const uint32_t last) const
+        uint32_t find_split(const uint32_t first, const uint32_t last) const
         {
             uint32_t result = first;
 
-            const uint64_t firstCode = pairs[first].first;
-            const uint64_t lastCode = pairs[last].first;
+            const uint64_t firstCode = morton_codes[first];
+            const uint64_t lastCode = morton_codes[last];
 
             // Identical morton codes: split range in the middle
             if (firstCode == lastCode)
@@ -693,7 +1183,7 @@ namespace polymer
                     proposed_split = result + step_size;
                     if (proposed_split < last)
                     {
-                        const uint64_t split = pairs[proposed_split].first;
+                        const uint64_t split = morton_codes[proposed_split];
                         const uint32_t prefix = clz64(firstCode ^ split);
                         if (prefix > common_prefix) result = proposed_split;
      
@@ -752,6 +1242,459 @@ namespace polymer
         }
     };
 
+    ///////////////////////
+    //   bvh_wide_tree   //
+    ///////////////////////
+
+    // A 4- or 8-wide BVH (MBVH) collapsed from a built bvh_tree. The children of each node are stored as
+    // structure-of-arrays so that a ray can be slab-tested against all of them with one sequence of SSE
+    // (4-wide) or AVX2 (8-wide) instructions. The kernel is chosen at runtime from the CPU features, with
+    // a scalar fallback, so binaries built without -mavx2 still take the fast path where it exists.
+    template <uint32_t N>
+    struct alignas(32) bvh_wide_node
+    {
+        static_assert(N == 4 || N == 8, "bvh_wide_node supports widths of 4 and 8");
+
+        float bmin_x[N], bmin_y[N], bmin_z[N];
+        float bmax_x[N], bmax_y[N], bmax_z[N];
+        uint32_t child[N];          // wide node index for internal children, first flat object for leaves
+        uint32_t count[N];          // object count for leaf children, 0 for internal children
+        uint32_t num_children {0};  // lanes at or past this are unused
+    };
+
+    // A ray with its reciprocal direction precomputed, as consumed by the traversal kernels
+    struct bvh_ray
+    {
+        float o[3];
+        float inv[3];
+        bvh_ray(const ray & r)
+        {
+            const float3 inv_dir = r.inverse_direction();
+            for (int i = 0; i < 3; ++i) { o[i] = r.origin[i]; inv[i] = inv_dir[i]; }
+        }
+    };
+
+    // Up to 8 rays in structure-of-arrays form. Packets work best when the rays are coherent, e.g. a
+    // pixel block of a mouse-picking sweep, because the whole packet descends into any child hit by one ray.
+    struct alignas(32) bvh_ray_packet
+    {
+        static constexpr uint32_t kSize = 8;
+        float ox[kSize], oy[kSize], oz[kSize];
+        float ix[kSize], iy[kSize], iz[kSize];
+        uint32_t size {0};
+
+        bvh_ray_packet(const ray * rays, const uint32_t count)
+        {
+            size = std::min(count, kSize);
+            for (uint32_t i = 0; i < kSize; ++i)
+            {
+                // Pad with copies of the first ray so that the unused lanes stay finite
+                const bvh_ray r(rays[i < size ? i : 0]);
+                ox[i] = r.o[0]; oy[i] = r.o[1]; oz[i] = r.o[2];
+                ix[i] = r.inv[0]; iy[i] = r.inv[1]; iz[i] = r.inv[2];
+            }
+        }
+    };
+
+    namespace simd
+    {
+        // Returns a bitmask of the children of `n` hit by the ray. Same conventions as intersect_ray_box:
+        // the ray starts at t = 0 and hits behind the origin are rejected.
+        template <uint32_t N>
+        inline uint32_t bvh_test_children_scalar(const bvh_wide_node<N> & n, const bvh_ray & r)
+        {
+            uint32_t mask = 0;
+            for (uint32_t j = 0; j < n.num_children; ++j)
+            {
+                const float tx0 = (n.bmin_x[j] - r.o[0]) * r.inv[0], tx1 = (n.bmax_x[j] - r.o[0]) * r.inv[0];
+                const float ty0 = (n.bmin_y[j] - r.o[1]) * r.inv[1], ty1 = (n.bmax_y[j] - r.o[1]) * r.inv[1];
+                const float tz0 = (n.bmin_z[j] - r.o[2]) * r.inv[2], tz1 = (n.bmax_z[j] - r.o[2]) * r.inv[2];
+                const float tnear = std::max(std::max(std::min(tx0, tx1), std::min(ty0, ty1)), std::max(std::min(tz0, tz1), 0.f));
+                const float tfar = std::min(std::min(std::max(tx0, tx1), std::max(ty0, ty1)), std::max(tz0, tz1));
+                if (tnear <= tfar && tfar > PLANE_EPSILON) mask |= (1u << j);
+            }
+            return mask;
+        }
+
+        // Returns a bitmask of the rays in the packet that hit the box
+        inline uint32_t bvh_test_packet_scalar(const bvh_ray_packet & p, const float bmin[3], const float bmax[3])
+        {
+            uint32_t mask = 0;
+            for (uint32_t i = 0; i < p.size; ++i)
+            {
+                const float tx0 = (bmin[0] - p.ox[i]) * p.ix[i], tx1 = (bmax[0] - p.ox[i]) * p.ix[i];
+                const float ty0 = (bmin[1] - p.oy[i]) * p.iy[i], ty1 = (bmax[1] - p.oy[i]) * p.iy[i];
+                const float tz0 = (bmin[2] - p.oz[i]) * p.iz[i], tz1 = (bmax[2] - p.oz[i]) * p.iz[i];
+                const float tnear = std::max(std::max(std::min(tx0, tx1), std::min(ty0, ty1)), std::max(std::min(tz0, tz1), 0.f));
+                const float tfar = std::min(std::min(std::max(tx0, tx1), std::max(ty0, ty1)), std::max(tz0, tz1));
+                if (tnear <= tfar && tfar > PLANE_EPSILON) mask |= (1u << i);
+            }
+            return mask;
+        }
+
+    #if defined(POLYMER_SIMD_X86)
+
+        // Four boxes against one ray, or one box against four rays. Both are the same slab test with
+        // the operands broadcast differently.
+        inline uint32_t bvh_slab_test_sse(
+            const __m128 bmin_x, const __m128 bmin_y, const __m128 bmin_z,
+            const __m128 bmax_x, const __m128 bmax_y, const __m128 bmax_z,
+            const __m128 ox, const __m128 oy, const __m128 oz,
+            const __m128 ix, const __m128 iy, const __m128 iz)
+        {
+            const __m128 tx0 = _mm_mul_ps(_mm_sub_ps(bmin_x, ox), ix), tx1 = _mm_mul_ps(_mm_sub_ps(bmax_x, ox), ix);
+            const __m128 ty0 = _mm_mul_ps(_mm_sub_ps(bmin_y, oy), iy), ty1 = _mm_mul_ps(_mm_sub_ps(bmax_y, oy), iy);
+            const __m128 tz0 = _mm_mul_ps(_mm_sub_ps(bmin_z, oz), iz), tz1 = _mm_mul_ps(_mm_sub_ps(bmax_z, oz), iz);
+            const __m128 tnear = _mm_max_ps(_mm_max_ps(_mm_min_ps(tx0, tx1), _mm_min_ps(ty0, ty1)), _mm_max_ps(_mm_min_ps(tz0, tz1), _mm_setzero_ps()));
+            const __m128 tfar = _mm_min_ps(_mm_min_ps(_mm_max_ps(tx0, tx1), _mm_max_ps(ty0, ty1)), _mm_max_ps(tz0, tz1));
+            const __m128 hit = _mm_and_ps(_mm_cmple_ps(tnear, tfar), _mm_cmpgt_ps(tfar, _mm_set1_ps(PLANE_EPSILON)));
+            return static_cast<uint32_t>(_mm_movemask_ps(hit));
+        }
+
+        template <uint32_t N>
+        inline uint32_t bvh_test_children_sse(const bvh_wide_node<N> & n, const bvh_ray & r)
+        {
+            const __m128 ox = _mm_set1_ps(r.o[0]), oy = _mm_set1_ps(r.o[1]), oz = _mm_set1_ps(r.o[2]);
+            const __m128 ix = _mm_set1_ps(r.inv[0]), iy = _mm_set1_ps(r.inv[1]), iz = _mm_set1_ps(r.inv[2]);
+
+            uint32_t mask = 0;
+            for (uint32_t j = 0; j < N; j += 4)
+            {
+                mask |= bvh_slab_test_sse(
+                    _mm_load_ps(n.bmin_x + j), _mm_load_ps(n.bmin_y + j), _mm_load_ps(n.bmin_z + j),
+                    _mm_load_ps(n.bmax_x + j), _mm_load_ps(n.bmax_y + j), _mm_load_ps(n.bmax_z + j),
+                    ox, oy, oz, ix, iy, iz) << j;
+            }
+            return mask & ((1u << n.num_children) - 1);
+        }
+
+        inline uint32_t bvh_test_packet_sse(const bvh_ray_packet & p, const float bmin[3], const float bmax[3])
+        {
+            const __m128 bmin_x = _mm_set1_ps(bmin[0]), bmin_y = _mm_set1_ps(bmin[1]), bmin_z = _mm_set1_ps(bmin[2]);
+            const __m128 bmax_x = _mm_set1_ps(bmax[0]), bmax_y = _mm_set1_ps(bmax[1]), bmax_z = _mm_set1_ps(bmax[2]);
+
+            uint32_t mask = 0;
+            for (uint32_t i = 0; i < bvh_ray_packet::kSize; i += 4)
+            {
+                mask |= bvh_slab_test_sse(bmin_x, bmin_y, bmin_z, bmax_x, bmax_y, bmax_z,
+                    _mm_load_ps(p.ox + i), _mm_load_ps(p.oy + i), _mm_load_ps(p.oz + i),
+                    _mm_load_ps(p.ix + i), _mm_load_ps(p.iy + i), _mm_load_ps(p.iz + i)) << i;
+            }
+            return mask & ((1u << p.size) - 1);
+        }
+
+        POLYMER_TARGET_AVX2 inline uint32_t bvh_slab_test_avx2(
+            const __m256 bmin_x, const __m256 bmin_y, const __m256 bmin_z,
+            const __m256 bmax_x, const __m256 bmax_y, const __m256 bmax_z,
+            const __m256 ox, const __m256 oy, const __m256 oz,
+            const __m256 ix, const __m256 iy, const __m256 iz)
+        {
+            // (b - o) * inv == b * inv - o * inv, which folds into one fused multiply-subtract per slab
+            const __m256 oix = _mm256_mul_ps(ox, ix), oiy = _mm256_mul_ps(oy, iy), oiz = _mm256_mul_ps(oz, iz);
+            const __m256 tx0 = _mm256_fmsub_ps(bmin_x, ix, oix), tx1 = _mm256_fmsub_ps(bmax_x, ix, oix);
+            const __m256 ty0 = _mm256_fmsub_ps(bmin_y, iy, oiy), ty1 = _mm256_fmsub_ps(bmax_y, iy, oiy);
+            const __m256 tz0 = _mm256_fmsub_ps(bmin_z, iz, oiz), tz1 = _mm256_fmsub_ps(bmax_z, iz, oiz);
+            const __m256 tnear = _mm256_max_ps(_mm256_max_ps(_mm256_min_ps(tx0, tx1), _mm256_min_ps(ty0, ty1)), _mm256_max_ps(_mm256_min_ps(tz0, tz1), _mm256_setzero_ps()));
+            const __m256 tfar = _mm256_min_ps(_mm256_min_ps(_mm256_max_ps(tx0, tx1), _mm256_max_ps(ty0, ty1)), _mm256_max_ps(tz0, tz1));
+            const __m256 hit = _mm256_and_ps(_mm256_cmp_ps(tnear, tfar, _CMP_LE_OQ), _mm256_cmp_ps(tfar, _mm256_set1_ps(PLANE_EPSILON), _CMP_GT_OQ));
+            return static_cast<uint32_t>(_mm256_movemask_ps(hit));
+        }
+
+        template <uint32_t N>
+        POLYMER_TARGET_AVX2 inline uint32_t bvh_test_children_avx2(const bvh_wide_node<N> & n, const bvh_ray & r)
+        {
+            if (N != 8) return bvh_test_children_sse(n, r);
+
+            const uint32_t mask = bvh_slab_test_avx2(
+                _mm256_load_ps(n.bmin_x), _mm256_load_ps(n.bmin_y), _mm256_load_ps(n.bmin_z),
+                _mm256_load_ps(n.bmax_x), _mm256_load_ps(n.bmax_y), _mm256_load_ps(n.bmax_z),
+                _mm256_set1_ps(r.o[0]), _mm256_set1_ps(r.o[1]), _mm256_set1_ps(r.o[2]),
+                _mm256_set1_ps(r.inv[0]), _mm256_set1_ps(r.inv[1]), _mm256_set1_ps(r.inv[2]));
+            return mask & ((1u << n.num_children) - 1);
+        }
+
+        POLYMER_TARGET_AVX2 inline uint32_t bvh_test_packet_avx2(const bvh_ray_packet & p, const float bmin[3], const float bmax[3])
+        {
+            const uint32_t mask = bvh_slab_test_avx2(
+                _mm256_set1_ps(bmin[0]), _mm256_set1_ps(bmin[1]), _mm256_set1_ps(bmin[2]),
+                _mm256_set1_ps(bmax[0]), _mm256_set1_ps(bmax[1]), _mm256_set1_ps(bmax[2]),
+                _mm256_load_ps(p.ox), _mm256_load_ps(p.oy), _mm256_load_ps(p.oz),
+                _mm256_load_ps(p.ix), _mm256_load_ps(p.iy), _mm256_load_ps(p.iz));
+            return mask & ((1u << p.size) - 1);
+        }
+
+    #endif // end POLYMER_SIMD_X86
+
+    } // end namespace simd
+
+    template <uint32_t N>
+    class bvh_wide_tree
+    {
+        typedef std::pair<bvh_node_data*, float> hit_type;
+
+        std::vector<bvh_wide_node<N>> nodes;
+        std::vector<bvh_node_data *> objects; // leaf ranges index into this, in the source tree's flat order
+        uint32_t depth {0};
+        simd_level level { get_simd_level() };
+
+        template <simd_level L>
+        static uint32_t test_children(const bvh_wide_node<N> & n, const bvh_ray & r)
+        {
+        #if defined(POLYMER_SIMD_X86)
+            if (L == simd_level::avx2) return simd::bvh_test_children_avx2(n, r);
+            if (L == simd_level::sse) return simd::bvh_test_children_sse(n, r);
+        #endif
+            return simd::bvh_test_children_scalar(n, r);
+        }
+
+        template <simd_level L>
+        static uint32_t test_packet(const bvh_ray_packet & p, const float bmin[3], const float bmax[3])
+        {
+        #if defined(POLYMER_SIMD_X86)
+            if (L == simd_level::avx2) return simd::bvh_test_packet_avx2(p, bmin, bmax);
+            if (L == simd_level::sse) return simd::bvh_test_packet_sse(p, bmin, bmax);
+        #endif
+            return simd::bvh_test_packet_scalar(p, bmin, bmax);
+        }
+
+        static uint32_t next_bit(uint32_t & mask)
+        {
+            uint32_t bit = 0;
+            while (!(mask & (1u << bit))) ++bit;
+            mask &= mask - 1;
+            return bit;
+        }
+
+        template <simd_level L>
+        void intersect_impl(const ray & world_ray, std::vector<hit_type> & results) const
+        {
+            if (nodes.empty()) return;
+
+            const bvh_ray r(world_ray);
+
+            uint32_t local_stack[256];
+            std::vector<uint32_t> heap_stack;
+            uint32_t * stack = local_stack;
+            const size_t max_stack = size_t(depth) * (N - 1) + 1;
+            if (max_stack > 256) { heap_stack.resize(max_stack); stack = heap_stack.data(); }
+
+            uint32_t stack_size = 0;
+            stack[stack_size++] = 0;
+
+            while (stack_size)
+            {
+                const bvh_wide_node<N> & n = nodes[stack[--stack_size]];
+                uint32_t mask = test_children<L>(n, r);
+
+                while (mask)
+                {
+                    const uint32_t j = next_bit(mask);
+                    if (n.count[j] == 0)
+                    {
+                        stack[stack_size++] = n.child[j];
+                        continue;
+                    }
+
+                    for (uint32_t i = n.child[j]; i < n.child[j] + n.count[j]; ++i)
+                    {
+                        float t;
+                        const aabb_3d & b = objects[i]->bounds;
+                        if (intersect_ray_box(world_ray, b.min(), b.max(), &t)) results.emplace_back(objects[i], t);
+                    }
+                }
+            }
+        }
+
+        template <simd_level L>
+        void intersect_packet_impl(const ray * rays, const uint32_t count, std::vector<hit_type> * results) const
+        {
+            if (nodes.empty() || count == 0) return;
+
+            const bvh_ray_packet packet(rays, count);
+
+            struct entry { uint32_t node; uint32_t mask; };
+            std::vector<entry> stack;
+            stack.reserve(size_t(depth) * (N - 1) + 1);
+            stack.push_back({ 0, (1u << packet.size) - 1 });
+
+            while (!stack.empty())
+            {
+                const entry e = stack.back();
+                stack.pop_back();
+
+                const bvh_wide_node<N> & n = nodes[e.node];
+                for (uint32_t j = 0; j < n.num_children; ++j)
+                {
+                    const float bmin[3] = { n.bmin_x[j], n.bmin_y[j], n.bmin_z[j] };
+                    const float bmax[3] = { n.bmax_x[j], n.bmax_y[j], n.bmax_z[j] };
+                    const uint32_t hit_mask = test_packet<L>(packet, bmin, bmax) & e.mask;
+                    if (!hit_mask) continue;
+
+                    if (n.count[j] == 0)
+                    {
+                        stack.push_back({ n.child[j], hit_mask });
+                        continue;
+                    }
+
+                    for (uint32_t i = n.child[j]; i < n.child[j] + n.count[j]; ++i)
+                    {
+                        const aabb_3d & b = objects[i]->bounds;
+                        uint32_t ray_mask = hit_mask;
+                        while (ray_mask)
+                        {
+                            const uint32_t k = next_bit(ray_mask);
+                            float t;
+                            if (intersect_ray_box(rays[k], b.min(), b.max(), &t)) results[k].emplace_back(objects[i], t);
+                        }
+                    }
+                }
+            }
+        }
+
+    #if defined(POLYMER_SIMD_X86)
+        POLYMER_TARGET_AVX2 void intersect_avx2(const ray & r, std::vector<hit_type> & results) const { intersect_impl<simd_level::avx2>(r, results); }
+        POLYMER_TARGET_AVX2 void intersect_packet_avx2(const ray * rays, const uint32_t count, std::vector<hit_type> * results) const { intersect_packet_impl<simd_level::avx2>(rays, count, results); }
+    #endif
+
+        static void sort_hits(std::vector<hit_type> & results)
+        {
+            std::sort(results.begin(), results.end(), [](const hit_type & a, const hit_type & b) { return a.second < b.second; });
+        }
+
+    public:
+
+        static const uint32_t width = N;
+
+        bvh_wide_tree() = default;
+
+        // Collapses a built bvh_tree (either build mode). Each wide node repeatedly opens its largest
+        // internal child until it has N children or only leaves remain.
+        void build(const bvh_tree & source)
+        {
+            build(source.get_flat_nodes(), source.get_flat_objects());
+        }
+
+        // Collapses any depth-first flattened binary tree laid out like bvh_tree's, e.g. dynamic_bvh::flatten
+        void build(const std::vector<bvh_flat_node> & flat, const std::vector<bvh_node_data *> & flat_objects)
+        {
+            nodes.clear();
+            objects = flat_objects;
+            depth = 0;
+
+            if (flat.empty()) return;
+
+            auto area = [&](const uint32_t i) { const float3 d = flat[i].bmax - flat[i].bmin; return d.x * d.y + d.y * d.z + d.z * d.x; };
+
+            struct pending { uint32_t flat_index; uint32_t wide_index; uint32_t depth; };
+            std::vector<pending> stack = { { 0, 0, 1 } };
+            nodes.emplace_back();
+
+            while (!stack.empty())
+            {
+                const pending p = stack.back();
+                stack.pop_back();
+                depth = std::max(depth, p.depth);
+
+                // A leaf root becomes a single-child wide node
+                std::vector<uint32_t> children;
+                if (flat[p.flat_index].is_leaf()) children = { p.flat_index };
+                else children = { p.flat_index + 1, flat[p.flat_index].offset };
+
+                while (children.size() < N)
+                {
+                    int open = -1;
+                    float largest = -1.f;
+                    for (size_t c = 0; c < children.size(); ++c)
+                    {
+                        if (flat[children[c]].is_leaf()) continue;
+                        const float a = area(children[c]);
+                        if (a > largest) { largest = a; open = static_cast<int>(c); }
+                    }
+                    if (open < 0) break;
+
+                    const uint32_t opened = children[open];
+                    children[open] = opened + 1;
+                    children.push_back(flat[opened].offset);
+                }
+
+                bvh_wide_node<N> w = {};
+                w.num_children = static_cast<uint32_t>(children.size());
+                for (uint32_t j = 0; j < w.num_children; ++j)
+                {
+                    const bvh_flat_node & c = flat[children[j]];
+                    w.bmin_x[j] = c.bmin.x; w.bmin_y[j] = c.bmin.y; w.bmin_z[j] = c.bmin.z;
+                    w.bmax_x[j] = c.bmax.x; w.bmax_y[j] = c.bmax.y; w.bmax_z[j] = c.bmax.z;
+
+                    if (c.is_leaf())
+                    {
+                        w.child[j] = c.offset;
+                        w.count[j] = c.count;
+                    }
+                    else
+                    {
+                        w.child[j] = static_cast<uint32_t>(nodes.size());
+                        w.count[j] = 0;
+                        nodes.emplace_back();
+                        stack.push_back({ children[j], w.child[j], p.depth + 1 });
+                    }
+                }
+
+                nodes[p.wide_index] = w;
+            }
+        }
+
+        void clear() { nodes.clear(); objects.clear(); depth = 0; }
+        size_t size() const { return nodes.size(); }
+
+        // Forces a kernel tier for testing or comparison. Requests beyond what the CPU supports are clamped.
+        void set_simd_level(const simd_level l) { level = std::min(l, get_simd_level()); }
+        simd_level get_simd_level_in_use() const { return level; }
+
+        // Same results as bvh_tree::intersect: every object whose box is hit, sorted by distance
+        bool intersect(const ray & r, std::vector<hit_type> & results) const
+        {
+            switch (level)
+            {
+            #if defined(POLYMER_SIMD_X86)
+                case simd_level::avx2: intersect_avx2(r, results); break;
+                case simd_level::sse: intersect_impl<simd_level::sse>(r, results); break;
+            #endif
+                default: intersect_impl<simd_level::scalar>(r, results); break;
+            }
+            sort_hits(results);
+            return !results.empty();
+        }
+
+        // Traverses up to bvh_ray_packet::kSize rays together. results[i] receives the hits for rays[i].
+        void intersect_packet(const ray * rays, const uint32_t count, std::vector<hit_type> * results) const
+        {
+            const uint32_t n = std::min(count, bvh_ray_packet::kSize);
+            switch (level)
+            {
+            #if defined(POLYMER_SIMD_X86)
+                case simd_level::avx2: intersect_packet_avx2(rays, n, results); break;
+                case simd_level::sse: intersect_packet_impl<simd_level::sse>(rays, n, results); break;
+            #endif
+                default: intersect_packet_impl<simd_level::scalar>(rays, n, results); break;
+            }
+            for (uint32_t i = 0; i < n; ++i) sort_hits(results[i]);
+        }
+
+        // Splits any number of rays into packets
+        void intersect(const std::vector<ray> & rays, std::vector<std::vector<hit_type>> & results) const
+        {
+            results.resize(rays.size());
+            for (size_t i = 0; i < rays.size(); i += bvh_ray_packet::kSize)
+            {
+                const uint32_t count = static_cast<uint32_t>(std::min<size_t>(bvh_ray_packet::kSize, rays.size() - i));
+                intersect_packet(rays.data() + i, count, results.data() + i);
+            }
+        }
+    };
+
+    typedef bvh_wide_tree<4> bvh4_tree;
+    typedef bvh_wide_tree<8> bvh8_tree;
+
 } // end namespace polymer
 
 #endif // end polymer_bvh_hpp
@@ -0,0 +1,525 @@
+#pragma once
+
+#ifndef polymer_dynamic_bvh_hpp
+#define polymer_dynamic_bvh_hpp
+
+#include "polymer-core/math/math-core.hpp"
+#include "polymer-core/tools/bvh.hpp"
+
+namespace polymer
+{
+
+    /////////////////////
+    //   dynamic_bvh   //
+    /////////////////////
+
+    // Incrementally updated binary BVH for objects that are added, removed and moved at runtime (the
+    // dynamic AABB tree of Box2D, extended to 3D). Each object owns one leaf whose box is the object
+    // bounds fattened by a margin. Insert and remove are O(log n): a leaf is placed next to the sibling
+    // with the lowest surface area cost, and every ancestor is refit on the way back to the root, with
+    // local tree rotations ("Fast, Effective BVH Updates for Animated Scenes", Kopta et al. 2012) to keep
+    // the tree from degrading. Moving an object only touches its leaf while it stays inside the fattened
+    // box; otherwise its leaf is removed and reinserted.
+    //
+    // Objects are not owned, and their bvh_node_data must outlive their proxy. Queries test leaves against
+    // the exact object bounds, so results match bvh_tree.
+    class dynamic_bvh
+    {
+    public:
+
+        static constexpr uint32_t kNull = 0xFFFFFFFF;
+
+    private:
+
+        struct node
+        {
+            aabb_3d bounds;
+            bvh_node_data * object {nullptr};
+            uint32_t parent {kNull};    // doubles as the next link while on the free list
+            uint32_t child[2] {kNull, kNull};
+            bool is_leaf() const { return child[0] == kNull; }
+        };
+
+        std::vector<node> nodes;
+        uint32_t root {kNull};
+        uint32_t free_list {kNull};
+        uint32_t leaf_count {0};
+        float margin {0.1f};
+
+        static float area(const aabb_3d & b)
+        {
+            const float3 d = b.size();
+            return d.x * d.y + d.y * d.z + d.z * d.x;
+        }
+
+        static bool contains(const aabb_3d & outer, const aabb_3d & inner)
+        {
+            return all(gequal(inner.min(), outer.min())) && all(lequal(inner.max(), outer.max()));
+        }
+
+        aabb_3d fatten(const aabb_3d & b) const
+        {
+            const float3 pad = b.size() * margin + float3(1e-4f);
+            return { b.min() - pad, b.max() + pad };
+        }
+
+        uint32_t allocate_node()
+        {
+            if (free_list == kNull)
+            {
+                nodes.emplace_back();
+                return static_cast<uint32_t>(nodes.size() - 1);
+            }
+            const uint32_t index = free_list;
+            free_list = nodes[index].parent;
+            nodes[index] = node();
+            return index;
+        }
+
+        void free_node(const uint32_t index)
+        {
+            nodes[index].object = nullptr;
+            nodes[index].child[0] = nodes[index].child[1] = kNull;
+            nodes[index].parent = free_list;
+            free_list = index;
+        }
+
+        // Swaps the subtree at `a` with a grandchild on the other side whenever that shrinks the
+        // sibling it moves into. The bounds of `index` itself are unchanged by any rotation.
+        void rotate(const uint32_t index)
+        {
+            const node & n = nodes[index];
+            if (n.is_leaf()) return;
+
+            const uint32_t b = n.child[0], c = n.child[1];
+
+            float best_gain = 0.f;
+            uint32_t best_move = kNull, best_target = kNull; // best_move is swapped with grandchild best_target
+
+            const auto consider = [&](const uint32_t move, const uint32_t other)
+            {
+                // Swap `move` with one of the children of its sibling `other`
+                const node & o = nodes[other];
+                if (o.is_leaf()) return;
+                const float other_area = area(o.bounds);
+                for (int k = 0; k < 2; ++k)
+                {
+                    const uint32_t target = o.child[k];
+                    const uint32_t kept = o.child[1 - k];
+                    const float gain = other_area - area(nodes[move].bounds.add(nodes[kept].bounds));
+                    if (gain > best_gain) { best_gain = gain; best_move = move; best_target = target; }
+                }
+            };
+
+            consider(b, c);
+            consider(c, b);
+            if (best_move == kNull) return;
+
+            const uint32_t other = nodes[best_target].parent;
+            node & o = nodes[other];
+            const int target_slot = (o.child[0] == best_target) ? 0 : 1;
+            node & p = nodes[index];
+            const int move_slot = (p.child[0] == best_move) ? 0 : 1;
+
+            p.child[move_slot] = best_target;
+            nodes[best_target].parent = index;
+            o.child[target_slot] = best_move;
+            nodes[best_move].parent = other;
+            o.bounds = nodes[o.child[0]].bounds.add(nodes[o.child[1]].bounds);
+        }
+
+        void refit_ancestors(uint32_t index)
+        {
+            while (index != kNull)
+            {
+                node & n = nodes[index];
+                n.bounds = nodes[n.child[0]].bounds.add(nodes[n.child[1]].bounds);
+                rotate(index);
+                index = nodes[index].parent;
+            }
+        }
+
+        // Descends from the root toward the child whose cost of hosting the new leaf (its enlargement
+        // plus the enlargement inherited by every ancestor) is lowest, stopping when creating a new
+        // parent at the current node is cheaper than going deeper.
+        uint32_t find_best_sibling(const aabb_3d & leaf_bounds) const
+        {
+            uint32_t index = root;
+            while (!nodes[index].is_leaf())
+            {
+                const node & n = nodes[index];
+                const float node_area = area(n.bounds);
+                const float combined_area = area(n.bounds.add(leaf_bounds));
+
+                const float cost = 2.f * combined_area;
+                const float inherited = 2.f * (combined_area - node_area);
+
+                float child_cost[2];
+                for (int k = 0; k < 2; ++k)
+                {
+                    const node & c = nodes[n.child[k]];
+                    const float enlarged = area(c.bounds.add(leaf_bounds));
+                    child_cost[k] = (c.is_leaf() ? enlarged : enlarged - area(c.bounds)) + inherited;
+                }
+
+                if (cost < child_cost[0] && cost < child_cost[1]) break;
+                index = (child_cost[0] < child_cost[1]) ? n.child[0] : n.child[1];
+            }
+            return index;
+        }
+
+        void insert_leaf(const uint32_t leaf)
+        {
+            if (root == kNull)
+            {
+                root = leaf;
+                nodes[root].parent = kNull;
+                return;
+            }
+
+            const aabb_3d leaf_bounds = nodes[leaf].bounds;
+            const uint32_t sibling = find_best_sibling(leaf_bounds);
+            const uint32_t old_parent = nodes[sibling].parent;
+
+            const uint32_t new_parent = allocate_node();
+            node & p = nodes[new_parent];
+            p.parent = old_parent;
+            p.bounds = nodes[sibling].bounds.add(leaf_bounds);
+            p.child[0] = sibling;
+            p.child[1] = leaf;
+            nodes[sibling].parent = new_parent;
+            nodes[leaf].parent = new_parent;
+
+            if (old_parent == kNull)
+            {
+                root = new_parent;
+                return;
+            }
+
+            node & op = nodes[old_parent];
+            op.child[(op.child[0] == sibling) ? 0 : 1] = new_parent;
+            refit_ancestors(old_parent);
+        }
+
+        void remove_leaf(const uint32_t leaf)
+        {
+            if (leaf == root)
+            {
+                root = kNull;
+                return;
+            }
+
+            const uint32_t parent = nodes[leaf].parent;
+            const uint32_t grandparent = nodes[parent].parent;
+            const uint32_t sibling = (nodes[parent].child[0] == leaf) ? nodes[parent].child[1] : nodes[parent].child[0];
+
+            free_node(parent);
+
+            if (grandparent == kNull)
+            {
+                root = sibling;
+                nodes[sibling].parent = kNull;
+                return;
+            }
+
+            node & gp = nodes[grandparent];
+            gp.child[(gp.child[0] == parent) ? 0 : 1] = sibling;
+            nodes[sibling].parent = grandparent;
+            refit_ancestors(grandparent);
+        }
+
+        static bool intersect_ray_node(const aabb_3d & b, const float3 & origin, const float3 & inv_dir, float & t_near)
+        {
+            const float3 t0 = (b.min() - origin) * inv_dir;
+            const float3 t1 = (b.max() - origin) * inv_dir;
+            t_near = std::max(maxelem(linalg::min(t0, t1)), 0.f);
+            return t_near <= minelem(linalg::max(t0, t1));
+        }
+
+    public:
+
+        dynamic_bvh() = default;
+
+        // Fraction of an object's extent that its leaf box is grown by on every side. Larger margins
+        // mean fewer reinsertions for moving objects at the cost of looser internal nodes.
+        void set_margin(const float m) { margin = m; }
+        float get_margin() const { return margin; }
+
+        size_t size() const { return leaf_count; }
+        bool empty() const { return leaf_count == 0; }
+
+        void clear()
+        {
+            nodes.clear();
+            root = free_list = kNull;
+            leaf_count = 0;
+        }
+
+        // Adds an object using its current bounds and returns its proxy
+        uint32_t insert(bvh_node_data * object)
+        {
+            const uint32_t leaf = allocate_node();
+            nodes[leaf].object = object;
+            nodes[leaf].bounds = fatten(object->bounds);
+            insert_leaf(leaf);
+            ++leaf_count;
+            return leaf;
+        }
+
+        void remove(const uint32_t proxy)
+        {
+            assert(proxy < nodes.size() && nodes[proxy].is_leaf() && nodes[proxy].object);
+            remove_leaf(proxy);
+            free_node(proxy);
+            --leaf_count;
+        }
+
+        // Call after the object's bounds change. Returns true if the leaf had to be reinserted,
+        // false if the new bounds still fit inside its fattened box and the tree was not touched.
+        bool update(const uint32_t proxy)
+        {
+            node & leaf = nodes[proxy];
+            if (contains(leaf.bounds, leaf.object->bounds)) return false;
+
+            remove_leaf(proxy);
+            nodes[proxy].bounds = fatten(nodes[proxy].object->bounds);
+            insert_leaf(proxy);
+            return true;
+        }
+
+        // Replaces the contents with a top-down binned SAH build, which gives a better tree than
+        // inserting many objects one at a time. proxies[i] receives the proxy of objects[i].
+        void build(const std::vector<bvh_node_data *> & objects, std::vector<uint32_t> & proxies)
+        {
+            clear();
+            proxies.assign(objects.size(), kNull);
+            if (objects.empty()) return;
+
+            std::vector<aabb_3d> bounds(objects.size());
+            for (size_t i = 0; i < objects.size(); ++i) bounds[i] = fatten(objects[i]->bounds);
+
+            std::vector<bvh_flat_node> flat;
+            std::vector<uint32_t> order;
+            bvh_tree::build_binned_sah(bounds, flat, order);
+
+            nodes.reserve(objects.size() * 2);
+
+            // Leaves of the flat tree may hold several objects; they become small balanced subtrees
+            const auto make_range = [&](const auto & self, const uint32_t first, const uint32_t count) -> uint32_t
+            {
+                if (count == 1)
+                {
+                    const uint32_t object_index = order[first];
+                    const uint32_t leaf = allocate_node();
+                    nodes[leaf].object = objects[object_index];
+                    nodes[leaf].bounds = bounds[object_index];
+                    proxies[object_index] = leaf;
+                    return leaf;
+                }
+                const uint32_t l = self(self, first, count / 2);
+                const uint32_t r = self(self, first + count / 2, count - count / 2);
+                const uint32_t parent = allocate_node();
+                nodes[parent].child[0] = l;
+                nodes[parent].child[1] = r;
+                nodes[parent].bounds = nodes[l].bounds.add(nodes[r].bounds);
+                nodes[l].parent = nodes[r].parent = parent;
+                return parent;
+            };
+
+            const auto convert = [&](const auto & self, const uint32_t index) -> uint32_t
+            {
+                const bvh_flat_node & f = flat[index];
+                if (f.is_leaf()) return make_range(make_range, f.offset, f.count);
+
+                const uint32_t l = self(self, index + 1);
+                const uint32_t r = self(self, f.offset);
+                const uint32_t parent = allocate_node();
+                nodes[parent].child[0] = l;
+                nodes[parent].child[1] = r;
+                nodes[parent].bounds = nodes[l].bounds.add(nodes[r].bounds);
+                nodes[l].parent = nodes[r].parent = parent;
+                return parent;
+            };
+
+            root = convert(convert, 0);
+            nodes[root].parent = kNull;
+            leaf_count = static_cast<uint32_t>(objects.size());
+        }
+
+        // Same results as bvh_tree::intersect: every object whose bounds are hit, sorted by distance
+        bool intersect(const ray & r, std::vector<std::pair<bvh_node_data*, float>> & results) const
+        {
+            if (root == kNull) return false;
+
+            const float3 inv_dir = r.inverse_direction();
+
+            std::vector<uint32_t> stack;
+            stack.reserve(64);
+            stack.push_back(root);
+
+            while (!stack.empty())
+            {
+                const node & n = nodes[stack.back()];
+                stack.pop_back();
+
+                float t;
+                if (!intersect_ray_node(n.bounds, r.origin, inv_dir, t)) continue;
+
+                if (n.is_leaf())
+                {
+                    const aabb_3d & b = n.object->bounds;
+                    if (intersect_ray_box(r, b.min(), b.max(), &t)) results.emplace_back(n.object, t);
+                }
+                else
+                {
+                    stack.push_back(n.child[1]);
+                    stack.push_back(n.child[0]);
+                }
+            }
+
+            std::sort(results.begin(), results.end(), [](const std::pair<bvh_node_data*, float> & a, const std::pair<bvh_node_data*, float> & b) { return a.second < b.second; });
+            return !results.empty();
+        }
+
+        // Writes the tree depth-first in bvh_tree's flat layout, one object per leaf, so it can be
+        // collapsed into a bvh_wide_tree. Leaf boxes are the fattened ones; queries on the result still
+        // test the exact object bounds.
+        void flatten(std::vector<bvh_flat_node> & flat, std::vector<bvh_node_data *> & flat_objects) const
+        {
+            flat.clear();
+            flat_objects.clear();
+            if (root == kNull) return;
+
+            flat.reserve(nodes.size());
+            flat_objects.reserve(leaf_count);
+
+            const auto emit = [&](const auto & self, const uint32_t index) -> void
+            {
+                const node & n = nodes[index];
+                const uint32_t f = static_cast<uint32_t>(flat.size());
+                flat.emplace_back();
+                flat[f].bmin = n.bounds.min();
+                flat[f].bmax = n.bounds.max();
+
+                if (n.is_leaf())
+                {
+                    flat[f].offset = static_cast<uint32_t>(flat_objects.size());
+                    flat[f].count = 1;
+                    flat_objects.push_back(n.object);
+                    return;
+                }
+
+                self(self, n.child[0]);
+                flat[f].offset = static_cast<uint32_t>(flat.size());
+                self(self, n.child[1]);
+            };
+            emit(emit, root);
+        }
+
+        std::vector<bvh_node_data*> find_visible_nodes(const frustum & camera_frustum) const
+        {
+            std::vector<bvh_node_data*> visible;
+            if (root == kNull) return visible;
+
+            std::vector<uint32_t> stack;
+            stack.reserve(64);
+            stack.push_back(root);
+
+            while (!stack.empty())
+            {
+                const node & n = nodes[stack.back()];
+                stack.pop_back();
+
+                const aabb_3d & b = n.is_leaf() ? n.object->bounds : n.bounds;
+                if (!camera_frustum.intersects(b.center(), b.size())) continue;
+
+                if (n.is_leaf()) visible.push_back(n.object);
+                else
+                {
+                    stack.push_back(n.child[1]);
+                    stack.push_back(n.child[0]);
+                }
+            }
+
+            return visible;
+        }
+
+        // Surface area heuristic cost of the tree, relative to the root (traversal and intersection cost 1)
+        float compute_sah_cost() const
+        {
+            if (root == kNull) return 0.f;
+            const float root_area = std::max(area(nodes[root].bounds), 1e-12f);
+
+            float cost = 0.f;
+            std::vector<uint32_t> stack = { root };
+            while (!stack.empty())
+            {
+                const node & n = nodes[stack.back()];
+                stack.pop_back();
+                const float a = area(n.bounds) / root_area;
+                if (n.is_leaf()) cost += a;
+                else
+                {
+                    cost += a;
+                    stack.push_back(n.child[0]);
+                    stack.push_back(n.child[1]);
+                }
+            }
+            return cost;
+        }
+
+        uint32_t compute_height() const
+        {
+            if (root == kNull) return 0;
+            uint32_t height = 0;
+            std::vector<std::pair<uint32_t, uint32_t>> stack = { { root, 1 } };
+            while (!stack.empty())
+            {
+                const auto e = stack.back();
+                stack.pop_back();
+                height = std::max(height, e.second);
+                const node & n = nodes[e.first];
+                if (!n.is_leaf())
+                {
+                    stack.push_back({ n.child[0], e.second + 1 });
+                    stack.push_back({ n.child[1], e.second + 1 });
+                }
+            }
+            return height;
+        }
+
+        // Checks parent links, that every node encloses its children and every leaf its object. For tests.
+        bool validate() const
+        {
+            if (root == kNull) return leaf_count == 0;
+            if (nodes[root].parent != kNull) return false;
+
+            uint32_t leaves = 0;
+            std::vector<uint32_t> stack = { root };
+            while (!stack.empty())
+            {
+                const uint32_t index = stack.back();
+                stack.pop_back();
+                const node & n = nodes[index];
+
+                if (n.is_leaf())
+                {
+                    if (!n.object || !contains(n.bounds, n.object->bounds)) return false;
+                    ++leaves;
+                    continue;
+                }
+
+                for (int k = 0; k < 2; ++k)
+                {
+                    const node & c = nodes[n.child[k]];
+                    if (c.parent != index || !contains(n.bounds, c.bounds)) return false;
+                    stack.push_back(n.child[k]);
+                }
+            }
+            return leaves == leaf_count;
+        }
+    };
+
+} // end namespace polymer
+
+#endif // end polymer_dynamic_bvh_hpp
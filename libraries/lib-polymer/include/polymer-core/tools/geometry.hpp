@@ -78,6 +78,26 @@ namespace polymer
         return compute_bounds(g.vertices);
     }
 
+    // Bounds of a local-space box after scaling and posing it. Gives the same box as transforming
+    // all eight corners, computed from the center and the absolute rotation matrix instead (Arvo).
+    inline aabb_3d transform_bounds(const aabb_3d & local, const transform & pose, const float3 & scale = float3(1.f))
+    {
+        const float3 center = pose.transform_coord(local.center() * scale);
+        const float3 half = abs(local.size() * scale) * 0.5f;
+        const float3x3 r = qmat(pose.orientation);
+        const float3 extent = abs(r[0]) * half.x + abs(r[1]) * half.y + abs(r[2]) * half.z;
+        return { center - extent, center + extent };
+    }
+
+    // Same as above for an arbitrary affine matrix, e.g. a world matrix that already carries the scale
+    inline aabb_3d transform_bounds(const aabb_3d & local, const float4x4 & m)
+    {
+        const float3 center = transform_coord(m, local.center());
+        const float3 half = local.size() * 0.5f;
+        const float3 extent = abs(float3(m[0].xyz)) * half.x + abs(float3(m[1].xyz)) * half.y + abs(float3(m[2].xyz)) * half.z;
+        return { center - extent, center + extent };
+    }
+
     // Lengyel, Eric. "Computing Tangent Space Basis Vectors for an Arbitrary Mesh".
     // Terathon Software 3D Graphics Library, 2001.
     inline void compute_tangents(geometry & g)
@@ -279,6 +299,41 @@ namespace polymer
         for (auto & f : add.faces) base.faces.push_back({ (int)base.vertices.size() + f.x, (int)base.vertices.size() + f.y, (int)base.vertices.size() + f.z });
     }
 
+    // Interpolates the texcoord and computes the face normal of a ray hit, given the barycentric
+    // coordinates (weights of the second and third vertex) reported by intersect_ray_triangle
+    inline void compute_mesh_hit_attributes(const geometry & mesh, const uint3 & face, const float2 & uv,
+        float3 * outFaceNormal = nullptr,
+        float2 * outTexcoord = nullptr)
+    {
+        if (outTexcoord && mesh.texcoord0.size())
+        {
+            float u = uv.x;
+            float v = uv.y;
+            float w = 1.f - u - v;
+
+            float3 weight = { std::max(0.f, w), std::max(0.f, u), std::max(0.f, v) };
+
+            const float fDiv = 1.f / (weight.x + weight.y + weight.z);
+            weight *= fDiv;
+
+            const float2 tc_0 = mesh.texcoord0[face.x];
+            const float2 tc_1 = mesh.texcoord0[face.y];
+            const float2 tc_2 = mesh.texcoord0[face.z];
+
+            *outTexcoord = tc_0 * weight.x + tc_1 * weight.y + tc_2 * weight.z;
+        }
+
+        if (outFaceNormal)
+        {
+            const auto v0 = mesh.vertices[face.x];
+            const auto v1 = mesh.vertices[face.y];
+            const auto v2 = mesh.vertices[face.z];
+            *outFaceNormal = safe_normalize(cross(v1 - v0, v2 - v0));
+        }
+    }
+
+    // Brute force over every face. For repeated queries against large meshes, build a mesh_bvh
+    // (tools/mesh-bvh.hpp) and use the overload that takes it.
     inline bool intersect_ray_mesh(const ray & ray,
         const geometry & mesh,
         float * outRayT = nullptr,
@@ -288,15 +343,16 @@ namespace polymer
     {
         float best_t = std::numeric_limits<float>::infinity(), t;
         uint3 best_face = { 0, 0, 0 };
-        float2 outUv;
+        float2 best_uv, uv;
 
         for (int f = 0; f < mesh.faces.size(); ++f)
         {
             auto & tri = mesh.faces[f];
-            if (intersect_ray_triangle(ray, mesh.vertices[tri.x], mesh.vertices[tri.y], mesh.vertices[tri.z], &t, &outUv) && t < best_t)
+            if (intersect_ray_triangle(ray, mesh.vertices[tri.x], mesh.vertices[tri.y], mesh.vertices[tri.z], &t, &uv) && t < best_t)
             {
                 best_t = t;
                 best_face = mesh.faces[f];
+                best_uv = uv;
             }
         }
 
@@ -307,32 +363,7 @@ namespace polymer
             *outRayT = best_t;
         }
 
-        if (outTexcoord && mesh.texcoord0.size())
-        {
-            float u = outUv.x;
-            float v = outUv.y;
-            float w = 1.f - u - v;
-
-            float3 weight = { std::max(0.f, w), std::max(0.f, u), std::max(0.f, v) };
-
-            const float fDiv = 1.f / (weight.x + weight.y + weight.z);
-            weight *= fDiv;
-
-            const float2 tc_0 = mesh.texcoord0[best_face.x];
-            const float2 tc_1 = mesh.texcoord0[best_face.y];
-            const float2 tc_2 = mesh.texcoord0[best_face.z];
-
-            *outTexcoord = tc_0 * weight.x + tc_1 * weight.y + tc_2 * weight.z;
-        }
-
-        if (outFaceNormal)
-        {
-            const auto v0 = mesh.vertices[best_face.x];
-            const auto v1 = mesh.vertices[best_face.y];
-            const auto v2 = mesh.vertices[best_face.z];
-            *outFaceNormal = safe_normalize(cross(v1 - v0, v2 - v0));
-        }
-
+        compute_mesh_hit_attributes(mesh, best_face, best_uv, outFaceNormal, outTexcoord);
         return true;
     }
 
@@ -0,0 +1,191 @@
+#pragma once
+
+#ifndef polymer_incremental_sort_hpp
+#define polymer_incremental_sort_hpp
+
+#include "polymer-core/tools/radix-sort.hpp"
+#include "polymer-core/util/job-system.hpp"
+
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+#include <type_traits>
+#include <vector>
+
+namespace polymer
+{
+    // Keeps an order of [0, count) ascending by a key that changes a little between calls, e.g. the view
+    // depth of splats or translucent objects under a slowly moving camera. Each sort() gathers the new
+    // keys through the previous order and measures its disorder: the fraction of neighbouring pairs
+    // that are now out of order. Below max_disorder the order is repaired in place by insertion sort,
+    // in parallel blocks followed by one serial pass that only has work left at the block seams. Above
+    // it, or when the repair needs more than max_moves_per_element shifts per element, or when count
+    // changes, the keys are radix sorted from scratch. Equal keys keep their previous relative order.
+    template <typename K>
+    class incremental_sort
+    {
+        static_assert(std::is_same<K, float>::value || (std::is_integral<K>::value && std::is_unsigned<K>::value), "incremental_sort keys must be float or unsigned");
+
+        static const size_t kBlockSize = 4096;
+
+        job_system * jobs { nullptr }; // default_job_system() unless given, looked up by the first parallel sort
+        radix_sort full_sorter;
+        size_t parallel_threshold { radix_sort::kDefaultParallelThreshold };
+
+        std::vector<uint32_t> permutation;
+        std::vector<K> sorted_keys;
+        std::vector<uint32_t> block_counts;
+
+        float disorder_ratio { 0.f };
+        bool was_full_sort { false };
+
+        // Stable insertion sort of keys/values that gives up once it has shifted more than budget elements
+        static bool bounded_insertion_sort(K * keys, uint32_t * values, const size_t size, size_t budget)
+        {
+            for (size_t i = 1; i < size; ++i)
+            {
+                if (!(keys[i] < keys[i - 1])) continue;
+
+                const K key = keys[i];
+                const uint32_t value = values[i];
+                size_t j = i;
+                for (; j > 0 && key < keys[j - 1]; --j)
+                {
+                    keys[j] = keys[j - 1];
+                    values[j] = values[j - 1];
+                }
+                keys[j] = key;
+                values[j] = value;
+
+                const size_t moved = i - j;
+                if (moved > budget) return false;
+                budget -= moved;
+            }
+            return true;
+        }
+
+        void sort_from_scratch(const K * keys, const size_t count)
+        {
+            for (size_t i = 0; i < count; ++i) sorted_keys[i] = keys[permutation[i]];
+            full_sorter.sort_pairs(sorted_keys.data(), permutation.data(), count);
+            was_full_sort = true;
+        }
+
+    public:
+
+        float max_disorder { 0.05f };          // descents per neighbouring pair tolerated before a full sort
+        uint32_t max_moves_per_element { 8 };  // average shift distance tolerated during the repair
+
+        incremental_sort() = default;
+        incremental_sort(job_system & jobs) : jobs(&jobs), full_sorter(jobs) {}
+
+        // Inputs at least this large gather, measure and repair on the job system. Pass SIZE_MAX to stay serial.
+        void set_parallel_threshold(const size_t threshold)
+        {
+            parallel_threshold = threshold;
+            full_sorter.set_parallel_threshold(threshold);
+        }
+
+        // Forget the previous order; the next sort() is a full sort
+        void reset() { permutation.clear(); }
+
+        // Returns indices into keys, ascending by key
+        const std::vector<uint32_t> & sort(const K * keys, const size_t count)
+        {
+            disorder_ratio = 0.f;
+            was_full_sort = false;
+
+            if (permutation.size() != count)
+            {
+                permutation.resize(count);
+                sorted_keys.resize(count);
+                std::iota(permutation.begin(), permutation.end(), 0u);
+                disorder_ratio = 1.f;
+                sort_from_scratch(keys, count);
+                return permutation;
+            }
+            if (count < 2) return permutation;
+
+            if (count >= parallel_threshold && !jobs) jobs = &default_job_system();
+            const bool parallel = count >= parallel_threshold && jobs->num_workers() > 0;
+            const size_t num_blocks = (count + kBlockSize - 1) / kBlockSize;
+            const auto block_end = [count](const size_t b) { return std::min(count, (b + 1) * kBlockSize); };
+            const auto for_each_block = [&](const auto & f)
+            {
+                if (parallel) jobs->parallel_for(num_blocks, 1, f);
+                else f(size_t(0), num_blocks);
+            };
+
+            // Gather through the previous order and count descents, block by block
+            block_counts.assign(num_blocks, 0);
+            for_each_block([&](const size_t first, const size_t last)
+            {
+                for (size_t b = first; b < last; ++b)
+                {
+                    uint32_t descents = 0;
+                    for (size_t i = b * kBlockSize; i < block_end(b); ++i)
+                    {
+                        sorted_keys[i] = keys[permutation[i]];
+                        if (i > b * kBlockSize && sorted_keys[i] < sorted_keys[i - 1]) ++descents;
+                    }
+                    block_counts[b] = descents;
+                }
+            });
+
+            size_t descents = 0;
+            for (size_t b = 0; b < num_blocks; ++b)
+            {
+                descents += block_counts[b];
+                if (b > 0 && sorted_keys[b * kBlockSize] < sorted_keys[b * kBlockSize - 1]) ++descents;
+            }
+            disorder_ratio = float(descents) / float(count - 1);
+
+            if (descents == 0) return permutation;
+            if (disorder_ratio > max_disorder)
+            {
+                full_sorter.sort_pairs(sorted_keys.data(), permutation.data(), count);
+                was_full_sort = true;
+                return permutation;
+            }
+
+            // Repair: blocks in parallel, then the seams. Both keep the arrays a permutation even when they
+            // give up, so the full sort can take over from wherever the repair stopped.
+            std::atomic<bool> within_budget { true };
+            for_each_block([&](const size_t first, const size_t last)
+            {
+                for (size_t b = first; b < last && within_budget.load(std::memory_order_relaxed); ++b)
+                {
+                    const size_t begin = b * kBlockSize;
+                    if (!block_counts[b]) continue;
+                    if (!bounded_insertion_sort(&sorted_keys[begin], &permutation[begin], block_end(b) - begin, size_t(max_moves_per_element) * kBlockSize))
+                    {
+                        within_budget.store(false, std::memory_order_relaxed);
+                    }
+                }
+            });
+
+            if (!within_budget || !bounded_insertion_sort(sorted_keys.data(), permutation.data(), count, size_t(max_moves_per_element) * count))
+            {
+                full_sorter.sort_pairs(sorted_keys.data(), permutation.data(), count);
+                was_full_sort = true;
+            }
+
+            return permutation;
+        }
+
+        const std::vector<uint32_t> & order() const { return permutation; }
+
+        // Keys in order() as of the last sort
+        const std::vector<K> & keys() const { return sorted_keys; }
+
+        // Fraction of neighbouring pairs the previous order had wrong at the last sort (1 after a count change)
+        float disorder() const { return disorder_ratio; }
+
+        // Whether the last sort fell back to a full radix sort
+        bool full_sort() const { return was_full_sort; }
+    };
+
+} // end namespace polymer
+
+#endif // end polymer_incremental_sort_hpp
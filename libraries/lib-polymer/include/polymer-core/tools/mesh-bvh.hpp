@@ -0,0 +1,377 @@
+#pragma once
+
+#ifndef polymer_mesh_bvh_hpp
+#define polymer_mesh_bvh_hpp
+
+#include "polymer-core/math/math-core.hpp"
+#include "polymer-core/tools/geometry.hpp"
+#include "polymer-core/tools/bvh.hpp"
+#include "polymer-core/util/cpu-features.hpp"
+
+namespace polymer
+{
+
+    /////////////////////////////////////////
+    //   watertight ray/triangle testing   //
+    /////////////////////////////////////////
+
+    // Per-ray setup for "Watertight Ray/Triangle Intersection" (Woop, Benthin, Wald 2013). The ray is
+    // sheared so that it points down +z, after which the edge tests are 2D and consistent across shared
+    // edges: a ray through an edge or vertex can never slip between two adjacent triangles.
+    struct watertight_ray
+    {
+        float3 origin;
+        int kx, ky, kz;
+        float sx, sy, sz;
+
+        watertight_ray(const ray & r) : origin(r.origin)
+        {
+            const float3 d = r.direction;
+            const float3 ad = abs(d);
+            kz = (ad.x > ad.y) ? ((ad.x > ad.z) ? 0 : 2) : ((ad.y > ad.z) ? 1 : 2);
+            kx = (kz + 1) % 3;
+            ky = (kx + 1) % 3;
+            if (d[kz] < 0.f) std::swap(kx, ky); // preserve winding
+            sx = d[kx] / d[kz];
+            sy = d[ky] / d[kz];
+            sz = 1.f / d[kz];
+        }
+    };
+
+    // Two-sided. Reports hits with 0 <= t <= max_t, and `out_uv` as the weights of v1 and v2,
+    // matching intersect_ray_triangle.
+    inline bool intersect_ray_triangle_watertight(const watertight_ray & r, const float3 & v0, const float3 & v1, const float3 & v2,
+        const float max_t, float * out_t = nullptr, float2 * out_uv = nullptr)
+    {
+        const float3 a = v0 - r.origin, b = v1 - r.origin, c = v2 - r.origin;
+
+        const float ax = a[r.kx] - r.sx * a[r.kz], ay = a[r.ky] - r.sy * a[r.kz];
+        const float bx = b[r.kx] - r.sx * b[r.kz], by = b[r.ky] - r.sy * b[r.kz];
+        const float cx = c[r.kx] - r.sx * c[r.kz], cy = c[r.ky] - r.sy * c[r.kz];
+
+        float u = cx * by - cy * bx;
+        float v = ax * cy - ay * cx;
+        float w = bx * ay - by * ax;
+
+        // An edge passes exactly through the ray: redo the edge functions in double so that the
+        // triangles sharing that edge agree on which of them is hit
+        if (u == 0.f || v == 0.f || w == 0.f)
+        {
+            u = static_cast<float>(double(cx) * double(by) - double(cy) * double(bx));
+            v = static_cast<float>(double(ax) * double(cy) - double(ay) * double(cx));
+            w = static_cast<float>(double(bx) * double(ay) - double(by) * double(ax));
+        }
+
+        if ((u < 0.f || v < 0.f || w < 0.f) && (u > 0.f || v > 0.f || w > 0.f)) return false;
+
+        const float det = u + v + w;
+        if (det == 0.f) return false;
+
+        const float t_scaled = u * (r.sz * a[r.kz]) + v * (r.sz * b[r.kz]) + w * (r.sz * c[r.kz]);
+        const float det_sign = (det < 0.f) ? -1.f : 1.f;
+        if (t_scaled * det_sign < 0.f || t_scaled * det_sign > max_t * det * det_sign) return false;
+
+        const float inv_det = 1.f / det;
+        if (out_t) *out_t = t_scaled * inv_det;
+        if (out_uv) *out_uv = { v * inv_det, w * inv_det };
+        return true;
+    }
+
+    //////////////////
+    //   mesh_bvh   //
+    //////////////////
+
+    struct mesh_hit
+    {
+        float t {std::numeric_limits<float>::infinity()};
+        uint32_t face {0};  // index into runtime_mesh::faces
+        float2 uv;          // weights of the face's second and third vertex
+    };
+
+    // Bottom-level (per-mesh) triangle BVH. Built with the bvh_tree binned SAH builder, then the triangle
+    // vertices are copied into leaf order as structure-of-arrays streams so that each leaf (at most four
+    // triangles) is tested with a single 4-wide watertight test. Queries return the closest hit and
+    // visit nodes near-to-far, skipping any that start beyond the best hit so far.
+    //
+    // The tree holds a copy of the vertex data and does not observe the mesh. matches() is a cheap check
+    // against the buffers it was built from (storage and sizes, not contents); callers that edit
+    // vertices in place must rebuild explicitly.
+    class mesh_bvh
+    {
+        static constexpr uint32_t kLanes = 4;
+
+        std::vector<bvh_flat_node> nodes;
+        std::vector<float> streams[9];  // [vertex * 3 + axis], per triangle in leaf order, padded to whole lanes
+        std::vector<uint32_t> faces;    // leaf order -> index into runtime_mesh::faces
+        uint32_t depth {0};
+
+        const float3 * source_vertices {nullptr};
+        const uint3 * source_faces {nullptr};
+        size_t source_num_vertices {0};
+        size_t source_num_faces {0};
+
+        const float * stream(const uint32_t vertex, const int axis) const { return streams[vertex * 3 + axis].data(); }
+
+        bool intersect_leaf_scalar(const watertight_ray & r, const uint32_t first, const uint32_t count, mesh_hit & best) const
+        {
+            bool hit = false;
+            for (uint32_t i = first; i < first + count; ++i)
+            {
+                const float3 v0 = { stream(0, 0)[i], stream(0, 1)[i], stream(0, 2)[i] };
+                const float3 v1 = { stream(1, 0)[i], stream(1, 1)[i], stream(1, 2)[i] };
+                const float3 v2 = { stream(2, 0)[i], stream(2, 1)[i], stream(2, 2)[i] };
+
+                float t; float2 uv;
+                if (intersect_ray_triangle_watertight(r, v0, v1, v2, best.t, &t, &uv) && t < best.t)
+                {
+                    best = { t, faces[i], uv };
+                    hit = true;
+                }
+            }
+            return hit;
+        }
+
+    #if defined(POLYMER_SIMD_X86)
+        bool intersect_leaf_sse(const watertight_ray & r, const uint32_t first, const uint32_t count, mesh_hit & best) const
+        {
+            bool hit = false;
+            for (uint32_t i = first; i < first + count; i += kLanes)
+            {
+                const uint32_t lanes = std::min(kLanes, first + count - i);
+                const int lane_mask = (1 << lanes) - 1;
+
+                const __m128 sx = _mm_set1_ps(r.sx), sy = _mm_set1_ps(r.sy), sz = _mm_set1_ps(r.sz);
+                const float o[3] = { r.origin.x, r.origin.y, r.origin.z };
+
+                __m128 px[3], py[3], pz[3];
+                for (uint32_t v = 0; v < 3; ++v)
+                {
+                    const __m128 x = _mm_sub_ps(_mm_loadu_ps(stream(v, r.kx) + i), _mm_set1_ps(o[r.kx]));
+                    const __m128 y = _mm_sub_ps(_mm_loadu_ps(stream(v, r.ky) + i), _mm_set1_ps(o[r.ky]));
+                    const __m128 z = _mm_sub_ps(_mm_loadu_ps(stream(v, r.kz) + i), _mm_set1_ps(o[r.kz]));
+                    px[v] = _mm_sub_ps(x, _mm_mul_ps(sx, z));
+                    py[v] = _mm_sub_ps(y, _mm_mul_ps(sy, z));
+                    pz[v] = _mm_mul_ps(sz, z);
+                }
+
+                const __m128 u = _mm_sub_ps(_mm_mul_ps(px[2], py[1]), _mm_mul_ps(py[2], px[1]));
+                const __m128 v = _mm_sub_ps(_mm_mul_ps(px[0], py[2]), _mm_mul_ps(py[0], px[2]));
+                const __m128 w = _mm_sub_ps(_mm_mul_ps(px[1], py[0]), _mm_mul_ps(py[1], px[0]));
+
+                // Lanes with an edge exactly through the ray take the scalar path and its double-precision retry
+                const __m128 zero = _mm_setzero_ps();
+                const int degenerate = _mm_movemask_ps(_mm_or_ps(_mm_or_ps(_mm_cmpeq_ps(u, zero), _mm_cmpeq_ps(v, zero)), _mm_cmpeq_ps(w, zero))) & lane_mask;
+
+                const __m128 any_negative = _mm_or_ps(_mm_or_ps(_mm_cmplt_ps(u, zero), _mm_cmplt_ps(v, zero)), _mm_cmplt_ps(w, zero));
+                const __m128 any_positive = _mm_or_ps(_mm_or_ps(_mm_cmpgt_ps(u, zero), _mm_cmpgt_ps(v, zero)), _mm_cmpgt_ps(w, zero));
+                const __m128 det = _mm_add_ps(_mm_add_ps(u, v), w);
+                const __m128 t_scaled = _mm_add_ps(_mm_add_ps(_mm_mul_ps(u, pz[0]), _mm_mul_ps(v, pz[1])), _mm_mul_ps(w, pz[2]));
+
+                // Flip signs by det so that the range test works for either winding
+                const __m128 sign_bit = _mm_and_ps(det, _mm_set1_ps(-0.f));
+                const __m128 t_signed = _mm_xor_ps(t_scaled, sign_bit);
+                const __m128 det_abs = _mm_xor_ps(det, sign_bit);
+
+                __m128 valid = _mm_andnot_ps(_mm_and_ps(any_negative, any_positive), _mm_cmpneq_ps(det, zero));
+                valid = _mm_and_ps(valid, _mm_cmpge_ps(t_signed, zero));
+                valid = _mm_and_ps(valid, _mm_cmple_ps(t_signed, _mm_mul_ps(_mm_set1_ps(best.t), det_abs)));
+
+                int mask = _mm_movemask_ps(valid) & lane_mask & ~degenerate;
+
+                if (mask)
+                {
+                    const __m128 inv_det = _mm_div_ps(_mm_set1_ps(1.f), det);
+                    alignas(16) float t[4], bu[4], bv[4];
+                    _mm_store_ps(t, _mm_mul_ps(t_scaled, inv_det));
+                    _mm_store_ps(bu, _mm_mul_ps(v, inv_det));
+                    _mm_store_ps(bv, _mm_mul_ps(w, inv_det));
+
+                    for (uint32_t k = 0; k < lanes; ++k)
+                    {
+                        if ((mask & (1 << k)) && t[k] < best.t)
+                        {
+                            best = { t[k], faces[i + k], { bu[k], bv[k] } };
+                            hit = true;
+                        }
+                    }
+                }
+
+                for (uint32_t k = 0; k < lanes; ++k)
+                {
+                    if (degenerate & (1 << k)) hit |= intersect_leaf_scalar(r, i + k, 1, best);
+                }
+            }
+            return hit;
+        }
+    #endif
+
+        bool intersect_leaf(const watertight_ray & r, const uint32_t first, const uint32_t count, mesh_hit & best) const
+        {
+        #if defined(POLYMER_SIMD_X86)
+            return intersect_leaf_sse(r, first, count, best);
+        #else
+            return intersect_leaf_scalar(r, first, count, best);
+        #endif
+        }
+
+        // Clamped away from zero: an infinite reciprocal times a zero offset (a ray starting on a node
+        // face, parallel to it) would be NaN and reject the node
+        static float3 safe_inverse_direction(const float3 & d)
+        {
+            const auto safe_rcp = [](const float x) { return 1.f / (std::abs(x) > 1e-30f ? x : std::copysign(1e-30f, x)); };
+            return { safe_rcp(d.x), safe_rcp(d.y), safe_rcp(d.z) };
+        }
+
+        static bool intersect_node(const bvh_flat_node & n, const float3 & origin, const float3 & inv_dir, const float max_t, float & t_near)
+        {
+            const float3 t0 = (n.bmin - origin) * inv_dir;
+            const float3 t1 = (n.bmax - origin) * inv_dir;
+            t_near = std::max(maxelem(linalg::min(t0, t1)), 0.f);
+            const float t_far = std::min(minelem(linalg::max(t0, t1)), max_t);
+            return t_near <= t_far;
+        }
+
+    public:
+
+        mesh_bvh() = default;
+
+        void build(const runtime_mesh & mesh)
+        {
+            clear();
+
+            const uint32_t num_faces = static_cast<uint32_t>(mesh.faces.size());
+
+            std::vector<aabb_3d> bounds(num_faces);
+            for (uint32_t f = 0; f < num_faces; ++f)
+            {
+                const uint3 & tri = mesh.faces[f];
+                aabb_3d b(mesh.vertices[tri.x], mesh.vertices[tri.x]);
+                b.surround(mesh.vertices[tri.y]);
+                b.surround(mesh.vertices[tri.z]);
+                bounds[f] = b;
+            }
+
+            depth = bvh_tree::build_binned_sah(std::move(bounds), nodes, faces);
+
+            // Padding lanes are masked off by leaf counts, but keep them finite
+            const size_t padded = faces.size() + kLanes - 1;
+            for (auto & s : streams) s.assign(padded, 0.f);
+
+            for (size_t i = 0; i < faces.size(); ++i)
+            {
+                const uint3 & tri = mesh.faces[faces[i]];
+                const float3 v[3] = { mesh.vertices[tri.x], mesh.vertices[tri.y], mesh.vertices[tri.z] };
+                for (int k = 0; k < 3; ++k)
+                {
+                    streams[k * 3 + 0][i] = v[k].x;
+                    streams[k * 3 + 1][i] = v[k].y;
+                    streams[k * 3 + 2][i] = v[k].z;
+                }
+            }
+
+            source_vertices = mesh.vertices.data();
+            source_faces = mesh.faces.data();
+            source_num_vertices = mesh.vertices.size();
+            source_num_faces = mesh.faces.size();
+        }
+
+        void clear()
+        {
+            nodes.clear();
+            faces.clear();
+            for (auto & s : streams) s.clear();
+            depth = 0;
+            source_vertices = nullptr;
+            source_faces = nullptr;
+            source_num_vertices = source_num_faces = 0;
+        }
+
+        bool empty() const { return nodes.empty(); }
+        size_t num_nodes() const { return nodes.size(); }
+
+        // True if this tree was built from the mesh's current vertex and face buffers
+        bool matches(const runtime_mesh & mesh) const
+        {
+            return source_vertices == mesh.vertices.data() && source_num_vertices == mesh.vertices.size()
+                && source_faces == mesh.faces.data() && source_num_faces == mesh.faces.size();
+        }
+
+        // Closest hit with t in [0, max_t]. `hit` is only written when something is hit.
+        bool intersect(const ray & r, mesh_hit & hit, const float max_t = std::numeric_limits<float>::infinity()) const
+        {
+            if (nodes.empty()) return false;
+
+            const watertight_ray wr(r);
+            const float3 inv_dir = safe_inverse_direction(r.direction);
+
+            mesh_hit best;
+            best.t = max_t;
+            bool found = false;
+
+            struct entry { uint32_t node; float t_near; };
+            entry local_stack[64];
+            std::vector<entry> heap_stack;
+            entry * stack = local_stack;
+            if (depth > 64) { heap_stack.resize(depth); stack = heap_stack.data(); }
+
+            uint32_t stack_size = 0;
+            float t_root;
+            if (intersect_node(nodes[0], r.origin, inv_dir, best.t, t_root)) stack[stack_size++] = { 0, t_root };
+
+            while (stack_size)
+            {
+                const entry e = stack[--stack_size];
+                if (e.t_near > best.t) continue;
+
+                uint32_t index = e.node;
+                while (true)
+                {
+                    const bvh_flat_node & n = nodes[index];
+                    if (n.is_leaf())
+                    {
+                        found |= intersect_leaf(wr, n.offset, n.count, best);
+                        break;
+                    }
+
+                    // Descend into the nearer child and defer the farther one
+                    const uint32_t left = index + 1, right = n.offset;
+                    float t_left, t_right;
+                    const bool hit_left = intersect_node(nodes[left], r.origin, inv_dir, best.t, t_left);
+                    const bool hit_right = intersect_node(nodes[right], r.origin, inv_dir, best.t, t_right);
+
+                    if (hit_left && hit_right)
+                    {
+                        if (t_left <= t_right) { stack[stack_size++] = { right, t_right }; index = left; }
+                        else { stack[stack_size++] = { left, t_left }; index = right; }
+                    }
+                    else if (hit_left) index = left;
+                    else if (hit_right) index = right;
+                    else break;
+                }
+            }
+
+            if (found) hit = best;
+            return found;
+        }
+    };
+
+    // Same results as the brute-force intersect_ray_mesh, using an accelerator built from `mesh`
+    inline bool intersect_ray_mesh(const ray & ray,
+        const geometry & mesh,
+        const mesh_bvh & accelerator,
+        float * outRayT = nullptr,
+        float3 * outFaceNormal = nullptr,
+        float2 * outTexcoord = nullptr,
+        const float max_t = std::numeric_limits<float>::infinity())
+    {
+        mesh_hit hit;
+        if (!accelerator.intersect(ray, hit, max_t)) return false;
+
+        if (outRayT) *outRayT = hit.t;
+        compute_mesh_hit_attributes(mesh, mesh.faces[hit.face], hit.uv, outFaceNormal, outTexcoord);
+        return true;
+    }
+
+} // end namespace polymer
+
+#endif // end polymer_mesh_bvh_hpp
@@ -6,89 +6,305 @@
 #ifndef polymer_radix_sort_hpp
 #define polymer_radix_sort_hpp
 
+#include "polymer-core/util/job-system.hpp"
+
 #include <memory>
 #include <stdint.h>
 #include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
 namespace polymer
 {
+    // Stable LSD radix sort over integral or float keys, optionally carrying a payload array along
+    // with the keys (sort_pairs). 32-bit keys use 11-bit digits (three passes over a 2048-entry
+    // histogram that stays in L1), everything else uses 8-bit digits. All digit histograms come from
+    // one read of the keys, and passes where every key shares a digit are skipped, so 64-bit keys
+    // holding small values only pay for the bytes actually in use.
+    //
+    // Scratch memory is kept between calls; a radix_sort reused every frame does not allocate once
+    // it has seen its largest input. Inputs of at least parallel_threshold elements are sorted on the
+    // job system: each pass histograms and scatters contiguous chunks concurrently, and chunk c writes
+    // after chunks < c within every digit so the result is identical to the serial sort.
     class radix_sort
     {
-        void float_flip(uint32_t & f) { int32_t mask = (int32_t(f) >> 31) | 0x80000000; f ^= mask; } // Warren Hunt, Manchor Ko
-        void inverse_float_flip(uint32_t & f) { uint32_t mask = (int32_t(f ^ 0x80000000) >> 31) | 0x80000000; f ^= mask; } // Michael Herf
+        struct no_value {};
 
-        constexpr static const uint32_t RADIX_LENGTH_BITS = 16;
-        constexpr static const uint32_t HISTOGRAM_BUCKETS = (1 << RADIX_LENGTH_BITS);
-        constexpr static const uint32_t BIT_MASK = (HISTOGRAM_BUCKETS - 1);
+        static void float_flip(uint32_t & f) { int32_t mask = (int32_t(f) >> 31) | 0x80000000; f ^= mask; } // Warren Hunt, Manchor Ko
+        static void inverse_float_flip(uint32_t & f) { uint32_t mask = (int32_t(f ^ 0x80000000) >> 31) | 0x80000000; f ^= mask; } // Michael Herf
 
-        template<typename T>
-        void radix_impl(T * data, size_t size)
-        {
-            const uint32_t passes = (sizeof(T) * 8) % RADIX_LENGTH_BITS == 0 ? (sizeof(T) * 8) / RADIX_LENGTH_BITS : (sizeof(T) * 8) / RADIX_LENGTH_BITS + 1;
-            static_assert(passes % 2 == 0, "must be even number");
+        static const size_t kInsertionSortThreshold = 64; // below this, a stable insertion sort wins
+        static const size_t kMinParallelChunk = 16384;    // elements per chunk on the parallel path
 
-            std::vector<size_t> histograms(passes * HISTOGRAM_BUCKETS);
-            std::vector<T> result(size);
+        job_system * jobs { nullptr }; // default_job_system() unless given, looked up by the first parallel sort
+        size_t parallel_threshold { kDefaultParallelThreshold };
 
-            // Build histograms in parallel
-            for (size_t i = 0; i < size; i++)
-            {
-                T element = data[i];
+        std::vector<uint8_t> key_scratch;
+        std::vector<uint8_t> value_scratch;
+        std::vector<uint32_t> counts;
 
-                for (int r = 0; r < passes; r++)
+        template <typename T>
+        static T * scratch_as(std::vector<uint8_t> & buffer, const size_t size)
+        {
+            static_assert(alignof(T) <= alignof(std::max_align_t), "scratch storage is only max_align_t aligned");
+            if (buffer.size() < size * sizeof(T)) buffer.resize(size * sizeof(T));
+            return reinterpret_cast<T *>(buffer.data());
+        }
+
+        template <typename U, typename V>
+        static void insertion_sort(U * keys, V * values, const size_t size)
+        {
+            for (size_t i = 1; i < size; ++i)
+            {
+                const U key = keys[i];
+                size_t j = i;
+                if constexpr (std::is_same<V, no_value>::value)
                 {
-                    T pos = (element >> (r * RADIX_LENGTH_BITS)) & BIT_MASK;
-                    histograms[r * HISTOGRAM_BUCKETS + pos] += 1;
+                    for (; j > 0 && key < keys[j - 1]; --j) keys[j] = keys[j - 1];
+                    keys[j] = key;
+                }
+                else
+                {
+                    const V value = values[i];
+                    for (; j > 0 && key < keys[j - 1]; --j) { keys[j] = keys[j - 1]; values[j] = values[j - 1]; }
+                    keys[j] = key;
+                    values[j] = value;
                 }
             }
+        }
 
-            // Sum the histograms
-            for (uint32_t r = 0; r < passes; r++)
+        // Exclusive prefix sum over one histogram; returns false if the pass would not move anything
+        static bool prefix_sum(uint32_t * histogram, const uint32_t buckets, const size_t size)
+        {
+            uint32_t sum = 0;
+            for (uint32_t d = 0; d < buckets; ++d)
             {
-                size_t sum = 0;
-                for (uint32_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+                const uint32_t count = histogram[d];
+                if (count == size) return false;
+                histogram[d] = sum;
+                sum += count;
+            }
+            return true;
+        }
+
+        // Sorts unsigned keys (already mapped so that unsigned order is the desired order), ping-ponging
+        // between keys/values and alt_keys/alt_values. Returns true if the result ended up in the alt arrays.
+        template <typename U, typename V>
+        bool radix_passes(U * keys, V * values, U * alt_keys, V * alt_values, const size_t size)
+        {
+            static_assert(std::is_unsigned<U>::value, "radix_passes expects unsigned keys");
+            constexpr bool has_values = !std::is_same<V, no_value>::value;
+
+            if (size < 2) return false;
+            if (size > std::numeric_limits<uint32_t>::max()) throw std::invalid_argument("radix_sort supports at most 2^32 - 1 elements");
+            if (size < kInsertionSortThreshold) { insertion_sort(keys, values, size); return false; }
+
+            constexpr uint32_t key_bits = sizeof(U) * 8;
+            constexpr uint32_t digit_bits = (sizeof(U) == 4) ? 11 : 8;
+            constexpr uint32_t buckets = 1u << digit_bits;
+            constexpr uint32_t mask = buckets - 1;
+            constexpr uint32_t passes = (key_bits + digit_bits - 1) / digit_bits;
+
+            U * src_keys = keys;
+            U * dst_keys = alt_keys;
+            V * src_values = values;
+            V * dst_values = alt_values;
+
+            const auto digit = [](const U key, const uint32_t pass) { return static_cast<uint32_t>(key >> (pass * digit_bits)) & mask; };
+
+            if (size >= parallel_threshold && !jobs) jobs = &default_job_system();
+            const bool parallel = size >= parallel_threshold && jobs->num_workers() > 0;
+
+            if (!parallel)
+            {
+                counts.assign(passes * buckets, 0);
+                for (size_t i = 0; i < size; ++i)
                 {
-                    size_t val = histograms[r * HISTOGRAM_BUCKETS + i];
-                    histograms[r * HISTOGRAM_BUCKETS + i] = sum;
-                    sum += val;
+                    const U key = src_keys[i];
+                    for (uint32_t p = 0; p < passes; ++p) ++counts[p * buckets + digit(key, p)];
                 }
-            }
 
-            T * src = data;
-            T * dst = result.data();
-            for (uint32_t r = 0; r < passes; r++)
+                for (uint32_t p = 0; p < passes; ++p)
+                {
+                    uint32_t * offsets = &counts[p * buckets];
+                    if (!prefix_sum(offsets, buckets, size)) continue;
+
+                    for (size_t i = 0; i < size; ++i)
+                    {
+                        const uint32_t index = offsets[digit(src_keys[i], p)]++;
+                        dst_keys[index] = src_keys[i];
+                        if constexpr (has_values) dst_values[index] = src_values[i];
+                    }
+
+                    std::swap(src_keys, dst_keys);
+                    if constexpr (has_values) std::swap(src_values, dst_values);
+                }
+            }
+            else
             {
-                for (size_t i = 0; i < size; i++)
+                const size_t num_chunks = std::max<size_t>(1, std::min<size_t>(jobs->num_threads(), size / kMinParallelChunk));
+                const auto chunk_begin = [&](const size_t c) { return size * c / num_chunks; };
+                counts.resize(num_chunks * buckets);
+
+                for (uint32_t p = 0; p < passes; ++p)
                 {
-                    T element = src[i];
-                    T pos = ((element >> (r * RADIX_LENGTH_BITS)) & BIT_MASK);
+                    std::fill(counts.begin(), counts.end(), 0u);
+
+                    jobs->parallel_for(num_chunks, 1, [&](const size_t begin, const size_t end)
+                    {
+                        for (size_t c = begin; c < end; ++c)
+                        {
+                            uint32_t * histogram = &counts[c * buckets];
+                            for (size_t i = chunk_begin(c); i < chunk_begin(c + 1); ++i) ++histogram[digit(src_keys[i], p)];
+                        }
+                    });
+
+                    // Exclusive prefix sum in (digit, chunk) order
+                    uint32_t sum = 0;
+                    bool trivial = false;
+                    for (uint32_t d = 0; d < buckets && !trivial; ++d)
+                    {
+                        uint32_t digit_total = 0;
+                        for (size_t c = 0; c < num_chunks; ++c)
+                        {
+                            const uint32_t count = counts[c * buckets + d];
+                            counts[c * buckets + d] = sum;
+                            sum += count;
+                            digit_total += count;
+                        }
+                        trivial = (digit_total == size);
+                    }
+                    if (trivial) continue;
+
+                    jobs->parallel_for(num_chunks, 1, [&](const size_t begin, const size_t end)
+                    {
+                        for (size_t c = begin; c < end; ++c)
+                        {
+                            uint32_t * offsets = &counts[c * buckets];
+                            for (size_t i = chunk_begin(c); i < chunk_begin(c + 1); ++i)
+                            {
+                                const uint32_t index = offsets[digit(src_keys[i], p)]++;
+                                dst_keys[index] = src_keys[i];
+                                if constexpr (has_values) dst_values[index] = src_values[i];
+                            }
+                        }
+                    });
 
-                    size_t & index = histograms[r * HISTOGRAM_BUCKETS + pos];
-                    dst[index] = element;
-                    index++;
+                    std::swap(src_keys, dst_keys);
+                    if constexpr (has_values) std::swap(src_values, dst_values);
                 }
+            }
+
+            return src_keys != keys;
+        }
 
-                std::swap(src, dst);
+        template <typename U, typename V>
+        void radix_impl(U * keys, V * values, const size_t size)
+        {
+            constexpr bool has_values = !std::is_same<V, no_value>::value;
+            if (size < kInsertionSortThreshold)
+            {
+                radix_passes<U, V>(keys, values, nullptr, nullptr, size);
+                return;
+            }
+
+            U * alt_keys = scratch_as<U>(key_scratch, size);
+            V * alt_values = has_values ? scratch_as<V>(value_scratch, size) : nullptr;
+
+            // An odd number of executed passes leaves the result in scratch
+            if (radix_passes<U, V>(keys, values, alt_keys, alt_values, size))
+            {
+                std::copy(alt_keys, alt_keys + size, keys);
+                if constexpr (has_values) std::copy(alt_values, alt_values + size, values);
+            }
+        }
+
+        // Maps signed and float keys onto unsigned order in place, sorts, then maps them back
+        template <typename K, typename V>
+        void sort_keys(K * keys, V * values, const size_t size)
+        {
+            static_assert(std::is_integral<K>::value || std::is_same<K, float>::value, "radix_sort keys must be integral or float");
+            static_assert(std::is_same<V, no_value>::value || std::is_trivially_copyable<V>::value, "radix_sort values must be trivially copyable");
+
+            if constexpr (std::is_same<K, float>::value)
+            {
+                uint32_t * bits = reinterpret_cast<uint32_t *>(keys);
+                for (size_t i = 0; i < size; ++i) float_flip(bits[i]);
+                radix_impl<uint32_t, V>(bits, values, size);
+                for (size_t i = 0; i < size; ++i) inverse_float_flip(bits[i]);
+            }
+            else if constexpr (std::is_signed<K>::value)
+            {
+                using U = typename std::make_unsigned<K>::type;
+                const U sign_bit = U(1) << (sizeof(U) * 8 - 1);
+                U * bits = reinterpret_cast<U *>(keys);
+                for (size_t i = 0; i < size; ++i) bits[i] ^= sign_bit;
+                radix_impl<U, V>(bits, values, size);
+                for (size_t i = 0; i < size; ++i) bits[i] ^= sign_bit;
+            }
+            else
+            {
+                radix_impl<K, V>(keys, values, size);
             }
         }
 
     public:
 
-        template <typename T, typename = std::enable_if <std::is_integral<T>::value>::type>
+        static const size_t kDefaultParallelThreshold = 1 << 17;
+
+        // Serial sorts never touch the job system, so a default constructed sorter only starts the
+        // workers of default_job_system() once it is given an input of parallel_threshold elements.
+        radix_sort() = default;
+        radix_sort(job_system & jobs) : jobs(&jobs) {}
+
+        // Inputs at least this large are sorted across the job system. Pass SIZE_MAX to stay serial.
+        void set_parallel_threshold(const size_t threshold) { parallel_threshold = threshold; }
+
+        template <typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
         void sort(T * data, const size_t size)
         {
-            radix_impl<T>(data, size);
+            sort_keys<T, no_value>(data, nullptr, size);
         }
 
         void sort(float * data, const size_t size)
         {
-            for (size_t i = 0; i < size; i++) float_flip((uint32_t &)data[i]);
-            radix_impl<uint32_t>((uint32_t *)data, size);
-            for (size_t i = 0; i < size; i++) inverse_float_flip((uint32_t &)data[i]);
+            sort_keys<float, no_value>(data, nullptr, size);
+        }
+
+        template <typename T>
+        void sort(std::vector<T> & data)
+        {
+            sort(data.data(), data.size());
         }
 
+        // Sorts keys ascending and applies the same permutation to values. Equal keys keep their order.
+        template <typename K, typename V>
+        void sort_pairs(K * keys, V * values, const size_t size)
+        {
+            sort_keys<K, V>(keys, values, size);
+        }
+
+        template <typename K, typename V>
+        void sort_pairs(std::vector<K> & keys, std::vector<V> & values)
+        {
+            if (keys.size() != values.size()) throw std::invalid_argument("sort_pairs needs one value per key");
+            sort_keys<K, V>(keys.data(), values.data(), keys.size());
+        }
+
+        // Double-buffered variant over caller-owned storage (e.g. persistently mapped GPU buffers): passes
+        // alternate between the two key/value arrays and nothing is allocated or copied back. Returns true
+        // if the sorted result is in keys_b/values_b, false if it is in keys_a/values_a. Keys must be unsigned.
+        template <typename K, typename V>
+        bool sort_pairs(K * keys_a, V * values_a, K * keys_b, V * values_b, const size_t size)
+        {
+            static_assert(std::is_unsigned<K>::value, "double-buffered sort_pairs expects unsigned keys");
+            static_assert(std::is_trivially_copyable<V>::value, "radix_sort values must be trivially copyable");
+            return radix_passes<K, V>(keys_a, values_a, keys_b, values_b, size);
+        }
     };
 
 } // end namespace polymer
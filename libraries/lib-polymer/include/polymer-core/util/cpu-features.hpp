@@ -0,0 +1,120 @@
+#pragma once
+
+#ifndef polymer_cpu_features_hpp
+#define polymer_cpu_features_hpp
+
+#include <stdint.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+    #define POLYMER_SIMD_X86 1
+    #include <immintrin.h>
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #else
+        #include <cpuid.h>
+    #endif
+#endif
+
+// MSVC lets any function use any intrinsic. GCC and Clang only allow instructions beyond the compile-time
+// target inside functions that opt in, which is what keeps AVX2 paths out of the baseline build.
+#if defined(POLYMER_SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+    #define POLYMER_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+    #define POLYMER_TARGET_AVX2
+#endif
+
+namespace polymer
+{
+    // Coarse instruction-set tiers used to pick a kernel at runtime. SSE2 is part of x86-64,
+    // so `sse` is the floor on any x86 machine and `scalar` is only selected elsewhere (or forced).
+    enum class simd_level : uint32_t
+    {
+        scalar = 0,
+        sse    = 1,
+        avx2   = 2
+    };
+
+    struct cpu_features
+    {
+        bool sse41 {false};
+        bool avx {false};
+        bool avx2 {false};
+        bool fma {false};
+    };
+
+    namespace detail
+    {
+        inline cpu_features query_cpu_features()
+        {
+            cpu_features f;
+
+        #if defined(POLYMER_SIMD_X86)
+            uint32_t r[4] = {};
+            auto cpuid = [&r](const uint32_t leaf, const uint32_t subleaf)
+            {
+            #if defined(_MSC_VER)
+                int regs[4];
+                __cpuidex(regs, static_cast<int>(leaf), static_cast<int>(subleaf));
+                for (int i = 0; i < 4; ++i) r[i] = static_cast<uint32_t>(regs[i]);
+            #else
+                __cpuid_count(leaf, subleaf, r[0], r[1], r[2], r[3]);
+            #endif
+            };
+
+            cpuid(0, 0);
+            const uint32_t max_leaf = r[0];
+
+            cpuid(1, 0);
+            f.sse41 = (r[2] & (1u << 19)) != 0;
+            f.fma = (r[2] & (1u << 12)) != 0;
+            const bool osxsave = (r[2] & (1u << 27)) != 0;
+            const bool cpu_avx = (r[2] & (1u << 28)) != 0;
+
+            // The OS has to save the upper ymm halves on context switch (XCR0 bits 1 and 2)
+            bool os_avx = false;
+            if (osxsave)
+            {
+            #if defined(_MSC_VER)
+                const uint64_t xcr0 = _xgetbv(0);
+            #else
+                uint32_t lo, hi;
+                __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+                const uint64_t xcr0 = (static_cast<uint64_t>(hi) << 32) | lo;
+            #endif
+                os_avx = (xcr0 & 0x6) == 0x6;
+            }
+
+            f.avx = cpu_avx && os_avx;
+            f.fma = f.fma && f.avx;
+
+            if (max_leaf >= 7)
+            {
+                cpuid(7, 0);
+                f.avx2 = f.avx && (r[1] & (1u << 5)) != 0;
+            }
+        #endif
+
+            return f;
+        }
+    } // end namespace detail
+
+    // Queried once; safe to call from any thread
+    inline const cpu_features & get_cpu_features()
+    {
+        static const cpu_features features = detail::query_cpu_features();
+        return features;
+    }
+
+    inline simd_level get_simd_level()
+    {
+    #if defined(POLYMER_SIMD_X86)
+        const cpu_features & f = get_cpu_features();
+        return (f.avx2 && f.fma) ? simd_level::avx2 : simd_level::sse;
+    #else
+        return simd_level::scalar;
+    #endif
+    }
+
+} // end namespace polymer
+
+#endif // end polymer_cpu_features_hpp
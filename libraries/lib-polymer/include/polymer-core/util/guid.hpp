@@ -4,6 +4,7 @@
 #define polymer_guid_hpp
 
 #include <array>
+#include <cstring>
 #include <functional>
 #include <iomanip>
 #include <iostream>
@@ -126,6 +127,21 @@ namespace polymer
         void swap(guid & other) { byte_array.swap(other.byte_array); }
         bool valid() const { return *this != guid(); }
 
+        // Folds the 128 raw bits into 64 without touching the string representation. The
+        // bytes of a guid are already uniformly random, so a single multiply-xorshift mix 
+        // of the two halves is sufficient for use as an unordered_map key.
+        uint64_t hash() const
+        {
+            uint64_t lo, hi;
+            std::memcpy(&lo, byte_array.data(), sizeof(uint64_t));
+            std::memcpy(&hi, byte_array.data() + sizeof(uint64_t), sizeof(uint64_t));
+            uint64_t h = lo ^ (hi * 0x9E3779B97F4A7C15ull);
+            h ^= h >> 32;
+            h *= 0xD6E8FEB86659FD93ull;
+            h ^= h >> 32;
+            return h;
+        }
+
         std::string as_string() const
         {
             char one[10], two[6], three[6], four[6], five[14];
@@ -175,8 +191,7 @@ namespace std
         typedef std::size_t result_type;
         result_type operator()(argument_type const & guid) const
         {
-            std::hash<std::string> h;
-            return static_cast<result_type>(h(guid.as_string()));
+            return static_cast<result_type>(guid.hash());
         }
     };
 
@@ -0,0 +1,472 @@
+#pragma once
+
+#ifndef polymer_job_system_hpp
+#define polymer_job_system_hpp
+
+#include "polymer-core/queues/queue-work-stealing.hpp"
+
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace polymer
+{
+    class job_system;
+
+    ///////////////
+    //   job     //
+    ///////////////
+
+    // A unit of work plus the bookkeeping for parent/child completion and continuations. Small
+    // callables are stored inline; jobs are recycled through a per-thread free list, so spawning
+    // one does not touch the heap in steady state. Jobs must not throw.
+    class job
+    {
+        friend class job_system;
+        friend class job_handle;
+
+        static const size_t kInlineBytes = 64;
+
+        void (*invoke_fn)(job *) { nullptr };
+        void (*destroy_fn)(job *) { nullptr };
+        std::aligned_storage<kInlineBytes, 16>::type storage;
+
+        job * parent { nullptr };
+        std::atomic<int32_t> unfinished { 0 };  // self + children not yet finished
+        std::atomic<int32_t> unmet { 0 };       // unfinished dependencies, +1 until submitted
+        std::atomic<int32_t> refs { 0 };        // handles, +1 held by the scheduler until finished
+
+        std::atomic_flag lock = ATOMIC_FLAG_INIT;
+        bool done { false };                    // guarded by lock
+        std::vector<job *> continuations;       // guarded by lock
+
+        template <typename F>
+        void set_function(F && f)
+        {
+            using fn_t = typename std::decay<F>::type;
+            if (sizeof(fn_t) <= kInlineBytes && alignof(fn_t) <= 16)
+            {
+                new (&storage) fn_t(std::forward<F>(f));
+                invoke_fn = [](job * j) { (*reinterpret_cast<fn_t *>(&j->storage))(); };
+                destroy_fn = [](job * j) { reinterpret_cast<fn_t *>(&j->storage)->~fn_t(); };
+            }
+            else
+            {
+                *reinterpret_cast<fn_t **>(&storage) = new fn_t(std::forward<F>(f));
+                invoke_fn = [](job * j) { (**reinterpret_cast<fn_t **>(&j->storage))(); };
+                destroy_fn = [](job * j) { delete *reinterpret_cast<fn_t **>(&j->storage); };
+            }
+        }
+
+        void execute()
+        {
+            invoke_fn(this);
+            destroy_fn(this);
+            invoke_fn = nullptr;
+            destroy_fn = nullptr;
+        }
+
+        void acquire_lock() { while (lock.test_and_set(std::memory_order_acquire)) std::this_thread::yield(); }
+        void release_lock() { lock.clear(std::memory_order_release); }
+
+        struct free_list
+        {
+            std::vector<job *> jobs;
+            ~free_list() { for (job * j : jobs) delete j; }
+        };
+
+        static free_list & local_free_list()
+        {
+            thread_local free_list list;
+            return list;
+        }
+
+        static job * allocate()
+        {
+            auto & list = local_free_list().jobs;
+            if (list.empty()) return new job();
+            job * j = list.back();
+            list.pop_back();
+            return j;
+        }
+
+        // Called on whichever thread drops the last reference, so jobs migrate between free lists
+        static void recycle(job * j)
+        {
+            static const size_t kMaxCachedJobs = 4096;
+            if (j->destroy_fn) j->destroy_fn(j); // created but never run
+            j->invoke_fn = nullptr;
+            j->destroy_fn = nullptr;
+            j->parent = nullptr;
+            j->done = false;
+            j->continuations.clear();
+
+            auto & list = local_free_list().jobs;
+            if (list.size() < kMaxCachedJobs) list.push_back(j);
+            else delete j;
+        }
+
+        void add_ref() { refs.fetch_add(1, std::memory_order_relaxed); }
+        void release() { if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) recycle(this); }
+    };
+
+    // Reference-counted handle to a job. A job stays valid (and can be waited on or used as a
+    // dependency) for as long as any handle to it exists, even after it has finished.
+    class job_handle
+    {
+        friend class job_system;
+        job * j { nullptr };
+
+        explicit job_handle(job * j) : j(j) { if (j) j->add_ref(); }
+
+    public:
+
+        job_handle() = default;
+        job_handle(const job_handle & other) : j(other.j) { if (j) j->add_ref(); }
+        job_handle(job_handle && other) : j(other.j) { other.j = nullptr; }
+        ~job_handle() { if (j) j->release(); }
+
+        job_handle & operator = (job_handle other) { std::swap(j, other.j); return *this; }
+
+        bool valid() const { return j != nullptr; }
+        bool finished() const { return !j || j->unfinished.load(std::memory_order_acquire) == 0; }
+    };
+
+    //////////////////////
+    //   job_system     //
+    //////////////////////
+
+    // Work-stealing scheduler. Each worker owns a Chase-Lev deque: jobs spawned on a worker are pushed
+    // to its own deque and popped LIFO, idle workers steal FIFO from the others. The thread that
+    // constructs the system also owns a deque, so the main thread can spawn without locking; any other
+    // thread submits through a mutex-protected injection queue. wait() never blocks idle: the waiting
+    // thread runs queued jobs until the one it waits on has finished, which also makes nested
+    // parallel_for calls inside jobs safe.
+    //
+    // A job finishes when its function and all of its children have finished. Continuations added
+    // with add_dependency() are scheduled when their last dependency finishes.
+    class job_system
+    {
+        struct worker_context
+        {
+            const job_system * system { nullptr };
+            int32_t queue { -1 };
+        };
+
+        static worker_context & local_context()
+        {
+            thread_local worker_context ctx;
+            return ctx;
+        }
+
+        std::vector<std::unique_ptr<work_stealing_deque<job *>>> queues; // [0] main thread, [1..] workers
+        std::vector<std::thread> workers;
+        const std::thread::id main_thread;
+
+        std::mutex injection_mutex;
+        std::deque<job *> injected;
+        std::atomic<size_t> num_injected { 0 };
+
+        std::mutex sleep_mutex;
+        std::condition_variable sleep_cv;
+        std::atomic<uint64_t> epoch { 0 };
+        std::atomic<uint32_t> sleepers { 0 };
+        std::atomic<bool> should_stop { false };
+
+        job_system(const job_system &) = delete;
+        job_system & operator= (const job_system &) = delete;
+
+        int32_t local_queue() const
+        {
+            const worker_context & ctx = local_context();
+            if (ctx.system == this) return ctx.queue;
+            if (std::this_thread::get_id() == main_thread) return 0;
+            return -1;
+        }
+
+        template <typename F>
+        job * make_job(F && f, job * parent)
+        {
+            job * j = job::allocate();
+            j->set_function(std::forward<F>(f));
+            j->parent = parent;
+            j->unfinished.store(1, std::memory_order_relaxed);
+            j->unmet.store(1, std::memory_order_relaxed);
+            j->refs.store(1, std::memory_order_relaxed);
+            if (parent) parent->unfinished.fetch_add(1, std::memory_order_relaxed);
+            return j;
+        }
+
+        void schedule(job * j)
+        {
+            const int32_t q = local_queue();
+            if (q >= 0) queues[q]->push(j);
+            else
+            {
+                std::lock_guard<std::mutex> lock(injection_mutex);
+                injected.push_back(j);
+                num_injected.fetch_add(1, std::memory_order_release);
+            }
+            wake_one();
+        }
+
+        void wake_one()
+        {
+            epoch.fetch_add(1, std::memory_order_seq_cst);
+            if (sleepers.load(std::memory_order_seq_cst) > 0)
+            {
+                std::lock_guard<std::mutex> lock(sleep_mutex);
+                sleep_cv.notify_one();
+            }
+        }
+
+        // Own deque first, then the injection queue, then steal round-robin from everyone else
+        bool find_job(const int32_t q, job *& out)
+        {
+            if (q >= 0 && queues[q]->pop(out)) return true;
+
+            if (num_injected.load(std::memory_order_acquire) > 0)
+            {
+                std::lock_guard<std::mutex> lock(injection_mutex);
+                if (!injected.empty())
+                {
+                    out = injected.front();
+                    injected.pop_front();
+                    num_injected.fetch_sub(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+
+            const size_t n = queues.size();
+            const size_t start = (q >= 0) ? size_t(q) + 1 : 0;
+            for (size_t k = 0; k < n; ++k)
+            {
+                const size_t victim = (start + k) % n;
+                if (int32_t(victim) == q) continue;
+                if (queues[victim]->steal(out)) return true;
+            }
+
+            return false;
+        }
+
+        void run(job * j)
+        {
+            j->execute();
+            finish(j);
+        }
+
+        void finish(job * j)
+        {
+            while (j)
+            {
+                if (j->unfinished.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+
+                // No continuation can be added once done is set, so the list is stable after unlocking
+                j->acquire_lock();
+                j->done = true;
+                j->release_lock();
+
+                for (job * c : j->continuations)
+                {
+                    if (c->unmet.fetch_sub(1, std::memory_order_acq_rel) == 1) schedule(c);
+                }
+
+                job * parent = j->parent;
+                j->release();
+                j = parent;
+            }
+        }
+
+        void worker_loop(const int32_t q)
+        {
+            local_context() = { this, q };
+
+            static const uint32_t kSpinsBeforeSleep = 64;
+            uint32_t idle_spins = 0;
+
+            while (!should_stop.load(std::memory_order_acquire))
+            {
+                const uint64_t seen = epoch.load(std::memory_order_seq_cst);
+
+                job * j = nullptr;
+                if (find_job(q, j))
+                {
+                    run(j);
+                    idle_spins = 0;
+                    continue;
+                }
+
+                if (++idle_spins < kSpinsBeforeSleep)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lock(sleep_mutex);
+                sleepers.fetch_add(1, std::memory_order_seq_cst);
+                sleep_cv.wait(lock, [&]() { return should_stop.load() || epoch.load(std::memory_order_seq_cst) != seen; });
+                sleepers.fetch_sub(1, std::memory_order_seq_cst);
+                idle_spins = 0;
+            }
+        }
+
+    public:
+
+        // One worker per hardware thread besides the calling thread, which participates through wait()
+        static uint32_t default_worker_count()
+        {
+            const uint32_t hardware_threads = std::thread::hardware_concurrency();
+            return hardware_threads > 1 ? hardware_threads - 1 : 0;
+        }
+
+        job_system(const uint32_t num_workers = default_worker_count()) : main_thread(std::this_thread::get_id())
+        {
+            for (uint32_t i = 0; i <= num_workers; ++i) queues.emplace_back(new work_stealing_deque<job *>());
+            for (uint32_t i = 1; i <= num_workers; ++i) workers.emplace_back([this, i]() { worker_loop(int32_t(i)); });
+        }
+
+        // Outstanding jobs must have been waited on before destruction
+        ~job_system()
+        {
+            {
+                std::lock_guard<std::mutex> lock(sleep_mutex);
+                should_stop = true;
+            }
+            sleep_cv.notify_all();
+            for (std::thread & w : workers) if (w.joinable()) w.join();
+        }
+
+        uint32_t num_workers() const { return static_cast<uint32_t>(workers.size()); }
+
+        // Workers plus the main thread
+        uint32_t num_threads() const { return num_workers() + 1; }
+
+        // Whether the calling thread constructed the system and owns deque 0
+        bool on_main_thread() const { return std::this_thread::get_id() == main_thread; }
+
+        // Creates a job without scheduling it, so dependencies can be attached before submit(); every
+        // created job must eventually be submitted. A parent does not finish until this job has.
+        template <typename F>
+        job_handle create(F && f, const job_handle & parent = {})
+        {
+            return job_handle(make_job(std::forward<F>(f), parent.j));
+        }
+
+        // `after` will not start before `before` has finished. Must be called before `after` is submitted.
+        void add_dependency(const job_handle & before, const job_handle & after)
+        {
+            if (!before.j || !after.j) throw std::invalid_argument("add_dependency on an empty job_handle");
+
+            before.j->acquire_lock();
+            if (!before.j->done)
+            {
+                after.j->unmet.fetch_add(1, std::memory_order_relaxed);
+                before.j->continuations.push_back(after.j);
+            }
+            before.j->release_lock();
+        }
+
+        // Schedules the job once all of its dependencies have finished. Each job is submitted once.
+        void submit(const job_handle & h)
+        {
+            if (!h.j) throw std::invalid_argument("submit on an empty job_handle");
+            if (h.j->unmet.fetch_sub(1, std::memory_order_acq_rel) == 1) schedule(h.j);
+        }
+
+        template <typename F>
+        job_handle run(F && f, const job_handle & parent = {})
+        {
+            job_handle h = create(std::forward<F>(f), parent);
+            submit(h);
+            return h;
+        }
+
+        // Runs f once `before` has finished
+        template <typename F>
+        job_handle then(const job_handle & before, F && f)
+        {
+            job_handle h = create(std::forward<F>(f));
+            add_dependency(before, h);
+            submit(h);
+            return h;
+        }
+
+        // Runs other jobs on the calling thread until h (and all of its children) have finished
+        void wait(const job_handle & h)
+        {
+            if (!h.j) return;
+
+            const int32_t q = local_queue();
+            while (h.j->unfinished.load(std::memory_order_acquire) > 0)
+            {
+                job * j = nullptr;
+                if (find_job(q, j)) run(j);
+                else std::this_thread::yield();
+            }
+        }
+
+        // Invokes f(begin, end) over [0, count) in ranges of at most `grain` items and returns when all
+        // have run. Ranges are split in halves, the upper half spawned as a stealable job and the lower
+        // half kept, so thieves take large pieces and the owner stays on contiguous memory.
+        template <typename F>
+        void parallel_for(const size_t count, const size_t grain, F && f)
+        {
+            if (count == 0) return;
+
+            const size_t chunk = std::max<size_t>(1, grain);
+            if (count <= chunk || workers.empty())
+            {
+                f(size_t(0), count);
+                return;
+            }
+
+            job_handle root = create([]() {});
+            job * const parent = root.j;
+
+            const auto split = [this, &f, chunk, parent](const auto & self, size_t begin, size_t end) -> void
+            {
+                while (end - begin > chunk)
+                {
+                    const size_t mid = begin + (end - begin) / 2;
+                    job * upper = make_job([&self, mid, end]() { self(self, mid, end); }, parent);
+                    upper->unmet.store(0, std::memory_order_relaxed);
+                    schedule(upper);
+                    end = mid;
+                }
+                f(begin, end);
+            };
+
+            split(split, 0, count);
+            submit(root);
+            wait(root);
+        }
+    };
+
+    // Shared system for engine subsystems. The first thread to call this becomes its main thread, so
+    // applications call it on their main thread at startup, before any other thread can get there first
+    // (polymer_app does so on construction).
+    inline job_system & default_job_system()
+    {
+        static job_system system;
+        return system;
+    }
+
+    template <typename F>
+    inline void parallel_for(const size_t count, const size_t grain, F && f)
+    {
+        default_job_system().parallel_for(count, grain, std::forward<F>(f));
+    }
+
+} // end namespace polymer
+
+#endif // end polymer_job_system_hpp
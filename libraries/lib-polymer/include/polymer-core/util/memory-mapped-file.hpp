@@ -0,0 +1,53 @@
+#pragma once
+
+#ifndef polymer_memory_mapped_file_hpp
+#define polymer_memory_mapped_file_hpp
+
+#include <stdint.h>
+#include <cstddef>
+#include <string>
+#include <utility>
+
+namespace polymer
+{
+    // Read-only view of a whole file mapped into the address space. Pages are faulted in by the OS
+    // on first touch, so opening is O(1) regardless of file size and untouched regions are never
+    // read. Throws std::runtime_error if the file cannot be opened or mapped. Empty files map to
+    // a null data() with size() == 0.
+    class memory_mapped_file
+    {
+        const uint8_t * ptr { nullptr };
+        size_t length { 0 };
+
+    #if defined(_WIN32)
+        void * file_handle { nullptr };
+        void * mapping_handle { nullptr };
+    #else
+        int fd { -1 };
+    #endif
+
+        void close();
+
+    public:
+
+        memory_mapped_file() = default;
+        explicit memory_mapped_file(const std::string & path);
+        ~memory_mapped_file() { close(); }
+
+        memory_mapped_file(const memory_mapped_file &) = delete;
+        memory_mapped_file & operator= (const memory_mapped_file &) = delete;
+
+        memory_mapped_file(memory_mapped_file && other) noexcept { *this = std::move(other); }
+        memory_mapped_file & operator= (memory_mapped_file && other) noexcept;
+
+        // Hints that the whole mapping will be read front to back (madvise / PrefetchVirtualMemory)
+        void prefetch() const;
+
+        const uint8_t * data() const { return ptr; }
+        size_t size() const { return length; }
+        bool empty() const { return length == 0; }
+    };
+
+} // end namespace polymer
+
+#endif // end polymer_memory_mapped_file_hpp
@@ -0,0 +1,114 @@
+#include "polymer-core/util/memory-mapped-file.hpp"
+
+#include <stdexcept>
+
+#if defined(_WIN32)
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <Windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+using namespace polymer;
+
+#if defined(_WIN32)
+
+memory_mapped_file::memory_mapped_file(const std::string & path)
+{
+    HANDLE file = ::CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) throw std::runtime_error("could not open file for mapping: " + path);
+    file_handle = file;
+
+    LARGE_INTEGER file_size;
+    if (!::GetFileSizeEx(file, &file_size)) { close(); throw std::runtime_error("could not stat file for mapping: " + path); }
+    length = static_cast<size_t>(file_size.QuadPart);
+    if (length == 0) return;
+
+    mapping_handle = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping_handle) { close(); throw std::runtime_error("could not create file mapping: " + path); }
+
+    ptr = static_cast<const uint8_t *>(::MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+    if (!ptr) { close(); throw std::runtime_error("could not map view of file: " + path); }
+}
+
+void memory_mapped_file::close()
+{
+    if (ptr) ::UnmapViewOfFile(ptr);
+    if (mapping_handle) ::CloseHandle(mapping_handle);
+    if (file_handle) ::CloseHandle(file_handle);
+    ptr = nullptr;
+    length = 0;
+    mapping_handle = nullptr;
+    file_handle = nullptr;
+}
+
+memory_mapped_file & memory_mapped_file::operator= (memory_mapped_file && other) noexcept
+{
+    if (this == &other) return *this;
+    close();
+    std::swap(ptr, other.ptr);
+    std::swap(length, other.length);
+    std::swap(file_handle, other.file_handle);
+    std::swap(mapping_handle, other.mapping_handle);
+    return *this;
+}
+
+void memory_mapped_file::prefetch() const
+{
+#if defined(_WIN32_WINNT) && (_WIN32_WINNT >= 0x0602)
+    if (!ptr) return;
+    WIN32_MEMORY_RANGE_ENTRY range = { const_cast<uint8_t *>(ptr), length };
+    ::PrefetchVirtualMemory(::GetCurrentProcess(), 1, &range, 0);
+#endif
+}
+
+#else
+
+memory_mapped_file::memory_mapped_file(const std::string & path)
+{
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("could not open file for mapping: " + path);
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) { close(); throw std::runtime_error("could not stat file for mapping: " + path); }
+    length = static_cast<size_t>(st.st_size);
+    if (length == 0) return;
+
+    void * mapping = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) { length = 0; close(); throw std::runtime_error("could not map file: " + path); }
+    ptr = static_cast<const uint8_t *>(mapping);
+}
+
+void memory_mapped_file::close()
+{
+    if (ptr) ::munmap(const_cast<uint8_t *>(ptr), length);
+    if (fd >= 0) ::close(fd);
+    ptr = nullptr;
+    length = 0;
+    fd = -1;
+}
+
+memory_mapped_file & memory_mapped_file::operator= (memory_mapped_file && other) noexcept
+{
+    if (this == &other) return *this;
+    close();
+    std::swap(ptr, other.ptr);
+    std::swap(length, other.length);
+    std::swap(fd, other.fd);
+    return *this;
+}
+
+void memory_mapped_file::prefetch() const
+{
+    if (ptr) ::madvise(const_cast<uint8_t *>(ptr), length, MADV_WILLNEED);
+}
+
+#endif
@@ -203,17 +203,21 @@ void sample_engine_performance::on_draw()
             render_component r;
             r.material          = t.get_component<material_component>();
             r.mesh              = t.get_component<mesh_component>();
-            r.world_matrix      = t.get_component<transform_component>()->get_world_transform().matrix();
+            r.world_matrix      = t.get_component<transform_component>()->get_world_matrix();
             r.render_sort_order = 0;
             return r;
         };
 
         // Render everything
-        for (auto & t : scene.get_graph().graph_objects)
-        { 
-            render_component r = assemble_render_component(t.second);
+        scene.get_graph().view<material_component, mesh_component, transform_component>([&](const entity & e, material_component & mat, mesh_component & mesh, transform_component & xform)
+        {
+            render_component r;
+            r.material          = &mat;
+            r.mesh              = &mesh;
+            r.world_matrix      = xform.get_world_matrix();
+            r.render_sort_order = 0;
             payload.render_components.emplace_back(r);
-        };
+        });
 
         for (size_t i = 0; i < visible_entity_list.size(); ++i)
         {
@@ -90,7 +90,7 @@ sample_engine_procedural_material::sample_engine_procedural_material() : polymer
     // Assemble render component from base_object
     auto assemble_render_component = [](base_object & obj) {
         render_component r;
-        if (auto * xform = obj.get_component<transform_component>()) r.world_matrix = xform->get_world_transform().matrix();
+        if (auto * xform = obj.get_component<transform_component>()) r.world_matrix = xform->get_world_matrix();
         if (auto * mesh = obj.get_component<mesh_component>()) r.mesh = mesh;
         if (auto * mat = obj.get_component<material_component>()) r.material = mat;
         return r;
@@ -65,7 +65,7 @@ sample_engine_procedural_scene::sample_engine_procedural_scene() : polymer_app(1
         render_component r;
         r.material = obj.get_component<material_component>();
         r.mesh = obj.get_component<mesh_component>();
-        r.world_matrix = obj.get_component<transform_component>()->get_world_transform().matrix();
+        r.world_matrix = obj.get_component<transform_component>()->get_world_matrix();
         r.render_sort_order = 0;
         return r;
     };
@@ -6,8 +6,21 @@
 #include "ecs/core-events.hpp"
 #include "system-transform.hpp"
 #include "system-identifier.hpp"
+#include "polymer-engine/animation.hpp"
+#include "asset/asset-handle.hpp"
+#include "asset/asset-catalog.hpp"
+#include "asset/asset-resolver.hpp"
+#include "scene.hpp"
+#include "renderer/render-queue.hpp"
+#include "renderer/render-culling.hpp"
+#include "renderer/light-clusters.hpp"
 #include "ui-actions.hpp"
 
+#include "polymer-app-base/glfw-app.hpp"
+
+#include <filesystem>
+#include <fstream>
+
 /// Quick reference for doctest macros
 /// REQUIRE, REQUIRE_FALSE, CHECK, WARN, CHECK_THROWS_AS(func(), std::exception)
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
@@ -199,85 +212,78 @@ namespace polymer
 
     TEST_CASE("transform system has_transform")
     {
-        entity_system_manager the_entity_system_manager;
-        transform_system * system = the_entity_system_manager.create_system<transform_system>(&the_entity_system_manager);
+        scene_graph graph;
 
-        entity root = the_entity_system_manager.create_entity();
-        REQUIRE_FALSE(system->has_transform(root));
+        base_object obj;
+        const entity root = obj.get_entity();
+        REQUIRE_FALSE(graph.get_components().contains<transform_component>(root));
 
-        system->create(root, transform(), float3(1));
-        REQUIRE(system->has_transform(root));
+        graph.add_object(std::move(obj));
+        REQUIRE(graph.get_components().contains<transform_component>(root));
     }
 
     TEST_CASE("transform system double add")
     {
-        entity_system_manager the_entity_system_manager;
-        transform_system * system = the_entity_system_manager.create_system<transform_system>(&the_entity_system_manager);
+        scene_graph graph;
+
+        base_object obj;
+        base_object copy = obj;
 
-        entity root = the_entity_system_manager.create_entity();
-        REQUIRE(system->create(root, transform(), float3(1)));
-        REQUIRE_FALSE(system->create(root, transform(), float3(1)));
+        graph.add_object(std::move(obj));
+        graph.add_object(std::move(copy));
+        REQUIRE(graph.get_components().pool<transform_component>().size() == 1);
     }
 
     TEST_CASE("transform system destruction")
     {
-        entity_system_manager the_entity_system_manager;
-        transform_system * system = the_entity_system_manager.create_system<transform_system>(&the_entity_system_manager);
+        scene_graph graph;
 
         std::vector<entity> entities;
         for (int i = 0; i < 32; ++i)
         {
-            entity e = the_entity_system_manager.create_entity();
-            system->create(e, transform(), float3(1));
-            entities.push_back(e);
-            REQUIRE(system->has_transform(e));
+            base_object obj;
+            entities.push_back(obj.get_entity());
+            graph.add_object(std::move(obj));
+            REQUIRE(graph.get_components().contains<transform_component>(entities.back()));
         }
 
         for (auto & e : entities)
         {
-            system->destroy(e);
-            REQUIRE_FALSE(system->has_transform(e));
+            graph.destroy(e);
+            REQUIRE_FALSE(graph.get_components().contains<transform_component>(e));
         }
 
-        CHECK_THROWS_AS(system->destroy(0), std::exception);
+        CHECK_THROWS_AS(graph.destroy(kInvalidEntity), std::exception);
     }
 
     TEST_CASE("transform system add/remove parent & children")
     {
-        transform p1(make_rotation_quat_axis_angle({ 0, 1, 0 }, (float) POLYMER_PI / 2.0f), float3(0, 5.f, 0));
-        transform p2(make_rotation_quat_axis_angle({ 1, 1, 0 }, (float) POLYMER_PI / 0.5f), float3(3.f, 0, 0));
-        transform p3(make_rotation_quat_axis_angle({ 0, 1, -1 }, (float) POLYMER_PI), float3(0, 1.f, 4.f));
-
-        entity_system_manager the_entity_system_manager;
-        transform_system * system = the_entity_system_manager.create_system<transform_system>(&the_entity_system_manager);
-
-        entity root = the_entity_system_manager.create_entity();
-        entity child1 = the_entity_system_manager.create_entity();
-        entity child2 = the_entity_system_manager.create_entity();
+        scene_graph graph;
 
-        system->create(root, transform(), float3(1));
-        system->create(child1, transform(), float3(1));
-        system->create(child2, transform(), float3(1));
+        base_object a, b, c;
+        const entity root = a.get_entity();
+        const entity child1 = b.get_entity();
+        const entity child2 = c.get_entity();
 
-        REQUIRE(system->has_transform(root));
-        REQUIRE(system->has_transform(child1));
-        REQUIRE(system->has_transform(child2));
+        graph.add_object(std::move(a));
+        graph.add_object(std::move(b));
+        graph.add_object(std::move(c));
 
-        REQUIRE(system->get_parent(root) == kInvalidEntity);
-        REQUIRE(system->get_parent(child1) == kInvalidEntity);
-        REQUIRE(system->get_parent(child2) == kInvalidEntity);
+        REQUIRE(graph.get_parent(root) == kInvalidEntity);
+        REQUIRE(graph.get_parent(child1) == kInvalidEntity);
+        REQUIRE(graph.get_parent(child2) == kInvalidEntity);
 
-        CHECK_THROWS_AS(system->add_child(0, 0), std::exception); // invalid parent
-        CHECK_THROWS_AS(system->add_child(root, 0), std::exception); // invalid child
+        CHECK_THROWS_AS(graph.add_child(kInvalidEntity, child1), std::exception); // invalid parent
+        CHECK_THROWS_AS(graph.add_child(root, kInvalidEntity), std::exception); // invalid child
 
-        system->add_child(root, child1);
-        system->add_child(root, child2);
+        graph.add_child(root, child1);
+        graph.add_child(root, child2);
 
-        REQUIRE(system->get_parent(child1) == root);
-        REQUIRE(system->get_parent(child2) == root);
+        REQUIRE(graph.get_parent(child1) == root);
+        REQUIRE(graph.get_parent(child2) == root);
 
-        system->remove_child_from_parent(child1);
-        REQUIRE(system->get_parent(child1) == kInvalidEntity);
+        graph.remove_child_from_parent(child1);
+        REQUIRE(graph.get_parent(child1) == kInvalidEntity);
     }
 
     TEST_CASE("transform system scene graph math correctness")
@@ -286,31 +292,47 @@ namespace polymer
         const transform p2(make_rotation_quat_axis_angle({ 1, 1, 0 }, (float) POLYMER_PI / 0.5f), float3(3.f, 0, 0));
         const transform p3(make_rotation_quat_axis_angle({ 0, 1, -1 }, (float) POLYMER_PI), float3(0, 1.f, 4.f));
 
-        entity_system_manager the_entity_system_manager;
-        transform_system * system = the_entity_system_manager.create_system<transform_system>(&the_entity_system_manager);
+        scene_graph graph;
+
+        base_object a, b, c;
+        a.add_component(transform_component(p1, float3(1)));
+        b.add_component(transform_component(p2, float3(1)));
+        c.add_component(transform_component(p3, float3(1)));
+        const entity root = a.get_entity();
+        const entity child1 = b.get_entity();
+        const entity grandchild = c.get_entity();
+
+        graph.add_object(std::move(a));
+        graph.add_object(std::move(b));
+        graph.add_object(std::move(c));
+
+        auto xform = [&](const entity e) { return graph.get_object(e).get_component<transform_component>(); };
 
-        entity root = the_entity_system_manager.create_entity();
-        entity child1 = the_entity_system_manager.create_entity();
-        entity child2 = the_entity_system_manager.create_entity();
+        REQUIRE(xform(root)->local_pose == p1);
+        REQUIRE(xform(child1)->local_pose == p2);
+        REQUIRE(xform(grandchild)->local_pose == p3);
 
-        system->create(root, p1, float3(1));
-        system->create(child1, p2, float3(1));
-        system->create(child2, p3, float3(1));
+        graph.add_child(root, child1);
+        graph.add_child(child1, grandchild);
 
-        REQUIRE(system->get_local_transform(root)->local_pose == p1);
-        REQUIRE(system->get_local_transform(child1)->local_pose == p2);
-        REQUIRE(system->get_local_transform(child2)->local_pose == p3);
+        // Children compose with the world pose of their parent, not its local pose
+        REQUIRE(xform(root)->get_world_transform() == p1); // root (already in worldspace)
+        REQUIRE(xform(child1)->get_world_transform() == p1 * p2);
+        REQUIRE(xform(grandchild)->get_world_transform() == (p1 * p2) * p3);
 
-        system->add_child(root, child1);
-        system->add_child(root, child2);
+        // The flattened refresh agrees with the immediate update
+        graph.refresh();
+        REQUIRE(xform(grandchild)->get_world_transform() == (p1 * p2) * p3);
 
-        const transform check_p1 = p1;
-        const transform check_p2 = p1 * p2;
-        const transform check_p3 = p1 * p3;
+        // Scale is inherited and spreads out child offsets in the parent's frame
+        graph.set_local_transform(root, transform(float3(1, 0, 0)), float3(2));
+        graph.set_local_transform(child1, transform(float3(0, 3, 0)), float3(1, 1, 0.5f));
+        graph.set_local_transform(grandchild, transform(float3(0, 0, 4)), float3(1));
+        graph.update_world_transforms();
 
-        REQUIRE(system->get_world_transform(root)->world_pose == check_p1); // root (already in worldspace)
-        REQUIRE(system->get_world_transform(child1)->world_pose == check_p2);
-        REQUIRE(system->get_world_transform(child2)->world_pose == check_p3);
+        REQUIRE(xform(child1)->get_world_transform().position == float3(1, 6, 0));
+        REQUIRE(xform(grandchild)->get_world_transform().position == float3(1, 6, 4));
+        REQUIRE(xform(grandchild)->get_world_scale() == float3(2, 2, 1));
     }
 
     TEST_CASE("transform system insert child via index")
@@ -325,13 +347,34 @@ namespace polymer
 
     TEST_CASE("transform system set local transform")
     {
-        // todo - test set_local_transform
+        transform_system system;
+
+        // Two roots, each with a chain of two children
+        for (uint32_t r = 0; r < 2; ++r)
+        {
+            const uint32_t root = system.add(transform_system::kInvalidIndex, transform(float3(10.f * r, 0, 0)), float3(1));
+            const uint32_t child = system.add(root, transform(float3(0, 1, 0)), float3(1));
+            system.add(child, transform(float3(0, 0, 1)), float3(1));
+        }
+
+        CHECK_THROWS_AS(system.add(0, transform(), float3(1)), std::exception); // not pre-order
+
+        REQUIRE(system.update() == 6);
+        REQUIRE(system.update() == 0);
+        REQUIRE(system.world_poses[5].position == float3(10, 1, 1));
+
+        // Only the dirty node and its descendants are recomputed
+        system.set_local_transform(1, transform(float3(0, 2, 0)), float3(1));
+        std::vector<uint32_t> updated;
+        REQUIRE(system.update(nullptr, [&](uint32_t i) { updated.push_back(i); }) == 2);
+        REQUIRE(updated == std::vector<uint32_t>({ 1, 2 }));
+        REQUIRE(system.world_poses[2].position == float3(0, 2, 1));
+        REQUIRE(system.world_poses[5].position == float3(10, 1, 1));
     }
 
     TEST_CASE("transform system performance testing")
     {
-        entity_system_manager the_entity_system_manager;
-        transform_system * system = the_entity_system_manager.create_system<transform_system>(&the_entity_system_manager);
+        scene_graph graph;
         uniform_random_gen gen;
 
         double timer = 0.f;
@@ -350,36 +393,426 @@ namespace polymer
             scoped_timer t("create 16384 entities with 4 children each (65535 total)");
             for (int i = 0; i < 16384; ++i)
             {
-                auto rootEntity = the_entity_system_manager.create_entity();
-                system->create(rootEntity, random_pose(), float3(1));
+                base_object root;
+                root.add_component(transform_component(random_pose(), float3(1)));
+                const entity root_entity = root.get_entity();
+                graph.add_object(std::move(root));
 
                 for (int c = 0; c < 4; ++c)
                 {
-                    auto childEntity = the_entity_system_manager.create_entity();
-                    system->create(childEntity, random_pose(), float3(1));
-                    system->add_child(rootEntity, childEntity);
+                    base_object child;
+                    child.add_component(transform_component(random_pose(), float3(1)));
+                    const entity child_entity = child.get_entity();
+                    graph.add_object(std::move(child));
+                    graph.add_child(root_entity, child_entity);
                 }
             }
 
             std::cout << "Random pose generation took: " << timer << "ms" << std::endl;
         }
+
+        {
+            scoped_timer t("refresh 65535 entities (flatten + propagate)");
+            graph.refresh();
+        }
+
+        {
+            scoped_timer t("refresh 65535 entities");
+            graph.refresh();
+        }
     }
 
     TEST_CASE("transform system performance testing 2")
     {
-        entity_system_manager the_entity_system_manager;
-        transform_system * system = the_entity_system_manager.create_system<transform_system>(&the_entity_system_manager);
+        scene_graph graph;
 
         for (int i = 0; i < 65536; ++i)
         {
-            auto rootEntity = the_entity_system_manager.create_entity();
-            system->create(rootEntity, transform(), float3(1));
+            graph.add_object(base_object());
         }
 
+        graph.update_world_transforms();
+
         {
             scoped_timer t("iterate and add");
-            system->world_transforms.for_each([&](world_transform_component & t) { t.world_pose.position += float3(0.001f); });
+            graph.view<transform_component>([&](const entity & e, transform_component & t) { t.local_pose.position += float3(0.001f); });
+            graph.refresh();
+        }
+    }
+
+    TEST_CASE("transform system 1M node hierarchy performance testing")
+    {
+        // 4096 root subtrees of 256 nodes each: a root with 15 children, each of which has a chain of 16 descendants
+        const uint32_t num_roots = 4096;
+        const uint32_t num_nodes = num_roots * 256;
+
+        uniform_random_gen gen;
+        transform_system serial;
+        serial.reserve(num_nodes);
+
+        for (uint32_t r = 0; r < num_roots; ++r)
+        {
+            const float3 root_position(gen.random_float() * 100, gen.random_float() * 100, gen.random_float() * 100);
+            const uint32_t root = serial.add(transform_system::kInvalidIndex, transform(root_position), float3(1));
+
+            for (uint32_t c = 0; c < 15; ++c)
+            {
+                uint32_t parent = root;
+                for (uint32_t d = 0; d < 17; ++d)
+                {
+                    const transform local(make_rotation_quat_axis_angle({ 0, 1, 0 }, gen.random_float()), float3(0, 0.5f, 0));
+                    parent = serial.add(parent, local, float3(0.99f));
+                }
+            }
+        }
+
+        REQUIRE(serial.size() == num_nodes);
+        transform_system parallel = serial;
+
+        job_system jobs;
+
+        {
+            scoped_timer t("propagate 1M nodes (serial)");
+            REQUIRE(serial.update() == num_nodes);
+        }
+
+        {
+            scoped_timer t("propagate 1M nodes (parallel root subtrees)");
+            REQUIRE(parallel.update(&jobs) == num_nodes);
+        }
+
+        for (uint32_t i = 0; i < num_nodes; i += 997)
+        {
+            REQUIRE(serial.world_poses[i] == parallel.world_poses[i]);
+            REQUIRE(serial.world_scales[i] == parallel.world_scales[i]);
+        }
+
+        // Touch one node in every 64th subtree; only the touched chains are recomputed
+        uint32_t expected = 0;
+        for (uint32_t r = 0; r < num_roots; r += 64)
+        {
+            const uint32_t chain_head = r * 256 + 1;
+            serial.set_local_transform(chain_head, transform(float3(0, 1, 0)), float3(1));
+            expected += 17;
+        }
+
+        {
+            scoped_timer t("propagate 1M nodes (64 dirty subtrees)");
+            REQUIRE(serial.update(&jobs) == expected);
+        }
+    }
+
+    ///////////////////////////////////
+    //   Animation Sampling Tests    //
+    ///////////////////////////////////
+
+    // A chain of bones, each offset along +y and rotated about z relative to its parent
+    inline std::vector<bone> make_test_skeleton(const uint32_t count)
+    {
+        std::vector<bone> bones(count);
+        float4x4 world = linalg::identity;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            world = world * make_rigid_transformation_matrix(make_rotation_quat_axis_angle({ 0, 0, 1 }, 0.1f), float3(0, 1, 0));
+            bones[i].name = "bone_" + std::to_string(i);
+            bones[i].parentIndex = i ? i - 1 : 0xFFFFFFFF;
+            bones[i].initialPose = world;
+            bones[i].bindPose = inverse(world);
+        }
+        return bones;
+    }
+
+    // Every bone rotates about x and most of them translate, with keys at uneven frames
+    inline skeletal_animation make_test_animation(const uint32_t bone_count, const uint32_t frame_count, uniform_random_gen & gen)
+    {
+        skeletal_animation anim;
+        anim.name = "test";
+        for (uint32_t b = 0; b < bone_count; ++b)
+        {
+            auto track = std::make_shared<animation_track>();
+            track->boneIndex = b;
+            uint32_t frame = 0;
+            for (uint32_t k = 0; k < frame_count; ++k)
+            {
+                auto kf = std::make_shared<animation_keyframe>();
+                kf->key = frame;
+                const quatf q = make_rotation_quat_axis_angle({ 1, 0, 0 }, gen.random_float() * 3.f);
+                kf->rotation = float4(q.x, q.y, q.z, q.w);
+                if (b % 3) kf->translation = float3(gen.random_float(), 1.f, gen.random_float());
+                track->keyframes.push_back(kf);
+                anim.startFrame = std::min(anim.startFrame, frame);
+                anim.endFrame = std::max(anim.endFrame, frame);
+                frame += 1 + (k % 3);
+            }
+            track->keyframeCount = frame_count;
+            anim.tracks.push_back(track);
+        }
+        anim.trackCount = bone_count;
+        return anim;
+    }
+
+    // Reference evaluation straight from the keyframes: linear key search, lerp/nlerp, matrix products per bone
+    inline std::vector<float4x4> reference_palette(const skeletal_animation & anim, const std::vector<bone> & bones, const skeleton_rig & rig, const float time)
+    {
+        std::vector<float4x4> model(bones.size()), palette(bones.size());
+        for (uint32_t b = 0; b < bones.size(); ++b)
+        {
+            const auto & keys = anim.tracks[b]->keyframes;
+            const float frame = time * 24.f;
+            size_t k = 0;
+            while (k + 1 < keys.size() && keys[k + 1]->key <= frame) ++k;
+            const size_t k1 = std::min(k + 1, keys.size() - 1);
+            const float alpha = (k1 == k) ? 0.f : (frame - keys[k]->key) / float(keys[k1]->key - keys[k]->key);
+
+            float4 q0 = keys[k]->rotation, q1 = keys[k1]->rotation;
+            if (dot(q0, q1) < 0) q1 = -q1;
+            const float4 q = normalize(q0 + (q1 - q0) * alpha);
+            const float3 t = (b % 3) ? keys[k]->translation + (keys[k1]->translation - keys[k]->translation) * alpha : rig.rest_translations[b];
+
+            const float4x4 local = make_translation_matrix(t) * make_rotation_matrix(quatf(q.x, q.y, q.z, q.w));
+            model[b] = (b == 0) ? local : model[b - 1] * local;
+            palette[b] = model[b] * bones[b].bindPose;
+        }
+        return palette;
+    }
+
+    TEST_CASE("animation clip sampling and skinning palette")
+    {
+        uniform_random_gen gen;
+        const uint32_t bone_count = 23;
+        const std::vector<bone> bones = make_test_skeleton(bone_count);
+        const skeleton_rig rig = make_skeleton_rig(bones);
+        const skeletal_animation anim = make_test_animation(bone_count, 40, gen);
+
+        REQUIRE(rig.size() == bone_count);
+        REQUIRE(rig.evaluation_order.front() == 0);
+        REQUIRE(std::abs(rig.rest_translations[5].y - 1.f) < 1e-5f);
+
+        // The rest pose reproduces the bind pose, so the palette is identity
+        {
+            skeleton_pose rest;
+            rest.translations = rig.rest_translations;
+            rest.rotations = rig.rest_rotations;
+            rest.scales = rig.rest_scales;
+            std::vector<float4x4> model(bone_count), palette(bone_count);
+            compute_skinning_palette(rig, rest, model.data(), palette.data());
+            for (uint32_t b = 0; b < bone_count; ++b)
+            {
+                for (int c = 0; c < 4; ++c) REQUIRE(maxelem(abs(palette[b][c] - float4x4(linalg::identity)[c])) < 1e-4f);
+            }
+        }
+
+        const animation_clip clip = make_animation_clip(anim, rig);
+        REQUIRE(clip.bone_count == bone_count);
+        REQUIRE(clip.duration == doctest::Approx(anim.total_time()));
+        REQUIRE(clip.translation_keys.count(0) == 1); // bone 0 never translates: one rest key
+        REQUIRE(clip.rotation_keys.count(0) == 40);
+        REQUIRE(clip.scale_keys.count(7) == 1);
+
+        animation_clip_options quantize;
+        quantize.quantize_rotations = true;
+        const animation_clip quantized = make_animation_clip(anim, rig, quantize);
+        REQUIRE(quantized.quantized());
+        REQUIRE(quantized.memory_bytes() < clip.memory_bytes());
+
+        // Forward playback, then jumps backwards, which reset the cursors
+        std::vector<float> times;
+        for (float t = 0.f; t <= clip.duration; t += 0.013f) times.push_back(t);
+        for (int i = 0; i < 50; ++i) times.push_back(gen.random_float() * clip.duration);
+
+        animation_sampler sampler(clip), quantized_sampler(quantized);
+        skeleton_pose pose, quantized_pose;
+        std::vector<float4x4> model(bone_count), palette(bone_count), quantized_palette(bone_count);
+        for (const float t : times)
+        {
+            sampler.sample(t, pose);
+            quantized_sampler.sample(t, quantized_pose);
+            compute_skinning_palette(rig, pose, model.data(), palette.data());
+            compute_skinning_palette(rig, quantized_pose, model.data(), quantized_palette.data());
+
+            const std::vector<float4x4> expected = reference_palette(anim, bones, rig, t);
+            for (uint32_t b = 0; b < bone_count; ++b)
+            {
+                for (int c = 0; c < 4; ++c)
+                {
+                    REQUIRE(maxelem(abs(palette[b][c] - expected[b][c])) < 1e-3f);
+                    REQUIRE(maxelem(abs(quantized_palette[b][c] - expected[b][c])) < 1e-2f);
+                }
+            }
+        }
+    }
+
+    TEST_CASE("animation clip key reduction and instance updates")
+    {
+        uniform_random_gen gen;
+        const std::vector<bone> bones = make_test_skeleton(4);
+        const skeleton_rig rig = make_skeleton_rig(bones);
+
+        // Linear motion is reproduced exactly by its end points
+        skeletal_animation linear;
+        auto track = std::make_shared<animation_track>();
+        track->boneIndex = 2;
+        for (uint32_t k = 0; k <= 24; ++k)
+        {
+            auto kf = std::make_shared<animation_keyframe>();
+            kf->key = k;
+            kf->translation = float3(k * 0.5f, 1.f, 0.f);
+            track->keyframes.push_back(kf);
+        }
+        linear.tracks.push_back(track);
+        linear.startFrame = 0;
+        linear.endFrame = 24;
+
+        animation_clip_options options;
+        options.tolerance = 1e-5f;
+        const animation_clip clip = make_animation_clip(linear, rig, options);
+        REQUIRE(clip.translation_keys.count(2) == 2);
+        REQUIRE(clip.rotation_keys.count(2) == 1);
+
+        std::vector<animation_instance> instances(64);
+        for (size_t i = 0; i < instances.size(); ++i)
+        {
+            instances[i].rig = &rig;
+            instances[i].sampler.bind(clip);
+            instances[i].time = i * 0.01f;
+        }
+
+        job_system jobs;
+        update_animation_instances(instances.data(), instances.size(), 0.25f, jobs);
+        for (size_t i = 0; i < instances.size(); ++i)
+        {
+            const float time = std::fmod(i * 0.01f + 0.25f, clip.duration);
+            REQUIRE(instances[i].time == doctest::Approx(time));
+            REQUIRE(instances[i].palette.size() == 4);
+            REQUIRE(instances[i].pose.translations[2].x == doctest::Approx(time * 12.f));
+        }
+    }
+
+    TEST_CASE("animation sampling and skinning performance testing")
+    {
+        uniform_random_gen gen;
+        const uint32_t bone_count = 64;
+        const std::vector<bone> bones = make_test_skeleton(bone_count);
+        const skeleton_rig rig = make_skeleton_rig(bones);
+        const skeletal_animation anim = make_test_animation(bone_count, 120, gen);
+
+        animation_clip_options options;
+        options.quantize_rotations = true;
+        const animation_clip clip = make_animation_clip(anim, rig, options);
+
+        std::vector<animation_instance> instances(500);
+        for (size_t i = 0; i < instances.size(); ++i)
+        {
+            instances[i].rig = &rig;
+            instances[i].sampler.bind(clip);
+            instances[i].time = gen.random_float() * clip.duration;
+        }
+
+        job_system jobs;
+        {
+            scoped_timer t("sample + skin 500 characters x 64 bones, 60 frames");
+            for (int frame = 0; frame < 60; ++frame) update_animation_instances(instances.data(), instances.size(), 1.f / 60.f, jobs);
+        }
+    }
+
+    /////////////////////////////////
+    //   Entity Lookup Benchmarks   //
+    /////////////////////////////////
+
+    // The previous std::hash<guid>, which formatted the guid to a string on every call
+    struct guid_string_hash
+    {
+        size_t operator()(const entity & e) const { return std::hash<std::string>()(e.as_string()); }
+    };
+
+    TEST_CASE("scene_graph entity handles")
+    {
+        scene_graph graph;
+
+        base_object a("a");
+        base_object b("b");
+        const entity ea = a.get_entity();
+        const entity eb = b.get_entity();
+
+        graph.add_object(std::move(a));
+        graph.add_object(std::move(b));
+
+        const entity_handle ha = graph.get_handle(ea);
+        const entity_handle hb = graph.get_handle(eb);
+        REQUIRE(ha != kInvalidEntityHandle);
+        REQUIRE(ha != hb);
+        REQUIRE(graph.get_object_from_handle(ha) == &graph.get_object(ea));
+        REQUIRE(graph.get_object_from_handle(hb)->get_entity() == eb);
+
+        // A destroyed object's handle goes stale, even after its slot is reused
+        graph.destroy(ea);
+        REQUIRE(graph.get_object_from_handle(ha) == nullptr);
+
+        base_object c("c");
+        const entity ec = c.get_entity();
+        graph.add_object(std::move(c));
+        REQUIRE(entity_handle_index(graph.get_handle(ec)) == entity_handle_index(ha));
+        REQUIRE(graph.get_object_from_handle(ha) == nullptr);
+        REQUIRE(graph.get_object_from_handle(graph.get_handle(ec))->get_entity() == ec);
+    }
+
+    TEST_CASE("entity lookup performance testing")
+    {
+        const uint32_t num_entities = 65536;
+        const uint32_t num_lookups = 1 << 20;
+
+        uniform_random_gen gen;
+        std::vector<entity> entities(num_entities);
+        for (auto & e : entities) e = make_guid();
+
+        std::vector<uint32_t> lookup_order(num_lookups);
+        for (auto & idx : lookup_order) idx = gen.random_uint(num_entities - 1);
+
+        std::unordered_map<entity, uint32_t, guid_string_hash> string_hashed;
+        std::unordered_map<entity, uint32_t> byte_hashed;
+        scene_graph graph;
+
+        for (uint32_t i = 0; i < num_entities; ++i)
+        {
+            string_hashed[entities[i]] = i;
+            byte_hashed[entities[i]] = i;
+            graph.add_object(base_object(entities[i]));
         }
+
+        std::vector<entity_handle> handles(num_entities);
+        for (uint32_t i = 0; i < num_entities; ++i) handles[i] = graph.get_handle(entities[i]);
+
+        manual_timer t;
+        uint64_t sum_string{ 0 }, sum_bytes{ 0 }, sum_graph{ 0 }, sum_handle{ 0 };
+
+        t.start();
+        for (const uint32_t idx : lookup_order) sum_string += string_hashed.find(entities[idx])->second;
+        t.stop();
+        const double string_ms = t.get();
+
+        t.start();
+        for (const uint32_t idx : lookup_order) sum_bytes += byte_hashed.find(entities[idx])->second;
+        t.stop();
+        const double bytes_ms = t.get();
+
+        t.start();
+        for (const uint32_t idx : lookup_order) sum_graph += graph.get_object(entities[idx]).get_entity().bytes()[0];
+        t.stop();
+        const double graph_ms = t.get();
+
+        t.start();
+        for (const uint32_t idx : lookup_order) sum_handle += graph.get_object_from_handle(handles[idx])->get_entity().bytes()[0];
+        t.stop();
+        const double handle_ms = t.get();
+
+        REQUIRE(sum_string == sum_bytes);
+        REQUIRE(sum_graph == sum_handle);
+
+        const double to_ns = 1000000.0 / num_lookups;
+        std::cout << "unordered_map<entity> (string hash):  " << string_ms * to_ns << " ns/lookup" << std::endl;
+        std::cout << "unordered_map<entity> (byte hash):    " << bytes_ms * to_ns << " ns/lookup" << std::endl;
+        std::cout << "scene_graph::get_object(entity):      " << graph_ms * to_ns << " ns/lookup" << std::endl;
+        std::cout << "scene_graph::get_object_from_handle:  " << handle_ms * to_ns << " ns/lookup" << std::endl;
     }
 
     //////////////////////////////
@@ -474,6 +907,48 @@ namespace polymer
         REQUIRE(static_cast<int>(scene_graph_pool.size()) == (128 - 101 + 44));
     }
 
+    TEST_CASE("scene_graph component store view")
+    {
+        scene_graph graph;
+        std::vector<entity> entities;
+
+        for (int i = 0; i < 3000; ++i)
+        {
+            base_object obj("object-" + std::to_string(i));
+            obj.add_component(transform_component(transform(float3(static_cast<float>(i), 0, 0)), float3(1)));
+            if (i % 2 == 0) obj.add_component(mesh_component());
+            if (i % 3 == 0) obj.add_component(material_component());
+            entities.push_back(obj.get_entity());
+            graph.add_object(std::move(obj));
+        }
+
+        auto count_renderable = [&]()
+        {
+            int count = 0;
+            graph.view<material_component, mesh_component, transform_component>([&](const entity & e, material_component &, mesh_component &, transform_component & t)
+            {
+                REQUIRE(graph.get_object(e).get_component<transform_component>() == &t);
+                ++count;
+            });
+            return count;
+        };
+
+        REQUIRE(count_renderable() == 500);
+
+        // Destruction swap-and-pops out of every pool the entity was in
+        int expected = 500;
+        for (int i = 0; i < 3000; i += 7)
+        {
+            if (i % 6 == 0) --expected;
+            graph.destroy(entities[i]);
+        }
+
+        REQUIRE(count_renderable() == expected);
+        REQUIRE(graph.get_object(entities[1]).get_component<mesh_component>() == nullptr);
+        REQUIRE(graph.get_object(entities[2]).get_component<mesh_component>() != nullptr);
+        REQUIRE(graph.get_object(entities[2]).get_component<transform_component>()->local_pose.position.x == 2.f);
+    }
+
     /////////////////////////////////
     //   Identifier System Tests   //
     /////////////////////////////////
@@ -661,5 +1136,485 @@ namespace polymer
         REQUIRE(sky_turbidity == 15);
     }
 
+    ////////////////////////////
+    //   Asset Handle Tests   //
+    ////////////////////////////
+
+    TEST_CASE("asset_handle loading states")
+    {
+        asset_handle<std::vector<int>> handle("asset-state-test");
+        REQUIRE(handle.get_state() == asset_state::unresolved);
+
+        // A loading handle hands out an empty placeholder without being assigned
+        handle.mark_loading();
+        REQUIRE(handle.is_loading());
+        REQUIRE_FALSE(handle.assigned());
+        REQUIRE(handle.get().empty());
+
+        // Assigning through another handle with the same id makes both ready
+        asset_handle<std::vector<int>> loader("asset-state-test");
+        REQUIRE(loader.is_loading());
+        loader.assign({ 1, 2, 3 });
+        REQUIRE(handle.is_ready());
+        REQUIRE(handle.assigned());
+        REQUIRE(handle.get().size() == 3);
+
+        // A ready asset is not demoted
+        handle.mark_failed();
+        handle.mark_loading();
+        REQUIRE(handle.is_ready());
+
+        asset_handle<std::vector<int>> missing("asset-state-missing");
+        missing.mark_failed();
+        REQUIRE(missing.get_state() == asset_state::failed);
+        REQUIRE_FALSE(missing.assigned());
+
+        REQUIRE(asset_handle<std::vector<int>>::destroy("asset-state-test"));
+        REQUIRE(asset_handle<std::vector<int>>::destroy("asset-state-missing"));
+    }
+
+    TEST_CASE("asset_catalog lookups and incremental refresh")
+    {
+        namespace fs = std::filesystem;
+
+        const fs::path root = fs::temp_directory_path() / "polymer-asset-catalog-test";
+        const fs::path cache = fs::temp_directory_path() / "polymer-asset-catalog-test-cache";
+        fs::remove_all(root);
+        fs::remove_all(cache);
+        fs::create_directories(root / "textures" / "wood");
+        fs::create_directories(root / "models");
+        fs::create_directories(cache);
+
+        auto touch = [](const fs::path & p) { std::ofstream(p) << "x"; };
+        touch(root / "textures" / "wood" / "Oak_Albedo.png");
+        touch(root / "models" / "crate.obj");
+        touch(root / "models" / "crate.material");
+        touch(root / "readme");
+
+        {
+            asset_catalog catalog(cache.generic_string());
+            catalog.add_root(root.generic_string());
+
+            const asset_catalog_stats stats = catalog.get_stats(root.generic_string());
+            REQUIRE_FALSE(stats.loaded_from_cache);
+            REQUIRE(stats.directories == 4);
+            REQUIRE(stats.listed_directories == 4);
+            REQUIRE(stats.files == 4);
+            REQUIRE(catalog.size() == 4);
+
+            // Stems are matched lowercase; names keep the relative path
+            auto albedo = catalog.find("oak_albedo");
+            REQUIRE(albedo.size() == 1);
+            REQUIRE(albedo[0]->extension == "png");
+            REQUIRE(albedo[0]->name == "textures/wood/Oak_Albedo");
+            REQUIRE(albedo[0]->path == root.generic_string() + "/textures/wood/Oak_Albedo.png");
+
+            REQUIRE(catalog.find("crate").size() == 2);
+            REQUIRE(catalog.find_extension("material").size() == 1);
+            REQUIRE(catalog.find_extension("").size() == 1);
+            REQUIRE(catalog.find("missing").empty());
+        }
+
+        // A new catalog starts from the cache file and lists nothing that has not changed
+        {
+            asset_catalog catalog(cache.generic_string());
+            catalog.add_root(root.generic_string());
+
+            const asset_catalog_stats stats = catalog.get_stats(root.generic_string());
+            REQUIRE(stats.loaded_from_cache);
+            REQUIRE(stats.listed_directories == 0);
+            REQUIRE(catalog.size() == 4);
+
+            // Adding and removing files only lists their parent directories
+            touch(root / "models" / "barrel.obj");
+            fs::remove(root / "textures" / "wood" / "Oak_Albedo.png");
+            const auto later = fs::file_time_type::clock::now() + std::chrono::seconds(5);
+            fs::last_write_time(root / "models", later);
+            fs::last_write_time(root / "textures" / "wood", later);
+
+            catalog.refresh();
+            const asset_catalog_stats refreshed = catalog.get_stats(root.generic_string());
+            REQUIRE(refreshed.listed_directories == 2);
+            REQUIRE(catalog.find("barrel").size() == 1);
+            REQUIRE(catalog.find("oak_albedo").empty());
+            REQUIRE(catalog.size() == 4);
+        }
+
+        fs::remove_all(root);
+        fs::remove_all(cache);
+    }
+
+    TEST_CASE("asset_resolver uploads model meshes with bounds")
+    {
+        namespace fs = std::filesystem;
+
+        // Uploading needs a GL context, which a headless machine cannot create
+        std::unique_ptr<gl_context> context;
+        try { context.reset(new gl_context()); }
+        catch (const std::exception & e) { MESSAGE("skipped: " << e.what()); return; }
+
+        const fs::path root = fs::temp_directory_path() / "polymer-asset-resolver-test";
+        fs::remove_all(root);
+        fs::create_directories(root);
+        std::ofstream(root / "resolver-quad.obj") << "o quad\nv -1 0 -2\nv 3 0 -2\nv 3 0.5 4\nv -1 0.5 4\nf 1 2 3\nf 1 3 4\n";
+
+        {
+            scene the_scene;
+            material_library library;
+            the_scene.instantiate_mesh("quad", transform(), float3(1, 1, 1), "resolver-quad/quad");
+
+            asset_resolver_options options;
+            options.catalog_cache_directory = "";
+            asset_resolver resolver(&the_scene, &library, options);
+            resolver.add_search_path(root.generic_string());
+            resolver.resolve();
+
+            // The renderer culls with these bounds, so an uploaded mesh must carry them
+            gpu_mesh_handle handle("resolver-quad/quad");
+            REQUIRE(handle.is_ready());
+            const gl_mesh & mesh = handle.get();
+            REQUIRE(mesh.has_bounds());
+
+            // Bounds of the imported vertices, which are rescaled into the unit cube around the origin
+            const runtime_mesh & geometry = cpu_mesh_handle("resolver-quad/quad").get();
+            const aabb_3d expected = compute_bounds(geometry.vertices);
+            REQUIRE(mesh.get_bounds_min() == expected.min());
+            REQUIRE(mesh.get_bounds_max() == expected.max());
+        }
+
+        gpu_mesh_handle::destroy("resolver-quad/quad");
+        cpu_mesh_handle::destroy("resolver-quad/quad");
+        fs::remove_all(root);
+    }
+
+    //////////////////////////
+    //   render sort keys   //
+    //////////////////////////
+
+    TEST_CASE("render sort keys order layers, state and depth")
+    {
+        // Opaque: lower layer first, then program, material, mesh, then near to far
+        const uint64_t near_a = make_opaque_sort_key(0, 1, 2, 3, 0.1f);
+        const uint64_t far_a = make_opaque_sort_key(0, 1, 2, 3, 0.9f);
+        const uint64_t near_other_mesh = make_opaque_sort_key(0, 1, 2, 4, 0.0f);
+        const uint64_t other_material = make_opaque_sort_key(0, 1, 3, 0, 0.0f);
+        const uint64_t other_program = make_opaque_sort_key(0, 2, 0, 0, 0.0f);
+        const uint64_t next_layer = make_opaque_sort_key(1, 0, 0, 0, 0.0f);
+
+        REQUIRE(near_a < far_a);
+        REQUIRE(far_a < near_other_mesh);
+        REQUIRE(near_other_mesh < other_material);
+        REQUIRE(other_material < other_program);
+        REQUIRE(other_program < next_layer);
+
+        // Translucent: after every opaque key in any layer, then far to near before state
+        const uint64_t translucent_far = make_translucent_sort_key(0, 9, 9, 9, 0.9f);
+        const uint64_t translucent_near = make_translucent_sort_key(0, 0, 0, 0, 0.1f);
+        const uint64_t last_opaque = make_opaque_sort_key(255, 4095, 8191, 16383, 1.0f);
+
+        REQUIRE(sort_key_is_translucent(translucent_far));
+        REQUIRE_FALSE(sort_key_is_translucent(last_opaque));
+        REQUIRE(last_opaque < translucent_far);
+        REQUIRE(translucent_far < translucent_near);
+        REQUIRE(make_translucent_sort_key(0, 0, 0, 0, 0.5f) < make_translucent_sort_key(0, 1, 0, 0, 0.5f));
+        REQUIRE(translucent_near < make_translucent_sort_key(1, 0, 0, 0, 1.0f));
+
+        REQUIRE(sort_key_layer(next_layer) == 1);
+        REQUIRE(sort_key_layer(make_translucent_sort_key(7, 0, 0, 0, 0.5f)) == 7);
+
+        // Out of range fields saturate instead of spilling into their neighbours
+        REQUIRE(sort_key_layer(make_opaque_sort_key(1000, 0, 0, 0, 0.f)) == 255);
+        REQUIRE(make_opaque_sort_key(0, 5000, 0, 0, 0.f) < make_opaque_sort_key(1, 0, 0, 0, 0.f));
+        REQUIRE(make_opaque_sort_key(0, 0, 0, 0, -3.f) == make_opaque_sort_key(0, 0, 0, 0, 0.f));
+        REQUIRE(make_opaque_sort_key(0, 0, 0, 0, 7.f) == make_opaque_sort_key(0, 0, 0, 0, 1.f));
+
+        // Ids are dense, in order of first use
+        sort_key_ids ids;
+        int a, b;
+        REQUIRE(ids.get(&b) == 0);
+        REQUIRE(ids.get(&a) == 1);
+        REQUIRE(ids.get(&b) == 0);
+        REQUIRE(ids.get(uint64_t(42)) == 2);
+        REQUIRE(ids.size() == 3);
+        ids.clear();
+        REQUIRE(ids.get(&a) == 0);
+    }
+
+    TEST_CASE("make_draw_batches merges runs of identical draws")
+    {
+        // Draw index -> mesh; the order below groups them as a render queue sort would
+        const std::vector<uint32_t> mesh = { 7, 3, 7, 7, 3, 9 };
+        const std::vector<uint32_t> order = { 1, 4, 0, 2, 3, 5 };
+        const auto same_mesh = [&](const uint32_t a, const uint32_t b) { return mesh[a] == mesh[b]; };
+
+        std::vector<draw_batch> batches;
+        const uint64_t end = make_draw_batches(order.data(), order.size(), same_mesh, 208, 256, 0, batches);
+
+        REQUIRE(batches.size() == 3);
+        REQUIRE(batches[0].first == 0);
+        REQUIRE(batches[0].count == 2);
+        REQUIRE(batches[1].first == 2);
+        REQUIRE(batches[1].count == 3);
+        REQUIRE(batches[2].first == 5);
+        REQUIRE(batches[2].count == 1);
+
+        // Each block starts aligned, right after the previous one
+        REQUIRE(batches[0].offset == 0);
+        REQUIRE(batches[1].offset == 512);
+        REQUIRE(batches[2].offset == 1280);
+        REQUIRE(end == 1280 + 208);
+
+        // Appends, continuing from the given offset
+        make_draw_batches(order.data(), 1, same_mesh, 208, 256, end, batches);
+        REQUIRE(batches.size() == 4);
+        REQUIRE(batches[3].offset == 1536);
+
+        // Nothing merges when the predicate never holds
+        batches.clear();
+        make_draw_batches(order.data(), order.size(), [](uint32_t, uint32_t) { return false; }, 208, 16, 0, batches);
+        REQUIRE(batches.size() == order.size());
+        REQUIRE(batches[1].offset == 208);
+    }
+
+    TEST_CASE("render_culler matches a brute force frustum test")
+    {
+        uniform_random_gen gen;
+
+        const auto random_box = [&]()
+        {
+            const float3 center = float3(gen.random_float() * 200 - 100, gen.random_float() * 40 - 20, gen.random_float() * 200 - 100);
+            const float3 half = float3(0.1f + gen.random_float() * 3, 0.1f + gen.random_float() * 3, 0.1f + gen.random_float() * 3);
+            return aabb_3d(center - half, center + half);
+        };
+
+        // Enough objects for the parallel path. Every 97th has empty bounds and is never culled.
+        std::vector<aabb_3d> bounds(5000);
+        for (size_t i = 0; i < bounds.size(); ++i) bounds[i] = (i % 97 == 0) ? aabb_3d(float3(1), float3(-1)) : random_box();
+
+        // A camera, and an ortho volume looking down like a shadow cascade
+        const transform eye = lookat_rh(float3(0, 5, 60), float3(10, 0, 0));
+        const transform sun = lookat_rh(float3(0, 80, 0), float3(0, 0, 0), float3(0, 0, 1));
+        const frustum frustums[2] = {
+            frustum(make_projection_matrix(1.f, 1.5f, 0.1f, 120.f) * eye.view_matrix()),
+            frustum(make_orthographic_matrix(-40, 40, -40, 40, 0, 160) * sun.view_matrix())
+        };
+
+        const auto check = [&](const render_culler & culler)
+        {
+            std::vector<uint32_t> masks;
+            culler.cull(frustums, 2, masks);
+            REQUIRE(masks.size() == bounds.size());
+
+            size_t visible[2] = { 0, 0 };
+            for (size_t i = 0; i < bounds.size(); ++i)
+            {
+                for (uint32_t q = 0; q < 2; ++q)
+                {
+                    const bool expected = (i % 97 == 0) || frustums[q].intersects(bounds[i].center(), bounds[i].size());
+                    REQUIRE(((masks[i] >> q) & 1) == (expected ? 1u : 0u));
+                    visible[q] += expected;
+                }
+            }
+
+            // Some of each, so the test is not trivially satisfied
+            REQUIRE(visible[0] > bounds.size() / 50);
+            REQUIRE(visible[0] < bounds.size() / 2);
+            REQUIRE(visible[1] > bounds.size() / 50);
+        };
+
+        render_culler culler;
+        culler.update(bounds);
+        REQUIRE(culler.rebuilt());
+        REQUIRE(culler.size() == bounds.size());
+        check(culler);
+
+        // Small moves refit the same tree
+        for (size_t i = 0; i < bounds.size(); i += 3)
+        {
+            if (i % 97 == 0) continue;
+            const float3 offset = float3(gen.random_float() - 0.5f, 0, gen.random_float() - 0.5f);
+            bounds[i] = aabb_3d(bounds[i].min() + offset, bounds[i].max() + offset);
+        }
+        culler.update(bounds);
+        REQUIRE_FALSE(culler.rebuilt());
+        check(culler);
+
+        // Scattering everything degrades the refit tree past the threshold
+        std::vector<aabb_3d> shuffled = bounds;
+        std::reverse(shuffled.begin() + 1, shuffled.end() - 1);
+        for (size_t i = 0; i < bounds.size(); ++i) if (i % 97 != 0) bounds[i] = (shuffled[i].min().x <= shuffled[i].max().x) ? shuffled[i] : random_box();
+        culler.update(bounds);
+        REQUIRE(culler.rebuilt());
+        check(culler);
+
+        // A different number of objects rebuilds
+        bounds.resize(300);
+        culler.update(bounds);
+        REQUIRE(culler.rebuilt());
+        check(culler);
+
+        culler.update({});
+        std::vector<uint32_t> masks;
+        culler.cull(frustums, 2, masks);
+        REQUIRE(masks.empty());
+    }
+
+    TEST_CASE("inverse_transpose_matrices matches the general inverse")
+    {
+        uniform_random_gen gen;
+
+        std::vector<float4x4> models;
+        for (int i = 0; i < 37; ++i)
+        {
+            const float3 axis = normalize(float3(gen.random_float() + 0.1f, gen.random_float(), gen.random_float()));
+            const float4x4 rotation = make_rotation_matrix(axis, gen.random_float() * (float) POLYMER_TAU);
+            const float4x4 scaling = make_scaling_matrix(float3(0.1f + gen.random_float() * 4, 0.1f + gen.random_float() * 4, 0.1f + gen.random_float() * 4));
+            const float4x4 translation = make_translation_matrix(float3(gen.random_float() * 100, gen.random_float() * -50, gen.random_float() * 10));
+            models.push_back(translation * rotation * scaling);
+        }
+
+        // Not affine, takes the fallback
+        models.push_back(make_projection_matrix(1.f, 1.5f, 0.1f, 100.f));
+
+        std::vector<float4x4> result(models.size());
+        inverse_transpose_matrices(models.data(), result.data(), models.size());
+
+        for (size_t i = 0; i < models.size(); ++i)
+        {
+            const float4x4 expected = inverse(transpose(models[i]));
+            for (int c = 0; c < 4; ++c) for (int r = 0; r < 4; ++r)
+            {
+                REQUIRE(result[i][c][r] == doctest::Approx(expected[c][r]).epsilon(1e-4));
+            }
+        }
+
+        // In place
+        inverse_transpose_matrices(models.data(), models.data(), models.size());
+        for (size_t i = 0; i < models.size(); ++i) REQUIRE(models[i][3][1] == doctest::Approx(result[i][3][1]));
+    }
+
+    TEST_CASE("light_cluster_grid matches a brute force froxel test")
+    {
+        uniform_random_gen gen;
+
+        // Off center, like one eye of a stereo pair
+        const float near = 0.1f, far = 80.f;
+        const float4x4 projection = make_projection_matrix(-0.06f, 0.1f, -0.05f, 0.05f, near, far);
+        const transform eye = lookat_rh(float3(0, 2, 10), float3(3, 1, -20));
+        const float4x4 view = eye.view_matrix();
+
+        // Spheres all around the eye, so some cross the near plane, lie behind it, or straddle the far plane.
+        // Every 53rd has no radius and is left out.
+        std::vector<float4> spheres(3000);
+        for (size_t i = 0; i < spheres.size(); ++i)
+        {
+            const float3 p = float3(gen.random_float() * 120 - 60, gen.random_float() * 20 - 8, gen.random_float() * 120 - 100);
+            spheres[i] = float4(p, (i % 53 == 0) ? 0.f : 0.2f + gen.random_float() * 4);
+        }
+
+        light_cluster_grid grid(16, 9, 24);
+        REQUIRE_THROWS_AS(grid.bin(view, spheres.data(), spheres.size()), std::runtime_error);
+        REQUIRE(light_cluster_grid::is_perspective(projection));
+        REQUIRE_FALSE(light_cluster_grid::is_perspective(make_orthographic_matrix(-1, 1, -1, 1, near, far)));
+        REQUIRE_THROWS_AS(grid.set_projection(make_orthographic_matrix(-1, 1, -1, 1, near, far), near, far), std::runtime_error);
+
+        grid.set_projection(projection, near, far);
+        grid.bin(view, spheres.data(), spheres.size());
+
+        const std::vector<light_cluster> & clusters = grid.get_clusters();
+        const std::vector<uint32_t> & indices = grid.get_indices();
+        REQUIRE(clusters.size() == grid.size());
+
+        // Runs are contiguous, in froxel order, and hold each light once in ascending order. Membership
+        // matches a sphere to box test, up to rounding at the surface.
+        uint32_t offset = 0;
+        size_t binned = 0;
+        for (uint32_t z = 0; z < 24; ++z) for (uint32_t y = 0; y < 9; ++y) for (uint32_t x = 0; x < 16; ++x)
+        {
+            const light_cluster & c = clusters[grid.cluster_index(x, y, z)];
+            REQUIRE(c.offset == offset);
+            offset += c.count;
+
+            const aabb_3d bounds = grid.cluster_bounds(x, y, z);
+            std::vector<bool> in_run(spheres.size(), false);
+            for (uint32_t k = 0; k < c.count; ++k)
+            {
+                if (k > 0) REQUIRE(indices[c.offset + k - 1] < indices[c.offset + k]);
+                in_run[indices[c.offset + k]] = true;
+            }
+
+            for (size_t i = 0; i < spheres.size(); ++i)
+            {
+                const float3 center = transform_coord(view, spheres[i].xyz);
+                const float3 closest = linalg::clamp(center, bounds.min(), bounds.max());
+                const float d2 = length2(center - closest);
+                const float r2 = spheres[i].w * spheres[i].w;
+                if (spheres[i].w > 0.f && d2 < r2 * 0.999f) REQUIRE(in_run[i]);
+                if (spheres[i].w <= 0.f || d2 > r2 * 1.001f) REQUIRE_FALSE(in_run[i]);
+            }
+            binned += c.count;
+        }
+        REQUIRE(offset == indices.size());
+
+        // Some of each, so the test is not trivially satisfied
+        REQUIRE(binned > spheres.size());
+        REQUIRE(binned < spheres.size() * grid.size() / 20);
+
+        // Points looked up the way the shaders do find every light that reaches them
+        const float2 slice = grid.slice_params();
+        for (int n = 0; n < 2000; ++n)
+        {
+            const float3 ndc = float3(gen.random_float() * 2 - 1, gen.random_float() * 2 - 1, gen.random_float() * 2 - 1);
+            const float3 p = transform_coord(inverse(projection * view), ndc);
+            const float depth = -transform_coord(view, p).z;
+            if (depth <= near || depth >= far) continue;
+
+            const uint32_t x = std::min(uint32_t((ndc.x * 0.5f + 0.5f) * 16), 15u);
+            const uint32_t y = std::min(uint32_t((ndc.y * 0.5f + 0.5f) * 9), 8u);
+            const uint32_t z = uint32_t(std::min(std::max(std::log(depth) * slice.x + slice.y, 0.f), 23.f));
+            const light_cluster & c = clusters[grid.cluster_index(x, y, z)];
+
+            for (uint32_t i = 0; i < spheres.size(); ++i)
+            {
+                if (!(length(spheres[i].xyz - p) < spheres[i].w * 0.999f)) continue;
+                REQUIRE(std::binary_search(indices.begin() + c.offset, indices.begin() + c.offset + c.count, i));
+            }
+        }
+
+        grid.bin(view, spheres.data(), 0);
+        REQUIRE(grid.get_indices().empty());
+        for (const light_cluster & c : grid.get_clusters()) REQUIRE(c.count == 0);
+    }
+
+    TEST_CASE("light_cluster_grid binning (1k to 10k lights)")
+    {
+        uniform_random_gen gen;
+
+        // Lights spread through the rooms of a building around the eye
+        const float4x4 projection = make_projection_matrix(to_radians(70.f), 16.f / 9.f, 0.1f, 100.f);
+        const float4x4 view = lookat_rh(float3(0, 1.7f, 0), float3(10, 1.5f, -30)).view_matrix();
+
+        for (const size_t count : { 1000, 4000, 10000 })
+        {
+            std::vector<float4> spheres(count);
+            for (auto & s : spheres) s = float4(gen.random_float() * 100 - 50, gen.random_float() * 12, gen.random_float() * 100 - 80, 1.f + gen.random_float() * 4);
+
+            light_cluster_grid grid;
+            grid.set_projection(projection, 0.1f, 100.f);
+            grid.bin(view, spheres.data(), spheres.size()); // allocates
+
+            {
+                scoped_timer t("light_cluster_grid binning (" + std::to_string(count) + " lights, 16x9x24)");
+                grid.bin(view, spheres.data(), spheres.size());
+            }
+
+            size_t occupied = 0;
+            for (const light_cluster & c : grid.get_clusters()) occupied += c.count > 0;
+            std::cout << "    " << grid.get_indices().size() << " light indices in " << occupied << " of " << grid.size() << " froxels" << std::endl;
+            REQUIRE(grid.get_indices().size() >= occupied);
+            REQUIRE(occupied > 0);
+        }
+    }
+
 } // end namespace polymer
 
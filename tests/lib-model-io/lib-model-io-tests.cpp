@@ -0,0 +1,603 @@
+/*
+ * File: tests/lib-model-io-tests.cpp
+ * Test-cases and import benchmarks for the model loaders in polymer-model-io.
+ */
+
+#include "polymer-model-io/model-io.hpp"
+#include "polymer-model-io/mesh-binary-io.hpp"
+#include "polymer-model-io/gaussian-splat-io.hpp"
+#include "polymer-model-io/gltf-io.hpp"
+#include "meshoptimizer/meshoptimizer.h"
+#include "polymer-core/util/file-io.hpp"
+#include "polymer-core/tools/procedural-mesh.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <tuple>
+
+using namespace polymer;
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+TEST_CASE("obj import: polygons, relative indices, groups and materials")
+{
+    write_file_text("model-io-test.mtl", "newmtl blue\nKd 0 0 1\nnewmtl red\nKd 1 0 0\n");
+    write_file_text("model-io-test.obj",
+        "mtllib model-io-test.mtl\n"
+        "o quad\n"
+        "v 0 0 0\nv 1.5 0 0\nv 1.5 1e0 0\nv 0 1 -0.25\n"
+        "vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\n"
+        "vn 0 0 1\n"
+        "usemtl red\n"
+        "f 1/1/1 2/2/1 3/3/1 4/4/1\n"
+        "g tri\r\n"
+        "v 2 0 0\r\nv 3 0 0\r\nv 2 1 0\r\n"
+        "usemtl blue\r\n"
+        "f -3 -2 -1\r\n");
+
+    auto models = import_obj_model("model-io-test.obj");
+    REQUIRE(models.size() == 2);
+
+    const runtime_mesh & quad = models["quad"];
+    REQUIRE(quad.faces.size() == 2);
+    REQUIRE(quad.vertices.size() == 4);
+    REQUIRE(quad.texcoord0.size() == 4);
+    REQUIRE(quad.normals.size() == 4);
+    REQUIRE(quad.material == std::vector<uint32_t>{ 1, 1 });
+    REQUIRE(quad.vertices[2] == float3(1.5f, 1.f, 0.f));
+    REQUIRE(quad.vertices[3] == float3(0.f, 1.f, -0.25f));
+
+    // No normals in the file: generated, facing +z for a counter-clockwise triangle
+    const runtime_mesh & tri = models["tri"];
+    REQUIRE(tri.faces.size() == 1);
+    REQUIRE(tri.vertices[tri.faces[0].x] == float3(2, 0, 0));
+    REQUIRE(tri.vertices[tri.faces[0].z] == float3(2, 1, 0));
+    REQUIRE(tri.normals.size() == 3);
+    REQUIRE(tri.normals[0].z == doctest::Approx(1.f));
+    REQUIRE(tri.material == std::vector<uint32_t>{ 0 });
+
+    std::remove("model-io-test.obj");
+    std::remove("model-io-test.mtl");
+}
+
+TEST_CASE("polymer mesh v2 round trip")
+{
+    runtime_mesh mesh;
+    for (uint32_t i = 0; i < 64; ++i)
+    {
+        const float a = i * 0.1f;
+        mesh.vertices.push_back({ std::cos(a), std::sin(a), a });
+        mesh.normals.push_back(normalize(float3(std::cos(a), std::sin(a), 1.f)));
+        mesh.texcoord0.push_back({ a / 6.4f, 1.f - a / 6.4f });
+        mesh.colors.push_back({ 0.25f, 0.5f, 0.75f, 1.f });
+    }
+    for (uint32_t i = 0; i + 2 < 64; ++i) mesh.faces.push_back({ i, i + 1, i + 2 });
+
+    for (const bool compress : { false, true })
+    {
+        mesh_export_options options;
+        options.compress = compress;
+        options.quantize = compress;
+        options.meshlets = true;
+        export_polymer_binary_model("model-io-test.mesh", mesh, options);
+
+        mapped_mesh mapped("model-io-test.mesh");
+        REQUIRE(mapped.file_version() == 2);
+        REQUIRE(mapped.vertices().size == mesh.vertices.size());
+        REQUIRE(mapped.colors().size == mesh.colors.size());
+        REQUIRE(mapped.faces().size == mesh.faces.size());
+        if (!compress) REQUIRE(mapped.decoded_bytes() == 0);
+
+        const float tolerance = compress ? 1e-3f : 0.f;
+        for (size_t i = 0; i < mesh.vertices.size(); ++i)
+        {
+            REQUIRE(length(mapped.vertices()[i] - mesh.vertices[i]) <= tolerance);
+            REQUIRE(length(mapped.normals()[i] - mesh.normals[i]) <= tolerance);
+            REQUIRE(length(mapped.colors()[i] - mesh.colors[i]) <= tolerance);
+        }
+
+        uint32_t meshlet_triangles = 0;
+        for (const mesh_meshlet & m : mapped.meshlets()) meshlet_triangles += m.triangle_count;
+        REQUIRE(meshlet_triangles == mesh.faces.size());
+    }
+
+    std::remove("model-io-test.mesh");
+}
+
+// Points at the entry of the first section of a type in the table of a v2 file
+static runtime_mesh_binary_section * find_section(std::vector<uint8_t> & file, const mesh_section type)
+{
+    runtime_mesh_binary_header_v2 header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    auto * sections = reinterpret_cast<runtime_mesh_binary_section *>(file.data() + sizeof(header));
+    for (uint32_t i = 0; i < header.sectionCount; ++i) if (sections[i].type == uint32_t(type)) return &sections[i];
+    return nullptr;
+}
+
+TEST_CASE("mapped_mesh rejects malformed and truncated files")
+{
+    runtime_mesh mesh;
+    for (uint32_t i = 0; i < 64; ++i) mesh.vertices.push_back({ float(i), float(i % 8), 0.f });
+    for (uint32_t i = 0; i + 2 < 64; ++i) mesh.faces.push_back({ i, i + 1, i + 2 });
+
+    for (const bool compress : { false, true })
+    {
+        mesh_export_options options;
+        options.compress = compress;
+        options.meshlets = !compress;
+        export_polymer_binary_model("model-io-test.mesh", mesh, options);
+        const std::vector<uint8_t> valid = read_file_binary("model-io-test.mesh");
+        REQUIRE_NOTHROW(mapped_mesh("model-io-test.mesh"));
+
+        const auto check_throws = [](std::vector<uint8_t> file)
+        {
+            write_file_binary("model-io-test.mesh", file);
+            CHECK_THROWS_AS(mapped_mesh("model-io-test.mesh"), std::runtime_error);
+        };
+
+        // Cut anywhere: inside the header, the section table or the section data
+        for (const size_t size : { size_t(2), sizeof(runtime_mesh_binary_header_v2) - 1, sizeof(runtime_mesh_binary_header_v2) + 8, valid.size() / 2, valid.size() - 1 })
+        {
+            check_throws(std::vector<uint8_t>(valid.begin(), valid.begin() + size));
+        }
+
+        std::vector<uint8_t> file = valid;
+        find_section(file, mesh_section::vertices)->offset = valid.size() - 4;
+        check_throws(file);
+
+        file = valid;
+        find_section(file, mesh_section::faces)->count = 0x40000000;
+        check_throws(file);
+
+        file = valid;
+        runtime_mesh_binary_header_v2 header;
+        std::memcpy(&header, file.data(), sizeof(header));
+        header.lodCount = header.sectionCount + 1;
+        std::memcpy(file.data(), &header, sizeof(header));
+        check_throws(file);
+
+        if (!compress)
+        {
+            // Raw sections can be edited in place
+            file = valid;
+            runtime_mesh_binary_section * meshlets = find_section(file, mesh_section::meshlets);
+            REQUIRE(meshlets);
+            reinterpret_cast<mesh_meshlet *>(file.data() + meshlets->offset)->vertex_count = 0xffff;
+            check_throws(file);
+
+            file = valid;
+            runtime_mesh_binary_section * faces = find_section(file, mesh_section::faces);
+            reinterpret_cast<uint3 *>(file.data() + faces->offset)[3].y = 64;
+            check_throws(file);
+        }
+    }
+
+    // Face indices past the vertex streams, raw and through the index codec
+    mesh.faces.push_back({ 0, 1, 64 });
+    for (const bool compress : { false, true })
+    {
+        mesh_export_options options;
+        options.compress = compress;
+        export_polymer_binary_model("model-io-test.mesh", mesh, options);
+        CHECK_THROWS_AS(mapped_mesh("model-io-test.mesh"), std::runtime_error);
+    }
+
+    std::remove("model-io-test.mesh");
+}
+
+// A supershape with its faces shuffled, so the input has a poor post-transform cache order
+static runtime_mesh make_shuffled_supershape()
+{
+    runtime_mesh mesh = make_supershape_3d(96, 5, 7, 4, 12);
+    std::mt19937 rng(7);
+    std::shuffle(mesh.faces.begin(), mesh.faces.end(), rng);
+    return mesh;
+}
+
+// Each triangle as its three positions, rotated to start at the smallest so that winding is kept
+static std::vector<std::array<float, 9>> triangle_positions(const runtime_mesh & mesh)
+{
+    std::vector<std::array<float, 9>> triangles;
+    for (const uint3 & f : mesh.faces)
+    {
+        std::array<float3, 3> p = { mesh.vertices[f.x], mesh.vertices[f.y], mesh.vertices[f.z] };
+        const auto less = [](const float3 & a, const float3 & b) { return std::tie(a.x, a.y, a.z) < std::tie(b.x, b.y, b.z); };
+        std::rotate(p.begin(), std::min_element(p.begin(), p.end(), less), p.end());
+        triangles.push_back({ p[0].x, p[0].y, p[0].z, p[1].x, p[1].y, p[1].z, p[2].x, p[2].y, p[2].z });
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+TEST_CASE("optimize_model keeps every triangle and improves its cache and overdraw metrics")
+{
+    runtime_mesh mesh = make_shuffled_supershape();
+    const runtime_mesh source = mesh;
+
+    mesh_optimization_options options;
+    const mesh_optimization_stats stats = optimize_model(mesh, options);
+
+    // Same triangles with the same winding, indices in range, normals still per-vertex
+    REQUIRE(mesh.faces.size() == source.faces.size());
+    for (const uint3 & f : mesh.faces) REQUIRE(maxelem(f) < mesh.vertices.size());
+    REQUIRE(mesh.normals.size() == mesh.vertices.size());
+    REQUIRE(triangle_positions(mesh) == triangle_positions(source));
+
+    REQUIRE(stats.acmr_after < stats.acmr_before);
+    REQUIRE(stats.overdraw_after <= stats.overdraw_before);
+    REQUIRE(stats.overfetch_after <= stats.overfetch_before);
+
+    // The reported numbers describe the input and output meshes
+    const unsigned int * indices = reinterpret_cast<const unsigned int *>(mesh.faces.data());
+    const unsigned int * source_indices = reinterpret_cast<const unsigned int *>(source.faces.data());
+    const size_t index_count = mesh.faces.size() * 3;
+    REQUIRE(stats.triangles == mesh.faces.size());
+    REQUIRE(stats.vertices_before == source.vertices.size());
+    REQUIRE(stats.vertices_after == mesh.vertices.size());
+    REQUIRE(stats.vertices_after <= stats.vertices_before);
+    REQUIRE(stats.acmr_before == meshopt_analyzeVertexCache(source_indices, index_count, source.vertices.size(), options.cache_size, 0, 0).acmr);
+    REQUIRE(stats.acmr_after == meshopt_analyzeVertexCache(indices, index_count, mesh.vertices.size(), options.cache_size, 0, 0).acmr);
+    REQUIRE(stats.atvr_after == meshopt_analyzeVertexCache(indices, index_count, mesh.vertices.size(), options.cache_size, 0, 0).atvr);
+    REQUIRE(stats.overdraw_after == meshopt_analyzeOverdraw(indices, index_count, &mesh.vertices[0].x, mesh.vertices.size(), sizeof(float3)).overdraw);
+}
+
+TEST_CASE("optimize_model lod chain")
+{
+    runtime_mesh mesh = make_shuffled_supershape();
+
+    mesh_optimization_options options;
+    options.lod_count = 4;
+    std::vector<mesh_lod> lods;
+    optimize_model(mesh, options, &lods);
+
+    REQUIRE(lods.size() > 1);
+    REQUIRE(lods.size() <= options.lod_count);
+
+    size_t previous = mesh.faces.size();
+    for (const mesh_lod & lod : lods)
+    {
+        REQUIRE(lod.faces.size() < previous);
+        REQUIRE(lod.material.empty());
+        for (const uint3 & f : lod.faces) REQUIRE(maxelem(f) < mesh.vertices.size());
+        previous = lod.faces.size();
+    }
+}
+
+// Index codec streams as files carry them. The v0 stream is meshoptimizer's reference encoding of
+// 0 1 2, 2 1 3, 4 6 5, 7 8 9. The v1 stream is encoded by hand following the v1 encoder: the third and
+// fifth triangles end in free indices (7 and 20), the fourth and sixth in last + 1 and last - 1 (fec 14
+// and 13), and the seventh restarts at 0 (codeaux 0 outside the table).
+TEST_CASE("meshopt index codec decodes version 0 and version 1 streams")
+{
+    const unsigned char v0[] = {
+        0xe0,
+        0xf0, 0x10, 0xfe, 0xff,
+        0xf0, 0x0c, 0xff, 0x02, 0x02, 0x02,
+        0x00, 0x76, 0x87, 0x56, 0x67, 0x78, 0xa9, 0x86, 0x65, 0x89, 0x68, 0x98, 0x01, 0x69, 0x00, 0x00,
+    };
+    const unsigned char v1[] = {
+        0xe1,
+        0xf0, 0x10, 0x0f, 0x0e, 0x0f, 0x0d, 0xfe, 0x10,
+        0x0e, 0x18, 0x00,
+        0x00, 0x76, 0x87, 0x56, 0x67, 0x78, 0xa9, 0x86, 0x65, 0x89, 0x68, 0x98, 0x01, 0x69, 0x00, 0x00,
+    };
+
+    std::vector<uint32_t> indices(12);
+    REQUIRE(meshopt_decodeIndexBuffer(indices.data(), indices.size(), sizeof(uint32_t), v0, sizeof(v0)) == 0);
+    REQUIRE(indices == std::vector<uint32_t>{ 0, 1, 2, 2, 1, 3, 4, 6, 5, 7, 8, 9 });
+
+    indices.resize(24);
+    REQUIRE(meshopt_decodeIndexBuffer(indices.data(), indices.size(), sizeof(uint32_t), v1, sizeof(v1)) == 0);
+    REQUIRE(indices == std::vector<uint32_t>{ 0, 1, 2, 2, 1, 3, 2, 3, 7, 2, 7, 8, 2, 8, 20, 2, 20, 19, 0, 1, 2, 2, 1, 3 });
+
+    // 16-bit output, and later versions are still refused
+    std::vector<uint16_t> short_indices(24);
+    REQUIRE(meshopt_decodeIndexBuffer(short_indices.data(), short_indices.size(), sizeof(uint16_t), v1, sizeof(v1)) == 0);
+    REQUIRE(short_indices[17] == 19);
+
+    unsigned char v2[sizeof(v1)];
+    std::memcpy(v2, v1, sizeof(v1));
+    v2[0] = 0xe2;
+    REQUIRE(meshopt_decodeIndexBuffer(indices.data(), indices.size(), sizeof(uint32_t), v2, sizeof(v2)) == -1);
+}
+
+// Quantized positions in a meshopt compressed vertex stream, triangles in the index codec and a strip in
+// the index sequence codec, all behind a fallback buffer without data
+TEST_CASE("gltf import: EXT_meshopt_compression and KHR_mesh_quantization")
+{
+    const uint32_t n = 16;
+    std::vector<int16_t> positions;
+    std::vector<uint32_t> triangles, strip;
+    for (uint32_t y = 0; y < n; ++y)
+    {
+        for (uint32_t x = 0; x < n; ++x)
+        {
+            const float3 p = { x / float(n - 1) * 2.f - 1.f, y / float(n - 1) * 2.f - 1.f, std::sin(x * 0.5f) * std::cos(y * 0.5f) };
+            for (int c = 0; c < 3; ++c) positions.push_back(int16_t(std::round(p[c] * 32767.f)));
+            positions.push_back(0);
+            if (x + 1 < n && y + 1 < n)
+            {
+                const uint32_t i = y * n + x;
+                triangles.insert(triangles.end(), { i, i + 1, i + n, i + 1, i + n + 1, i + n });
+            }
+        }
+    }
+    for (uint32_t i = 0; i + 2 < n * n; ++i) strip.insert(strip.end(), { i, i + 1, i + 2 });
+
+    const size_t vertex_count = positions.size() / 4;
+    std::vector<uint8_t> streams(meshopt_encodeVertexBufferBound(vertex_count, 8));
+    streams.resize(meshopt_encodeVertexBuffer(streams.data(), streams.size(), positions.data(), vertex_count, 8));
+    const size_t vertices_size = streams.size();
+    const auto align = [&]() { while (streams.size() % 4) streams.push_back(0); return streams.size(); };
+
+    const size_t triangles_offset = align();
+    std::vector<uint8_t> encoded(meshopt_encodeIndexBufferBound(triangles.size(), vertex_count));
+    encoded.resize(meshopt_encodeIndexBuffer(encoded.data(), encoded.size(), triangles.data(), triangles.size()));
+    streams.insert(streams.end(), encoded.begin(), encoded.end());
+    const size_t triangles_size = encoded.size();
+
+    // Index sequence: version 1 header, zigzag deltas against baseline 0 as varints, 4 bytes of tail
+    const size_t strip_offset = align();
+    streams.push_back(0xd1);
+    uint32_t last = 0;
+    for (const uint32_t i : strip)
+    {
+        const int32_t delta = int32_t(i - last);
+        uint32_t v = (uint32_t((delta << 1) ^ (delta >> 31))) << 1;
+        last = i;
+        for (; v >= 128; v >>= 7) streams.push_back(uint8_t(v | 128));
+        streams.push_back(uint8_t(v));
+    }
+    streams.insert(streams.end(), 4, 0);
+    const size_t strip_size = streams.size() - strip_offset;
+    const size_t streams_size = align();
+
+    {
+        std::ofstream bin("gltf-test.bin", std::ios::binary);
+        bin.write(reinterpret_cast<const char *>(streams.data()), streams.size());
+    }
+
+    const auto view = [](size_t fallback_offset, size_t count, size_t stride, size_t offset, size_t size, const char * mode)
+    {
+        std::ostringstream v;
+        v << "{\"buffer\":1,\"byteOffset\":" << fallback_offset << ",\"byteLength\":" << count * stride << (stride == 8 ? ",\"byteStride\":8" : "")
+          << ",\"extensions\":{\"EXT_meshopt_compression\":{\"buffer\":0,\"byteOffset\":" << offset << ",\"byteLength\":" << size
+          << ",\"byteStride\":" << stride << ",\"count\":" << count << ",\"mode\":\"" << mode << "\"}}}";
+        return v.str();
+    };
+
+    std::ostringstream gltf;
+    gltf << "{\"asset\":{\"version\":\"2.0\"},"
+         << "\"extensionsUsed\":[\"EXT_meshopt_compression\",\"KHR_mesh_quantization\"],\"extensionsRequired\":[\"EXT_meshopt_compression\",\"KHR_mesh_quantization\"],"
+         << "\"buffers\":[{\"uri\":\"gltf-test.bin\",\"byteLength\":" << streams_size << "},"
+         << "{\"byteLength\":" << (vertex_count * 8 + (triangles.size() + strip.size()) * 4) << ",\"extensions\":{\"EXT_meshopt_compression\":{\"fallback\":true}}}],"
+         << "\"bufferViews\":[" << view(0, vertex_count, 8, 0, vertices_size, "ATTRIBUTES") << ","
+         << view(vertex_count * 8, triangles.size(), 4, triangles_offset, triangles_size, "TRIANGLES") << ","
+         << view(vertex_count * 8 + triangles.size() * 4, strip.size(), 4, strip_offset, strip_size, "INDICES") << "],"
+         << "\"accessors\":[{\"bufferView\":0,\"componentType\":5122,\"normalized\":true,\"count\":" << vertex_count << ",\"type\":\"VEC3\",\"min\":[-1,-1,-1],\"max\":[1,1,1]},"
+         << "{\"bufferView\":1,\"componentType\":5125,\"count\":" << triangles.size() << ",\"type\":\"SCALAR\"},"
+         << "{\"bufferView\":2,\"componentType\":5125,\"count\":" << strip.size() << ",\"type\":\"SCALAR\"}],"
+         << "\"meshes\":[{\"name\":\"grid\",\"primitives\":[{\"attributes\":{\"POSITION\":0},\"indices\":1},{\"attributes\":{\"POSITION\":0},\"indices\":2}]}],"
+         << "\"nodes\":[{\"mesh\":0}],\"scenes\":[{\"nodes\":[0]}],\"scene\":0}";
+    write_file_text("gltf-test.gltf", gltf.str());
+
+    for (const bool parallel : { false, true })
+    {
+        gltf_import_options options;
+        options.parallel = parallel;
+        options.compute_tangents = false;
+        const gltf_scene scene = import_gltf_scene("gltf-test.gltf", options);
+        REQUIRE(scene.primitives.size() == 2);
+
+        for (const gltf_primitive & prim : scene.primitives)
+        {
+            REQUIRE(prim.mesh.vertices.size() == vertex_count);
+            REQUIRE(prim.mesh.normals.size() == vertex_count);
+            for (size_t i = 0; i < vertex_count; ++i)
+            {
+                for (int c = 0; c < 3; ++c) REQUIRE(std::abs(prim.mesh.vertices[i][c] - positions[i * 4 + c] / 32767.f) < 1e-6f);
+            }
+        }
+
+        const auto & faces = scene.primitives[0].mesh.faces;
+        const auto & strip_faces = scene.primitives[1].mesh.faces;
+        REQUIRE(faces.size() * 3 == triangles.size());
+        REQUIRE(strip_faces.size() * 3 == strip.size());
+        REQUIRE(std::equal(strip.begin(), strip.end(), &strip_faces[0].x));
+
+        // The triangle codec keeps the order of triangles but may rotate their corners
+        for (size_t t = 0; t < faces.size(); ++t)
+        {
+            const uint3 f = faces[t];
+            const uint3 e = { triangles[t * 3], triangles[t * 3 + 1], triangles[t * 3 + 2] };
+            REQUIRE((f == e || f == uint3(e.y, e.z, e.x) || f == uint3(e.z, e.x, e.y)));
+        }
+    }
+
+    const auto meshes = import_gltf_model("gltf-test.gltf");
+    REQUIRE(meshes.count("grid_prim0") == 1);
+    REQUIRE(meshes.at("grid_prim0").faces.size() * 3 == triangles.size());
+
+    std::remove("gltf-test.gltf");
+    std::remove("gltf-test.bin");
+}
+
+// Imports every model under assets/models, then a generated OBJ large enough to exercise the chunked parser.
+// Writes about 60MB and prints timings, so it only runs when asked for, e.g. with --no-skip.
+TEST_CASE("model import benchmark" * doctest::skip())
+{
+    std::string asset_root;
+    for (const char * candidate : { "assets/models", "../assets/models", "../../assets/models", "../../../assets/models" })
+    {
+        if (std::filesystem::exists(candidate)) { asset_root = candidate; break; }
+    }
+
+    if (!asset_root.empty())
+    {
+        for (const auto & entry : std::filesystem::recursive_directory_iterator(asset_root))
+        {
+            const std::string ext = entry.path().extension().string();
+            if (ext != ".obj" && ext != ".ply" && ext != ".mesh") continue;
+
+            manual_timer timer;
+            timer.start();
+            auto models = import_model(entry.path().string());
+            timer.stop();
+
+            size_t triangles = 0;
+            for (const auto & m : models) triangles += m.second.faces.size();
+            std::cout << entry.path().filename().string() << ": " << triangles << " triangles in " << timer.get() << "ms" << std::endl;
+            REQUIRE(triangles > 0);
+        }
+    }
+
+    const uint32_t grid = 768;
+    {
+        std::ostringstream obj;
+        obj.precision(6);
+        for (uint32_t y = 0; y <= grid; ++y)
+            for (uint32_t x = 0; x <= grid; ++x)
+                obj << "v " << std::fixed << x / float(grid) << " " << std::sin(x * 0.05f) * std::cos(y * 0.05f) << " " << y / float(grid) << "\n"
+                    << "vt " << x / float(grid) << " " << y / float(grid) << "\n";
+        for (uint32_t y = 0; y < grid; ++y)
+        {
+            for (uint32_t x = 0; x < grid; ++x)
+            {
+                const uint32_t a = y * (grid + 1) + x + 1, b = a + 1, c = a + grid + 1, d = c + 1;
+                obj << "f " << a << "/" << a << " " << c << "/" << c << " " << d << "/" << d << " " << b << "/" << b << "\n";
+            }
+        }
+        write_file_text("model-io-benchmark.obj", obj.str());
+    }
+
+    const double megabytes = std::filesystem::file_size("model-io-benchmark.obj") / (1024.0 * 1024.0);
+
+    manual_timer timer;
+    timer.start();
+    auto models = import_obj_model("model-io-benchmark.obj");
+    timer.stop();
+
+    std::cout << "generated obj (" << megabytes << " MB): " << timer.get() << "ms, " << megabytes / (timer.get() / 1000.0) << " MB/s" << std::endl;
+    REQUIRE(models.size() == 1);
+    REQUIRE(models.begin()->second.faces.size() == size_t(grid) * grid * 2);
+    REQUIRE(models.begin()->second.vertices.size() == size_t(grid + 1) * (grid + 1));
+
+    std::remove("model-io-benchmark.obj");
+}
+
+// Writes a binary splat PLY in the layout produced by the reference 3DGS trainer
+static void write_splat_ply(const std::string & path, const std::vector<std::array<float, 62>> & rows)
+{
+    std::ostringstream header;
+    header << "ply\nformat binary_little_endian 1.0\nelement vertex " << rows.size() << "\n";
+    for (const char * p : { "x", "y", "z", "nx", "ny", "nz", "f_dc_0", "f_dc_1", "f_dc_2" }) header << "property float " << p << "\n";
+    for (int i = 0; i < 45; ++i) header << "property float f_rest_" << i << "\n";
+    for (const char * p : { "opacity", "scale_0", "scale_1", "scale_2", "rot_0", "rot_1", "rot_2", "rot_3" }) header << "property float " << p << "\n";
+    header << "end_header\n";
+
+    std::ofstream file(path, std::ios::binary);
+    file << header.str();
+    file.write(reinterpret_cast<const char *>(rows.data()), rows.size() * sizeof(rows[0]));
+}
+
+static std::vector<std::array<float, 62>> make_splat_rows(const size_t count)
+{
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<float> unit(-1.f, 1.f);
+    std::vector<std::array<float, 62>> rows(count);
+    for (auto & r : rows)
+    {
+        for (float & v : r) v = unit(gen);
+        for (int i = 0; i < 3; ++i) r[i] *= 10.f;        // position
+        for (int i = 55; i < 58; ++i) r[i] -= 4.f;       // log scale
+    }
+    return rows;
+}
+
+TEST_CASE("gaussian splat ply import and compression")
+{
+    const auto rows = make_splat_rows(5000);
+    write_splat_ply("splat-test.ply", rows);
+
+    REQUIRE(is_gaussian_splat_ply("splat-test.ply"));
+    const gaussian_splat_scene scene = import_gaussian_splat_ply("splat-test.ply");
+    REQUIRE(scene.size() == rows.size());
+    REQUIRE(scene.sh_degree == 3);
+
+    for (size_t i = 0; i < rows.size(); ++i)
+    {
+        const auto & r = rows[i];
+        REQUIRE(scene.positions[i] == float3(r[0], r[1], r[2]));
+        REQUIRE(scene.scales[i].y == doctest::Approx(std::exp(r[56])));
+        REQUIRE(scene.opacities[i] == doctest::Approx(1.f / (1.f + std::exp(-r[54]))));
+        REQUIRE(length(scene.rotations[i] - normalize(float4(r[58], r[59], r[60], r[61]))) < 1e-6f);
+        REQUIRE(scene.shs[i * 48 + 1] == r[7]);                // dc green
+        REQUIRE(scene.shs[i * 48 + 5 * 3 + 2] == r[9 + 30 + 4]); // blue coefficient 5
+    }
+
+    const compressed_gaussian_splats compressed = compress_gaussian_splats(scene);
+    REQUIRE(compressed.size() == scene.size());
+    REQUIRE(compressed.memory_bytes() * 3 < scene.memory_bytes());
+
+    // Compressed splats are Morton ordered; match them back up by position
+    std::vector<gaussian_vertex> decoded(compressed.size());
+    pack_gaussian_vertices(compressed, decoded.data());
+    std::vector<uint32_t> matched(decoded.size());
+    for (size_t i = 0; i < decoded.size(); ++i)
+    {
+        float best = std::numeric_limits<float>::max();
+        for (size_t j = 0; j < scene.size(); ++j)
+        {
+            const float d = length2(scene.positions[j] - decoded[i].position.xyz());
+            if (d < best) { best = d; matched[i] = static_cast<uint32_t>(j); }
+        }
+    }
+
+    for (size_t i = 0; i < decoded.size(); ++i)
+    {
+        const gaussian_vertex & v = decoded[i];
+        const size_t j = matched[i];
+        const float4 q = scene.rotations[j];
+        REQUIRE(std::abs(dot(v.rotation, q)) > 0.999f);
+        REQUIRE(v.scale_opacity.w == doctest::Approx(scene.opacities[j]).epsilon(1e-3));
+        for (int k = 0; k < 3; ++k) REQUIRE(v.scale_opacity[k] == doctest::Approx(scene.scales[j][k]).epsilon(0.01));
+        for (int k = 0; k < 48; ++k) REQUIRE(std::abs(v.shs[k] - scene.shs[j * 48 + k]) < 0.01f);
+    }
+
+    const compressed_gaussian_splats streamed = import_gaussian_splat_ply_compressed("splat-test.ply");
+    REQUIRE(streamed.positions == compressed.positions);
+    REQUIRE(streamed.shs == compressed.shs);
+
+    std::remove("splat-test.ply");
+}
+
+// Writes and imports 500k splats and prints timings; skipped unless asked for, like the model import benchmark
+TEST_CASE("gaussian splat import benchmark" * doctest::skip())
+{
+    const auto rows = make_splat_rows(500000);
+    write_splat_ply("splat-benchmark.ply", rows);
+    const double megabytes = rows.size() * sizeof(rows[0]) / (1024.0 * 1024.0);
+
+    manual_timer timer;
+    timer.start();
+    const gaussian_splat_scene scene = import_gaussian_splat_ply("splat-benchmark.ply");
+    timer.stop();
+    std::cout << "splat ply (" << megabytes << " MB): " << timer.get() << "ms, " << scene.memory_bytes() / (1024 * 1024) << " MB resident" << std::endl;
+
+    timer.start();
+    const compressed_gaussian_splats compressed = import_gaussian_splat_ply_compressed("splat-benchmark.ply");
+    timer.stop();
+    std::cout << "splat ply compressed: " << timer.get() << "ms, " << compressed.memory_bytes() / (1024 * 1024) << " MB resident" << std::endl;
+
+    REQUIRE(scene.size() == rows.size());
+    REQUIRE(compressed.size() == rows.size());
+
+    std::remove("splat-benchmark.ply");
+}
@@ -6,6 +6,7 @@
  */
 
 #include "lib-polymer.hpp"
+#include "polymer-core/tools/procedural-mesh.hpp"
 
 using namespace polymer;
 
@@ -332,6 +333,85 @@ TEST_CASE("simple_thread_pool with workgroup")
     REQUIRE(results[1].get() == 22); // sum [4, 7]
 }
 
+TEST_CASE("job_system parallel_for, dependencies and nested waits")
+{
+    job_system jobs(4);
+    REQUIRE(jobs.num_threads() == 5);
+    REQUIRE(jobs.on_main_thread());
+    std::thread([&]() { REQUIRE_FALSE(jobs.on_main_thread()); }).join();
+
+    // Every index visited exactly once, with ranges no larger than the grain
+    std::vector<std::atomic<uint32_t>> visits(100000);
+    for (auto & v : visits) v = 0;
+    std::atomic<size_t> max_range { 0 };
+    jobs.parallel_for(visits.size(), 1000, [&](const size_t begin, const size_t end)
+    {
+        for (size_t i = begin; i < end; ++i) visits[i]++;
+        size_t prev = max_range.load();
+        while (end - begin > prev && !max_range.compare_exchange_weak(prev, end - begin)) {}
+    });
+    for (auto & v : visits) REQUIRE(v.load() == 1);
+    REQUIRE(max_range.load() <= 1000);
+
+    // Nested parallel_for inside jobs must not deadlock
+    std::atomic<uint64_t> nested_sum { 0 };
+    jobs.parallel_for(64, 1, [&](const size_t begin, const size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            jobs.parallel_for(1000, 10, [&](const size_t b, const size_t e) { for (size_t k = b; k < e; ++k) nested_sum += k; });
+        }
+    });
+    REQUIRE(nested_sum.load() == 64ull * (999ull * 1000ull / 2ull));
+
+    // Diamond: a -> (b, c) -> d
+    std::vector<int> order;
+    std::mutex order_mutex;
+    const auto record = [&](int id) { std::lock_guard<std::mutex> lock(order_mutex); order.push_back(id); };
+
+    job_handle a = jobs.create([&]() { record(0); });
+    job_handle b = jobs.create([&]() { record(1); });
+    job_handle c = jobs.create([&]() { record(2); });
+    job_handle d = jobs.create([&]() { record(3); });
+    jobs.add_dependency(a, b);
+    jobs.add_dependency(a, c);
+    jobs.add_dependency(b, d);
+    jobs.add_dependency(c, d);
+    jobs.submit(d);
+    jobs.submit(c);
+    jobs.submit(b);
+    REQUIRE_FALSE(d.finished());
+    jobs.submit(a);
+    jobs.wait(d);
+    REQUIRE(order.size() == 4);
+    REQUIRE(order.front() == 0);
+    REQUIRE(order.back() == 3);
+
+    // A continuation on an already-finished job runs immediately
+    std::atomic<bool> ran { false };
+    jobs.wait(jobs.then(a, [&]() { ran = true; }));
+    REQUIRE(ran.load());
+
+    // Parents wait for all of their children; 5000 also forces the main deque to grow
+    std::atomic<uint32_t> children { 0 };
+    job_handle parent = jobs.create([]() {});
+    for (int i = 0; i < 5000; ++i) jobs.run([&]() { children++; }, parent);
+    jobs.submit(parent);
+    jobs.wait(parent);
+    REQUIRE(children.load() == 5000);
+
+    // Submission from a thread the system does not own goes through the injection queue
+    std::atomic<uint32_t> external { 0 };
+    std::thread producer([&]()
+    {
+        std::vector<job_handle> handles;
+        for (int i = 0; i < 1000; ++i) handles.push_back(jobs.run([&]() { external++; }));
+        for (auto & h : handles) jobs.wait(h);
+    });
+    producer.join();
+    REQUIRE(external.load() == 1000);
+}
+
 TEST_CASE("integral and floating point radix sort")
 {
     uniform_random_gen random_generator;
@@ -345,6 +425,549 @@ TEST_CASE("integral and floating point radix sort")
     radix_sort radix_sorter;
     radix_sorter.sort(int_list.data(), int_list.size());
     radix_sorter.sort(float_list.data(), float_list.size());
+    REQUIRE(std::is_sorted(int_list.begin(), int_list.end()));
+    REQUIRE(std::is_sorted(float_list.begin(), float_list.end()));
+}
+
+TEST_CASE("radix sort_pairs is stable and matches std::stable_sort")
+{
+    uniform_random_gen gen;
+    job_system jobs(4);
+
+    // Serial and parallel paths must produce the same permutation
+    for (const size_t threshold : { std::numeric_limits<size_t>::max(), size_t(0) })
+    {
+        radix_sort sorter(jobs);
+        sorter.set_parallel_threshold(threshold);
+
+        // 64-bit keys with only the low bytes in use, like (tile << 32 | depth) with few tiles
+        std::vector<uint64_t> keys(200000);
+        std::vector<uint32_t> values(keys.size());
+        for (uint32_t i = 0; i < keys.size(); ++i)
+        {
+            keys[i] = (uint64_t(gen.random_uint(16)) << 32) | gen.random_uint(1024);
+            values[i] = i;
+        }
+
+        std::vector<std::pair<uint64_t, uint32_t>> expected(keys.size());
+        for (size_t i = 0; i < keys.size(); ++i) expected[i] = { keys[i], values[i] };
+        std::stable_sort(expected.begin(), expected.end(), [](const auto & a, const auto & b) { return a.first < b.first; });
+
+        sorter.sort_pairs(keys, values);
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            REQUIRE(keys[i] == expected[i].first);
+            REQUIRE(values[i] == expected[i].second);
+        }
+
+        // Signed and float keys, reusing the same sorter and its scratch memory
+        std::vector<int32_t> signed_keys(50000);
+        for (auto & k : signed_keys) k = int32_t(gen.random_uint(200000)) - 100000;
+        std::vector<int32_t> signed_expected = signed_keys;
+        std::sort(signed_expected.begin(), signed_expected.end());
+        sorter.sort(signed_keys);
+        REQUIRE(signed_keys == signed_expected);
+
+        std::vector<float> float_keys(150000);
+        for (auto & k : float_keys) k = gen.random_float(-1000.f, 1000.f);
+        std::vector<float> float_expected = float_keys;
+        std::sort(float_expected.begin(), float_expected.end());
+        sorter.sort(float_keys);
+        REQUIRE(float_keys == float_expected);
+
+        // Small inputs take the insertion sort path
+        std::vector<uint16_t> small_keys = { 9, 3, 7, 3, 1 };
+        std::vector<char> small_values = { 'a', 'b', 'c', 'd', 'e' };
+        sorter.sort_pairs(small_keys, small_values);
+        REQUIRE(small_keys == std::vector<uint16_t>{ 1, 3, 3, 7, 9 });
+        REQUIRE(small_values == std::vector<char>{ 'e', 'b', 'd', 'c', 'a' });
+
+        // Double-buffered over caller storage: the result is in whichever pair the last pass wrote
+        std::vector<uint64_t> keys_a(expected.size()), keys_b(expected.size());
+        std::vector<uint32_t> values_a(expected.size()), values_b(expected.size());
+        for (size_t i = 0; i < expected.size(); ++i) { keys_a[expected[i].second] = expected[i].first; values_a[expected[i].second] = expected[i].second; }
+        const bool in_b = sorter.sort_pairs(keys_a.data(), values_a.data(), keys_b.data(), values_b.data(), keys_a.size());
+        REQUIRE(in_b); // depth bytes 0 and 1 plus tile byte 4: three passes
+        for (size_t i = 0; i < expected.size(); ++i)
+        {
+            REQUIRE(keys_b[i] == expected[i].first);
+            REQUIRE(values_b[i] == expected[i].second);
+        }
+    }
+}
+
+TEST_CASE("incremental_sort repairs a slowly changing order and falls back to radix sort")
+{
+    uniform_random_gen gen;
+    job_system jobs(4);
+
+    // Serial and parallel repair must produce the same order as a stable sort of the gathered keys
+    for (const size_t threshold : { std::numeric_limits<size_t>::max(), size_t(0) })
+    {
+        incremental_sort<float> sorter(jobs);
+        sorter.set_parallel_threshold(threshold);
+
+        std::vector<float> depths(100000);
+        for (auto & d : depths) d = gen.random_float(1.f, 100.f);
+
+        const auto check = [&](const std::vector<uint32_t> & previous)
+        {
+            const std::vector<uint32_t> & order = sorter.order();
+            REQUIRE(order.size() == depths.size());
+
+            // Equal keys keep their previous relative order
+            std::vector<uint32_t> expected = previous;
+            std::stable_sort(expected.begin(), expected.end(), [&](const uint32_t a, const uint32_t b) { return depths[a] < depths[b]; });
+            REQUIRE(order == expected);
+            for (size_t i = 0; i < order.size(); ++i) REQUIRE(sorter.keys()[i] == depths[order[i]]);
+        };
+
+        // First call has no previous order
+        std::vector<uint32_t> previous(depths.size());
+        std::iota(previous.begin(), previous.end(), 0u);
+        sorter.sort(depths.data(), depths.size());
+        REQUIRE(sorter.full_sort());
+        REQUIRE(sorter.disorder() == 1.f);
+        check(previous);
+
+        // Unchanged keys: nothing to do
+        previous = sorter.order();
+        sorter.sort(depths.data(), depths.size());
+        REQUIRE(sorter.disorder() == 0.f);
+        REQUIRE_FALSE(sorter.full_sort());
+        check(previous);
+
+        // Small camera motion: every depth moves a little, so few neighbours swap
+        for (int frame = 0; frame < 4; ++frame)
+        {
+            for (auto & d : depths) d += gen.random_float(-0.0001f, 0.0001f);
+            previous = sorter.order();
+            sorter.sort(depths.data(), depths.size());
+            REQUIRE(sorter.disorder() > 0.f);
+            REQUIRE(sorter.disorder() < sorter.max_disorder);
+            REQUIRE_FALSE(sorter.full_sort());
+            check(previous);
+        }
+
+        // A few keys jump far away: low disorder, but the repair exceeds its move budget
+        sorter.max_moves_per_element = 1;
+        for (int i = 0; i < 200; ++i) depths[gen.random_uint(uint32_t(depths.size()))] = gen.random_float(1.f, 100.f);
+        previous = sorter.order();
+        sorter.sort(depths.data(), depths.size());
+        REQUIRE(sorter.disorder() < sorter.max_disorder);
+        REQUIRE(sorter.full_sort());
+        check(previous);
+        sorter.max_moves_per_element = 8;
+
+        // Camera cut: the previous order is no better than random
+        for (auto & d : depths) d = gen.random_float(1.f, 100.f);
+        previous = sorter.order();
+        sorter.sort(depths.data(), depths.size());
+        REQUIRE(sorter.disorder() > sorter.max_disorder);
+        REQUIRE(sorter.full_sort());
+        check(previous);
+
+        // Ties between identical keys stay put across repairs
+        for (auto & d : depths) d = float(gen.random_uint(64));
+        sorter.sort(depths.data(), depths.size());
+        previous = sorter.order();
+        for (int i = 0; i < 50; ++i) depths[gen.random_uint(uint32_t(depths.size()))] += 1.f;
+        sorter.sort(depths.data(), depths.size());
+        check(previous);
+    }
+}
+
+TEST_CASE("bvh_tree lbvh and binned sah agree")
+{
+    uniform_random_gen gen;
+
+    // Clustered, non-uniform scene: most objects packed into a few small regions with a sparse background
+    std::vector<bvh_node_data> objects(20000);
+    for (size_t i = 0; i < objects.size(); ++i)
+    {
+        const bool clustered = (i % 8) != 0;
+        const float3 cluster = float3(float(i % 3) * 200.f, 0, 0);
+        const float3 center = clustered ? cluster + float3(gen.random_float(4.f), gen.random_float(4.f), gen.random_float(4.f))
+                                        : float3(gen.random_float(-500.f, 500.f), gen.random_float(-500.f, 500.f), gen.random_float(-500.f, 500.f));
+        const float3 half_size = float3(gen.random_float(0.05f, 1.f));
+        objects[i].bounds = aabb_3d(center - half_size, center + half_size);
+        objects[i].user_data = nullptr;
+    }
+
+    bvh_tree lbvh(bvh_build_mode::lbvh);
+    bvh_tree sah(bvh_build_mode::binned_sah);
+    for (auto & o : objects) { lbvh.add(&o); sah.add(&o); }
+
+    {
+        scoped_timer t("lbvh build (20k objects)");
+        lbvh.build();
+    }
+
+    {
+        scoped_timer t("binned sah build (20k objects)");
+        sah.build();
+    }
+
+    REQUIRE(sah.get_flat_objects().size() == objects.size());
+    REQUIRE(sah.get_flat_nodes().size() > 0);
+    REQUIRE(sah.compute_sah_cost() < lbvh.compute_sah_cost());
+    std::cout << "sah cost - lbvh: " << lbvh.compute_sah_cost() << ", binned sah: " << sah.compute_sah_cost() << std::endl;
+
+    std::vector<ray> rays;
+    for (int i = 0; i < 2048; ++i)
+    {
+        const float3 origin(gen.random_float(-600.f, 600.f), gen.random_float(-600.f, 600.f), -700.f);
+        const float3 target(gen.random_float(-10.f, 410.f), gen.random_float(-5.f, 5.f), gen.random_float(-5.f, 5.f));
+        rays.push_back(ray(origin, normalize(target - origin)));
+    }
+
+    auto hit_set = [](std::vector<std::pair<bvh_node_data*, float>> & hits)
+    {
+        std::vector<bvh_node_data*> set;
+        for (auto & h : hits) set.push_back(h.first);
+        std::sort(set.begin(), set.end());
+        return set;
+    };
+
+    size_t total_hits = 0;
+    double lbvh_ms = 0, sah_ms = 0;
+    manual_timer timer;
+    for (const ray & r : rays)
+    {
+        std::vector<std::pair<bvh_node_data*, float>> a, b;
+        timer.start(); lbvh.intersect(r, a); timer.stop(); lbvh_ms += timer.get();
+        timer.start(); sah.intersect(r, b); timer.stop(); sah_ms += timer.get();
+        REQUIRE(hit_set(a) == hit_set(b));
+        total_hits += a.size();
+    }
+    std::cout << "2048 rays, " << total_hits << " hits - lbvh: " << lbvh_ms << "ms, binned sah: " << sah_ms << "ms" << std::endl;
+
+    const frustum f(make_projection_matrix(1.f, 1.f, 0.1f, 300.f) * transform(float3(200.f, 0, 100.f)).view_matrix());
+    auto lbvh_visible = lbvh.find_visible_nodes(f);
+    auto sah_visible = sah.find_visible_nodes(f);
+    std::sort(lbvh_visible.begin(), lbvh_visible.end());
+    std::sort(sah_visible.begin(), sah_visible.end());
+    REQUIRE(lbvh_visible == sah_visible);
+
+    // Refitting after moving objects keeps the two in agreement
+    for (auto & o : objects) o.bounds = aabb_3d(o.bounds.min() + float3(1, 0, 0), o.bounds.max() + float3(1, 0, 0));
+    lbvh.refit();
+    sah.refit();
+    for (int i = 0; i < 128; ++i)
+    {
+        std::vector<std::pair<bvh_node_data*, float>> a, b;
+        lbvh.intersect(rays[i], a);
+        sah.intersect(rays[i], b);
+        REQUIRE(hit_set(a) == hit_set(b));
+    }
+}
+
+TEST_CASE("bvh4 and bvh8 simd traversal match bvh_tree")
+{
+    uniform_random_gen gen;
+
+    std::vector<bvh_node_data> objects(20000);
+    for (size_t i = 0; i < objects.size(); ++i)
+    {
+        const float3 center = float3(gen.random_float(-300.f, 300.f), gen.random_float(-300.f, 300.f), gen.random_float(-300.f, 300.f));
+        const float3 half_size = float3(gen.random_float(0.1f, 4.f));
+        objects[i].bounds = aabb_3d(center - half_size, center + half_size);
+        objects[i].user_data = nullptr;
+    }
+
+    bvh_tree tree(bvh_build_mode::binned_sah);
+    for (auto & o : objects) tree.add(&o);
+    tree.build();
+
+    bvh4_tree bvh4;
+    bvh8_tree bvh8;
+    bvh4.build(tree);
+    bvh8.build(tree);
+    REQUIRE(bvh8.size() < bvh4.size());
+    REQUIRE(bvh4.size() < tree.get_flat_nodes().size());
+
+    // Coherent packets: eight rays from one eye through neighbouring pixels, as in a picking sweep
+    std::vector<ray> rays;
+    for (int p = 0; p < 256; ++p)
+    {
+        const float3 origin(gen.random_float(-400.f, 400.f), gen.random_float(-400.f, 400.f), -500.f);
+        const float3 target(gen.random_float(-200.f, 200.f), gen.random_float(-200.f, 200.f), 0.f);
+        for (int i = 0; i < 8; ++i) rays.push_back(ray(origin, normalize(target + float3(float(i % 4), float(i / 4), 0) - origin)));
+    }
+
+    std::vector<std::vector<std::pair<bvh_node_data*, float>>> expected(rays.size());
+    manual_timer timer;
+    timer.start();
+    for (size_t i = 0; i < rays.size(); ++i) tree.intersect(rays[i], expected[i]);
+    timer.stop();
+    std::cout << rays.size() << " rays - bvh_tree: " << timer.get() << "ms" << std::endl;
+
+    auto same_hits = [](const std::vector<std::pair<bvh_node_data*, float>> & a, const std::vector<std::pair<bvh_node_data*, float>> & b)
+    {
+        if (a.size() != b.size()) return false;
+        for (size_t i = 0; i < a.size(); ++i) if (a[i].second != b[i].second) return false;
+        return true;
+    };
+
+    const simd_level levels[] = { simd_level::scalar, simd_level::sse, simd_level::avx2 };
+    for (const simd_level level : levels)
+    {
+        if (level > get_simd_level()) continue;
+        bvh4.set_simd_level(level);
+        bvh8.set_simd_level(level);
+
+        double bvh4_ms = 0, bvh8_ms = 0;
+        for (size_t i = 0; i < rays.size(); ++i)
+        {
+            std::vector<std::pair<bvh_node_data*, float>> a, b;
+            timer.start(); bvh4.intersect(rays[i], a); timer.stop(); bvh4_ms += timer.get();
+            timer.start(); bvh8.intersect(rays[i], b); timer.stop(); bvh8_ms += timer.get();
+            REQUIRE(same_hits(a, expected[i]));
+            REQUIRE(same_hits(b, expected[i]));
+        }
+
+        std::vector<std::vector<std::pair<bvh_node_data*, float>>> packet_results;
+        timer.start();
+        bvh8.intersect(rays, packet_results);
+        timer.stop();
+        for (size_t i = 0; i < rays.size(); ++i) REQUIRE(same_hits(packet_results[i], expected[i]));
+
+        std::cout << "simd level " << uint32_t(level) << " - bvh4: " << bvh4_ms << "ms, bvh8: " << bvh8_ms << "ms, bvh8 packets: " << timer.get() << "ms" << std::endl;
+    }
+}
+
+TEST_CASE("mesh_bvh matches brute force intersect_ray_mesh")
+{
+    uniform_random_gen gen;
+
+    const geometry mesh = make_supershape_3d(384, 5, 7, 4, 12);
+    REQUIRE(mesh.faces.size() > 100000);
+
+    mesh_bvh accelerator;
+    {
+        scoped_timer t("mesh_bvh build (" + std::to_string(mesh.faces.size()) + " triangles)");
+        accelerator.build(mesh);
+    }
+    REQUIRE(accelerator.matches(mesh));
+
+    double brute_ms = 0, bvh_ms = 0;
+    manual_timer timer;
+    uint32_t num_hits = 0;
+
+    for (int i = 0; i < 256; ++i)
+    {
+        const float3 origin = normalize(float3(gen.random_float(-1.f, 1.f), gen.random_float(-1.f, 1.f), gen.random_float(-1.f, 1.f))) * 8.f;
+        const float3 target = float3(gen.random_float(-0.5f, 0.5f), gen.random_float(-0.5f, 0.5f), gen.random_float(-0.5f, 0.5f));
+        const ray r(origin, normalize(target - origin));
+
+        float brute_t = 0, bvh_t = 0;
+        float3 brute_n, bvh_n;
+        float2 brute_uv, bvh_uv;
+
+        timer.start(); const bool brute_hit = intersect_ray_mesh(r, mesh, &brute_t, &brute_n, &brute_uv); timer.stop(); brute_ms += timer.get();
+        timer.start(); const bool bvh_hit = intersect_ray_mesh(r, mesh, accelerator, &bvh_t, &bvh_n, &bvh_uv); timer.stop(); bvh_ms += timer.get();
+
+        REQUIRE(brute_hit == bvh_hit);
+        if (!brute_hit) continue;
+        REQUIRE(bvh_t == doctest::Approx(brute_t).epsilon(0.0001));
+        ++num_hits;
+
+        // Closest-hit pruning: nothing closer than the hit, and the hit itself is found within max_t
+        mesh_hit hit;
+        REQUIRE_FALSE(accelerator.intersect(r, hit, bvh_t * 0.99f));
+        REQUIRE(accelerator.intersect(r, hit, bvh_t * 1.01f));
+    }
+
+    REQUIRE(num_hits > 0);
+    std::cout << "256 rays, " << num_hits << " hits - brute force: " << brute_ms << "ms, mesh_bvh: " << bvh_ms << "ms" << std::endl;
+}
+
+TEST_CASE("watertight ray triangle intersection")
+{
+    // A flat grid of unit cells split along the diagonal. Rays aimed exactly at vertices and edges
+    // shared between triangles must never fall through the seams.
+    const uint32_t n = 32;
+    geometry grid;
+    for (uint32_t y = 0; y <= n; ++y) for (uint32_t x = 0; x <= n; ++x) grid.vertices.push_back({ float(x), float(y), 0.f });
+    for (uint32_t y = 0; y < n; ++y)
+    {
+        for (uint32_t x = 0; x < n; ++x)
+        {
+            const uint32_t i = y * (n + 1) + x;
+            grid.faces.push_back({ i, i + 1, i + n + 2 });
+            grid.faces.push_back({ i, i + n + 2, i + n + 1 });
+        }
+    }
+
+    mesh_bvh accelerator;
+    accelerator.build(grid);
+
+    const float3 directions[] = { float3(0, 0, -1), normalize(float3(0.3f, -0.2f, -1.f)), normalize(float3(-1.f, 1.f, -0.5f)) };
+    for (const float3 & d : directions)
+    {
+        for (uint32_t y = 1; y < n; ++y)
+        {
+            for (uint32_t x = 1; x < n; ++x)
+            {
+                const float3 targets[] = { float3(float(x), float(y), 0), float3(x + 0.5f, float(y), 0), float3(x + 0.5f, y + 0.5f, 0) };
+                for (const float3 & target : targets)
+                {
+                    const ray r(target - d * 4.f, d);
+                    mesh_hit hit;
+                    REQUIRE(accelerator.intersect(r, hit));
+                    REQUIRE(hit.t == doctest::Approx(4.f).epsilon(0.001));
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("dynamic_bvh insert, remove and update")
+{
+    uniform_random_gen gen;
+
+    auto random_box = [&](const float3 & center)
+    {
+        const float3 half_size = float3(gen.random_float(0.1f, 2.f), gen.random_float(0.1f, 2.f), gen.random_float(0.1f, 2.f));
+        return aabb_3d(center - half_size, center + half_size);
+    };
+    auto random_point = [&]() { return float3(gen.random_float(-200.f, 200.f), gen.random_float(-200.f, 200.f), gen.random_float(-200.f, 200.f)); };
+
+    std::vector<bvh_node_data> objects(10000);
+    std::vector<uint32_t> proxies(objects.size(), dynamic_bvh::kNull);
+    for (auto & o : objects) { o.bounds = random_box(random_point()); o.user_data = nullptr; }
+
+    dynamic_bvh tree;
+    {
+        scoped_timer t("dynamic_bvh insert (10k objects)");
+        for (size_t i = 0; i < objects.size(); ++i) proxies[i] = tree.insert(&objects[i]);
+    }
+    REQUIRE(tree.size() == objects.size());
+    REQUIRE(tree.validate());
+
+    // Remove every third object, then move everything that is left
+    for (size_t i = 0; i < objects.size(); i += 3) { tree.remove(proxies[i]); proxies[i] = dynamic_bvh::kNull; }
+    REQUIRE(tree.validate());
+
+    uint32_t reinserted = 0;
+    {
+        scoped_timer t("dynamic_bvh update (6.6k objects)");
+        for (size_t i = 0; i < objects.size(); ++i)
+        {
+            if (proxies[i] == dynamic_bvh::kNull) continue;
+            const float3 offset = (i % 2) ? float3(0.01f, 0, 0) : random_point() * 0.1f; // small jitter vs. large moves
+            objects[i].bounds = aabb_3d(objects[i].bounds.min() + offset, objects[i].bounds.max() + offset);
+            if (tree.update(proxies[i])) ++reinserted;
+        }
+    }
+    REQUIRE(tree.validate());
+    REQUIRE(reinserted < tree.size()); // jittered objects stay inside their fattened leaves
+
+    // Queries match a brute-force scan of the live objects
+    for (int k = 0; k < 256; ++k)
+    {
+        const ray r(random_point() * 2.f, normalize(random_point()));
+
+        std::vector<std::pair<bvh_node_data*, float>> hits;
+        tree.intersect(r, hits);
+
+        std::vector<bvh_node_data*> found, expected;
+        for (auto & h : hits) found.push_back(h.first);
+        for (size_t i = 0; i < objects.size(); ++i)
+        {
+            if (proxies[i] != dynamic_bvh::kNull && intersect_ray_box(r, objects[i].bounds.min(), objects[i].bounds.max())) expected.push_back(&objects[i]);
+        }
+        std::sort(found.begin(), found.end());
+        std::sort(expected.begin(), expected.end());
+        REQUIRE(found == expected);
+    }
+
+    // The flattened tree collapses into a wide tree whose packet traversal gives the same hits
+    {
+        std::vector<bvh_flat_node> flat;
+        std::vector<bvh_node_data *> flat_objects;
+        tree.flatten(flat, flat_objects);
+        REQUIRE(flat_objects.size() == tree.size());
+
+        bvh8_tree wide;
+        wide.build(flat, flat_objects);
+
+        std::vector<ray> rays;
+        for (int k = 0; k < 256; ++k) rays.push_back(ray(random_point() * 2.f, normalize(random_point())));
+
+        std::vector<std::vector<std::pair<bvh_node_data*, float>>> packet_hits;
+        wide.intersect(rays, packet_hits);
+        for (size_t k = 0; k < rays.size(); ++k)
+        {
+            std::vector<std::pair<bvh_node_data*, float>> hits;
+            tree.intersect(rays[k], hits);
+            REQUIRE(packet_hits[k] == hits);
+        }
+    }
+
+    // Incremental insertion with rotations stays within reach of a top-down SAH build
+    std::vector<bvh_node_data *> live;
+    for (size_t i = 0; i < objects.size(); ++i) if (proxies[i] != dynamic_bvh::kNull) live.push_back(&objects[i]);
+
+    dynamic_bvh bulk;
+    std::vector<uint32_t> bulk_proxies;
+    bulk.build(live, bulk_proxies);
+    REQUIRE(bulk.validate());
+    REQUIRE(bulk.size() == tree.size());
+    std::cout << "dynamic_bvh sah cost - incremental: " << tree.compute_sah_cost() << " (height " << tree.compute_height() << ")"
+              << ", bulk: " << bulk.compute_sah_cost() << " (height " << bulk.compute_height() << ")" << std::endl;
+    REQUIRE(tree.compute_sah_cost() < bulk.compute_sah_cost() * 2.f);
+
+    // World bounds from a cached local box match bounds of the transformed vertices
+    const aabb_3d local(float3(-1, -2, -0.5f), float3(3, 1, 0.5f));
+    const transform pose(make_rotation_quat_axis_angle(normalize(float3(0.3f, -0.2f, 0.5f)), 0.8f), float3(10, -4, 2));
+    const float3 scale(2.f, 0.5f, 3.f);
+    aabb_3d expected(float3(std::numeric_limits<float>::max()), float3(-std::numeric_limits<float>::max()));
+    for (int c = 0; c < 8; ++c)
+    {
+        const float3 corner((c & 1) ? local.max().x : local.min().x, (c & 2) ? local.max().y : local.min().y, (c & 4) ? local.max().z : local.min().z);
+        expected.surround(pose.transform_coord(corner * scale));
+    }
+    const aabb_3d world = transform_bounds(local, pose, scale);
+    for (int a = 0; a < 3; ++a)
+    {
+        REQUIRE(world.min()[a] == doctest::Approx(expected.min()[a]).epsilon(0.0001));
+        REQUIRE(world.max()[a] == doctest::Approx(expected.max()[a]).epsilon(0.0001));
+    }
+}
+
+TEST_CASE("bvh_tree lbvh build with parallel morton sort")
+{
+    uniform_random_gen gen;
+
+    // Large enough to take the radix sort path (kMortonRadixThreshold); hit counts are checked against brute force
+    std::vector<bvh_node_data> objects(70000);
+    for (auto & o : objects)
+    {
+        const float3 center(gen.random_float(-1000.f, 1000.f), gen.random_float(-1000.f, 1000.f), gen.random_float(-50.f, 50.f));
+        o.bounds = aabb_3d(center - float3(0.5f), center + float3(0.5f));
+        o.user_data = nullptr;
+    }
+
+    bvh_tree tree(bvh_build_mode::lbvh);
+    for (auto & o : objects) tree.add(&o);
+    {
+        scoped_timer t("lbvh build (70k objects)");
+        tree.build();
+    }
+    REQUIRE(tree.get_flat_objects().size() == objects.size());
+
+    for (int i = 0; i < 64; ++i)
+    {
+        const ray r(float3(gen.random_float(-1000.f, 1000.f), gen.random_float(-1000.f, 1000.f), 200.f), normalize(float3(gen.random_float(-0.2f, 0.2f), gen.random_float(-0.2f, 0.2f), -1.f)));
+
+        std::vector<std::pair<bvh_node_data*, float>> hits;
+        tree.intersect(r, hits);
+
+        size_t expected = 0;
+        for (auto & o : objects) if (intersect_ray_box(r, o.bounds.min(), o.bounds.max())) ++expected;
+        REQUIRE(hits.size() == expected);
+    }
 }
 
 TEST_CASE("guid to and from string")